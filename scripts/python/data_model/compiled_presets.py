@@ -0,0 +1,124 @@
+# Writes a preset as C++ that fills an HPWHSimInput directly, so that it is not decoded at run time.
+#
+# Each member present in the JSON is assigned, and its *_is_set flag raised, as from_json would.
+# Number lists, such as performance-map grids, become constexpr arrays. Enumerations and the
+# types of polymorphic members are found from the keys below.
+
+# members holding enumerations, whose values name enumerators
+ENUM_KEYS = {
+	"system_type",
+	"heat_source_type",
+	"heating_logic_type",
+	"comparison_type",
+	"coil_configuration",
+	"control_type",
+	"standby_temperature_location",
+}
+
+# polymorphic members: the member giving the type, and the type for each of its values
+POLYMORPHIC_MEMBERS = {
+	"heat_source": ("heat_source_type", {
+		"CONDENSER": "hpwh_data_model::rscondenserwaterheatsource::RSCONDENSERWATERHEATSOURCE",
+		"RESISTANCE": "hpwh_data_model::rsresistancewaterheatsource::RSRESISTANCEWATERHEATSOURCE",
+		"AIRTOWATERHEATPUMP": "hpwh_data_model::rsairtowaterheatpump::RSAIRTOWATERHEATPUMP",
+	}),
+	"heating_logic": ("heating_logic_type", {
+		"TEMPERATURE_BASED": "hpwh_data_model::heat_source_configuration::TemperatureBasedHeatingLogic",
+		"STATE_OF_CHARGE_BASED": "hpwh_data_model::heat_source_configuration::StateOfChargeBasedHeatingLogic",
+	}),
+}
+
+VALUES_PER_LINE = 8
+
+def cpp_string(text):
+	"""A C++ string literal; other than printable ASCII is written as octal escapes."""
+	literal = '"'
+	for byte in text.encode('utf-8'):
+		if byte in b'"\\':
+			literal += '\\' + chr(byte)
+		elif 32 <= byte < 127:
+			literal += chr(byte)
+		else:
+			literal += f"\\{byte:03o}"
+	return literal + '"'
+
+def cpp_double(value):
+	# repr gives the shortest text that reads back as the same double
+	return repr(float(value))
+
+def is_number(value):
+	return isinstance(value, (int, float)) and not isinstance(value, bool)
+
+class CompiledPreset:
+	def __init__(self, name):
+		self.name = name
+		self.arrays = []
+		self.lines = []
+
+	def write(self, depth, line):
+		self.lines.append('\t' * depth + line)
+
+	def add_array(self, values):
+		array_name = f"{self.name}_array{len(self.arrays)}"
+		rows = []
+		for i in range(0, len(values), VALUES_PER_LINE):
+			rows.append("\t" + ", ".join(cpp_double(value) for value in values[i:i + VALUES_PER_LINE]) + ",")
+		self.arrays.append({'name': array_name, 'size': len(values), 'text': "\n".join(rows)})
+		return array_name
+
+	def scalar(self, key, member, value):
+		if isinstance(value, bool):
+			return "true" if value else "false"
+		if isinstance(value, int):
+			return str(value)
+		if isinstance(value, float):
+			return cpp_double(value)
+		if key in ENUM_KEYS:
+			# list elements are named by subscript, whose decltype is a reference
+			return f"std::remove_reference_t<decltype({member})>::{value}"
+		return cpp_string(value)
+
+	def write_object(self, j, target, depth):
+		for key, value in j.items():
+			member = f"{target}.{key}"
+			if key in POLYMORPHIC_MEMBERS and isinstance(value, dict):
+				type_key, types = POLYMORPHIC_MEMBERS[key]
+				self.write(depth, "{")
+				self.write(depth + 1, f"auto p{depth} = std::make_unique<{types[j[type_key]]}>();")
+				self.write(depth + 1, f"auto& o{depth} = *p{depth};")
+				self.write_object(value, f"o{depth}", depth + 1)
+				self.write(depth + 1, f"{member} = std::move(p{depth});")
+				self.write(depth, "}")
+			elif isinstance(value, dict):
+				self.write(depth, "{")
+				self.write(depth + 1, f"auto& o{depth} = {member};")
+				self.write_object(value, f"o{depth}", depth + 1)
+				self.write(depth, "}")
+			elif isinstance(value, list):
+				self.write_list(key, member, value, depth)
+			else:
+				self.write(depth, f"{member} = {self.scalar(key, member, value)};")
+			self.write(depth, f"{member}_is_set = true;")
+
+	def write_list(self, key, member, values, depth):
+		if not values:
+			self.write(depth, f"{member}.clear();")
+		elif all(is_number(value) for value in values):
+			array_name = self.add_array(values)
+			self.write(depth, f"{member}.assign(std::begin({array_name}), std::end({array_name}));")
+		elif all(isinstance(value, dict) for value in values):
+			self.write(depth, f"{member}.resize({len(values)});")
+			for i, value in enumerate(values):
+				self.write(depth, "{")
+				self.write(depth + 1, f"auto& o{depth} = {member}[{i}];")
+				self.write_object(value, f"o{depth}", depth + 1)
+				self.write(depth, "}")
+		else:
+			items = ", ".join(self.scalar(key, f"{member}[0]", value) for value in values)
+			self.write(depth, f"{member} = {{{items}}};")
+
+def compiled_preset(name, json_data):
+	"""The constexpr arrays, and the body of a function filling 'hsi', for a preset."""
+	preset = CompiledPreset(name)
+	preset.write_object(json_data, "hsi", 1)
+	return preset.arrays, "\n".join(preset.lines)
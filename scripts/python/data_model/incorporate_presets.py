@@ -1,7 +1,8 @@
-# uv run incorporate_presets.py JSON ../../../build ../../../test/models_json/models.json
+# uv run incorporate_presets.py JSON ../../../build ../../../test/models_json/models.json [--compiled]
 
 # calls `hpwh convert' for each model in models_list_file json,
-# then creates a C++ header file containing that data.
+# then creates a C++ header file containing that data:
+# by default, as CBOR; with --compiled, as code that fills the HPWHSimInput directly.
 
 from pathlib import Path
 import os
@@ -9,9 +10,17 @@ import sys
 import json
 import cbor2
 
+from compiled_presets import compiled_preset
+
 from jinja2 import Environment, FileSystemLoader, select_autoescape
 
-def incorporate_presets(presets_list_file, build_dir, spec_type):
+def format_table(values, per_line = 20):
+	rows = []
+	for i in range(0, len(values), per_line):
+		rows.append("\t" + ", ".join(str(value) for value in values[i:i + per_line]) + ",")
+	return "\n".join(rows)
+
+def incorporate_presets(presets_list_file, build_dir, spec_type, compiled = False):
 
 	orig_dir = str(Path.cwd())
 	os.chdir(build_dir)
@@ -44,7 +53,7 @@ def incorporate_presets(presets_list_file, build_dir, spec_type):
 	    comment_end_string="##}",
     )
 
-	preset_model_h = env.get_template("preset_model.h.j2")
+	preset_model_h = env.get_template("preset_model_compiled.h.j2" if compiled else "preset_model.h.j2")
 	models_out = []
 	with open(presets_list_file) as json_file:
 		models_dict= json.load(json_file)
@@ -61,19 +70,25 @@ def incorporate_presets(presets_list_file, build_dir, spec_type):
 			except FileNotFoundError:
 				raise
 
-			cbor_data = cbor2.dumps(json_data)
-
 			guard_name = name.upper() + "_H"
 
-			nbytes = len(cbor_data)
-			cbor_text = ""
-			for i, entry  in enumerate(cbor_data):
-				cbor_text += hex(entry) + ", "
-				if (i % 40 == 0) and (i != 0):
-					cbor_text += "\n"
+			if compiled:
+				nbytes = 0
+				arrays, body = compiled_preset(name, json_data)
+				render_args = {'arrays': arrays, 'body': body}
+			else:
+				cbor_data = cbor2.dumps(json_data)
+
+				nbytes = len(cbor_data)
+				cbor_text = ""
+				for i, entry  in enumerate(cbor_data):
+					cbor_text += hex(entry) + ", "
+					if (i % 40 == 0) and (i != 0):
+						cbor_text += "\n"
+				render_args = {'size': nbytes, 'cbor': cbor_text}
 
 			try:
-				preset_model_header = preset_model_h.render(name = name, size = nbytes, cbor = cbor_text, guard_name = guard_name)
+				preset_model_header = preset_model_h.render(name = name, guard_name = guard_name, **render_args)
 				preset_model_header_path = os.path.join(presets_include_dir, name + ".h")
 				with open(preset_model_header_path, "w") as preset_model_header_file:
 					preset_model_header_file.write(preset_model_header )
@@ -88,7 +103,17 @@ def incorporate_presets(presets_list_file, build_dir, spec_type):
 		presets_header =  presets_h.render(models = models_out)
 
 		presets_cpp = env.get_template("presets.cpp.j2")
-		presets_implementation =  presets_cpp.render(models = models_out)
+		# lookup tables: positions sorted by name, and positions by id
+		name_order = sorted(range(len(models_out)), key = lambda i: models_out[i]['name'])
+		name_index = format_table(name_order)
+		max_id = max(int(model['number']) for model in models_out)
+		id_positions = [-1] * (max_id + 1)
+		for i, model in enumerate(models_out):
+			id_positions[int(model['number'])] = i
+		id_index = format_table(id_positions)
+
+		presets_implementation =  presets_cpp.render(models = models_out, compiled = compiled,
+			name_index = name_index, max_id = max_id, id_index = id_index)
 
 		try:
 			with open(os.path.join(presets_dir, "presets.h"), "w") as presets_header_file:
@@ -106,16 +131,18 @@ def incorporate_presets(presets_list_file, build_dir, spec_type):
 
 # main
 if __name__ == "__main__":
-	n_args = len(sys.argv) - 1
+	compiled = "--compiled" in sys.argv
+	args = [arg for arg in sys.argv if arg != "--compiled"]
+	n_args = len(args) - 1
 
 	if n_args > 1:
-		spec_type = sys.argv[1]
-		build_dir = sys.argv[2]
+		spec_type = args[1]
+		build_dir = args[2]
 
 		# presets_list_files = []
 		# for i in range(3, n_args + 1):
 		# 	presets_list_files.append(sys.argv[i])
-		presets_list_files = sys.argv[3]
+		presets_list_files = args[3]
 
-		incorporate_presets(presets_list_files, build_dir, spec_type)
+		incorporate_presets(presets_list_files, build_dir, spec_type, compiled)
 
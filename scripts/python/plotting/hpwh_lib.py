@@ -0,0 +1,119 @@
+# Calls HPWHsim in-process through its C interface (build with -DHPWHsim_BUILD_C_API=ON).
+# Schedules and results are NumPy arrays; no files are written.
+
+import os
+import sys
+import ctypes
+import json
+import numpy as np
+from pathlib import Path
+
+_double_p = ctypes.POINTER(ctypes.c_double)
+_int_p = ctypes.POINTER(ctypes.c_int)
+
+#
+def find_library(build_dir):
+	names = {'win32': 'HPWHsim_c.dll', 'darwin': 'libHPWHsim_c.dylib'}
+	name = names.get(sys.platform, 'libHPWHsim_c.so')
+	for subdir in ['src', os.path.join('src', 'Release'), os.path.join('src', 'Debug')]:
+		path = Path(build_dir) / subdir / name
+		if path.exists():
+			return str(path)
+	raise FileNotFoundError(f"{name} not found in {build_dir}")
+
+#
+def load_library(build_dir):
+	lib = ctypes.CDLL(find_library(build_dir))
+
+	lib.hpwh_create.restype = ctypes.c_void_p
+	lib.hpwh_create.argtypes = []
+	lib.hpwh_destroy.argtypes = [ctypes.c_void_p]
+	lib.hpwh_last_message.restype = ctypes.c_char_p
+	lib.hpwh_last_message.argtypes = [ctypes.c_void_p]
+	lib.hpwh_init_preset.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+	lib.hpwh_init_json.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p]
+	lib.hpwh_get_num_nodes.argtypes = [ctypes.c_void_p]
+	lib.hpwh_get_num_heat_sources.argtypes = [ctypes.c_void_p]
+	lib.hpwh_run.argtypes = [ctypes.c_void_p, ctypes.c_size_t] + 4 * [_double_p] + [_int_p] + 4 * [_double_p]
+	lib.hpwh_measure.argtypes = [ctypes.c_void_p, ctypes.c_uint, ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t)]
+	lib.hpwh_last_report.restype = ctypes.c_char_p
+	lib.hpwh_last_report.argtypes = [ctypes.c_void_p]
+	lib.hpwh_get_state.restype = ctypes.c_void_p
+	lib.hpwh_get_state.argtypes = [ctypes.c_void_p]
+	lib.hpwh_set_state.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+	lib.hpwh_destroy_state.argtypes = [ctypes.c_void_p]
+	return lib
+
+#
+def _as_double_p(array):
+	return None if array is None else array.ctypes.data_as(_double_p)
+
+#
+class Model:
+	def __init__(self, lib, model_spec, model_id_or_filepath):
+		self.lib = lib
+		self.handle = lib.hpwh_create()
+		if not self.handle:
+			raise MemoryError("Unable to create a model.")
+		if model_spec == 'JSON':
+			with open(model_id_or_filepath) as json_file:
+				json_text = json_file.read()
+			model_name = Path(model_id_or_filepath).stem
+			self._check(lib.hpwh_init_json(self.handle, json_text.encode(), model_name.encode()))
+		else:
+			self._check(lib.hpwh_init_preset(self.handle, model_id_or_filepath.encode()))
+
+	def __del__(self):
+		if getattr(self, 'handle', None):
+			self.lib.hpwh_destroy(self.handle)
+
+	def _check(self, status):
+		if status != 0:
+			raise RuntimeError(self.lib.hpwh_last_message(self.handle).decode())
+
+	# Runs one-minute steps; returns a dict of arrays: energy input and output (kWh) by step and
+	# heat source, outlet temperature (C) by step, and tank temperatures (C) by step and node.
+	def run(self, inlet_T_C, draw_volume_L, ambient_T_C, external_T_C, dr_status = None, save_tank_T = False):
+		inputs = [np.ascontiguousarray(x, dtype = np.float64) for x in [inlet_T_C, draw_volume_L, ambient_T_C, external_T_C]]
+		n_steps = min(len(x) for x in inputs)
+		n_heat_sources = self.lib.hpwh_get_num_heat_sources(self.handle)
+		results = {
+			'energy_input_kWh': np.zeros((n_steps, n_heat_sources)),
+			'energy_output_kWh': np.zeros((n_steps, n_heat_sources)),
+			'outlet_T_C': np.zeros(n_steps)}
+		if save_tank_T:
+			results['tank_T_C'] = np.zeros((n_steps, self.lib.hpwh_get_num_nodes(self.handle)))
+
+		dr_array = None if dr_status is None else np.ascontiguousarray(dr_status, dtype = np.intc)
+		if dr_array is not None and len(dr_array) != n_steps:
+			raise ValueError(f"dr_status has {len(dr_array)} values for {n_steps} steps")
+		self._check(self.lib.hpwh_run(self.handle, n_steps,
+			*[_as_double_p(x) for x in inputs],
+			None if dr_array is None else dr_array.ctypes.data_as(_int_p),
+			_as_double_p(results['energy_input_kWh']),
+			_as_double_p(results['energy_output_kWh']),
+			_as_double_p(results['outlet_T_C']),
+			_as_double_p(results.get('tank_T_C'))))
+		return results
+
+	# First-hour rating and the E50, UEF, and E95 24-hr tests
+	def measure(self, n_threads = 0):
+		# the report is kept by the model, so no buffer need be sized in advance
+		self._check(self.lib.hpwh_measure(self.handle, n_threads, None, 0, None))
+		return json.loads(self.lib.hpwh_last_report(self.handle).decode())
+
+	def get_state(self):
+		return ModelState(self.lib, self.lib.hpwh_get_state(self.handle))
+
+	def set_state(self, state):
+		self._check(self.lib.hpwh_set_state(self.handle, state.handle))
+
+#
+class ModelState:
+	def __init__(self, lib, handle):
+		self.lib = lib
+		self.handle = handle
+
+	def __del__(self):
+		if getattr(self, 'handle', None):
+			self.lib.hpwh_destroy_state(self.handle)
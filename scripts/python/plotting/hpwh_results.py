@@ -0,0 +1,75 @@
+# Loads results written by 'hpwh run --binary' (.hpwhr) without parsing text.
+#
+# The layout is described in src/HPWHResults.hh. Columns are mapped with numpy.memmap; a file
+# of a single block (up to 16384 rows) is not copied at all, and longer files are copied once,
+# when their blocks are joined.
+
+import sys
+import numpy as np
+
+HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('n_columns', '<u4'), ('reserved', '<u8', 2)])
+COLUMN = np.dtype([('name', 'S44'), ('units', 'S12'), ('type', 'S4'), ('item_size', '<u4')])
+TRAILER = np.dtype([('index_offset', '<u8'), ('n_blocks', '<u8'), ('magic', 'S8')])
+BLOCK = np.dtype([('offset', '<u8'), ('n_rows', '<u8')])
+
+def is_results_file(path):
+	return str(path).endswith(".hpwhr")
+
+def read_columns(path):
+	"""Returns the column descriptions and the block index."""
+	header = np.fromfile(path, dtype = HEADER, count = 1)[0]
+	if header['magic'] != b'HPWHRES' or header['version'] != 1:
+		raise ValueError(f"{path} is not a results file")
+	columns = np.fromfile(path, dtype = COLUMN, count = header['n_columns'], offset = HEADER.itemsize)
+
+	file_size = np.memmap(path, dtype = np.uint8, mode = 'r').size
+	trailer = np.fromfile(path, dtype = TRAILER, count = 1, offset = file_size - TRAILER.itemsize)[0]
+	if trailer['magic'] != b'HPWHIDX':
+		raise ValueError(f"{path} has no index; it may not have been closed")
+	blocks = np.fromfile(path, dtype = BLOCK, count = trailer['n_blocks'], offset = trailer['index_offset'])
+	return columns, blocks
+
+def read_results(path, names = None):
+	"""Returns a dict of numpy arrays, by column name, and a dict of units."""
+	columns, blocks = read_columns(path)
+	values = {}
+	units = {}
+	for block in blocks:
+		n_rows = int(block['n_rows'])
+		offset = int(block['offset'])
+		for column in columns:
+			name = column['name'].decode()
+			size = n_rows * int(column['item_size'])
+			if names is None or name in names:
+				view = np.memmap(path, dtype = np.dtype(column['type'].decode()), mode = 'r', offset = offset, shape = (n_rows,))
+				values.setdefault(name, []).append(view)
+				units[name] = column['units'].decode()
+			offset += (size + 7) // 8 * 8
+
+	for column in columns:
+		name = column['name'].decode()
+		if name not in values and (names is None or name in names):
+			values[name] = [np.empty(0, dtype = np.dtype(column['type'].decode()))]
+			units[name] = column['units'].decode()
+
+	for name in values:
+		values[name] = values[name][0] if len(values[name]) == 1 else np.concatenate(values[name])
+	return values, units
+
+def read_results_df(path, names = None):
+	"""As read_results, in a pandas DataFrame with the columns of the CSV output."""
+	import pandas as pd  # type: ignore
+	values, _ = read_results(path, names)
+	return pd.DataFrame(values)
+
+# main
+if __name__ == "__main__":
+	n_args = len(sys.argv) - 1
+	if n_args == 1:
+		columns, blocks = read_columns(sys.argv[1])
+		print(f"{int(sum(blocks['n_rows']))} rows in {len(blocks)} blocks")
+		for column in columns:
+			print(f"{column['name'].decode()} ({column['units'].decode()}): {column['type'].decode()}")
+	else:
+		print('hpwh_results arguments:')
+		print('1. results filepath (.hpwhr)')
@@ -4,8 +4,11 @@ import pandas as pd  # type: ignore
 import math
 import numpy as np
 from common import read_file, write_file, get_tank_volume
+from hpwh_results import is_results_file, read_results_df
 
 def call_csv(path, skip_rows):
+    if is_results_file(path):
+        return read_results_df(path)
     data = pd.read_csv(path, skiprows=skip_rows)
     df = pd.DataFrame(data)
     return df
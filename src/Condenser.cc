@@ -31,18 +31,29 @@ HPWH::Condenser::Condenser(HPWH* hpwh_in,
 {
 }
 
+HPWH::Condenser::Condenser(const Condenser& cond_in) : HeatSource(cond_in) { *this = cond_in; }
+
 HPWH::Condenser& HPWH::Condenser::operator=(const HPWH::Condenser& cond_in)
 {
+    if (this == &cond_in)
+    {
+        return *this;
+    }
     HPWH::HeatSource::operator=(cond_in);
 
     Tshrinkage_C = cond_in.Tshrinkage_C;
     lockedOut = cond_in.lockedOut;
 
+    perfPolySet = cond_in.perfPolySet;
     perfRGI = cond_in.perfRGI;
     evaluatePerformance = cond_in.evaluatePerformance;
+    bindPerformance();
 
+    doDefrost = cond_in.doDefrost;
     defrostMap = cond_in.defrostMap;
     resDefrost = cond_in.resDefrost;
+    maxOut_at_LowT = cond_in.maxOut_at_LowT;
+    standbyPower_kW = cond_in.standbyPower_kW;
 
     configuration = cond_in.configuration;
     isMultipass = cond_in.isMultipass;
@@ -65,6 +76,25 @@ HPWH::Condenser& HPWH::Condenser::operator=(const HPWH::Condenser& cond_in)
     return *this;
 }
 
+std::shared_ptr<HPWH::HeatSource> HPWH::Condenser::clone(HPWH* hpwh_in) const
+{
+    auto condenser = std::make_shared<Condenser>(*this);
+    condenser->setOwner(hpwh_in);
+
+    // btwxt interpolators hold the current target, so copies cannot share one
+    if (perfRGI)
+        condenser->perfRGI = std::make_shared<Btwxt::RegularGridInterpolator>(*perfRGI);
+    return condenser;
+}
+
+void HPWH::Condenser::bindPerformance()
+{
+    if (auto btwxtEvaluator = evaluatePerformance.target<BtwxtEvaluator>())
+        btwxtEvaluator->condenser = this;
+    else if (auto polyEvaluator = evaluatePerformance.target<PerformancePoly_CWHS_SP::Evaluator>())
+        polyEvaluator->condenser = this;
+}
+
 bool HPWH::Condenser::toLockOrUnlock(double heatSourceAmbientT_C)
 {
     if (shouldLockOut(heatSourceAmbientT_C))
@@ -889,11 +919,31 @@ void HPWH::Condenser::addHeat(double externalT_C, double minutesToRun)
     case CONFIG_WRAPPED:
     {
         // calculate capacity btu/hr, input btu/hr, and cop
-        hpwh->condenserInlet_C = getTankTemp();
-        performance = getPerformance(externalT_C, getTankTemp());
+        double condenserT_C = getTankTemp();
+        hpwh->condenserInlet_C = condenserT_C;
+        performance = getPerformance(externalT_C, condenserT_C);
         double cap_kJ = W_TO_KW(performance.outputPower_W) * (60. * minutesToRun);
 
-        auto leftoverCap_kJ = heat(cap_kJ, maxSetpoint_C);
+        // derivatives, if tracked, follow the same steps
+        const bool hasGradients = hpwh->tank->tracksGradients();
+        Gradient inputPowerGradient_W, leftoverCapGradient_kJ;
+        if (hasGradients)
+        {
+            Gradient outputPowerGradient_W;
+            getPerformanceGradient(externalT_C,
+                                   condenserT_C,
+                                   getTankTempGradient(),
+                                   inputPowerGradient_W,
+                                   outputPowerGradient_W);
+            leftoverCapGradient_kJ =
+                (60. * minutesToRun / 1000.) * outputPowerGradient_W +
+                (60. * W_TO_KW(performance.outputPower_W)) *
+                    hpwh->sensitivity->heatingTimeGradient_min;
+        }
+        Gradient capGradient_kJ = leftoverCapGradient_kJ;
+
+        auto leftoverCap_kJ =
+            heat(cap_kJ, maxSetpoint_C, hasGradients ? &leftoverCapGradient_kJ : nullptr);
 
         // compute actual runtime
         runtime_min = (1. - leftoverCap_kJ / cap_kJ) * minutesToRun;
@@ -906,6 +956,17 @@ void HPWH::Condenser::addHeat(double externalT_C, double minutesToRun)
         hpwh->condenserOutlet_C = getTankTemp();
         energyInput_kWh += W_TO_KW(performance.inputPower_W) * (runtime_min / min_per_hr);
         energyOutput_kWh += W_TO_KW(performance.outputPower_W) * (runtime_min / min_per_hr);
+
+        if (hasGradients)
+        {
+            runtimeGradient_min =
+                (1. - leftoverCap_kJ / cap_kJ) * hpwh->sensitivity->heatingTimeGradient_min -
+                (minutesToRun / cap_kJ) *
+                    (leftoverCapGradient_kJ - (leftoverCap_kJ / cap_kJ) * capGradient_kJ);
+            hpwh->sensitivity->stepInputGradient_kJ +=
+                (60. * runtime_min / 1000.) * inputPowerGradient_W +
+                (60. * W_TO_KW(performance.inputPower_W)) * runtimeGradient_min;
+        }
         break;
     }
 
@@ -927,7 +988,7 @@ void HPWH::Condenser::addHeat(double externalT_C, double minutesToRun)
     }
 }
 
-HPWH::Performance HPWH::Condenser::getPerformance(double externalT_C, double condenserT_C) const
+bool HPWH::Condenser::adjustEvaluationTemps(double& externalT_C, double& condenserT_C) const
 {
     bool resDefrostHeatingOn = false;
 
@@ -944,6 +1005,12 @@ HPWH::Performance HPWH::Condenser::getPerformance(double externalT_C, double con
             resDefrostHeatingOn = true;
         }
     }
+    return resDefrostHeatingOn;
+}
+
+HPWH::Performance HPWH::Condenser::getPerformance(double externalT_C, double condenserT_C) const
+{
+    bool resDefrostHeatingOn = adjustEvaluationTemps(externalT_C, condenserT_C);
 
     auto performance = evaluatePerformance(externalT_C, condenserT_C);
     performance.inputPower_W *= inputPowerScale;
@@ -986,6 +1053,42 @@ HPWH::Performance HPWH::Condenser::getPerformance(double externalT_C, double con
     return performance;
 }
 
+void HPWH::Condenser::getPerformanceGradient(double externalT_C,
+                                             double condenserT_C,
+                                             const Gradient& condenserTGradient_C,
+                                             Gradient& inputPowerGradient_W,
+                                             Gradient& outputPowerGradient_W) const
+{
+    // getPerformance scales the polynomial input power and COP by factors that do not depend on
+    // the condenser temperature, then adds any resistance-defrost input, which is fixed
+    auto& sensitivity = *hpwh->sensitivity;
+    adjustEvaluationTemps(externalT_C, condenserT_C);
+    auto performance = sensitivity.perfPolySet->evaluate(externalT_C, condenserT_C);
+
+    Gradient copGradient;
+    double inputPowerSlope_WperC, copSlope_perC;
+    sensitivity.perfPolySet->getGradient(externalT_C,
+                                         condenserT_C,
+                                         sensitivity.coefficients,
+                                         inputPowerGradient_W,
+                                         copGradient,
+                                         inputPowerSlope_WperC,
+                                         copSlope_perC);
+    inputPowerGradient_W += inputPowerSlope_WperC * condenserTGradient_C;
+    copGradient += copSlope_perC * condenserTGradient_C;
+
+    double copFactor = COP_scale;
+    if (doDefrost)
+        defrostDerate(copFactor, C_TO_F(externalT_C));
+    if (airflowFreedom != 1)
+        copFactor *= 0.00056 * (375 * airflowFreedom) + 0.79;
+
+    inputPowerGradient_W *= inputPowerScale;
+    copGradient *= copFactor;
+    outputPowerGradient_W = (copFactor * performance.cop) * inputPowerGradient_W +
+                            (inputPowerScale * performance.inputPower_W) * copGradient;
+}
+
 void HPWH::Condenser::setupDefrostMap(double derate35 /*=0.8865*/)
 {
     doDefrost = true;
@@ -1036,6 +1139,23 @@ void HPWH::Condenser::calcHeatDist(std::vector<double>& heatDistribution)
     }
 }
 
+void HPWH::Condenser::calcHeatDistGradient(std::vector<Gradient>& heatDistributionGradient)
+{
+    if (configuration == CONFIG_WRAPPED)
+    {
+        calcThermalDistGradient(heatDistributionGradient,
+                                Tshrinkage_C,
+                                lowestNode,
+                                hpwh->tank->nodeTs_C,
+                                hpwh->tank->nodeTGradients_C,
+                                hpwh->setpoint_C);
+    }
+    else
+    {
+        HPWH::HeatSource::calcHeatDistGradient(heatDistributionGradient);
+    }
+}
+
 //-----------------------------------------------------------------------------
 ///	@brief	Add external heat for a single-pass configuration.
 /// @param[in]	externalT_C	        external temperature
@@ -1053,6 +1173,12 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
 
     double setpointT_C = std::min(maxSetpoint_C, hpwh->setpoint_C);
     double remainingTime_min = stepTime_min;
+
+    // derivatives, if tracked, follow each step; untracked ones are empty
+    const bool hasGradients = hpwh->tank->tracksGradients();
+    Gradient remainingTimeGradient_min;
+    if (hasGradients)
+        remainingTimeGradient_min = hpwh->sensitivity->heatingTimeGradient_min;
     do
     {
         double& externalOutletT_C = hpwh->tank->nodeTs_C[externalOutletHeight];
@@ -1060,6 +1186,17 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
         // how much heat is available in remaining time
         auto tempPerformance = getPerformance(externalT_C, externalOutletT_C);
 
+        Gradient outletTGradient_C, inputPowerGradient_W, outputPowerGradient_W;
+        if (hasGradients)
+        {
+            outletTGradient_C = hpwh->tank->nodeTGradients_C[externalOutletHeight];
+            getPerformanceGradient(externalT_C,
+                                   externalOutletT_C,
+                                   outletTGradient_C,
+                                   inputPowerGradient_W,
+                                   outputPowerGradient_W);
+        }
+
         double heatingPower_kW = W_TO_KW(tempPerformance.outputPower_W);
 
         double targetT_C = setpointT_C;
@@ -1074,19 +1211,28 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
 
         // maximum heat that can be added in remaining time
         double heatingCapacity_kJ = heatingPower_kW * (remainingTime_min * sec_per_min);
+        Gradient heatingCapacityGradient_kJ =
+            (remainingTime_min * sec_per_min / 1000.) * outputPowerGradient_W +
+            (heatingPower_kW * sec_per_min) * remainingTimeGradient_min;
 
         // heat for outlet node to reach target temperature
         double nodeHeat_kJ = hpwh->tank->nodeCp_kJperC * deltaT_C;
+        Gradient nodeHeatGradient_kJ = -hpwh->tank->nodeCp_kJperC * outletTGradient_C;
 
         // assume one node will be heated this pass
         double neededHeat_kJ = nodeHeat_kJ;
+        Gradient neededHeatGradient_kJ = nodeHeatGradient_kJ;
 
         // reduce node fraction to heat if limited by capacity
         double nodeFrac = 1.;
+        Gradient nodeFracGradient;
         if (heatingCapacity_kJ < nodeHeat_kJ)
         {
             nodeFrac = heatingCapacity_kJ / nodeHeat_kJ;
             neededHeat_kJ = heatingCapacity_kJ;
+            nodeFracGradient =
+                (heatingCapacityGradient_kJ - nodeFrac * nodeHeatGradient_kJ) / nodeHeat_kJ;
+            neededHeatGradient_kJ = heatingCapacityGradient_kJ;
         }
 
         // limit node fraction to heat by comparison criterion
@@ -1095,18 +1241,29 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
         {
             nodeFrac = fractToShutOff;
             neededHeat_kJ = nodeFrac * nodeHeat_kJ;
+            if (hasGradients)
+                nodeFracGradient = fractToMeetComparisonExternalGradient();
+            neededHeatGradient_kJ = nodeHeat_kJ * nodeFracGradient + nodeFrac * nodeHeatGradient_kJ;
         }
 
         // heat for less than remaining time if full capacity will not be used
         double heatingTime_min = remainingTime_min;
+        Gradient heatingTimeGradient_min = remainingTimeGradient_min;
         if (heatingCapacity_kJ > neededHeat_kJ)
         {
+            heatingTimeGradient_min =
+                (neededHeat_kJ * remainingTimeGradient_min +
+                 remainingTime_min * (neededHeatGradient_kJ - (neededHeat_kJ / heatingCapacity_kJ) *
+                                                                  heatingCapacityGradient_kJ)) /
+                heatingCapacity_kJ;
             heatingTime_min *= neededHeat_kJ / heatingCapacity_kJ;
             remainingTime_min -= heatingTime_min;
+            remainingTimeGradient_min -= heatingTimeGradient_min;
         }
         else
         {
             remainingTime_min = 0.;
+            remainingTimeGradient_min *= 0.;
         }
 
         // track the condenser temperatures before mixing nodes
@@ -1116,6 +1273,14 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
             hpwh->condenserOutlet_C += targetT_C * heatingTime_min;
         }
 
+        // the pump runs for the heating time
+        if (hasGradients)
+            hpwh->sensitivity->stepInputGradient_kJ +=
+                (60. * heatingTime_min / 1000.) * inputPowerGradient_W +
+                (60. * W_TO_KW(tempPerformance.inputPower_W +
+                               secondaryHeatExchanger.extraPumpPower_W)) *
+                    heatingTimeGradient_min;
+
         // mix with node above from outlet to inlet
         // mix inlet water at target temperature with inlet node
         for (std::size_t nodeIndex = externalOutletHeight;
@@ -1125,6 +1290,16 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
             double& mixT_C = (static_cast<int>(nodeIndex) == externalInletHeight)
                                  ? targetT_C
                                  : hpwh->tank->nodeTs_C[nodeIndex + 1];
+            if (hasGradients)
+            {
+                auto& nodeTGradients_C = hpwh->tank->nodeTGradients_C;
+                Gradient mixTGradient_C = (static_cast<int>(nodeIndex) == externalInletHeight)
+                                              ? Gradient()
+                                              : nodeTGradients_C[nodeIndex + 1];
+                nodeTGradients_C[nodeIndex] =
+                    (1. - nodeFrac) * nodeTGradients_C[nodeIndex] + nodeFrac * mixTGradient_C +
+                    (mixT_C - hpwh->tank->nodeTs_C[nodeIndex]) * nodeFracGradient;
+            }
             hpwh->tank->nodeTs_C[nodeIndex] =
                 (1. - nodeFrac) * hpwh->tank->nodeTs_C[nodeIndex] + nodeFrac * mixT_C;
         }
@@ -1150,6 +1325,9 @@ double HPWH::Condenser::addHeatExternal(double externalT_C,
     // not remainingTime_min == minutesToRun is possible
     //   must prevent divide by 0 (added 4-11-2023)
     double runTime_min = stepTime_min - remainingTime_min;
+    if (hasGradients)
+        runtimeGradient_min =
+            hpwh->sensitivity->heatingTimeGradient_min - remainingTimeGradient_min;
     if (runTime_min > 0.)
     {
         netPerformance.inputPower_W /= runTime_min;
@@ -1179,50 +1357,86 @@ double HPWH::Condenser::addHeatExternalMP(double externalT_C,
     netPerformance = {0., 0., 0.};
 
     double remainingTime_min = stepTime_min;
+
+    // derivatives, if tracked, follow each step; untracked ones are empty
+    const bool hasGradients = hpwh->tank->tracksGradients();
+    Gradient remainingTimeGradient_min;
+    if (hasGradients)
+        remainingTimeGradient_min = hpwh->sensitivity->heatingTimeGradient_min;
     do
     {
         // find node fraction to heat in remaining time
         double nodeFrac =
             mpFlowRate_LPS * (remainingTime_min * sec_per_min) / hpwh->tank->nodeVolume_L;
+        Gradient nodeFracGradient =
+            (mpFlowRate_LPS * sec_per_min / hpwh->tank->nodeVolume_L) * remainingTimeGradient_min;
         if (nodeFrac > 1.)
         { // heat no more than one node each pass
             nodeFrac = 1.;
+            nodeFracGradient.clear();
         }
 
         // mix the tank
         // apply nodeFrac as the degree of mixing (formerly 1.0)
-        hpwh->mixTankNodes(0, hpwh->getNumNodes(), nodeFrac);
+        hpwh->mixTankNodes(0, hpwh->getNumNodes(), nodeFrac, nodeFracGradient);
 
         double& externalOutletT_C = hpwh->tank->nodeTs_C[externalOutletHeight];
 
         // find heating capacity
         auto tempPerformance = getPerformance(externalT_C, externalOutletT_C);
 
+        Gradient outletTGradient_C, inputPowerGradient_W, outputPowerGradient_W;
+        if (hasGradients)
+        {
+            outletTGradient_C = hpwh->tank->nodeTGradients_C[externalOutletHeight];
+            getPerformanceGradient(externalT_C,
+                                   externalOutletT_C,
+                                   outletTGradient_C,
+                                   inputPowerGradient_W,
+                                   outputPowerGradient_W);
+        }
+
         double heatingPower_kW = W_TO_KW(tempPerformance.outputPower_W);
 
         // temperature increase at this power and flow rate
         double deltaT_C =
             heatingPower_kW / (mpFlowRate_LPS * CPWATER_kJperkgC * DENSITYWATER_kgperL);
+        Gradient deltaTGradient_C =
+            outputPowerGradient_W /
+            (1000. * mpFlowRate_LPS * CPWATER_kJperkgC * DENSITYWATER_kgperL);
 
         // find target temperature
         double targetT_C = externalOutletT_C + deltaT_C;
+        Gradient targetTGradient_C = outletTGradient_C + deltaTGradient_C;
 
         // maximum heat that can be added in remaining time
         double heatingCapacity_kJ = heatingPower_kW * (remainingTime_min * sec_per_min);
+        Gradient heatingCapacityGradient_kJ =
+            (remainingTime_min * sec_per_min / 1000.) * outputPowerGradient_W +
+            (heatingPower_kW * sec_per_min) * remainingTimeGradient_min;
 
         // heat needed to raise temperature of one node by deltaT_C
         double nodeHeat_kJ = hpwh->tank->nodeCp_kJperC * deltaT_C;
+        Gradient nodeHeatGradient_kJ = hpwh->tank->nodeCp_kJperC * deltaTGradient_C;
 
         // heat no more than one node this step
         double heatingTime_min = remainingTime_min;
+        Gradient heatingTimeGradient_min = remainingTimeGradient_min;
         if (heatingCapacity_kJ > nodeHeat_kJ)
         {
+            heatingTimeGradient_min =
+                (nodeHeat_kJ * remainingTimeGradient_min +
+                 remainingTime_min * (nodeHeatGradient_kJ - (nodeHeat_kJ / heatingCapacity_kJ) *
+                                                                heatingCapacityGradient_kJ)) /
+                heatingCapacity_kJ;
             heatingTime_min *= nodeHeat_kJ / heatingCapacity_kJ;
             remainingTime_min -= heatingTime_min;
+            remainingTimeGradient_min -= heatingTimeGradient_min;
         }
         else
         {
             remainingTime_min = 0.;
+            remainingTimeGradient_min *= 0.;
         }
 
         // track the condenser temperatures before mixing nodes
@@ -1232,6 +1446,14 @@ double HPWH::Condenser::addHeatExternalMP(double externalT_C,
             hpwh->condenserOutlet_C += targetT_C * heatingTime_min;
         }
 
+        // the pump runs for the heating time
+        if (hasGradients)
+            hpwh->sensitivity->stepInputGradient_kJ +=
+                (60. * heatingTime_min / 1000.) * inputPowerGradient_W +
+                (60. * W_TO_KW(tempPerformance.inputPower_W +
+                               secondaryHeatExchanger.extraPumpPower_W)) *
+                    heatingTimeGradient_min;
+
         // mix with node above from outlet to inlet
         // mix inlet water at target temperature with inlet node
         for (std::size_t nodeIndex = externalOutletHeight;
@@ -1241,6 +1463,17 @@ double HPWH::Condenser::addHeatExternalMP(double externalT_C,
             double& mixT_C = (static_cast<int>(nodeIndex) == externalInletHeight)
                                  ? targetT_C
                                  : hpwh->tank->nodeTs_C[nodeIndex + 1];
+            if (hasGradients)
+            {
+                auto& nodeTGradients_C = hpwh->tank->nodeTGradients_C;
+                const Gradient& mixTGradient_C =
+                    (static_cast<int>(nodeIndex) == externalInletHeight)
+                        ? targetTGradient_C
+                        : nodeTGradients_C[nodeIndex + 1];
+                nodeTGradients_C[nodeIndex] =
+                    (1. - nodeFrac) * nodeTGradients_C[nodeIndex] + nodeFrac * mixTGradient_C +
+                    (mixT_C - hpwh->tank->nodeTs_C[nodeIndex]) * nodeFracGradient;
+            }
             hpwh->tank->nodeTs_C[nodeIndex] =
                 (1. - nodeFrac) * hpwh->tank->nodeTs_C[nodeIndex] + nodeFrac * mixT_C;
         }
@@ -1263,6 +1496,9 @@ double HPWH::Condenser::addHeatExternalMP(double externalT_C,
 
     // time elapsed in this function
     double elapsedTime_min = stepTime_min - remainingTime_min;
+    if (hasGradients)
+        runtimeGradient_min =
+            hpwh->sensitivity->heatingTimeGradient_min - remainingTimeGradient_min;
     if (elapsedTime_min > 0.)
     {
         netPerformance.inputPower_W /= elapsedTime_min;
@@ -1364,42 +1600,19 @@ void HPWH::Condenser::makePerformanceBtwxt(const std::vector<std::vector<double>
     perfRGI = std::make_shared<Btwxt::RegularGridInterpolator>(
         grid_axes, perfGridValues, "RegularGridInterpolator", get_courier());
 
-    /// internal function to form target vector
-    std::function<std::vector<double>(double externalT_C, double condenserT_C)>
-        getPerformanceTarget;
-
-    if (perfGrid.size() > 2)
-    {
-        getPerformanceTarget = [this](double externalT_C, double heatSourceT_C)
-        {
-            return std::vector<double>(
-                {externalT_C,
-                 heatSourceT_C,
-                 hpwh->getSetpoint() + secondaryHeatExchanger.hotSideTemperatureOffset_dC});
-        };
-    }
-    else
-    {
-        getPerformanceTarget = [](double externalT_C, double heatSourceT_C) {
-            return std::vector<double>({externalT_C, heatSourceT_C});
-        };
-    }
-
-    std::function<Performance(std::vector<double> result)> getPerformanceFromBtwxtResult;
-    if (hpwh->useCOP_inBtwxt)
-        getPerformanceFromBtwxtResult = [](std::vector<double> result) {
-            return Performance({result[0], result[0] * result[1], result[1]});
-        };
-    else
-        getPerformanceFromBtwxtResult = [](std::vector<double> result) {
-            return Performance({result[0], result[1], result[1] / result[0]});
-        };
+    evaluatePerformance = BtwxtEvaluator {this, perfGrid.size() > 2, hpwh->useCOP_inBtwxt};
+}
 
-    evaluatePerformance = [&perfRGI = perfRGI, getPerformanceTarget, getPerformanceFromBtwxtResult](
-                              double externalT_C, double heatSourceT_C)
-    {
-        auto target = getPerformanceTarget(externalT_C, heatSourceT_C);
-        std::vector<double> result = perfRGI->get_values_at_target(target);
-        return getPerformanceFromBtwxtResult(result);
-    };
+HPWH::Performance HPWH::Condenser::BtwxtEvaluator::operator()(double externalT_C,
+                                                              double heatSourceT_C) const
+{
+    std::vector<double> target = {externalT_C, heatSourceT_C};
+    if (usesSetpoint)
+        target.push_back(condenser->hpwh->getSetpoint() +
+                         condenser->secondaryHeatExchanger.hotSideTemperatureOffset_dC);
+
+    std::vector<double> result = condenser->perfRGI->get_values_at_target(target);
+    if (usesCOP)
+        return Performance({result[0], result[0] * result[1], result[1]});
+    return Performance({result[0], result[1], result[1] / result[0]});
 }
@@ -14,8 +14,13 @@ class HPWH::Condenser : public HPWH::HeatSource
               std::shared_ptr<Courier::Courier> courier = std::make_shared<DefaultCourier>(),
               const std::string& name_in = "condenser");
 
+    Condenser(const Condenser& cond_in);
+
     Condenser& operator=(const Condenser& hSource);
 
+    /// the copy holds its own interpolator, so that copies may be run concurrently
+    std::shared_ptr<HeatSource> clone(HPWH* hpwh_in) const override;
+
     HEATSOURCE_TYPE typeOfHeatSource() const override { return TYPE_compressor; }
 
     Description description;
@@ -32,6 +37,8 @@ class HPWH::Condenser : public HPWH::HeatSource
 
     void calcHeatDist(std::vector<double>& heatDistribution) override;
 
+    void calcHeatDistGradient(std::vector<Gradient>& heatDistributionGradient) override;
+
     void setupDefrostMap(double derate35 = 0.8865);
     /**< configure the heat source with a default for the defrost derating */
     void defrostDerate(double& to_derate, double airT_C) const;
@@ -130,6 +137,17 @@ class HPWH::Condenser : public HPWH::HeatSource
     /// general performance function used by all models
     Performance getPerformance(double externalT_C, double condenserT_C) const;
 
+    /// apply the heat-exchanger offset and defrost lift; returns whether resistance defrost is on
+    bool adjustEvaluationTemps(double& externalT_C, double& condenserT_C) const;
+
+    /// derivatives of the input and output powers from getPerformance with respect to the
+    /// tracked performance coefficients, given those of the condenser temperature
+    void getPerformanceGradient(double externalT_C,
+                                double condenserT_C,
+                                const Gradient& condenserTGradient_C,
+                                Gradient& inputPowerGradient_W,
+                                Gradient& outputPowerGradient_W) const;
+
     /// performance grid data and values to form btwxt RGI
     std::shared_ptr<Btwxt::RegularGridInterpolator> perfRGI = {};
 
@@ -137,9 +155,22 @@ class HPWH::Condenser : public HPWH::HeatSource
     void makePerformanceBtwxt(const std::vector<std::vector<double>>& perfGrid,
                               const std::vector<std::vector<double>>& perfGridValues);
 
+    /// evaluates performance from perfRGI; refers to its condenser for the current setpoint
+    struct BtwxtEvaluator
+    {
+        const Condenser* condenser;
+        bool usesSetpoint; /**< the grid includes the outlet temperature */
+        bool usesCOP;      /**< the grid values are (input power, COP) */
+
+        Performance operator()(double externalT_C, double heatSourceT_C) const;
+    };
+
     /// internal performance-evaluation function
     std::function<Performance(double externalT_C, double condenserT_C)> evaluatePerformance;
 
+    /// point an evaluatePerformance that refers to its condenser at this one
+    void bindPerformance();
+
     double inputPowerScale = 1.;
     double COP_scale = 1.;
 };
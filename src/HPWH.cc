@@ -43,6 +43,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <regex>
 #include <queue>
+#include <limits>
+#include <mutex>
+#include <typeinfo>
 
 #include <fmt/format.h>
 
@@ -56,6 +59,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Tank.hh"
 #include "Condenser.hh"
 #include "Resistance.hh"
+#include "HPWHCSVSink.hh"
+#include "HPWHResults.hh"
+#include "HPWHJSONLoader.hh"
 
 using std::cout;
 using std::endl;
@@ -202,42 +208,135 @@ HPWH& HPWH::operator=(const HPWH& hpwh)
     }
 
     Sender::operator=(hpwh);
+    copyModel(hpwh);
+    return *this;
+}
+
+void HPWH::copyModel(const HPWH& hpwh)
+{
     isHeating = hpwh.isHeating;
+    setpointFixed = hpwh.setpointFixed;
+    canScale = hpwh.canScale;
 
-    tank = hpwh.tank;
+    tank = std::make_shared<Tank>(*hpwh.tank);
     tank->hpwh = this;
+    tank->setCourier(get_courier());
+
+    heatSources.clear();
+    heatSources.reserve(hpwh.heatSources.size());
+    for (auto& heatSource : hpwh.heatSources)
+    {
+        heatSources.push_back(heatSource->clone(this));
+    }
 
-    heatSources = hpwh.heatSources;
-    for (auto& heatSource : heatSources)
+    // references between heat sources are rebound to the copies by position
+    auto findCopy = [this, &hpwh](const HeatSource* heatSource) -> HeatSource*
+    {
+        if (heatSource == NULL)
+            return NULL;
+        for (std::size_t i = 0; i < hpwh.heatSources.size(); ++i)
+        {
+            if (hpwh.heatSources[i].get() == heatSource)
+                return heatSources[i].get();
+        }
+        return NULL;
+    };
+    for (std::size_t i = 0; i < heatSources.size(); ++i)
     {
-        heatSource->hpwh = this;
+        auto& source = hpwh.heatSources[i];
+        heatSources[i]->backupHeatSource = findCopy(source->backupHeatSource);
+        heatSources[i]->companionHeatSource = findCopy(source->companionHeatSource);
+        heatSources[i]->followedByHeatSource = findCopy(source->followedByHeatSource);
+        heatSources[i]->setCourier(get_courier());
     }
 
+    compressorIndex = hpwh.compressorIndex;
+    lowestElementIndex = hpwh.lowestElementIndex;
+    highestElementIndex = hpwh.highestElementIndex;
+    VIPIndex = hpwh.VIPIndex;
+    resistanceHeightMap = hpwh.resistanceHeightMap;
+
     setpoint_C = hpwh.setpoint_C;
+    currentSoCFraction = hpwh.currentSoCFraction;
+    _targetSoC = hpwh._targetSoC;
 
     condenserInlet_C = hpwh.condenserInlet_C;
     condenserOutlet_C = hpwh.condenserOutlet_C;
     externalVolumeHeated_L = hpwh.externalVolumeHeated_L;
     energyRemovedFromEnvironment_kWh = hpwh.energyRemovedFromEnvironment_kWh;
     standbyLosses_kWh = hpwh.standbyLosses_kWh;
+    extraEnergyInput_kWh = hpwh.extraEnergyInput_kWh;
 
     doTempDepression = hpwh.doTempDepression;
+    maxDepression_C = hpwh.maxDepression_C;
 
     locationTemperature_C = hpwh.locationTemperature_C;
+    member_inletT_C = hpwh.member_inletT_C;
+    haveInletT = hpwh.haveInletT;
 
     prevDRstatus = hpwh.prevDRstatus;
     timerLimitTOT = hpwh.timerLimitTOT;
+    timerTOT = hpwh.timerTOT;
 
     usesSoCLogic = hpwh.usesSoCLogic;
+    useCOP_inBtwxt = hpwh.useCOP_inBtwxt;
+    setMinutesPerStep(hpwh.minutesPerStep);
 
     model = hpwh.model;
+    description = hpwh.description;
     productInformation = hpwh.productInformation;
-
-    return *this;
+    rating10CFR430 = hpwh.rating10CFR430;
 }
 
 HPWH::~HPWH() {}
 
+void HPWH::getState(State& state) const
+{
+    state.tankTs_C = tank->nodeTs_C;
+
+    state.heatSourceFlags.resize(heatSources.size());
+    for (std::size_t i = 0; i < heatSources.size(); ++i)
+    {
+        std::uint8_t flags = 0;
+        if (heatSources[i]->isOn)
+            flags |= State::isOnFlag;
+        if (heatSources[i]->lockedOut)
+            flags |= State::lockedOutFlag;
+        state.heatSourceFlags[i] = flags;
+    }
+
+    state.setpoint_C = setpoint_C;
+    state.currentSoCFraction = currentSoCFraction;
+    state.locationTemperature_C = locationTemperature_C;
+    state.timerTOT = timerTOT;
+    state.prevDRstatus = prevDRstatus;
+    state.isHeating = isHeating;
+}
+
+void HPWH::setState(const State& state)
+{
+    if ((state.tankTs_C.size() != tank->nodeTs_C.size()) ||
+        (state.heatSourceFlags.size() != heatSources.size()))
+    {
+        send_error("State does not match the configuration of this HPWH.");
+    }
+
+    tank->nodeTs_C = state.tankTs_C;
+
+    for (std::size_t i = 0; i < heatSources.size(); ++i)
+    {
+        heatSources[i]->isOn = (state.heatSourceFlags[i] & State::isOnFlag) != 0;
+        heatSources[i]->lockedOut = (state.heatSourceFlags[i] & State::lockedOutFlag) != 0;
+    }
+
+    setpoint_C = state.setpoint_C;
+    currentSoCFraction = state.currentSoCFraction;
+    locationTemperature_C = state.locationTemperature_C;
+    timerTOT = state.timerTOT;
+    prevDRstatus = state.prevDRstatus;
+    isHeating = state.isHeating;
+}
+
 HPWH::Condenser* HPWH::addCondenser(const std::string& name_in)
 {
     heatSources.emplace_back(std::make_shared<Condenser>(this, get_courier(), name_in));
@@ -279,8 +378,11 @@ void HPWH::runOneStep(double drawVolume_L,
         heatSources[i]->runtime_min = 0;
         heatSources[i]->energyInput_kWh = 0.;
         heatSources[i]->energyOutput_kWh = 0.;
+        heatSources[i]->runtimeGradient_min.clear();
     }
     extraEnergyInput_kWh = 0.;
+    if (sensitivity)
+        sensitivity->stepInputGradient_kJ = sensitivity->zero();
 
     // if you are doing temp. depression, set tank and heatSource ambient temps
     // to the tracked locationTemperature
@@ -380,6 +482,9 @@ void HPWH::runOneStep(double drawVolume_L,
 
         // do heating logic
         double minutesToRun = minutesPerStep;
+        Gradient minutesToRunGradient;
+        if (sensitivity)
+            minutesToRunGradient = sensitivity->zero();
         for (int i = 0; i < getNumHeatSources(); i++)
         {
 
@@ -453,6 +558,8 @@ void HPWH::runOneStep(double drawVolume_L,
                     heatSourcePtr = heatSources[i].get();
                 }
 
+                if (sensitivity)
+                    sensitivity->heatingTimeGradient_min = minutesToRunGradient;
                 addHeatParent(heatSourcePtr, heatSourceAmbientT_C, minutesToRun);
 
                 // if it finished early. i.e. shuts off early like if the heatsource met setpoint or
@@ -461,6 +568,7 @@ void HPWH::runOneStep(double drawVolume_L,
                 {
                     // subtract time it ran and turn it off
                     minutesToRun -= heatSourcePtr->runtime_min;
+                    minutesToRunGradient -= heatSourcePtr->runtimeGradient_min;
                     heatSources[i]->disengageHeatSource();
                     // and if there's a heat source that follows this heat source (regardless of
                     // lockout) that's able to come on,
@@ -499,6 +607,10 @@ void HPWH::runOneStep(double drawVolume_L,
                             // add heat if it hasn't heated up this whole minute already
                             if ((minutesToRun - backupHeatSource->runtime_min) >= 0.)
                             {
+                                if (sensitivity)
+                                    sensitivity->heatingTimeGradient_min =
+                                        minutesToRunGradient -
+                                        backupHeatSource->runtimeGradient_min;
                                 addHeatParent(backupHeatSource,
                                               heatSourceAmbientT_C,
                                               minutesToRun - backupHeatSource->runtime_min);
@@ -558,6 +670,9 @@ void HPWH::runOneStep(double drawVolume_L,
             auto condenser = reinterpret_cast<Condenser*>(heatSource.get());
             condenser->energyInput_kWh += condenser->standbyPower_kW *
                                           ((minutesPerStep - condenser->runtime_min) / min_per_hr);
+            if (sensitivity)
+                sensitivity->stepInputGradient_kJ -=
+                    (condenser->standbyPower_kW * sec_per_min) * condenser->runtimeGradient_min;
         }
 
     // outletTemp_C and standbyLosses_kWh are taken care of in updateTankTemps
@@ -679,24 +794,27 @@ int HPWH::writeCSVHeading(std::ofstream& outFILE,
                           int nTCouples,
                           int options) const
 {
-
     bool doIP = (options & CSVOPT_IPUNITS) != 0;
 
-    outFILE << preamble;
+    CSVSink sink(outFILE, false, CSVSink::defaultFlushSize, get_courier());
+
+    sink.write(preamble);
 
-    outFILE << "DRstatus";
+    sink.write("DRstatus");
 
     for (int iHS = 0; iHS < getNumHeatSources(); iHS++)
     {
-        outFILE << fmt::format(",h_src{}In (Wh),h_src{}Out (Wh)", iHS + 1, iHS + 1);
+        sink.write(",h_src{}In (Wh),h_src{}Out (Wh)", iHS + 1, iHS + 1);
     }
 
     for (int iTC = 0; iTC < nTCouples; iTC++)
     {
-        outFILE << fmt::format(",tcouple{} ({})", iTC + 1, doIP ? "F" : "C");
+        sink.write(",tcouple{} ({})", iTC + 1, doIP ? "F" : "C");
     }
 
-    outFILE << fmt::format(",toutlet ({})", doIP ? "F" : "C") << std::endl;
+    sink.write(",toutlet ({})", doIP ? "F" : "C");
+    sink.endRow();
+    sink.close();
 
     return 0;
 }
@@ -706,115 +824,217 @@ int HPWH::writeCSVRow(std::ofstream& outFILE,
                       int nTCouples,
                       int options) const
 {
-
     bool doIP = (options & CSVOPT_IPUNITS) != 0;
 
-    outFILE << preamble;
+    CSVSink sink(outFILE, false, CSVSink::defaultFlushSize, get_courier());
+
+    sink.write(preamble);
 
-    outFILE << prevDRstatus;
+    sink.write("{}", static_cast<int>(prevDRstatus));
 
     for (int iHS = 0; iHS < getNumHeatSources(); iHS++)
     {
-        outFILE << fmt::format(",{:0.2f},{:0.2f}",
-                               getNthHeatSourceEnergyInput(iHS, UNITS_KWH) * 1000.,
-                               getNthHeatSourceEnergyOutput(iHS, UNITS_KWH) * 1000.);
+        sink.write(",{:0.2f},{:0.2f}",
+                   getNthHeatSourceEnergyInput(iHS, UNITS_KWH) * 1000.,
+                   getNthHeatSourceEnergyOutput(iHS, UNITS_KWH) * 1000.);
     }
 
     for (int iTC = 0; iTC < nTCouples; iTC++)
     {
-        outFILE << fmt::format(",{:0.2f}",
-                               getNthSimTcouple(iTC + 1, nTCouples, doIP ? UNITS_F : UNITS_C));
+        sink.write(",{:0.2f}", getNthSimTcouple(iTC + 1, nTCouples, doIP ? UNITS_F : UNITS_C));
     }
 
     if (options & HPWH::CSVOPT_IS_DRAWING)
     {
-        outFILE << fmt::format(",{:0.2f}",
-                               doIP ? C_TO_F(tank->getOutletT_C()) : tank->getOutletT_C());
+        sink.write(",{:0.2f}", doIP ? C_TO_F(tank->getOutletT_C()) : tank->getOutletT_C());
     }
     else
     {
-        outFILE << ",";
+        sink.write(",");
     }
 
-    outFILE << std::endl;
+    sink.endRow();
+    sink.close();
 
     return 0;
 }
 
 // public members to write to CSV file
 void HPWH::writeCSVHeading(std::ostream* out, int options) const
+{
+    CSVSink sink(*out, false, CSVSink::defaultFlushSize, get_courier());
+    writeCSVHeading(sink, options);
+    sink.close();
+}
+
+void HPWH::writeCSVHeading(CSVSink& sink, int options) const
 {
     bool doIP = (options & CSVOPT_IPUNITS) != 0;
 
-    *out << "minutes,Ta,Tsetpoint,inletT,draw";
+    sink.write("minutes,Ta,Tsetpoint,inletT,draw");
 
-    if (isCompressorExternalMultipass())
-        *out << ",condenserInletT,condenserOutletT,externalVolGPM";
+    if (hasACompressor() && isCompressorExternalMultipass())
+        sink.write(",condenserInletT,condenserOutletT,externalVolGPM");
 
     if (usesSoCLogic)
-        *out << ",targetSoCFract,soCFract";
+        sink.write(",targetSoCFract,soCFract");
 
-    *out << ",DRstatus";
+    sink.write(",DRstatus");
 
     for (int iHS = 0; iHS < getNumHeatSources(); iHS++)
     {
-        *out << fmt::format(",h_src{}In (Wh),h_src{}Out (Wh)", iHS + 1, iHS + 1);
+        sink.write(",h_src{}In (Wh),h_src{}Out (Wh)", iHS + 1, iHS + 1);
     }
 
     for (int iTC = 0; iTC < TestData::nTCouples; iTC++)
     {
-        *out << fmt::format(",tcouple{} ({})", iTC + 1, doIP ? "F" : "C");
+        sink.write(",tcouple{} ({})", iTC + 1, doIP ? "F" : "C");
     }
 
-    *out << fmt::format(",toutlet ({})", doIP ? "F" : "C") << std::endl;
+    sink.write(",toutlet ({})", doIP ? "F" : "C");
+    sink.endRow();
 }
 
 void HPWH::writeCSVRow(std::ostream* out, TestData& testData, int options) const
+{
+    CSVSink sink(*out, false, CSVSink::defaultFlushSize, get_courier());
+    writeCSVRow(sink, testData, options);
+    sink.close();
+}
+
+void HPWH::writeCSVRow(CSVSink& sink, const TestData& testData, int options) const
 {
     bool doIP = (options & CSVOPT_IPUNITS) != 0;
 
-    *out << testData.time_min;
-    *out << fmt::format(", {:0.6f}", testData.ambientT_C);
-    *out << fmt::format(", {:0.6f}", testData.setpointT_C);
-    *out << ((testData.drawVolume_L > 0.) ? fmt::format(", {:0.6f}", testData.inletT_C) : ",");
-    *out << ((testData.drawVolume_L > 0.)
-                 ? fmt::format(", {:0.6f}", L_TO_GAL(testData.drawVolume_L))
-                 : ",");
+    // as written by std::ostream
+    sink.write("{:g}", testData.time_min);
+    sink.write(", {:0.6f}", testData.ambientT_C);
+    sink.write(", {:0.6f}", testData.setpointT_C);
+    if (testData.drawVolume_L > 0.)
+    {
+        sink.write(", {:0.6f}", testData.inletT_C);
+        sink.write(", {:0.6f}", L_TO_GAL(testData.drawVolume_L));
+    }
+    else
+        sink.write(",,");
 
-    if (isCompressorExternalMultipass() == 1)
+    if (hasACompressor() && (isCompressorExternalMultipass() == 1))
     {
-        *out << fmt::format(", {:0.6f}", getCondenserWaterInletTemp());
-        *out << fmt::format(", {:0.6f}", getCondenserWaterOutletTemp());
-        *out << fmt::format(", {:0.6f}", getExternalVolumeHeated(HPWH::UNITS_GAL));
+        sink.write(", {:0.6f}", getCondenserWaterInletTemp());
+        sink.write(", {:0.6f}", getCondenserWaterOutletTemp());
+        sink.write(", {:0.6f}", getExternalVolumeHeated(HPWH::UNITS_GAL));
     }
 
     if (usesSoCLogic)
     {
-        *out << fmt::format(", {:0.6f}", _targetSoC);
-        *out << fmt::format(", {:0.6f}", getSoCFraction());
+        sink.write(", {:0.6f}", _targetSoC);
+        sink.write(", {:0.6f}", getSoCFraction());
     }
 
-    *out << fmt::format(", {:d}", static_cast<int>(prevDRstatus));
+    sink.write(", {:d}", static_cast<int>(prevDRstatus));
 
     for (int iHS = 0; iHS < getNumHeatSources(); iHS++)
     {
-        *out << fmt::format(",{:0.2f},{:0.2f}",
-                            testData.h_srcIn_kWh[iHS] * 1000.,
-                            testData.h_srcOut_kWh[iHS] * 1000.);
+        sink.write(",{:0.2f},{:0.2f}",
+                   testData.h_srcIn_kWh[iHS] * 1000.,
+                   testData.h_srcOut_kWh[iHS] * 1000.);
     }
 
     for (int iTC = 0; iTC < TestData::nTCouples; iTC++)
     {
-        *out << fmt::format(",{:0.2f}",
-                            doIP ? C_TO_F(testData.thermocoupleT_C[iTC])
-                                 : testData.thermocoupleT_C[iTC]);
+        sink.write(",{:0.2f}",
+                   doIP ? C_TO_F(testData.thermocoupleT_C[iTC]) : testData.thermocoupleT_C[iTC]);
+    }
+
+    if (testData.drawVolume_L > 0.)
+        sink.write(",{:0.2f}", doIP ? C_TO_F(testData.outletT_C) : testData.outletT_C);
+    else
+        sink.write(",");
+
+    sink.endRow();
+}
+
+void HPWH::writeResultsHeading(ResultsWriter& writer, int options) const
+{
+    bool doIP = (options & CSVOPT_IPUNITS) != 0;
+    std::string tUnits = doIP ? "F" : "C";
+
+    // names as in the CSV heading, so either can be loaded the same way
+    writer.addColumn("minutes", "min");
+    writer.addColumn("Ta", "C");
+    writer.addColumn("Tsetpoint", "C");
+    writer.addColumn("inletT", "C");
+    writer.addColumn("draw", "gal");
+
+    if (isCompressorExternalMultipass())
+    {
+        writer.addColumn("condenserInletT", "C");
+        writer.addColumn("condenserOutletT", "C");
+        writer.addColumn("externalVolGPM", "gal");
+    }
+
+    if (usesSoCLogic)
+    {
+        writer.addColumn("targetSoCFract", "");
+        writer.addColumn("soCFract", "");
     }
 
-    *out << ((testData.drawVolume_L > 0.)
-                 ? fmt::format(",{:0.2f}", doIP ? C_TO_F(testData.outletT_C) : testData.outletT_C)
-                 : ",");
+    writer.addColumn("DRstatus", "", ResultsWriter::Type::int32);
 
-    *out << std::endl;
+    for (int iHS = 0; iHS < getNumHeatSources(); iHS++)
+    {
+        writer.addColumn(fmt::format("h_src{}In (Wh)", iHS + 1), "Wh");
+        writer.addColumn(fmt::format("h_src{}Out (Wh)", iHS + 1), "Wh");
+    }
+
+    for (int iTC = 0; iTC < TestData::nTCouples; iTC++)
+    {
+        writer.addColumn(fmt::format("tcouple{} ({})", iTC + 1, tUnits), tUnits);
+    }
+
+    writer.addColumn(fmt::format("toutlet ({})", tUnits), tUnits);
+}
+
+void HPWH::writeResultsRow(ResultsWriter& writer, const TestData& testData, int options) const
+{
+    bool doIP = (options & CSVOPT_IPUNITS) != 0;
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    bool hasDraw = (testData.drawVolume_L > 0.);
+
+    writer.write(testData.time_min);
+    writer.write(testData.ambientT_C);
+    writer.write(testData.setpointT_C);
+    writer.write(hasDraw ? testData.inletT_C : missing);
+    writer.write(hasDraw ? L_TO_GAL(testData.drawVolume_L) : missing);
+
+    if (isCompressorExternalMultipass())
+    {
+        writer.write(getCondenserWaterInletTemp());
+        writer.write(getCondenserWaterOutletTemp());
+        writer.write(getExternalVolumeHeated(HPWH::UNITS_GAL));
+    }
+
+    if (usesSoCLogic)
+    {
+        writer.write(_targetSoC);
+        writer.write(getSoCFraction());
+    }
+
+    writer.write(static_cast<int>(prevDRstatus));
+
+    for (int iHS = 0; iHS < getNumHeatSources(); iHS++)
+    {
+        writer.write(testData.h_srcIn_kWh[iHS] * 1000.);
+        writer.write(testData.h_srcOut_kWh[iHS] * 1000.);
+    }
+
+    for (int iTC = 0; iTC < TestData::nTCouples; iTC++)
+    {
+        writer.write(doIP ? C_TO_F(testData.thermocoupleT_C[iTC]) : testData.thermocoupleT_C[iTC]);
+    }
+
+    writer.write(hasDraw ? (doIP ? C_TO_F(testData.outletT_C) : testData.outletT_C) : missing);
+    writer.endRow();
 }
 
 bool HPWH::isSetpointFixed() const { return setpointFixed; }
@@ -2608,11 +2828,14 @@ void HPWH::updateSoCIfNecessary()
 // Inversion mixing modeled after bigladder EnergyPlus code PK
 void HPWH::mixTankInversions() { tank->mixInversions(); }
 
-double HPWH::addHeatAboveNode(double qAdd_kJ, int nodeNum, const double maxT_C)
+double HPWH::addHeatAboveNode(double qAdd_kJ,
+                              int nodeNum,
+                              const double maxT_C,
+                              Gradient* qAddGradient_kJ /*=nullptr*/)
 {
     // Do not exceed maxT_C or setpoint
     double maxHeatToT_C = std::min(maxT_C, setpoint_C);
-    return tank->addHeatAboveNode(qAdd_kJ, nodeNum, maxHeatToT_C);
+    return tank->addHeatAboveNode(qAdd_kJ, nodeNum, maxHeatToT_C, qAddGradient_kJ);
 }
 
 void HPWH::addExtraHeatAboveNode(double qAdd_kJ, const int nodeNum)
@@ -2678,9 +2901,12 @@ bool HPWH::areAllHeatSourcesOff() const
     return allOff;
 }
 
-void HPWH::mixTankNodes(int mixBottomNode, int mixBelowNode, double mixFactor)
+void HPWH::mixTankNodes(int mixBottomNode,
+                        int mixBelowNode,
+                        double mixFactor,
+                        const Gradient& mixFactorGradient /*={}*/)
 {
-    tank->mixNodes(mixBottomNode, mixBelowNode, mixFactor);
+    tank->mixNodes(mixBottomNode, mixBelowNode, mixFactor, mixFactorGradient);
 }
 
 void HPWH::calcDerivedValues()
@@ -3128,19 +3354,94 @@ void HPWH::configure()
     }
 }
 
-void HPWH::initPreset(hpwh_presets::MODELS presetNum)
+/// decoded preset inputs, and prototypes configured from them, by preset number; shared by all
+/// instances and filled on first use
+using PresetInput = hpwh_data_model::hpwh_sim_input::HPWHSimInput;
+static std::unordered_map<int, std::shared_ptr<const PresetInput>> presetInputCache;
+static std::unordered_map<int, std::shared_ptr<const HPWH>> presetPrototypeCache;
+static std::mutex presetCacheMutex;
+
+std::mutex& HPWH::getDataModelMutex() { return presetCacheMutex; }
+
+/// decode a preset unless already decoded; the caller holds presetCacheMutex, as decoding
+/// sets the data-model loggers
+static std::shared_ptr<const PresetInput>
+getPresetInput(hpwh_presets::MODELS presetNum, const std::shared_ptr<Courier::Courier>& courier)
 {
+    auto cached = presetInputCache.find(presetNum);
+    if (cached != presetInputCache.end())
+        return cached->second;
+
     auto presetData = hpwh_presets::find_by_id(presetNum);
-    nlohmann::json j =
-        nlohmann::json::from_cbor(presetData.cbor_data, presetData.cbor_data + presetData.size);
+    auto hsi = std::make_shared<PresetInput>();
+    hpwh_data_model::init(courier);
+    if (presetData.build)
+    {
+        // compiled presets fill the input directly
+        presetData.build(*hsi);
+    }
+    else
+    {
+        nlohmann::json j = nlohmann::json::from_cbor(presetData.cbor_data,
+                                                     presetData.cbor_data + presetData.size);
+        hpwh_data_model::hpwh_sim_input::from_json(j, *hsi);
+    }
+    presetInputCache.emplace(presetNum, hsi);
+    return hsi;
+}
 
-    hpwh_data_model::init(get_courier());
-    hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
-    hpwh_data_model::hpwh_sim_input::from_json(j, hsi);
-    name = presetData.name;
-    model = presetNum;
-    from(hsi);
-    configure();
+void HPWH::initPreset(hpwh_presets::MODELS presetNum)
+{
+    std::unique_lock<std::mutex> lock(presetCacheMutex);
+    auto hsi = getPresetInput(presetNum, get_courier());
+
+    // Messages from configuring a prototype go to the default courier, so only instances
+    // reporting to the default courier are copied; others are configured from the input.
+    auto& courier = *get_courier();
+    if (typeid(courier) != typeid(DefaultCourier))
+    {
+        lock.unlock();
+        name = hpwh_presets::find_by_id(presetNum).name;
+        model = presetNum;
+        from(*hsi);
+        configure();
+        return;
+    }
+
+    auto cached = presetPrototypeCache.find(presetNum);
+    if (cached == presetPrototypeCache.end())
+    {
+        auto prototype = std::make_shared<HPWH>();
+        prototype->name = hpwh_presets::find_by_id(presetNum).name;
+        prototype->model = presetNum;
+        prototype->from(*hsi);
+        prototype->configure();
+        cached = presetPrototypeCache.emplace(presetNum, prototype).first;
+    }
+    auto prototype = cached->second;
+    lock.unlock();
+
+    name = prototype->name;
+    copyModel(*prototype);
+}
+
+void HPWH::clearPresetCache()
+{
+    std::lock_guard<std::mutex> lock(presetCacheMutex);
+    presetInputCache.clear();
+    presetPrototypeCache.clear();
+}
+
+std::vector<std::unique_ptr<HPWH>> HPWH::initAllPresets()
+{
+    std::vector<std::unique_ptr<HPWH>> hpwhs;
+    hpwhs.reserve(hpwh_presets::models.size());
+    for (auto& model : hpwh_presets::models)
+    {
+        hpwhs.push_back(std::make_unique<HPWH>());
+        hpwhs.back()->initPreset(model.model());
+    }
+    return hpwhs;
 }
 
 void HPWH::initPreset(const std::string& presetName)
@@ -3158,9 +3459,22 @@ void HPWH::initPreset(const std::string& presetName)
 
 void HPWH::initFromJSON(const nlohmann::json& j, const std::string& modelName)
 {
-    hpwh_data_model::init(get_courier());
     hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
-    hpwh_data_model::hpwh_sim_input::from_json(j, hsi);
+    {
+        std::lock_guard<std::mutex> lock(getDataModelMutex());
+        hpwh_data_model::init(get_courier());
+        hpwh_data_model::hpwh_sim_input::from_json(j, hsi);
+    }
+    name = modelName;
+    getPresetNumberFromName(name, model);
+    from(hsi);
+    configure();
+}
+
+void HPWH::initFromJSON(std::istream& is, const std::string& modelName)
+{
+    hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+    JSONLoader(get_courier()).load(is, hsi);
     name = modelName;
     getPresetNumberFromName(name, model);
     from(hsi);
@@ -3640,6 +3954,114 @@ void HPWH::prepareForTest(const TestConfiguration& testConfiguration)
     }
 }
 
+//-----------------------------------------------------------------------------
+///	@brief	Change setpoint to DOE value, or highest available
+/// @note	see EERE-2019-BT-TP-0032-0058 (p. 40475)
+//-----------------------------------------------------------------------------
+void HPWH::setTestSetpoint()
+{
+    double maxAllowedSetpointT_C;
+    std::string why;
+    if (isNewSetpointPossible(HPWH::testSetpointT_C, maxAllowedSetpointT_C, why, UNITS_C))
+    {
+        setSetpoint(HPWH::testSetpointT_C);
+    }
+    else
+    {
+        if (isNewSetpointPossible(maxAllowedSetpointT_C, maxAllowedSetpointT_C, why, UNITS_C))
+            setSetpoint(maxAllowedSetpointT_C);
+    }
+}
+
+HPWH::State HPWH::getPreparedState(const TestConfiguration& testConfiguration) const
+{
+    auto hpwh = clone();
+    hpwh->setTestSetpoint();
+    hpwh->prepareForTest(testConfiguration);
+    return hpwh->getState();
+}
+
+std::string HPWH::getTestParameterKey() const
+{
+    hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+    to(hsi);
+    nlohmann::json j;
+    hpwh_data_model::hpwh_sim_input::to_json(j, hsi);
+    std::string parameters = j.dump();
+
+    // performance, as used, over the range of condenser temperatures
+    auto compressor = getCompressor();
+    if (compressor)
+    {
+        for (auto& testConfiguration :
+             {testConfiguration_E50, testConfiguration_UEF, testConfiguration_E95})
+        {
+            for (double condenserT_F = 40.; condenserT_F <= 160.; condenserT_F += 15.)
+            {
+                auto performance =
+                    compressor->getPerformance(testConfiguration.externalT_C, F_TO_C(condenserT_F));
+                parameters.append(
+                    fmt::format(";{:a},{:a}", performance.inputPower_W, performance.cop));
+            }
+        }
+    }
+
+    // prepareForTest runs from the current state, so a rating holds only for the same state
+    auto state = getState();
+    for (auto& tankT_C : state.tankTs_C)
+        parameters.append(fmt::format(";{:a}", tankT_C));
+    for (auto& flags : state.heatSourceFlags)
+        parameters.append(fmt::format(";{}", flags));
+    parameters.append(fmt::format(";{:a},{:a},{:a},{:a},{},{}",
+                                  state.setpoint_C,
+                                  state.currentSoCFraction,
+                                  state.locationTemperature_C,
+                                  state.timerTOT,
+                                  static_cast<int>(state.prevDRstatus),
+                                  state.isHeating));
+    return parameters;
+}
+
+/// first-hour ratings by full test-parameter key, shared by all instances
+static std::unordered_map<std::string, HPWH::FirstHourRating> firstHourRatingCache;
+static HPWH::CacheCounts firstHourRatingCacheCounts;
+static std::mutex firstHourRatingCacheMutex;
+
+HPWH::FirstHourRating HPWH::getFirstHourRating() const
+{
+    auto key = getTestParameterKey();
+    {
+        std::lock_guard<std::mutex> lock(firstHourRatingCacheMutex);
+        auto cached = firstHourRatingCache.find(key);
+        if (cached != firstHourRatingCache.end())
+        {
+            ++firstHourRatingCacheCounts.nHits;
+            return cached->second;
+        }
+        ++firstHourRatingCacheCounts.nMisses;
+    }
+
+    // run without holding the lock; a concurrent duplicate gives the same result
+    auto firstHourRating = clone()->findFirstHourRating();
+
+    std::lock_guard<std::mutex> lock(firstHourRatingCacheMutex);
+    firstHourRatingCache.emplace(std::move(key), firstHourRating);
+    return firstHourRating;
+}
+
+void HPWH::clearFirstHourRatingCache()
+{
+    std::lock_guard<std::mutex> lock(firstHourRatingCacheMutex);
+    firstHourRatingCache.clear();
+    firstHourRatingCacheCounts = {};
+}
+
+HPWH::CacheCounts HPWH::getFirstHourRatingCacheCounts()
+{
+    std::lock_guard<std::mutex> lock(firstHourRatingCacheMutex);
+    return firstHourRatingCacheCounts;
+}
+
 //-----------------------------------------------------------------------------
 ///	@brief	Find first-hour rating designation for 24-hr test
 /// @note	see EERE-2019-BT-TP-0032-0058, p. 40479 (5.3.3)
@@ -3655,19 +4077,7 @@ HPWH::FirstHourRating HPWH::findFirstHourRating()
     const double ambientT_C = testConfiguration_UEF.ambientT_C;
     const double externalT_C = testConfiguration_UEF.externalT_C;
 
-    // change setpoint to DOE value, or highest available
-    // see EERE-2019-BT-TP-0032-0058 (p. 40475)
-    double maxAllowedSetpointT_C;
-    std::string why;
-    if (isNewSetpointPossible(HPWH::testSetpointT_C, maxAllowedSetpointT_C, why, UNITS_C))
-    {
-        setSetpoint(HPWH::testSetpointT_C);
-    }
-    else
-    {
-        if (isNewSetpointPossible(maxAllowedSetpointT_C, maxAllowedSetpointT_C, why, UNITS_C))
-            setSetpoint(maxAllowedSetpointT_C);
-    }
+    setTestSetpoint();
 
     double tankT_C = getAverageTankTemp_C();
     double maxTankT_C = tankT_C;
@@ -3811,6 +4221,92 @@ HPWH::FirstHourRating HPWH::findFirstHourRating()
     return firstHourRating;
 }
 
+/// derivatives of the quantities accumulated during the 24-hr test
+struct TestGradients
+{
+    HPWH::Gradient usedEnergy_kJ;
+    HPWH::Gradient deliveredEnergy_kJ;
+    HPWH::Gradient initialTankT_C;
+    HPWH::Gradient finalTankT_C;
+    HPWH::Gradient recoveryUsedEnergy_kJ;
+    HPWH::Gradient recoveryStoredEnergy_kJ;
+    HPWH::Gradient recoveryDeliveredEnergy_kJ;
+    HPWH::Gradient standbyUsedEnergy_kJ;
+    HPWH::Gradient standbyStartTankT_C;
+    HPWH::Gradient standbyEndTankT_C;
+    HPWH::Gradient standbyAverageTankT_C;
+};
+
+//-----------------------------------------------------------------------------
+///	@brief	Propagates derivatives of the accumulated quantities through the 24-hr test metrics
+/// @note	forward-mode tangent of the formulas in runPrepared24hrTest, applied along its trajectory
+/// @param[in] testSummary	            metrics of the completed test
+/// @param[in] gradients	            derivatives of the accumulated quantities
+/// @param[in] tankHeatCapacity_kJperC	heat capacity of the tank contents
+/// @param[in] tankTChange_C	        change in average tank temperature over the test
+/// @param[in] standbyDifferenceT_C	    mean standby tank-ambient difference, or zero if UA unset
+/// @return	derivatives of EF
+//-----------------------------------------------------------------------------
+static std::vector<double> findEF_Gradient(const HPWH::TestSummary& testSummary,
+                                           const TestGradients& gradients,
+                                           double tankHeatCapacity_kJperC,
+                                           double tankTChange_C,
+                                           double standbyDifferenceT_C,
+                                           double standardAmbientT_C)
+{
+    const double RE = testSummary.recoveryEfficiency;
+    HPWH::Gradient EF_gradient(gradients.usedEnergy_kJ.size());
+    if ((RE <= 0.) || (testSummary.modifiedConsumedWaterHeatingEnergy_kJ <= 0.))
+        return EF_gradient;
+
+    HPWH::Gradient d_RE =
+        (gradients.recoveryStoredEnergy_kJ + gradients.recoveryDeliveredEnergy_kJ -
+         RE * gradients.recoveryUsedEnergy_kJ) /
+        testSummary.recoveryUsedEnergy_kJ;
+
+    // standby loss coefficient, UA
+    HPWH::Gradient d_UA;
+    if ((testSummary.standbyPeriodDuration_h > 0) && (standbyDifferenceT_C != 0.))
+    {
+        double standardTankEnergy_kJ =
+            testSummary.standbyUsedEnergy_kJ -
+            testSummary.standbyHourlyLossEnergy_kJperh * testSummary.standbyPeriodDuration_h;
+        HPWH::Gradient d_standardTankEnergy_kJ =
+            (tankHeatCapacity_kJperC / RE) *
+                (gradients.standbyEndTankT_C - gradients.standbyStartTankT_C) -
+            (standardTankEnergy_kJ / RE) * d_RE;
+        HPWH::Gradient d_standbyHourlyLossEnergy_kJperh =
+            (gradients.standbyUsedEnergy_kJ - d_standardTankEnergy_kJ) /
+            testSummary.standbyPeriodDuration_h;
+        d_UA = (d_standbyHourlyLossEnergy_kJperh -
+                testSummary.standbyLossCoefficient_kJperhC * gradients.standbyAverageTankT_C) /
+               standbyDifferenceT_C;
+    }
+
+    // Q_d, Q_HW, Q_HW,T
+    HPWH::Gradient d_consumedHeatingEnergy_kJ =
+        gradients.usedEnergy_kJ -
+        (tankHeatCapacity_kJperC / RE) * (gradients.finalTankT_C - gradients.initialTankT_C) +
+        (tankHeatCapacity_kJperC * tankTChange_C / (RE * RE)) * d_RE;
+    HPWH::Gradient d_waterHeatingEnergy_kJ =
+        gradients.deliveredEnergy_kJ / RE - (testSummary.waterHeatingEnergy_kJ / RE) * d_RE;
+    HPWH::Gradient d_standardWaterHeatingEnergy_kJ =
+        (-testSummary.standardWaterHeatingEnergy_kJ / RE) * d_RE;
+
+    // Q_da, Q_dm
+    double noDrawDifferenceT_C = standardAmbientT_C - testSummary.noDrawAverageAmbientT_C;
+    HPWH::Gradient d_adjustedConsumedWaterHeatingEnergy_kJ =
+        d_consumedHeatingEnergy_kJ -
+        (noDrawDifferenceT_C * testSummary.noDrawTotalTime_h) * d_UA;
+    HPWH::Gradient d_modifiedConsumedWaterHeatingEnergy_kJ =
+        d_adjustedConsumedWaterHeatingEnergy_kJ + d_standardWaterHeatingEnergy_kJ -
+        d_waterHeatingEnergy_kJ;
+
+    EF_gradient += (-testSummary.EF / testSummary.modifiedConsumedWaterHeatingEnergy_kJ) *
+                   d_modifiedConsumedWaterHeatingEnergy_kJ;
+    return EF_gradient;
+}
+
 //-----------------------------------------------------------------------------
 ///	@brief	Performs standard 24-hr test
 /// @note	see https://www.regulations.gov/document/EERE-2019-BT-TP-0032-0058 (5.4.2)
@@ -3819,10 +4315,52 @@ HPWH::FirstHourRating HPWH::findFirstHourRating()
 //-----------------------------------------------------------------------------
 HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
                                     FirstHourRating::Designation designation)
+{
+    setTestSetpoint();
+    prepareForTest(testConfiguration);
+    return runPrepared24hrTest(testConfiguration, designation);
+}
+
+HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
+                                    FirstHourRating::Designation designation,
+                                    const State& preparedState)
+{
+    setState(preparedState);
+    return runPrepared24hrTest(testConfiguration, designation);
+}
+
+HPWH::TestSummary
+HPWH::run24hrTest(TestConfiguration testConfiguration,
+                  FirstHourRating::Designation designation,
+                  const PerformancePolySet& perfPolySet,
+                  const std::vector<PerformancePolySet::CoefficientIndex>& coefficients,
+                  const State* preparedState)
+{
+    Sensitivity testSensitivity = {&perfPolySet, coefficients, {}, {}};
+    sensitivity = &testSensitivity;
+    tank->trackGradients(coefficients.size());
+
+    // stop tracking on any exit, as the sensitivity is local
+    struct ClearSensitivity
+    {
+        HPWH& hpwh;
+        ~ClearSensitivity()
+        {
+            hpwh.sensitivity = nullptr;
+            hpwh.tank->trackGradients(0);
+        }
+    } clearSensitivity {*this};
+
+    return preparedState ? run24hrTest(testConfiguration, designation, *preparedState)
+                         : run24hrTest(testConfiguration, designation);
+}
+
+HPWH::TestSummary HPWH::runPrepared24hrTest(TestConfiguration testConfiguration,
+                                            FirstHourRating::Designation designation)
 {
     // select the first draw cluster size and pattern
     // auto firstDrawClusterSize = firstDrawClusterSizes[designation];
-    DrawPattern& drawPattern = drawPatterns[designation];
+    const DrawPattern& drawPattern = drawPatterns.at(designation);
 
     const double inletT_C = testConfiguration.inletT_C;
     const double ambientT_C = testConfiguration.ambientT_C;
@@ -3830,22 +4368,6 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
 
     DRMODES drMode = DR_ALLOW;
 
-    // change setpoint to DOE value, or highest available
-    // see EERE-2019-BT-TP-0032-0058 (p. 40475)
-    double maxAllowedSetpointT_C;
-    std::string why;
-    if (isNewSetpointPossible(HPWH::testSetpointT_C, maxAllowedSetpointT_C, why, UNITS_C))
-    {
-        setSetpoint(HPWH::testSetpointT_C);
-    }
-    else
-    {
-        if (isNewSetpointPossible(maxAllowedSetpointT_C, maxAllowedSetpointT_C, why, UNITS_C))
-            setSetpoint(maxAllowedSetpointT_C);
-    }
-
-    prepareForTest(testConfiguration);
-
     TestSummary testSummary;
     testSummary.testDataSet = {};
 
@@ -3905,6 +4427,27 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
     double prevTankT_C = getAverageTankTemp_C();
     double initialTankT_C = prevTankT_C;
 
+    // derivatives with respect to any tracked performance coefficients
+    TestGradients gradients;
+    Gradient prevTankTGradient_C;
+    if (sensitivity)
+    {
+        for (auto gradient : {&gradients.usedEnergy_kJ,
+                              &gradients.deliveredEnergy_kJ,
+                              &gradients.recoveryUsedEnergy_kJ,
+                              &gradients.recoveryStoredEnergy_kJ,
+                              &gradients.recoveryDeliveredEnergy_kJ,
+                              &gradients.standbyUsedEnergy_kJ,
+                              &gradients.standbyStartTankT_C,
+                              &gradients.standbyEndTankT_C,
+                              &gradients.standbyAverageTankT_C})
+            *gradient = sensitivity->zero();
+        prevTankTGradient_C = tank->getAverageNodeTGradient_C();
+        gradients.initialTankT_C = prevTankTGradient_C;
+    }
+    Gradient recoverySumOutletVolumeTGradient_LC = gradients.deliveredEnergy_kJ;
+    Gradient standbySumTimeTankTGradient_minC = gradients.standbyAverageTankT_C;
+
     double recoverySumOutletVolumeT_LC = 0.;
     double recoverySumInletVolumeT_LC = 0.;
 
@@ -4034,6 +4577,14 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
         double tankT_C = getAverageTankTemp_C();
         hasHeated |= isHeating;
 
+        Gradient tankTGradient_C, stepInputGradient_kJ, stepOutletTGradient_C;
+        if (sensitivity)
+        {
+            tankTGradient_C = tank->getAverageNodeTGradient_C();
+            stepInputGradient_kJ = sensitivity->stepInputGradient_kJ;
+            stepOutletTGradient_C = tank->outletTGradient_C;
+        }
+
         sumOutletVolumeT_LC += stepDrawVolume_L * tank->getOutletT_C();
         sumInletVolumeT_LC += stepDrawVolume_L * inletT_C;
 
@@ -4042,6 +4593,7 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
             CPWATER_kJperkgC * DENSITYWATER_kgperL * stepDrawVolume_L;
         testSummary.deliveredEnergy_kJ +=
             stepDrawHeatCapacity_kJperC * (tank->getOutletT_C() - inletT_C);
+        gradients.deliveredEnergy_kJ += stepDrawHeatCapacity_kJperC * stepOutletTGradient_C;
 
         // collect used-energy info
         double stepUsedFossilFuelEnergy_kJ = 0.;
@@ -4057,13 +4609,16 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
         testSummary.usedFossilFuelEnergy_kJ += stepUsedFossilFuelEnergy_kJ;
         testSummary.usedElectricalEnergy_kJ += stepUsedElectricalEnergy_kJ;
         testSummary.usedEnergy_kJ += stepUsedEnergy_kJ;
+        gradients.usedEnergy_kJ += stepInputGradient_kJ;
 
         if (isFirstRecoveryPeriod)
         {
             testSummary.recoveryVolumeDrawn_L += stepDrawVolume_L;
             recoverySumInletVolumeT_LC += stepDrawVolume_L * inletT_C;
             recoverySumOutletVolumeT_LC += stepDrawVolume_L * tank->getOutletT_C();
+            recoverySumOutletVolumeTGradient_LC += stepDrawVolume_L * stepOutletTGradient_C;
             testSummary.recoveryUsedEnergy_kJ += stepUsedEnergy_kJ;
+            gradients.recoveryUsedEnergy_kJ += stepInputGradient_kJ;
             if (!isDrawing)
             {
                 if (hasHeated && (!isHeating))
@@ -4078,6 +4633,15 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
                     testSummary.recoveryDeliveredEnergy_kJ =
                         CPWATER_kJperkgC * DENSITYWATER_kgperL *
                         (recoverySumOutletVolumeT_LC - recoverySumInletVolumeT_LC);
+                    if (sensitivity)
+                    {
+                        gradients.recoveryStoredEnergy_kJ =
+                            tankHeatCapacity_kJperC *
+                            (prevTankTGradient_C - gradients.initialTankT_C);
+                        gradients.recoveryDeliveredEnergy_kJ =
+                            (CPWATER_kJperkgC * DENSITYWATER_kgperL) *
+                            recoverySumOutletVolumeTGradient_LC;
+                    }
                 }
             }
         }
@@ -4088,6 +4652,7 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
                 isStandbyPeriod = false;
                 standbyPeriodHasEnded = true;
                 testSummary.standbyEndTankT_C = prevTankT_C; // Tsu,0
+                gradients.standbyEndTankT_C = prevTankTGradient_C;
                 standbyPeriodEndTime_min = runTime_min - stepTime_min;
             }
             else
@@ -4097,12 +4662,15 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
                     isStandbyPeriod = false;
                     standbyPeriodHasEnded = true;
                     testSummary.standbyEndTankT_C = prevTankT_C; // Tsu,0
+                    gradients.standbyEndTankT_C = prevTankTGradient_C;
                     standbyPeriodEndTime_min = runTime_min - stepTime_min;
                 }
                 else
                 {
                     testSummary.standbyUsedEnergy_kJ += stepUsedEnergy_kJ;
+                    gradients.standbyUsedEnergy_kJ += stepInputGradient_kJ;
                     standbySumTimeTankT_minC += stepTime_min * tankT_C;
+                    standbySumTimeTankTGradient_minC += stepTime_min * tankTGradient_C;
                     standbySumTimeAmbientT_minC += stepTime_min * ambientT_C;
                 }
             }
@@ -4112,9 +4680,11 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
         {
             isStandbyPeriod = true;
             testSummary.standbyStartTankT_C = tankT_C;
+            gradients.standbyStartTankT_C = tankTGradient_C;
             standbyPeriodStartTime_min = runTime_min;
         }
         prevTankT_C = tankT_C;
+        prevTankTGradient_C = tankTGradient_C;
     }
 
     if (!standbyPeriodHasEnded)
@@ -4122,9 +4692,11 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
         standbyPeriodHasEnded = true;
         standbyPeriodEndTime_min = endTime_min;
         testSummary.standbyEndTankT_C = prevTankT_C; // Tsu,0
+        gradients.standbyEndTankT_C = prevTankTGradient_C;
     }
 
     double finalTankT_C = prevTankT_C;
+    gradients.finalTankT_C = prevTankTGradient_C;
 
     testSummary.averageOutletT_C = sumOutletVolumeT_LC / testSummary.removedVolume_L;
     testSummary.averageInletT_C = sumInletVolumeT_LC / testSummary.removedVolume_L;
@@ -4153,6 +4725,7 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
     // find the energy consumed during the standby-loss test, Qstdby
     // testSummary.standbyUsedEnergy_kJ = standbyEndTankEnergy_kJ - standbyStartTankEnergy_kJ;
 
+    double standbyDifferenceT_C = 0.; // nonzero if UA was found
     testSummary.standbyPeriodDuration_h =
         (standbyPeriodEndTime_min - standbyPeriodStartTime_min - 1.) / min_per_hr; // tau_stby,1
     if ((testSummary.standbyPeriodDuration_h > 0) && (testSummary.recoveryEfficiency > 0.))
@@ -4167,6 +4740,9 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
 
         double standbyAverageTankT_C =
             standbySumTimeTankT_minC / (standbyPeriodEndTime_min - standbyPeriodStartTime_min - 1.);
+        gradients.standbyAverageTankT_C =
+            standbySumTimeTankTGradient_minC /
+            (standbyPeriodEndTime_min - standbyPeriodStartTime_min - 1.);
         double standbyAverageAmbientT_C =
             standbySumTimeAmbientT_minC /
             (standbyPeriodEndTime_min - standbyPeriodStartTime_min - 1.);
@@ -4176,6 +4752,7 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
         {
             testSummary.standbyLossCoefficient_kJperhC =
                 testSummary.standbyHourlyLossEnergy_kJperh / dT_C; // UA
+            standbyDifferenceT_C = dT_C;
         }
     }
 
@@ -4242,6 +4819,16 @@ HPWH::TestSummary HPWH::run24hrTest(TestConfiguration testConfiguration,
             standardDeliveredEnergy_kJ / testSummary.modifiedConsumedWaterHeatingEnergy_kJ;
     }
 
+    if (sensitivity)
+    {
+        testSummary.EF_gradient = findEF_Gradient(testSummary,
+                                                  gradients,
+                                                  tankHeatCapacity_kJperC,
+                                                  finalTankT_C - initialTankT_C,
+                                                  standbyDifferenceT_C,
+                                                  standardAmbientT_C);
+    }
+
     // find the "Annual Energy Consumption" (6.4.5)
     testSummary.annualConsumedEnergy_kJ = 0.;
     if (testSummary.EF > 0.)
@@ -4412,7 +4999,9 @@ HPWH::TestSummary HPWH::makeGenericUEF(double targetUEF,
 }
 
 //-----------------------------------------------------------------------------
-///	@brief	Modify *this hpwh to meet at E50, UEF, and E95 configurations
+///	@brief	Modify *this hpwh to meet at E50, UEF, and E95 configurations,
+///         varying the constant COP coefficient nearest each configuration
+///         in a single least-squares fit
 //-----------------------------------------------------------------------------
 void HPWH::makeGenericE50_UEF_E95(double targetE50,
                                   double targetUEF,
@@ -4420,10 +5009,54 @@ void HPWH::makeGenericE50_UEF_E95(double targetE50,
                                   FirstHourRating::Designation designation,
                                   HPWH::PerformancePolySet& perfPolySet)
 {
-    // returned test summaries are unused
-    makeGenericEF(targetE50, testConfiguration_E50, designation, perfPolySet);
-    makeGenericEF(targetUEF, testConfiguration_UEF, designation, perfPolySet);
-    makeGenericEF(targetE95, testConfiguration_E95, designation, perfPolySet);
+    auto compressor = getCompressor();
+    if (!compressor)
+        send_error("No compressor");
+
+    std::vector<std::pair<double, TestConfiguration>> targets = {
+        {targetE50, testConfiguration_E50},
+        {targetUEF, testConfiguration_UEF},
+        {targetE95, testConfiguration_E95}};
+
+    // set up metrics, and a parameter for each distinct temperature index
+    std::vector<std::shared_ptr<Fitter::Metric>> metrics = {};
+    std::vector<std::shared_ptr<Fitter::Parameter>> parameters;
+    std::vector<int> i_ambientTs;
+    for (auto& target : targets)
+    {
+        metrics.push_back(std::make_shared<HPWH::Fitter::EF_Metric>(
+            target.first, target.second, designation, get_courier(), this));
+
+        int i_ambientT = perfPolySet.getAmbientT_index(target.second.ambientT_C);
+        if (std::find(i_ambientTs.begin(), i_ambientTs.end(), i_ambientT) == i_ambientTs.end())
+        {
+            i_ambientTs.push_back(i_ambientT);
+            parameters.push_back(std::make_shared<HPWH::Fitter::COP_Coefficient>(
+                i_ambientT, 0, get_courier(), &perfPolySet));
+        }
+    }
+
+    compressor->evaluatePerformance = perfPolySet.use();
+
+    Fitter fitter(metrics, parameters, get_courier());
+    fitter.fit();
+
+    compressor->evaluatePerformance = perfPolySet.make();
+
+    for (auto& target : targets)
+    {
+        auto performance1 =
+            compressor->getPerformance(target.second.ambientT_C, compressor->maxSetpoint_C);
+
+        if (performance1.cop < 0.)
+            send_error("COP is negative at maximum condenser temperature.");
+
+        /// low condenserT_C
+        auto performance0 = compressor->getPerformance(target.second.ambientT_C, 0.);
+
+        if (performance0.cop < performance1.cop)
+            send_error("COP slope is positive.");
+    }
 }
 
 int HPWH::PerformancePolySet::getAmbientT_index(double ambientT_C) const
@@ -4445,18 +5078,17 @@ int HPWH::PerformancePolySet::getAmbientT_index(double ambientT_C) const
     return (ratio < 0.5) ? i0 : i1;
 }
 
-HPWH::Performance HPWH::PerformancePolySet::evaluate(double externalT_C, double heatSourceT_C) const
+/// find the pair of polynomials to interpolate between at externalT_F
+static void findInterpolationIndices(const HPWH::PerformancePolySet& perfPolySet,
+                                     double externalT_F,
+                                     size_t& i_prev,
+                                     size_t& i_next)
 {
-    Performance performance = {0., 0., 0.};
-
-    size_t i_prev = 0;
-    size_t i_next = 1;
-
-    double externalT_F = C_TO_F(externalT_C);
-    double heatSourceT_F = C_TO_F(heatSourceT_C);
-    for (size_t i = 0; i < size(); ++i)
+    i_prev = 0;
+    i_next = 1;
+    for (size_t i = 0; i < perfPolySet.size(); ++i)
     {
-        if (externalT_F < at(i).T_F)
+        if (externalT_F < perfPolySet.at(i).T_F)
         {
             if (i == 0)
             {
@@ -4472,7 +5104,7 @@ HPWH::Performance HPWH::PerformancePolySet::evaluate(double externalT_C, double
         }
         else
         {
-            if (i == size() - 1)
+            if (i == perfPolySet.size() - 1)
             {
                 i_prev = i - 1;
                 i_next = i;
@@ -4480,6 +5112,17 @@ HPWH::Performance HPWH::PerformancePolySet::evaluate(double externalT_C, double
             }
         }
     }
+}
+
+HPWH::Performance HPWH::PerformancePolySet::evaluate(double externalT_C, double heatSourceT_C) const
+{
+    Performance performance = {0., 0., 0.};
+
+    size_t i_prev, i_next;
+
+    double externalT_F = C_TO_F(externalT_C);
+    double heatSourceT_F = C_TO_F(heatSourceT_C);
+    findInterpolationIndices(*this, externalT_F, i_prev, i_next);
 
     // Calculate COP and Input Power at each of the two reference temperatures
     double COP_T1 = at(i_prev).COP_coeffs[0];
@@ -4510,6 +5153,46 @@ HPWH::Performance HPWH::PerformancePolySet::evaluate(double externalT_C, double
     return performance;
 }
 
+void HPWH::PerformancePolySet::getGradient(double externalT_C,
+                                           double heatSourceT_C,
+                                           const std::vector<CoefficientIndex>& coefficients,
+                                           Gradient& inputPowerGradient_W,
+                                           Gradient& copGradient,
+                                           double& inputPowerSlope_WperC,
+                                           double& copSlope_perC) const
+{
+    size_t i_prev, i_next;
+
+    double externalT_F = C_TO_F(externalT_C);
+    double heatSourceT_F = C_TO_F(heatSourceT_C);
+    findInterpolationIndices(*this, externalT_F, i_prev, i_next);
+
+    // interpolation weight of the polynomial at i_next
+    double fraction = (externalT_F - at(i_prev).T_F) / (at(i_next).T_F - at(i_prev).T_F);
+
+    inputPowerGradient_W = Gradient(coefficients.size());
+    copGradient = Gradient(coefficients.size());
+    for (std::size_t iCoeff = 0; iCoeff < coefficients.size(); ++iCoeff)
+    {
+        auto& coefficient = coefficients[iCoeff];
+        double weight = 0.;
+        if (coefficient.temperatureIndex == i_prev)
+            weight += 1. - fraction;
+        if (coefficient.temperatureIndex == i_next)
+            weight += fraction;
+        auto& gradient = coefficient.ofInputPower ? inputPowerGradient_W : copGradient;
+        gradient[iCoeff] = weight * std::pow(heatSourceT_F, coefficient.exponent);
+    }
+
+    // d/dT_C = 1.8 d/dT_F
+    auto slope_perC = [&](const std::vector<double>& coeffs)
+    { return 1.8 * (coeffs[1] + 2. * coeffs[2] * heatSourceT_F); };
+    inputPowerSlope_WperC = (1. - fraction) * slope_perC(at(i_prev).inputPower_coeffs) +
+                            fraction * slope_perC(at(i_next).inputPower_coeffs);
+    copSlope_perC = (1. - fraction) * slope_perC(at(i_prev).COP_coeffs) +
+                    fraction * slope_perC(at(i_next).COP_coeffs);
+}
+
 static double regressedMethod(const std::vector<double>& coef, double x1, double x2, double x3)
 {
     return coef[0] + coef[1] * x1 + coef[2] * x2 + coef[3] * x3 + coef[4] * x1 * x1 +
@@ -4527,20 +5210,23 @@ static double regressedMethodMP(const std::vector<double>& coef, double x1, doub
 std::function<HPWH::Performance(double, double)>
 HPWH::PerformancePoly_CWHS_SP::make(Condenser* condenser) const
 {
-    return [*this, condenser](double externalT_C, double heatSourceT_C)
-    {
-        Performance performance = {0., 0., 0.};
+    return Evaluator {*this, condenser};
+}
 
-        double T1 = C_TO_F(externalT_C);
-        double T2 = C_TO_F(condenser->hpwh->getSetpoint() +
-                           condenser->secondaryHeatExchanger.hotSideTemperatureOffset_dC);
-        double T3 = C_TO_F(heatSourceT_C);
+HPWH::Performance HPWH::PerformancePoly_CWHS_SP::Evaluator::operator()(double externalT_C,
+                                                                       double heatSourceT_C) const
+{
+    Performance performance = {0., 0., 0.};
 
-        performance.inputPower_W = KW_TO_W(regressedMethod(inputPower_coeffs, T1, T2, T3));
-        performance.cop = regressedMethod(COP_coeffs, T1, T2, T3);
-        performance.outputPower_W = performance.cop * performance.inputPower_W;
-        return performance;
-    };
+    double T1 = C_TO_F(externalT_C);
+    double T2 = C_TO_F(condenser->hpwh->getSetpoint() +
+                       condenser->secondaryHeatExchanger.hotSideTemperatureOffset_dC);
+    double T3 = C_TO_F(heatSourceT_C);
+
+    performance.inputPower_W = KW_TO_W(regressedMethod(perfPoly.inputPower_coeffs, T1, T2, T3));
+    performance.cop = regressedMethod(perfPoly.COP_coeffs, T1, T2, T3);
+    performance.outputPower_W = performance.cop * performance.inputPower_W;
+    return performance;
 }
 
 std::function<HPWH::Performance(double, double)> HPWH::PerformancePoly_CWHS_MP::make() const
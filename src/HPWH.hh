@@ -9,9 +9,11 @@
 #include <iomanip>
 #include <functional>
 #include <memory>
+#include <mutex>
 
 #include <cstdio>
 #include <cstdlib> //for exit
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 
@@ -61,6 +63,18 @@ class HPWH : public Courier::Sender
     struct HeatingLogic;
     struct SoCBasedHeatingLogic;
     struct TempBasedHeatingLogic;
+    class ModelSpec;
+    class Fleet;
+    class TimeParallel;
+    class Sweep;
+    class SparseSchedule;
+    class ScheduleSet;
+    class ScheduleStream;
+    class CSVSink;
+    class OutputSpec;
+    class ResultsWriter;
+    class ResultsReader;
+    class JSONLoader;
 
     static const int version_major = HPWHVRSN_MAJOR;
     static const int version_minor = HPWHVRSN_MINOR;
@@ -95,6 +109,10 @@ class HPWH : public Courier::Sender
                                                                                        eventually?
               */
 
+    /// returns an independent copy; the tank, heat sources, and heating logics are deep-copied
+    /// and rebound to the copy
+    std::unique_ptr<HPWH> clone() const { return std::make_unique<HPWH>(*this); }
+
     void from(const hpwh_data_model::hpwh_sim_input::HPWHSimInput& hsi);
 
     void to(hpwh_data_model::hpwh_sim_input::HPWHSimInput& hsi) const;
@@ -122,6 +140,71 @@ class HPWH : public Courier::Sender
                            defined by timer_TOT. */
     };
 
+    /// derivatives of a quantity with respect to the parameters being differentiated;
+    /// an empty gradient counts as zero, so arithmetic is a no-op when none are
+    struct Gradient : public std::vector<double>
+    {
+        Gradient() = default;
+        explicit Gradient(std::size_t nParameters) : std::vector<double>(nParameters, 0.) {}
+
+        Gradient& operator+=(const Gradient& gradient)
+        {
+            if (empty())
+                assign(gradient.begin(), gradient.end());
+            else
+                for (std::size_t i = 0; i < gradient.size(); ++i)
+                    (*this)[i] += gradient[i];
+            return *this;
+        }
+
+        Gradient& operator-=(const Gradient& gradient) { return *this += -1. * gradient; }
+
+        Gradient& operator*=(double factor)
+        {
+            for (auto& value : *this)
+                value *= factor;
+            return *this;
+        }
+
+        Gradient& operator/=(double divisor) { return *this *= 1. / divisor; }
+
+        friend Gradient operator+(Gradient lhs, const Gradient& rhs) { return lhs += rhs; }
+        friend Gradient operator-(Gradient lhs, const Gradient& rhs) { return lhs -= rhs; }
+        friend Gradient operator*(double factor, Gradient gradient) { return gradient *= factor; }
+        friend Gradient operator*(Gradient gradient, double factor) { return gradient *= factor; }
+        friend Gradient operator/(Gradient gradient, double divisor) { return gradient /= divisor; }
+    };
+
+    ///	@struct State
+    /// the dynamic state of a simulated unit, excluding configuration
+    struct State
+    {
+        std::vector<double> tankTs_C; /**< tank node temperatures, 0 is the bottom node */
+        std::vector<std::uint8_t> heatSourceFlags; /**< isOn and lockedOut bits, by heat source */
+        double setpoint_C;
+        double currentSoCFraction;
+        double locationTemperature_C;
+        double timerTOT;
+        DRMODES prevDRstatus;
+        bool isHeating;
+
+        static constexpr std::uint8_t isOnFlag = 0b01;
+        static constexpr std::uint8_t lockedOutFlag = 0b10;
+    };
+
+    /// take a snapshot of the dynamic state, reusing the storage in state
+    void getState(State& state) const;
+
+    State getState() const
+    {
+        State state;
+        getState(state);
+        return state;
+    }
+
+    /// restore a snapshot taken from this or an identically configured instance
+    void setState(const State& state);
+
     /// specifies the allowable preset HPWH models
     /// values may vary - names should be used
     hpwh_presets::MODELS model;
@@ -636,16 +719,27 @@ class HPWH : public Courier::Sender
 
     void configure();
 
-    /// init Preset from embedded CBOR representation
+    /// init Preset from its embedded representation, CBOR or compiled (HPWHsim_COMPILED_PRESETS);
+    /// each preset is read once per process, and instances using the default courier copy the
+    /// model from a prototype configured once, keeping their own courier
     void initPreset(hpwh_presets::MODELS presetNum);
     void initPreset(const std::string& modelName);
 
+    static void clearPresetCache();
+
+    /// one instance of every preset, in catalog order
+    static std::vector<std::unique_ptr<HPWH>> initAllPresets();
+
     void initLegacy(hpwh_presets::MODELS presetNum);
     void initLegacy(const std::string& modelName);
 
     /// init from hpwh-data-model in JSON format
     void initFromJSON(const nlohmann::json& j, const std::string& modelName = "custom");
 
+    /// init from hpwh-data-model JSON text, read by a JSONLoader without building a JSON tree
+    /// of the performance maps
+    void initFromJSON(std::istream& is, const std::string& modelName = "custom");
+
     void runOneStep(double drawVolume_L,
                     double ambientT_C,
                     double externalT_C,
@@ -1085,7 +1179,10 @@ class HPWH : public Courier::Sender
 
     /// Addition of heat from a normal heat sources; return excess heat, if needed, to prevent
     /// exceeding maximum or setpoint
-    double addHeatAboveNode(double qAdd_kJ, const int nodeNum, const double maxT_C);
+    double addHeatAboveNode(double qAdd_kJ,
+                            const int nodeNum,
+                            const double maxT_C,
+                            Gradient* qAddGradient_kJ = nullptr);
 
     /// Addition of extra heat handled separately from normal heat sources
     void addExtraHeatAboveNode(double qAdd_kJ, const int nodeNum);
@@ -1136,6 +1233,8 @@ class HPWH : public Courier::Sender
 
     void writeCSVHeading(std::ostream* out, int options = CSVOPT_NONE) const;
 
+    void writeCSVHeading(CSVSink& sink, int options = CSVOPT_NONE) const;
+
     int writeCSVRow(std::ofstream& outFILE,
                     const char* preamble = "",
                     int nTCouples = 6,
@@ -1143,6 +1242,16 @@ class HPWH : public Courier::Sender
 
     void writeCSVRow(std::ostream* out, TestData& testData, int options = CSVOPT_NONE) const;
 
+    /// rows written through a sink are buffered rather than flushed; see HPWH::CSVSink
+    void writeCSVRow(CSVSink& sink, const TestData& testData, int options = CSVOPT_NONE) const;
+
+    /// the CSV columns, in the binary columnar format; see HPWH::ResultsWriter
+    void writeResultsHeading(ResultsWriter& writer, int options = CSVOPT_NONE) const;
+
+    void writeResultsRow(ResultsWriter& writer,
+                         const TestData& testData,
+                         int options = CSVOPT_NONE) const;
+
     /**< a couple of function to write the outputs to a file
         they both will return 0 for success
         the preamble should be supplied with a trailing comma, as these functions do
@@ -1195,6 +1304,9 @@ class HPWH : public Courier::Sender
 
         std::vector<TestData> testDataSet = {};
 
+        /// derivatives of EF with respect to requested performance coefficients, if any
+        std::vector<double> EF_gradient = {};
+
         // return a verbose string summary
         nlohmann::json report();
     };
@@ -1217,15 +1329,71 @@ class HPWH : public Courier::Sender
     /// determine first-hour rating
     FirstHourRating findFirstHourRating();
 
+    /// first-hour rating, found on a copy of this model unless already found for a model
+    /// with the same test-parameter key
+    FirstHourRating getFirstHourRating() const;
+
+    static void clearFirstHourRatingCache();
+
+    /// lookups in a cache since it was last cleared
+    struct CacheCounts
+    {
+        std::size_t nHits = 0;
+        std::size_t nMisses = 0;
+    };
+
+    static CacheCounts getFirstHourRatingCacheCounts();
+
+    /// the model as serialized, together with the compressor performance sampled at the
+    /// standard test conditions (which may differ from the serialized maps while fitting) and
+    /// the dynamic state, from which the test cycle starts
+    std::string getTestParameterKey() const;
+
+    /// state of a copy of this model prepared for the test (setpoint set, draw/heat cycle run)
+    State getPreparedState(const TestConfiguration& testConfiguration) const;
+
     /// run 24-hr draw pattern
     TestSummary run24hrTest(TestConfiguration testConfiguration,
                             FirstHourRating::Designation designation);
 
+    /// run 24-hr draw pattern starting from a prepared state, skipping the draw/heat cycle;
+    /// valid if the model has changed only in performance since the state was prepared
+    TestSummary run24hrTest(TestConfiguration testConfiguration,
+                            FirstHourRating::Designation designation,
+                            const State& preparedState);
+
     TestSummary run24hrTest(TestConfiguration testConfiguration)
     {
-        return run24hrTest(testConfiguration, findFirstHourRating().designation);
+        return run24hrTest(testConfiguration, getFirstHourRating().designation);
     }
 
+    /// first-hour rating and 24-hr tests at the E50, UEF, and E95 configurations
+    struct StandardTestResults
+    {
+        FirstHourRating firstHourRating;
+        bool hasFirstHourRating = false; /**< false if the designation was given */
+        double firstHourRatingTime_s = 0.;
+
+        struct ConfiguredTest
+        {
+            std::string name;
+            TestConfiguration testConfiguration;
+            TestSummary testSummary;
+            double elapsedTime_s = 0.;
+        };
+        std::vector<ConfiguredTest> tests; /**< E50, UEF, E95 */
+
+        nlohmann::json report();
+    };
+
+    /// find the first-hour rating, then run the three standard 24-hr tests concurrently on
+    /// copies of this model, which is not modified
+    StandardTestResults measureAll(unsigned nThreads = 0) const;
+
+    /// run the three standard 24-hr tests concurrently for the given designation
+    StandardTestResults measureAll(FirstHourRating::Designation designation,
+                                   unsigned nThreads = 0) const;
+
     /// specific information for a single draw
     struct Draw
     {
@@ -1251,6 +1419,47 @@ class HPWH : public Courier::Sender
     /// collection of standard draw patterns
     static std::unordered_map<FirstHourRating::Designation, DrawPattern> drawPatterns;
 
+    /// conditions for a single step of a forecast
+    struct ForecastStep
+    {
+        double inletT_C;
+        double drawVolume_L;
+        double ambientT_C;
+        double externalT_C;
+    };
+
+    /// sequence of steps, one per simulation step
+    typedef std::vector<ForecastStep> ForecastSchedule;
+
+    /// demand-response option to evaluate
+    struct DRCandidate
+    {
+        DRMODES drMode;
+        double timerLimitTOT_min = 60.; /**< used with DR_TOT */
+    };
+
+    /// result of evaluating a single candidate over the forecast horizon
+    struct ForecastSummary
+    {
+        DRCandidate candidate;
+        double energyInput_kWh = 0.;
+        double energyOutput_kWh = 0.;
+        double drawVolume_L = 0.;
+        double shortfallVolume_L = 0.; /**< volume drawn below the minimum useful temperature */
+        double shortfallEnergy_kWh =
+            0.; /**< energy needed to raise outlet water to the minimum useful temperature */
+        double minOutletT_C = 0.; /**< lowest outlet temperature during draws */
+        State finalState;
+    };
+
+    /// Evaluate each candidate over the horizon, starting from the current state, on private
+    /// copies run in parallel. This instance is not modified.
+    std::vector<ForecastSummary> forecast(double horizon_min,
+                                          const ForecastSchedule& schedule,
+                                          const std::vector<DRCandidate>& candidates,
+                                          double minUsefulT_C = 43.333,
+                                          unsigned nThreads = 0) const;
+
     struct Fitter;
 
     struct Performance
@@ -1291,6 +1500,24 @@ class HPWH : public Courier::Sender
 
         Performance evaluate(double externalT_C, double heatSourceT_C) const;
 
+        /// identifies a coefficient of the polynomial at one temperature
+        struct CoefficientIndex
+        {
+            unsigned temperatureIndex;
+            unsigned exponent;
+            bool ofInputPower = false; /**< otherwise of the COP */
+        };
+
+        /// derivatives of the input power and COP from evaluate with respect to the given
+        /// coefficients, and their slopes with respect to the heat-source temperature
+        void getGradient(double externalT_C,
+                         double heatSourceT_C,
+                         const std::vector<CoefficientIndex>& coefficients,
+                         Gradient& inputPowerGradient_W,
+                         Gradient& copGradient,
+                         double& inputPowerSlope_WperC,
+                         double& copSlope_perC) const;
+
         inline std::function<Performance(double, double)> make() const
         {
             return [*this](double externalT_C, double heatSourceT_C)
@@ -1320,6 +1547,15 @@ class HPWH : public Courier::Sender
         {
         }
 
+        /// evaluates the polynomial at the current setpoint of its condenser
+        struct Evaluator
+        {
+            PerformancePoly perfPoly;
+            const Condenser* condenser;
+
+            Performance operator()(double externalT_C, double heatSourceT_C) const;
+        };
+
         std::function<Performance(double, double)> make(Condenser* condenser) const;
     };
 
@@ -1352,7 +1588,7 @@ class HPWH : public Courier::Sender
                               PerformancePolySet& perfPolySet)
     {
         return makeGenericEF(
-            targetEF, testConfiguration, findFirstHourRating().designation, perfPolySet);
+            targetEF, testConfiguration, getFirstHourRating().designation, perfPolySet);
     }
     TestSummary makeGenericEF(double targetEF,
                               TestConfiguration testConfiguration,
@@ -1367,10 +1603,10 @@ class HPWH : public Courier::Sender
                               const PerformancePolySet& perfPolySet)
     {
         return makeGenericEF(
-            targetEF, testConfiguration, findFirstHourRating().designation, perfPolySet);
+            targetEF, testConfiguration, getFirstHourRating().designation, perfPolySet);
     }
 
-    /// fit using each of three configurations, independently
+    /// fit to all three configurations jointly
     void makeGenericE50_UEF_E95(double targetE50,
                                 double targetUEF,
                                 double targetE95,
@@ -1382,7 +1618,7 @@ class HPWH : public Courier::Sender
                                 PerformancePolySet& perfPolySet)
     {
         return makeGenericE50_UEF_E95(
-            targetE50, targetUEF, targetE95, findFirstHourRating().designation, perfPolySet);
+            targetE50, targetUEF, targetE95, getFirstHourRating().designation, perfPolySet);
     }
     void makeGenericE50_UEF_E95(double targetE50,
                                 double targetUEF,
@@ -1399,7 +1635,7 @@ class HPWH : public Courier::Sender
                                 const PerformancePolySet& perfPolySet)
     {
         return makeGenericE50_UEF_E95(
-            targetE50, targetUEF, targetE95, findFirstHourRating().designation, perfPolySet);
+            targetE50, targetUEF, targetE95, getFirstHourRating().designation, perfPolySet);
     }
 
     /// fit using UEF config, then adjust E50, E95 coefficients
@@ -1408,7 +1644,7 @@ class HPWH : public Courier::Sender
                                PerformancePolySet& perfPolySet);
     TestSummary makeGenericUEF(double targetUEF, PerformancePolySet& perfPolySet)
     {
-        return makeGenericUEF(targetUEF, findFirstHourRating().designation, perfPolySet);
+        return makeGenericUEF(targetUEF, getFirstHourRating().designation, perfPolySet);
     }
     TestSummary makeGenericUEF(double targetUEF,
                                FirstHourRating::Designation designation,
@@ -1419,9 +1655,20 @@ class HPWH : public Courier::Sender
     }
     TestSummary makeGenericUEF(double targetUEF, const PerformancePolySet& perfPolySet)
     {
-        return makeGenericUEF(targetUEF, findFirstHourRating().designation, perfPolySet);
+        return makeGenericUEF(targetUEF, getFirstHourRating().designation, perfPolySet);
     }
 
+    /// Run 24-hr draw pattern, also finding the gradient of EF with respect to COP and
+    /// input-power coefficients of perfPolySet, which the compressor must be evaluating.
+    /// Derivatives of the tank temperatures, run times, and energies are carried alongside
+    /// the simulation with its control decisions held fixed, so one test gives the gradient
+    /// with respect to every coefficient. Starts from preparedState, if given.
+    TestSummary run24hrTest(TestConfiguration testConfiguration,
+                            FirstHourRating::Designation designation,
+                            const PerformancePolySet& perfPolySet,
+                            const std::vector<PerformancePolySet::CoefficientIndex>& coefficients,
+                            const State* preparedState = nullptr);
+
     static void linearInterp(double& ynew, double xnew, double x0, double x1, double y0, double y1);
 
     bool useCOP_inBtwxt = false;
@@ -1452,9 +1699,24 @@ class HPWH : public Courier::Sender
     ///  "extra" heat added during a simulation step
     double extraEnergyInput_kWh;
 
+    /// performance coefficients being differentiated during a test
+    struct Sensitivity
+    {
+        const PerformancePolySet* perfPolySet;
+        std::vector<PerformancePolySet::CoefficientIndex> coefficients;
+        Gradient stepInputGradient_kJ;    /**< reset each step */
+        Gradient heatingTimeGradient_min; /**< of the time given to the heat source adding heat */
+
+        Gradient zero() const { return Gradient(coefficients.size()); }
+    };
+    Sensitivity* sensitivity = nullptr; /**< not copied */
+
     /// shift temperatures of tank nodes with indices in the range [mixBottomNode, mixBelowNode)
     /// by a factor mixFactor towards their average temperature
-    void mixTankNodes(int mixBottomNode, int mixBelowNode, double mixFactor);
+    void mixTankNodes(int mixBottomNode,
+                      int mixBelowNode,
+                      double mixFactor,
+                      const Gradient& mixFactorGradient = {});
 
     void calcDerivedValues();
     /**< a helper function for the inits, calculating condentropy and the lowest node  */
@@ -1557,6 +1819,20 @@ class HPWH : public Courier::Sender
     /// Generates a top-hat distribution
     Distribution getRangeDistribution(double bottomFraction, double topFraction);
 
+    /// change setpoint to DOE test value, or highest available
+    void setTestSetpoint();
+
+    /// run 24-hr draw pattern after prepareForTest
+    TestSummary runPrepared24hrTest(TestConfiguration testConfiguration,
+                                    FirstHourRating::Designation designation);
+
+    /// held while the global data-model loggers are set and used by from_json
+    static std::mutex& getDataModelMutex();
+
+    /// copy the model and its state, but not the Sender; the copied tank and heat sources
+    /// report to this instance's courier
+    void copyModel(const HPWH& hpwh);
+
   public:
     static double getResampledValue(const std::vector<double>& sampleValues,
                                     double beginFraction,
@@ -1587,6 +1863,14 @@ class HPWH : public Courier::Sender
                                 const std::vector<double>& nodeT_C,
                                 const double setpointT_C);
 
+    /// derivatives of calcThermalDist, given those of the node temperatures
+    static void calcThermalDistGradient(std::vector<Gradient>& thermalDistGradient,
+                                        const double shrinkageT_C,
+                                        const int lowestNode,
+                                        const std::vector<double>& nodeT_C,
+                                        const std::vector<Gradient>& nodeTGradient_C,
+                                        const double setpointT_C);
+
     static void scaleVector(std::vector<double>& coeffs, const double scaleFactor);
 
     static double getChargePerNode(double tCold, double tMix, double tHot);
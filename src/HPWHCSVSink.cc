@@ -0,0 +1,128 @@
+/*
+ * Implementation of class HPWH::CSVSink
+ */
+
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHCSVSink.hh"
+
+HPWH::CSVSink::CSVSink(const std::string& filepath,
+                       bool useWriterThread /*=false*/,
+                       std::size_t flushSize_in /*=defaultFlushSize*/,
+                       const std::shared_ptr<Courier::Courier>& courier)
+    : Sender("CSVSink", filepath, courier)
+    , destination(filepath)
+    , file(std::make_unique<std::ofstream>(filepath, std::ios::out | std::ios::trunc))
+    , stream(file.get())
+    , flushSize(flushSize_in)
+{
+    if (!file->is_open())
+    {
+        send_error(fmt::format("Could not open output file {}", filepath));
+    }
+    if (useWriterThread)
+        writer = std::thread(&CSVSink::work, this);
+}
+
+HPWH::CSVSink::CSVSink(std::ostream& stream_in,
+                       bool useWriterThread /*=false*/,
+                       std::size_t flushSize_in /*=defaultFlushSize*/,
+                       const std::shared_ptr<Courier::Courier>& courier)
+    : Sender("CSVSink", "stream", courier)
+    , destination("stream")
+    , stream(&stream_in)
+    , flushSize(flushSize_in)
+{
+    if (useWriterThread)
+        writer = std::thread(&CSVSink::work, this);
+}
+
+HPWH::CSVSink::~CSVSink()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void HPWH::CSVSink::writeBuffer()
+{
+    if (!writer.joinable())
+    {
+        stream->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+        return;
+    }
+
+    // the writer thread has finished with the previous buffer once hasPending is cleared
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return !hasPending; });
+    std::swap(buffer, pendingBuffer);
+    hasPending = true;
+    changed.notify_all();
+}
+
+void HPWH::CSVSink::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this]() { return hasPending || stopping; });
+        if (!hasPending)
+            return;
+
+        // only this thread touches pendingBuffer while hasPending is set
+        lock.unlock();
+        stream->write(pendingBuffer.data(), static_cast<std::streamsize>(pendingBuffer.size()));
+        pendingBuffer.clear();
+        lock.lock();
+        hasPending = false;
+        changed.notify_all();
+    }
+}
+
+void HPWH::CSVSink::flush()
+{
+    if (isClosed)
+        return;
+    writeBuffer();
+    if (writer.joinable())
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return !hasPending; });
+    }
+    stream->flush();
+}
+
+void HPWH::CSVSink::close()
+{
+    if (isClosed)
+        return;
+    isClosed = true;
+    writeBuffer();
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+    }
+
+    // a stream owned elsewhere is left unflushed, and its state to its owner
+    if (file)
+    {
+        file->close();
+        if (file->fail())
+        {
+            send_error(fmt::format("Could not write {}", destination));
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef HPWHCSVSINK_hh
+#define HPWHCSVSINK_hh
+
+#include "HPWH.hh"
+#include <condition_variable>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <fmt/format.h>
+
+///	@class HPWH::CSVSink HPWHCSVSink.hh
+/// Buffered destination for CSV output. Fields are formatted straight into a reusable buffer,
+/// which is written out only once it exceeds flushSize, or on flush or close; rows do not flush
+/// the stream. With a writer thread, a full buffer is handed to the thread and formatting
+/// continues in a second buffer, so writing overlaps simulation.
+class HPWH::CSVSink : public Sender
+{
+  public:
+    static constexpr std::size_t defaultFlushSize = 1 << 20;
+
+    /// write to a new file
+    explicit CSVSink(
+        const std::string& filepath,
+        bool useWriterThread = false,
+        std::size_t flushSize_in = defaultFlushSize,
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    /// write to an open stream, which must outlive the sink
+    explicit CSVSink(
+        std::ostream& stream_in,
+        bool useWriterThread = false,
+        std::size_t flushSize_in = defaultFlushSize,
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    CSVSink(const CSVSink&) = delete;
+    CSVSink& operator=(const CSVSink&) = delete;
+
+    /// writes out anything buffered; errors are only reported by close
+    ~CSVSink();
+
+    template <typename... T>
+    void write(fmt::format_string<T...> format, T&&... args)
+    {
+        fmt::format_to(std::back_inserter(buffer), format, std::forward<T>(args)...);
+    }
+
+    void write(std::string_view text) { buffer.append(text.data(), text.data() + text.size()); }
+
+    /// end the current row
+    void endRow()
+    {
+        buffer.push_back('\n');
+        if (buffer.size() >= flushSize)
+            writeBuffer();
+    }
+
+    /// write out all buffered rows and flush the stream
+    void flush();
+
+    /// write out all buffered rows, stop the writer thread, and close the file, if any
+    void close();
+
+  private:
+    std::string destination;             /**< for messages */
+    std::unique_ptr<std::ofstream> file; /**< set if the sink opened the file */
+    std::ostream* stream;
+    std::size_t flushSize;
+    fmt::memory_buffer buffer; /**< rows being formatted */
+
+    // writer thread
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable changed;
+    fmt::memory_buffer pendingBuffer; /**< rows being written by the writer thread */
+    bool hasPending = false;
+    bool stopping = false;
+
+    bool isClosed = false;
+
+    /// hand the buffer to the writer thread, or write it directly
+    void writeBuffer();
+
+    void work();
+};
+
+#endif
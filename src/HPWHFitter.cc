@@ -1,8 +1,10 @@
 
 #include <cfloat>
+#include <utility>
 
 #include "HPWH.hh"
 #include "HPWHFitter.hh"
+#include "HPWHParallel.hh"
 
 // evaluate the current metric using provided single-parameter value
 double HPWH::Fitter::getMetricSingleParameter(double x)
@@ -12,8 +14,13 @@ double HPWH::Fitter::getMetricSingleParameter(double x)
 
     if ((nParameters == 1) && (nMetrics == 1))
     {
+        std::vector<std::vector<std::shared_ptr<Metric>>> boundMetrics;
+        double value = evaluateMetrics({{x}}, boundMetrics, false)[0][0];
         *parameters[0]->data_ptr = x;
-        return metrics[0]->evaluate();
+        if (!boundMetrics[0].empty())
+            metrics[0]->adopt(*boundMetrics[0][0]);
+        lastSingleParameter = x;
+        return value;
     }
     return 1.e12;
 }
@@ -108,108 +115,326 @@ static int secant( // find x given f(x) (secant method)
 } // ::secant
 
 //-----------------------------------------------------------------------------
-///	@brief	Left pseudo-inverse an m x n (1 x 2) matrix, J, (one metric, two parameters)
-///         with scaling of diagonal terms (damping off-diagonal terms of inverse)
-///         J^L = (J^T * J + nu * diag(J^T * J))^-1 * J^T
+///	@brief	Find the damped least-squares step for an m x n Jacobian, J, and
+///         m errors, e, with scaling of diagonal terms (Levenberg-Marquardt):
+///         (J^T * J + nu * diag(J^T * J)) * dx = -J^T * e
+///         solved by Gaussian elimination with partial pivoting.
 //-----------------------------------------------------------------------------
-static bool getLeftDampedInverse(const double nu,
-                                 const std::vector<double>& matV, // 1 x 2
-                                 std::vector<double>& invMatV     // 2 x 1
+static bool getDampedStep(const double nu,
+                          const std::vector<std::vector<double>>& jacobiM, // m x n
+                          const std::vector<double>& errorV,               // m
+                          std::vector<double>& stepV                       // n
 )
 {
     constexpr double thresh = 1.e-12;
 
-    if (matV.size() != 2)
+    auto nMetrics = jacobiM.size();
+    if ((nMetrics == 0) || (errorV.size() != nMetrics))
     {
         return false;
     }
+    auto nParameters = jacobiM[0].size();
 
-    double a = matV[0];
-    double b = matV[1];
+    // augmented matrix [J^T * J + nu * diag | -J^T * e]
+    std::vector<std::vector<double>> augM(nParameters, std::vector<double>(nParameters + 1, 0.));
+    for (std::size_t i = 0; i < nParameters; ++i)
+    {
+        for (std::size_t k = 0; k < nParameters; ++k)
+        {
+            for (std::size_t j = 0; j < nMetrics; ++j)
+                augM[i][k] += jacobiM[j][i] * jacobiM[j][k];
+        }
+        augM[i][i] *= (1. + nu);
+        for (std::size_t j = 0; j < nMetrics; ++j)
+            augM[i][nParameters] -= jacobiM[j][i] * errorV[j];
+    }
+
+    for (std::size_t i = 0; i < nParameters; ++i)
+    {
+        std::size_t iPivot = i;
+        for (std::size_t k = i + 1; k < nParameters; ++k)
+        {
+            if (fabs(augM[k][i]) > fabs(augM[iPivot][i]))
+                iPivot = k;
+        }
+        if (fabs(augM[iPivot][i]) < thresh)
+        {
+            return false;
+        }
+        std::swap(augM[i], augM[iPivot]);
 
-    double A = (1. + nu) * a * a;
-    double B = (1. + nu) * b * b;
-    double C = a * b;
-    double det = A * B - C * C;
+        for (std::size_t k = i + 1; k < nParameters; ++k)
+        {
+            double factor = augM[k][i] / augM[i][i];
+            for (std::size_t l = i; l <= nParameters; ++l)
+                augM[k][l] -= factor * augM[i][l];
+        }
+    }
 
-    if (fabs(det) < thresh)
+    stepV.assign(nParameters, 0.);
+    for (std::size_t i = nParameters; i-- > 0;)
     {
+        double sum = augM[i][nParameters];
+        for (std::size_t k = i + 1; k < nParameters; ++k)
+            sum -= augM[i][k] * stepV[k];
+        stepV[i] = sum / augM[i][i];
+    }
+    return true;
+}
+
+bool HPWH::Fitter::canUseCopies() const
+{
+    // copies require one model, with a compressor, and one performance set
+    auto perfPolySet = parameters.empty() ? nullptr : parameters[0]->getPerformancePolySet();
+    auto model = metrics.empty() ? nullptr : metrics[0]->getModel();
+    bool useCopies = (perfPolySet != nullptr) && (model != nullptr) && model->hasACompressor();
+    for (auto& parameter : parameters)
+        useCopies = useCopies && (parameter->getPerformancePolySet() == perfPolySet);
+    for (auto& metric : metrics)
+        useCopies = useCopies && (metric->getModel() == model) && metric->bind(model);
+    return useCopies;
+}
+
+std::vector<std::vector<double>>
+HPWH::Fitter::evaluateMetrics(const std::vector<std::vector<double>>& parameterVs,
+                              std::vector<std::vector<std::shared_ptr<Metric>>>& boundMetrics,
+                              bool findErrors /*=true*/)
+{
+    auto nSets = parameterVs.size();
+    auto nParameters = parameters.size();
+    auto nMetrics = metrics.size();
+    std::vector<std::vector<double>> resultVs(nSets, std::vector<double>(nMetrics));
+    boundMetrics.assign(nSets, {});
+
+    if (!canUseCopies())
+    {
+        std::vector<double> parameterV(nParameters);
+        for (std::size_t i = 0; i < nParameters; ++i)
+            parameterV[i] = *parameters[i]->data_ptr;
+
+        for (std::size_t iSet = 0; iSet < nSets; ++iSet)
+        {
+            for (std::size_t i = 0; i < nParameters; ++i)
+                *parameters[i]->data_ptr = parameterVs[iSet][i];
+            for (std::size_t j = 0; j < nMetrics; ++j)
+                resultVs[iSet][j] = findErrors ? metrics[j]->findError() : metrics[j]->evaluate();
+        }
+
+        for (std::size_t i = 0; i < nParameters; ++i) // restore
+            *parameters[i]->data_ptr = parameterV[i];
+        return resultVs;
+    }
+
+    // each metric of each set gets its own copy; copies are made here and only the
+    // evaluations run concurrently
+    auto perfPolySet = parameters[0]->getPerformancePolySet();
+    auto model = metrics[0]->getModel();
+    std::vector<PerformancePolySet> perfPolySets(nSets, PerformancePolySet(*perfPolySet));
+    std::vector<std::unique_ptr<HPWH>> hpwhs(nSets * nMetrics);
+    for (std::size_t iSet = 0; iSet < nSets; ++iSet)
+    {
+        for (std::size_t i = 0; i < nParameters; ++i)
+            *parameters[i]->locate(perfPolySets[iSet]) = parameterVs[iSet][i];
+
+        for (std::size_t j = 0; j < nMetrics; ++j)
+        {
+            auto& hpwh = hpwhs[iSet * nMetrics + j];
+            hpwh = model->clone();
+            hpwh->getCompressor()->evaluatePerformance = perfPolySets[iSet].use();
+            boundMetrics[iSet].push_back(metrics[j]->bind(hpwh.get()));
+        }
+    }
+
+    hpwh_parallel::forEach(
+        nSets * nMetrics,
+        [&resultVs, &boundMetrics, nMetrics, findErrors](std::size_t iTask)
+        {
+            std::size_t iSet = iTask / nMetrics;
+            std::size_t j = iTask % nMetrics;
+            auto& metric = boundMetrics[iSet][j];
+            resultVs[iSet][j] = findErrors ? metric->findError() : metric->evaluate();
+        },
+        nThreads);
+    return resultVs;
+}
+
+bool HPWH::Fitter::evaluateJacobian(const std::vector<double>& parameterV,
+                                    std::vector<double>& errorV,
+                                    std::vector<std::vector<double>>& jacobiM,
+                                    std::vector<std::shared_ptr<Metric>>& boundMetrics)
+{
+    auto nParameters = parameters.size();
+    auto nMetrics = metrics.size();
+
+    if (!canUseCopies())
         return false;
+    for (auto& metric : metrics)
+        if (!metric->hasGradient())
+            return false;
+    std::vector<PerformancePolySet::CoefficientIndex> coefficients(nParameters);
+    for (std::size_t i = 0; i < nParameters; ++i)
+        if (!parameters[i]->getCoefficientIndex(coefficients[i]))
+            return false;
+
+    // the copies share one performance set, which the tests only read
+    PerformancePolySet perfPolySet(*parameters[0]->getPerformancePolySet());
+    for (std::size_t i = 0; i < nParameters; ++i)
+        *parameters[i]->locate(perfPolySet) = parameterV[i];
+
+    auto model = metrics[0]->getModel();
+    std::vector<std::unique_ptr<HPWH>> hpwhs(nMetrics);
+    boundMetrics.clear();
+    for (std::size_t j = 0; j < nMetrics; ++j)
+    {
+        hpwhs[j] = model->clone();
+        hpwhs[j]->getCompressor()->evaluatePerformance = perfPolySet.use();
+        boundMetrics.push_back(metrics[j]->bind(hpwhs[j].get()));
     }
 
-    invMatV.resize(2);
-    invMatV[0] = (a * B - b * C) / det;
-    invMatV[1] = (-a * C + b * A) / det;
+    errorV.assign(nMetrics, 0.);
+    jacobiM.assign(nMetrics, {});
+    hpwh_parallel::forEach(
+        nMetrics,
+        [&](std::size_t j)
+        {
+            errorV[j] =
+                boundMetrics[j]->findErrorGradient(perfPolySet, coefficients, jacobiM[j]);
+        },
+        nThreads);
     return true;
 }
 
 //-----------------------------------------------------------------------------
-///	@brief	Least-squares minimization (one metric, two parameters)
+///	@brief	Least-squares minimization (any number of metrics and parameters)
+///         The metrics at the current and at each perturbed parameter set are
+///         found in one call to evaluateMetrics, so the Jacobian is evaluated
+///         concurrently. Every evaluation starts from a copy of the same model
+///         state, so the result does not depend on the thread count, and the
+///         metrics at an accepted step are reused at the next iteration. The
+///         Jacobian is kept while accepted steps reduce the figure of merit
+///         a hundredfold, so those iterations cost one evaluation per metric.
+///         Where the metrics provide gradients, the Jacobian comes from one
+///         test per metric instead of one per perturbed parameter.
 /// @note	see [Numerical Recipes, Ch. 15.5](https://numerical.recipes/book.html)
-///         This can be generalized with suitable matrix utilities.
 //-----------------------------------------------------------------------------
 void HPWH::Fitter::performLeastSquaresMinimization()
 {
     bool success = false;
     const int maxIters = 20;
 
-    auto metric = metrics[0]; // currently, one metric only
+    auto nMetrics = metrics.size();
     auto nParameters = parameters.size();
     double nu = 0.001; // damping term
+
+    // figure of merit
+    auto getFOM = [](const std::vector<double>& errorV)
+    {
+        double FOM = 0.;
+        for (auto& error : errorV)
+            FOM += error * error;
+        return FOM;
+    };
+
+    // keep the test results of an evaluated set
+    auto adopt = [this, nMetrics](const std::vector<std::shared_ptr<Metric>>& boundMetrics)
+    {
+        if (boundMetrics.empty())
+            return;
+        for (std::size_t j = 0; j < nMetrics; ++j)
+            metrics[j]->adopt(*boundMetrics[j]);
+    };
+
+    bool haveErrors = false;
+    bool needJacobian = true;
+    bool freshJacobian = false; // found at the current parameters
+    std::vector<double> errorV(nMetrics);
+    std::vector<std::vector<double>> jacobiM(nMetrics, std::vector<double>(nParameters));
+    std::vector<std::vector<std::shared_ptr<Metric>>> boundMetrics;
     for (auto iter = 0; iter < maxIters; ++iter)
     {
-        std::string iter_msg = fmt::format("iter {:d}: ", iter);
-
-        double error = metric->findError();
-        double FOM = error * error; // figure of merit
-
-        iter_msg.append(fmt::format(", FOM: {:g}", FOM));
-        // courier->send_info(iter_msg);
-
         std::vector<double> parameterV(nParameters);
         for (std::size_t i = 0; i < nParameters; ++i)
         {
             parameterV[i] = *parameters[i]->data_ptr;
         }
 
-        std::vector<double> jacobiV(nParameters); // 1 x 2
-        for (std::size_t i = 0; i < nParameters; ++i)
-        { // get jacobian
-            *parameters[i]->data_ptr = parameterV[i] + (parameters[i]->increment);
-            jacobiV[i] = (metric->findError() - error) / (parameters[i]->increment);
-            *parameters[i]->data_ptr = parameterV[i]; // restore
+        // errors and Jacobian from the metric gradients, if available
+        std::vector<std::shared_ptr<Metric>> gradientMetrics;
+        if (needJacobian && evaluateJacobian(parameterV, errorV, jacobiM, gradientMetrics))
+        {
+            adopt(gradientMetrics);
+            haveErrors = true;
+            needJacobian = false;
+            freshJacobian = true;
         }
 
-        bool improved = false;
-        std::vector<double> inverseJacobiV; // invert jacobian using nu
-        if (getLeftDampedInverse(nu, jacobiV, inverseJacobiV))
+        // current parameters (unless known from the previous step), then one perturbed set
+        // per parameter if the Jacobian is needed
+        std::vector<std::vector<double>> parameterVs;
+        if (!haveErrors)
+            parameterVs.push_back(parameterV);
+        if (needJacobian)
         {
-            // find error using incremented parameters
-            std::vector<double> incrementParamV(2);
             for (std::size_t i = 0; i < nParameters; ++i)
             {
-                incrementParamV[i] = -inverseJacobiV[i] * error;
-                *parameters[i]->data_ptr = parameterV[i] + incrementParamV[i]; // increment
+                parameterVs.push_back(parameterV);
+                parameterVs.back()[i] += parameters[i]->increment;
             }
-            double incrementedError = metric->findError();
-            double incrementedFOM =
-                incrementedError * incrementedError; // FOM with increments applied
+        }
+
+        std::vector<std::vector<double>> errorVs;
+        if (!parameterVs.empty())
+            errorVs = evaluateMetrics(parameterVs, boundMetrics);
+        std::size_t iPerturbed = 0;
+        if (!haveErrors)
+        {
+            errorV = errorVs[0];
+            adopt(boundMetrics[0]);
+            haveErrors = true;
+            iPerturbed = 1;
+        }
+        double FOM = getFOM(errorV);
 
-            // restore parameters
-            for (std::size_t j = 0; j < nParameters; ++j)
+        if (needJacobian)
+        {
+            for (std::size_t j = 0; j < nMetrics; ++j)
             {
-                *parameters[j]->data_ptr = parameterV[j];
+                for (std::size_t i = 0; i < nParameters; ++i)
+                    jacobiM[j][i] =
+                        (errorVs[iPerturbed + i][j] - errorV[j]) / (parameters[i]->increment);
             }
+            needJacobian = false;
+            freshJacobian = true;
+        }
+
+        bool improved = false;
+        std::vector<double> incrementParamV; // damped step using nu
+        if (getDampedStep(nu, jacobiM, errorV, incrementParamV))
+        {
+            // find errors using incremented parameters
+            std::vector<double> incrementedParamV(nParameters);
+            for (std::size_t i = 0; i < nParameters; ++i)
+            {
+                incrementedParamV[i] = parameterV[i] + incrementParamV[i];
+            }
+            auto incrementedErrorV = evaluateMetrics({incrementedParamV}, boundMetrics)[0];
+            double incrementedFOM = getFOM(incrementedErrorV); // FOM with increments applied
 
             if (incrementedFOM < FOM)
             {
                 // improved, so apply increments and reduce nu
                 for (std::size_t i = 0; i < nParameters; ++i)
                 {
-                    *parameters[i]->data_ptr = parameterV[i] + incrementParamV[i];
-                    (parameters[i]->increment) = fabs(incrementParamV[i]) / 1.e3;
-                    FOM = incrementedFOM;
+                    *parameters[i]->data_ptr = incrementedParamV[i];
+                    if (incrementParamV[i] != 0.)
+                        (parameters[i]->increment) = fabs(incrementParamV[i]) / 1.e3;
                 }
+                // keep the Jacobian while steps converge quickly
+                needJacobian = (incrementedFOM > 1.e-2 * FOM);
+                freshJacobian = false;
+                errorV = incrementedErrorV;
+                FOM = incrementedFOM;
+                adopt(boundMetrics[0]);
                 nu /= 10.;
                 improved = true;
             }
@@ -218,6 +443,7 @@ void HPWH::Fitter::performLeastSquaresMinimization()
         // no improvement, increase nu or fail
         if (!improved)
         {
+            needJacobian = !freshJacobian;
             nu *= 10.;
             if (nu > 1.e6)
             {
@@ -249,21 +475,28 @@ void HPWH::Fitter::fit()
         auto parameter = parameters[0];
         auto metric = metrics[0];
 
+        // the first two guesses are evaluated together
         double value0 = *parameter->data_ptr;
-        double f0 = metric->evaluate();
-
         double value1 = value0 + parameter->increment;
-        *parameter->data_ptr = value1;
-        double f1 = metric->evaluate();
-
-        *parameter->data_ptr = value0;
+        std::vector<std::vector<std::shared_ptr<Metric>>> boundMetrics;
+        auto valueVs = evaluateMetrics({{value0}, {value1}}, boundMetrics, false);
+        double f0 = valueVs[0][0];
+        double f1 = valueVs[1][0];
+        // evaluated in place, the metric retains the results of the last set
+        if (!boundMetrics[0].empty())
+            metric->adopt(*boundMetrics[0][0]);
+        lastSingleParameter = boundMetrics[0].empty() ? value1 : value0;
 
         int iters =
             secant(targetFunc, this, metric->targetValue, 1.e-12, value0, f0, value1, f1, 1.e-12);
         if (iters < 0)
             send_error("Failure in makeGenericModel using secant");
+
+        // keep the best value, with its results, even if it was not the last evaluated
+        if (lastSingleParameter != value0)
+            getMetricSingleParameter(value0);
     }
-    else if ((nParameters == 2) && (nMetrics == 1))
+    else if ((nParameters > 0) && (nMetrics > 0))
     { // use least-squares
         performLeastSquaresMinimization();
     }
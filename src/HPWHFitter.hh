@@ -7,9 +7,10 @@
 ///	@struct HPWH::Fitter HPWHFitter.h
 /// Optimizer for varying model parameters to match metrics, used by
 /// HPWH::makeGenericEF to modify performance coeffs to match a target UEF.
-/// The structure is fairly general, but currently limited to one metric (UEF)
-/// and two parameters (COP coeffs). This could be expanded to include other metrics,
-/// such as total energy in 24-hr test.
+/// One metric with one parameter is solved by secant; any other combination
+/// by Levenberg-Marquardt least squares (e.g., E50, UEF, and E95 jointly).
+/// Where every metric provides its gradient with respect to every parameter,
+/// the least-squares Jacobian takes one test per metric.
 struct HPWH::Fitter : public Sender
 {
     ///	base class for variational parameters
@@ -25,6 +26,19 @@ struct HPWH::Fitter : public Sender
         virtual ~Parameter() = default;
 
         virtual std::string show() = 0;
+
+        /// performance set containing this parameter, if any
+        virtual std::vector<PerformancePoly>* getPerformancePolySet() { return nullptr; }
+
+        /// corresponding datum in a copy of the performance set
+        virtual double* locate(std::vector<PerformancePoly>& /*perfPolySet*/) { return nullptr; }
+
+        /// identify this parameter within its performance set (false if not a coefficient)
+        virtual bool
+        getCoefficientIndex(PerformancePolySet::CoefficientIndex& /*coefficientIndex*/) const
+        {
+            return false;
+        }
     };
 
     /// performance coefficient
@@ -61,6 +75,20 @@ struct HPWH::Fitter : public Sender
             return fmt::format(getFormat(), temperatureIndex, *data_ptr);
         }
 
+        std::vector<PerformancePoly>* getPerformancePolySet() override { return pPerfPolySet; }
+
+        double* locate(std::vector<PerformancePoly>& perfPolySet) override
+        {
+            return &getCoefficients(perfPolySet[temperatureIndex])[exponent];
+        }
+
+        bool
+        getCoefficientIndex(PerformancePolySet::CoefficientIndex& coefficientIndex) const override
+        {
+            coefficientIndex = {temperatureIndex, exponent, isInputPower()};
+            return true;
+        }
+
       protected:
         virtual std::vector<double>& getCoefficients(HPWH::PerformancePoly& perfPoly) = 0;
 
@@ -83,6 +111,7 @@ struct HPWH::Fitter : public Sender
 
       private:
         [[nodiscard]] virtual std::string getFormat() const = 0;
+        [[nodiscard]] virtual bool isInputPower() const = 0;
     };
 
     /// input-power coefficient parameter
@@ -100,6 +129,7 @@ struct HPWH::Fitter : public Sender
 
       private:
         [[nodiscard]] std::string getFormat() const override { return "Pin[{}]: {}"; }
+        [[nodiscard]] bool isInputPower() const override { return true; }
 
         std::vector<double>& getCoefficients(HPWH::PerformancePoly& perfPoly) override
         {
@@ -122,6 +152,7 @@ struct HPWH::Fitter : public Sender
 
       private:
         [[nodiscard]] std::string getFormat() const override { return "COP[{}]: {}"; }
+        [[nodiscard]] bool isInputPower() const override { return false; }
 
         std::vector<double>& getCoefficients(HPWH::PerformancePoly& perfPoly) override
         {
@@ -145,6 +176,28 @@ struct HPWH::Fitter : public Sender
 
         virtual double evaluate() = 0;
         virtual double findError() = 0;
+
+        /// model evaluated by this metric, if any
+        virtual HPWH* getModel() const { return nullptr; }
+
+        /// copy of this metric that evaluates hpwh_in instead (nullptr if unsupported)
+        virtual std::shared_ptr<Metric> bind(HPWH* /*hpwh_in*/) const { return nullptr; }
+
+        /// retain the results of a bound copy
+        virtual void adopt(const Metric& /*metric*/) {}
+
+        /// whether findErrorGradient is available
+        virtual bool hasGradient() const { return false; }
+
+        /// find error ratio and its gradient with respect to coefficients of perfPolySet,
+        /// which the model must be evaluating
+        virtual double
+        findErrorGradient(const PerformancePolySet& /*perfPolySet*/,
+                          const std::vector<PerformancePolySet::CoefficientIndex>& /*coefficients*/,
+                          std::vector<double>& /*errorGradient*/)
+        {
+            return findError();
+        }
     };
 
     /// energy-factor metric, i.e., E50, UEF, E95
@@ -155,6 +208,9 @@ struct HPWH::Fitter : public Sender
         FirstHourRating::Designation designation;
         TestSummary testSummary;
 
+        /// if set, tests start from this state instead of running the draw/heat cycle
+        std::shared_ptr<const State> preparedState;
+
         EF_Metric(double targetEF,
                   TestConfiguration testConfiguration_in,
                   FirstHourRating::Designation designation_in,
@@ -172,7 +228,9 @@ struct HPWH::Fitter : public Sender
         /// get current EF
         double evaluate() override
         {
-            testSummary = hpwh->run24hrTest(testConfiguration, designation);
+            testSummary = preparedState
+                              ? hpwh->run24hrTest(testConfiguration, designation, *preparedState)
+                              : hpwh->run24hrTest(testConfiguration, designation);
             return testSummary.EF;
         }
 
@@ -180,6 +238,35 @@ struct HPWH::Fitter : public Sender
         double findError() override { return (evaluate() - targetValue) / tolerance; }
 
         TestSummary getTestSummary() const { return testSummary; }
+
+        HPWH* getModel() const override { return hpwh; }
+
+        std::shared_ptr<Metric> bind(HPWH* hpwh_in) const override
+        {
+            auto metric = std::make_shared<EF_Metric>(*this);
+            metric->hpwh = hpwh_in;
+            return metric;
+        }
+
+        void adopt(const Metric& metric) override
+        {
+            testSummary = static_cast<const EF_Metric&>(metric).testSummary;
+        }
+
+        bool hasGradient() const override { return true; }
+
+        double
+        findErrorGradient(const PerformancePolySet& perfPolySet,
+                          const std::vector<PerformancePolySet::CoefficientIndex>& coefficients,
+                          std::vector<double>& errorGradient) override
+        {
+            testSummary = hpwh->run24hrTest(
+                testConfiguration, designation, perfPolySet, coefficients, preparedState.get());
+            errorGradient = testSummary.EF_gradient;
+            for (auto& value : errorGradient)
+                value /= tolerance;
+            return (testSummary.EF - targetValue) / tolerance;
+        }
     };
 
     /// metric and parameter data retained as shared pts
@@ -187,13 +274,41 @@ struct HPWH::Fitter : public Sender
     std::vector<std::shared_ptr<Fitter::Metric>> metrics;
     std::vector<std::shared_ptr<Fitter::Parameter>> parameters;
 
+    /// threads used for concurrent evaluations (0: hardware concurrency, 1: serial)
+    unsigned nThreads;
+
+    /// parameter value of the results last retained by the single metric (secant)
+    double lastSingleParameter = 0.;
+
+    /// whether each evaluation can use a copy of the model with its own performance set
+    bool canUseCopies() const;
+
+    /// Evaluate the metrics (or their errors) for each set of parameter values. Where the
+    /// metrics and parameters allow, each set is evaluated on a copy of the model whose
+    /// compressor uses its own copy of the performance set, and the sets are
+    /// evaluated concurrently. Otherwise they are applied to the model in turn.
+    std::vector<std::vector<double>>
+    evaluateMetrics(const std::vector<std::vector<double>>& parameterVs,
+                    std::vector<std::vector<std::shared_ptr<Metric>>>& boundMetrics,
+                    bool findErrors = true);
+
+    /// Evaluate the metric errors and their Jacobian at the given parameter values from the
+    /// metric gradients, one test per metric, evaluated concurrently on copies of the model.
+    /// Returns false, evaluating nothing, if any metric or parameter does not support this.
+    bool evaluateJacobian(const std::vector<double>& parameterV,
+                          std::vector<double>& errorV,
+                          std::vector<std::vector<double>>& jacobiM,
+                          std::vector<std::shared_ptr<Metric>>& boundMetrics);
+
   public:
     Fitter(std::vector<std::shared_ptr<Fitter::Metric>> metrics_in,
            std::vector<std::shared_ptr<Fitter::Parameter>> parameters_in,
-           std::shared_ptr<Courier::Courier> courier)
+           std::shared_ptr<Courier::Courier> courier,
+           unsigned nThreads_in = 0)
         : Sender("Fitter", "fitter", courier)
         , metrics(std::move(metrics_in))
         , parameters(std::move(parameters_in))
+        , nThreads(nThreads_in)
     {
     }
 
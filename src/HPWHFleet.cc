@@ -0,0 +1,349 @@
+/*
+ * Implementation of class HPWH::Fleet
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHFleet.hh"
+#include "HPWHParallel.hh"
+
+std::size_t HPWH::Fleet::Schedule::size() const
+{
+    std::size_t nMinutes =
+        std::min({inletT_C.size(), drawVolume_L.size(), ambientT_C.size(), externalT_C.size()});
+    if (!drStatus.empty())
+        nMinutes = std::min(nMinutes, drStatus.size());
+    return nMinutes;
+}
+
+void HPWH::Fleet::addUnit(const Unit& unit)
+{
+    if (!unit.spec)
+    {
+        send_error(fmt::format("Unit {} has no model.", unit.name));
+    }
+    if (!unit.schedule)
+    {
+        send_error(fmt::format("Unit {} has no schedule.", unit.name));
+    }
+    units.push_back(unit);
+}
+
+std::unique_ptr<HPWH> HPWH::Fleet::instantiate(const Unit& unit) const
+{
+    auto hpwh = unit.spec->instantiate();
+    if (unit.tankVolume_L > 0.)
+    {
+        hpwh->setTankSize(unit.tankVolume_L, UNITS_L);
+    }
+    if (unit.setpoint_C > 0.)
+    {
+        double maxAllowedSetpointT_C;
+        std::string why;
+        if (!hpwh->isNewSetpointPossible(unit.setpoint_C, maxAllowedSetpointT_C, why))
+        {
+            send_error(fmt::format("Unit {}: {}", unit.name, why));
+        }
+        hpwh->setSetpoint(unit.setpoint_C);
+        hpwh->resetTankToSetpoint();
+    }
+    return hpwh;
+}
+
+HPWH::Fleet::QuantileSketch::QuantileSketch(double relativeAccuracy /*=0.01*/)
+    : gamma((1. + relativeAccuracy) / (1. - relativeAccuracy))
+    , logGamma(std::log(gamma))
+    , minIndex(0)
+    , zeroCount(0)
+    , count(0)
+    , minValue(0.)
+    , maxValue(0.)
+{
+}
+
+void HPWH::Fleet::QuantileSketch::add(double value)
+{
+    if (count == 0)
+    {
+        minValue = maxValue = value;
+    }
+    else
+    {
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+    ++count;
+
+    if (value <= minBinnedValue)
+    {
+        ++zeroCount;
+        return;
+    }
+
+    int index = static_cast<int>(std::ceil(std::log(value) / logGamma));
+    if (bins.empty())
+    {
+        minIndex = index;
+        bins.push_back(0);
+    }
+    else if (index < minIndex)
+    {
+        bins.insert(bins.begin(), minIndex - index, 0);
+        minIndex = index;
+    }
+    else if (index >= minIndex + static_cast<int>(bins.size()))
+    {
+        bins.resize(index - minIndex + 1, 0);
+    }
+    ++bins[index - minIndex];
+}
+
+void HPWH::Fleet::QuantileSketch::merge(const QuantileSketch& sketch)
+{
+    if (sketch.count == 0)
+        return;
+    if (count == 0)
+    {
+        minValue = sketch.minValue;
+        maxValue = sketch.maxValue;
+    }
+    else
+    {
+        minValue = std::min(minValue, sketch.minValue);
+        maxValue = std::max(maxValue, sketch.maxValue);
+    }
+    count += sketch.count;
+    zeroCount += sketch.zeroCount;
+
+    if (sketch.bins.empty())
+        return;
+    if (bins.empty())
+    {
+        minIndex = sketch.minIndex;
+        bins = sketch.bins;
+        return;
+    }
+    if (sketch.minIndex < minIndex)
+    {
+        bins.insert(bins.begin(), minIndex - sketch.minIndex, 0);
+        minIndex = sketch.minIndex;
+    }
+    int maxIndex = sketch.minIndex + static_cast<int>(sketch.bins.size()) - 1;
+    if (maxIndex >= minIndex + static_cast<int>(bins.size()))
+    {
+        bins.resize(maxIndex - minIndex + 1, 0);
+    }
+    for (std::size_t i = 0; i < sketch.bins.size(); ++i)
+        bins[sketch.minIndex - minIndex + i] += sketch.bins[i];
+}
+
+double HPWH::Fleet::QuantileSketch::getQuantile(double q) const
+{
+    if (count == 0)
+        return 0.;
+    q = std::min(std::max(q, 0.), 1.);
+    if (q == 0.)
+        return minValue;
+    if (q == 1.)
+        return maxValue;
+
+    auto rank = static_cast<std::size_t>(q * (count - 1));
+    if (rank < zeroCount)
+        return minValue;
+
+    std::size_t nBelow = zeroCount;
+    for (std::size_t i = 0; i < bins.size(); ++i)
+    {
+        nBelow += bins[i];
+        if (nBelow > rank)
+        {
+            // midpoint of the bin, in the relative sense
+            double value = 2. * std::pow(gamma, minIndex + static_cast<int>(i)) / (gamma + 1.);
+            return std::min(std::max(value, minValue), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+void HPWH::Fleet::checkRun(long minutesToRun, double interval_min) const
+{
+    if (interval_min <= 0.)
+    {
+        send_error("Load-profile interval must be positive.");
+    }
+    for (auto& unit : units)
+    {
+        if (unit.schedule->size() < static_cast<std::size_t>(minutesToRun))
+        {
+            send_error(fmt::format("The schedule for unit {} is shorter than {} minutes.",
+                                   unit.name,
+                                   minutesToRun));
+        }
+    }
+}
+
+void HPWH::Fleet::simulate(const Unit& unit,
+                           long minutesToRun,
+                           double interval_min,
+                           UnitSummary& summary,
+                           std::vector<double>& intervalInput_kWh) const
+{
+    auto& schedule = *unit.schedule;
+    auto hpwh = instantiate(unit);
+    summary.name = unit.name;
+    summary.minOutletT_C = hpwh->getTankNodeTemp(hpwh->getNumNodes() - 1);
+
+    for (long i = 0; i < minutesToRun; ++i)
+    {
+        double drawVolume_L = unit.drawScale * schedule.drawVolume_L[i];
+        auto drStatus =
+            schedule.drStatus.empty() ? DR_ALLOW : static_cast<DRMODES>(schedule.drStatus[i]);
+        hpwh->runOneStep(schedule.inletT_C[i],
+                         drawVolume_L,
+                         schedule.ambientT_C[i],
+                         schedule.externalT_C[i],
+                         drStatus);
+
+        // condenser input includes standby power while off
+        double energyInput_kWh = 0.;
+        for (int iHeatSource = 0; iHeatSource < hpwh->getNumHeatSources(); ++iHeatSource)
+        {
+            energyInput_kWh += hpwh->getNthHeatSourceEnergyInput(iHeatSource);
+            summary.energyOutput_kWh += hpwh->getNthHeatSourceEnergyOutput(iHeatSource);
+        }
+        summary.energyInput_kWh += energyInput_kWh;
+        intervalInput_kWh[static_cast<std::size_t>(i / interval_min)] += energyInput_kWh;
+
+        if (drawVolume_L > 0.)
+        {
+            summary.drawVolume_L += drawVolume_L;
+            summary.minOutletT_C = std::min(summary.minOutletT_C, hpwh->getOutletTemp());
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+///	@brief	Simulate all units. Each unit is a task on a work-stealing pool; its
+///         per-interval input energy is added to a partial load profile held
+///         by the worker that ran it, and the partial profiles are summed once
+///         all units have finished.
+//-----------------------------------------------------------------------------
+HPWH::Fleet::Results
+HPWH::Fleet::run(long minutesToRun, double interval_min /*=60.*/, unsigned nThreads /*=0*/) const
+{
+    checkRun(minutesToRun, interval_min);
+
+    Results results;
+    results.interval_min = interval_min;
+    results.units.resize(units.size());
+    auto nIntervals = static_cast<std::size_t>(std::ceil(minutesToRun / interval_min));
+
+    hpwh_parallel::ThreadPool pool(nThreads);
+    std::vector<std::vector<double>> partialLoads_kWh(pool.getNumThreads(),
+                                                      std::vector<double>(nIntervals, 0.));
+
+    for (std::size_t iUnit = 0; iUnit < units.size(); ++iUnit)
+    {
+        pool.submit(
+            [this, iUnit, minutesToRun, interval_min, &results, &partialLoads_kWh]()
+            {
+                simulate(units[iUnit],
+                         minutesToRun,
+                         interval_min,
+                         results.units[iUnit],
+                         partialLoads_kWh[hpwh_parallel::ThreadPool::getWorkerIndex()]);
+            });
+    }
+    pool.wait();
+
+    results.load_kWh.assign(nIntervals, 0.);
+    for (auto& partialLoad_kWh : partialLoads_kWh)
+    {
+        for (std::size_t iInterval = 0; iInterval < nIntervals; ++iInterval)
+            results.load_kWh[iInterval] += partialLoad_kWh[iInterval];
+    }
+    return results;
+}
+
+//-----------------------------------------------------------------------------
+///	@brief	Simulate all units, reducing their input energy to a total and a
+///         quantile sketch per interval. Units run in batches: each unit of a
+///         batch fills a row of interval energies, then the rows are folded
+///         into the per-interval accumulators, with the intervals split among
+///         the threads. Memory is set by the batch size and the number of
+///         intervals, not by the number of units, and the totals do not
+///         depend on the thread count.
+//-----------------------------------------------------------------------------
+HPWH::Fleet::LoadShape HPWH::Fleet::runLoadShape(long minutesToRun,
+                                                 double interval_min /*=60.*/,
+                                                 unsigned nThreads /*=0*/,
+                                                 double relativeAccuracy /*=0.01*/,
+                                                 std::size_t batchSize /*=0*/) const
+{
+    checkRun(minutesToRun, interval_min);
+    if ((relativeAccuracy <= 0.) || (relativeAccuracy >= 1.))
+    {
+        send_error("Quantile accuracy must be between 0 and 1.");
+    }
+
+    LoadShape loadShape;
+    loadShape.nUnits = units.size();
+    loadShape.interval_min = interval_min;
+    auto nIntervals = static_cast<std::size_t>(std::ceil(minutesToRun / interval_min));
+    loadShape.intervals.assign(nIntervals, IntervalLoad {0., QuantileSketch(relativeAccuracy)});
+
+    hpwh_parallel::ThreadPool pool(nThreads);
+    if (batchSize == 0)
+        batchSize = 64 * pool.getNumThreads();
+    batchSize = std::min(batchSize, units.size());
+
+    std::vector<std::vector<double>> unitInputs_kWh(batchSize, std::vector<double>(nIntervals));
+    for (std::size_t firstUnit = 0; firstUnit < units.size(); firstUnit += batchSize)
+    {
+        std::size_t nBatchUnits = std::min(batchSize, units.size() - firstUnit);
+        for (std::size_t iBatchUnit = 0; iBatchUnit < nBatchUnits; ++iBatchUnit)
+        {
+            pool.submit(
+                [this, firstUnit, iBatchUnit, minutesToRun, interval_min, &unitInputs_kWh]()
+                {
+                    auto& unitInput_kWh = unitInputs_kWh[iBatchUnit];
+                    std::fill(unitInput_kWh.begin(), unitInput_kWh.end(), 0.);
+                    UnitSummary summary;
+                    simulate(units[firstUnit + iBatchUnit],
+                             minutesToRun,
+                             interval_min,
+                             summary,
+                             unitInput_kWh);
+                });
+        }
+        pool.wait();
+
+        // merge the batch, in unit order, into contiguous ranges of intervals
+        std::size_t nChunks = std::min<std::size_t>(pool.getNumThreads(), nIntervals);
+        for (std::size_t iChunk = 0; iChunk < nChunks; ++iChunk)
+        {
+            pool.submit(
+                [iChunk, nChunks, nIntervals, nBatchUnits, &unitInputs_kWh, &loadShape]()
+                {
+                    std::size_t begin = iChunk * nIntervals / nChunks;
+                    std::size_t end = (iChunk + 1) * nIntervals / nChunks;
+                    for (std::size_t iInterval = begin; iInterval < end; ++iInterval)
+                    {
+                        auto& intervalLoad = loadShape.intervals[iInterval];
+                        for (std::size_t iBatchUnit = 0; iBatchUnit < nBatchUnits; ++iBatchUnit)
+                        {
+                            double energyInput_kWh = unitInputs_kWh[iBatchUnit][iInterval];
+                            intervalLoad.energyInput_kWh += energyInput_kWh;
+                            intervalLoad.unitInput_kWh.add(energyInput_kWh);
+                        }
+                    }
+                });
+        }
+        pool.wait();
+    }
+    return loadShape;
+}
@@ -0,0 +1,146 @@
+#ifndef HPWHFLEET_hh
+#define HPWHFLEET_hh
+
+#include "HPWH.hh"
+#include "HPWHModelSpec.hh"
+
+///	@class HPWH::Fleet HPWHFleet.hh
+/// Simulates a set of heterogeneous units concurrently. Units refer to shared model specs and
+/// (optionally shared) schedules, so neither models nor schedules are re-read per unit.
+/// Produces a summary for each unit and the aggregate electrical load per interval.
+class HPWH::Fleet : public Sender
+{
+  public:
+    ///	@struct Schedule
+    /// per-minute conditions
+    struct Schedule
+    {
+        std::vector<double> inletT_C;
+        std::vector<double> drawVolume_L;
+        std::vector<double> ambientT_C;
+        std::vector<double> externalT_C;
+        std::vector<int> drStatus; /**< DR_ALLOW if empty */
+
+        /// number of minutes covered by every series
+        std::size_t size() const;
+    };
+
+    ///	@struct Unit
+    struct Unit
+    {
+        std::string name;
+        std::shared_ptr<const ModelSpec> spec;
+        std::shared_ptr<const Schedule> schedule;
+        double drawScale = 1.;    /**< multiplies the scheduled draw volumes */
+        double setpoint_C = 0.;   /**< used if positive */
+        double tankVolume_L = 0.; /**< used if positive */
+    };
+
+    ///	@struct UnitSummary
+    struct UnitSummary
+    {
+        std::string name;
+        double energyInput_kWh = 0.;
+        double energyOutput_kWh = 0.;
+        double drawVolume_L = 0.;
+        double minOutletT_C = 0.; /**< lowest outlet temperature during draws */
+    };
+
+    ///	@struct Results
+    struct Results
+    {
+        std::vector<UnitSummary> units;
+        double interval_min;
+        std::vector<double> load_kWh; /**< electrical input of all units, per interval */
+    };
+
+    ///	@class QuantileSketch
+    /// Mergeable sketch of a distribution of non-negative values. Values are counted in
+    /// logarithmic bins, so any quantile is returned within the relative accuracy given,
+    /// and the size depends only on the range of values, not on how many were added.
+    class QuantileSketch
+    {
+      public:
+        explicit QuantileSketch(double relativeAccuracy = 0.01);
+
+        void add(double value);
+
+        /// add the counts of another sketch with the same accuracy
+        void merge(const QuantileSketch& sketch);
+
+        /// value at fraction q (0 to 1) of the distribution
+        double getQuantile(double q) const;
+
+        std::size_t getCount() const { return count; }
+        double getMin() const { return minValue; }
+        double getMax() const { return maxValue; }
+
+      private:
+        double gamma;
+        double logGamma;
+        int minIndex;                  /**< bin index of bins[0] */
+        std::vector<std::size_t> bins; /**< counts of values in (gamma^(i-1), gamma^i] */
+        std::size_t zeroCount;         /**< values too small to bin */
+        std::size_t count;
+        double minValue;
+        double maxValue;
+
+        static constexpr double minBinnedValue = 1.e-9;
+    };
+
+    ///	@struct IntervalLoad
+    struct IntervalLoad
+    {
+        double energyInput_kWh = 0.;  /**< electrical input of all units */
+        QuantileSketch unitInput_kWh; /**< distribution of unit electrical input */
+    };
+
+    ///	@struct LoadShape
+    /// fleet electrical load per interval, without any per-unit data
+    struct LoadShape
+    {
+        std::size_t nUnits = 0;
+        double interval_min;
+        std::vector<IntervalLoad> intervals;
+    };
+
+    Fleet(const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+          const std::string& name_in = "fleet")
+        : Sender("Fleet", name_in, courier)
+    {
+    }
+
+    void addUnit(const Unit& unit);
+
+    std::size_t getNumUnits() const { return units.size(); }
+
+    const std::vector<Unit>& getUnits() const { return units; }
+
+    /// simulate all units for minutesToRun, on nThreads threads (0: hardware concurrency)
+    Results run(long minutesToRun, double interval_min = 60., unsigned nThreads = 0) const;
+
+    /// simulate all units, keeping only the aggregate load per interval; memory use does not
+    /// grow with the number of units (batchSize = 0: 64 units per thread)
+    LoadShape runLoadShape(long minutesToRun,
+                           double interval_min = 60.,
+                           unsigned nThreads = 0,
+                           double relativeAccuracy = 0.01,
+                           std::size_t batchSize = 0) const;
+
+  private:
+    std::vector<Unit> units;
+
+    void checkRun(long minutesToRun, double interval_min) const;
+
+    /// run unit for minutesToRun, adding its input energy per interval to intervalInput_kWh
+    void simulate(const Unit& unit,
+                  long minutesToRun,
+                  double interval_min,
+                  UnitSummary& summary,
+                  std::vector<double>& intervalInput_kWh) const;
+
+    /// create a working instance for unit
+    std::unique_ptr<HPWH> instantiate(const Unit& unit) const;
+};
+
+#endif
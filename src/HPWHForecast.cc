@@ -0,0 +1,91 @@
+/*
+ * Implementation of HPWH::forecast
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHParallel.hh"
+
+//-----------------------------------------------------------------------------
+///	@brief	Simulate each demand-response candidate over the horizon, starting
+///         from the current state of this instance.
+/// @note   Candidates run on private copies, in parallel; this instance is not
+///         modified.
+//-----------------------------------------------------------------------------
+std::vector<HPWH::ForecastSummary> HPWH::forecast(double horizon_min,
+                                                  const ForecastSchedule& schedule,
+                                                  const std::vector<DRCandidate>& candidates,
+                                                  double minUsefulT_C /*=43.333*/,
+                                                  unsigned nThreads /*=0*/) const
+{
+    if (horizon_min <= 0.)
+    {
+        send_error("Forecast horizon must be positive.");
+    }
+    auto nSteps = static_cast<std::size_t>(std::ceil(horizon_min / minutesPerStep - TOL_MINVALUE));
+    if (schedule.size() < nSteps)
+    {
+        send_error(fmt::format("Forecast schedule has {} steps; {} are needed for the horizon.",
+                               schedule.size(),
+                               nSteps));
+    }
+
+    // copies are made here, so that this instance is only read from the calling thread
+    std::vector<std::unique_ptr<HPWH>> copies;
+    copies.reserve(candidates.size());
+    for (auto& candidate : candidates)
+    {
+        copies.push_back(clone());
+        if ((candidate.drMode & DR_TOT) != 0)
+            copies.back()->setTimerLimitTOT(candidate.timerLimitTOT_min);
+    }
+
+    std::vector<ForecastSummary> summaries(candidates.size());
+    hpwh_parallel::forEach(
+        candidates.size(),
+        [&](std::size_t iCandidate)
+        {
+            auto& hpwh = *copies[iCandidate];
+            auto& summary = summaries[iCandidate];
+            summary.candidate = candidates[iCandidate];
+            summary.minOutletT_C = hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1);
+
+            for (std::size_t iStep = 0; iStep < nSteps; ++iStep)
+            {
+                auto& step = schedule[iStep];
+                hpwh.runOneStep(step.inletT_C,
+                                step.drawVolume_L,
+                                step.ambientT_C,
+                                step.externalT_C,
+                                summary.candidate.drMode);
+
+                for (int iHeatSource = 0; iHeatSource < hpwh.getNumHeatSources(); ++iHeatSource)
+                {
+                    summary.energyInput_kWh += hpwh.getNthHeatSourceEnergyInput(iHeatSource);
+                    summary.energyOutput_kWh += hpwh.getNthHeatSourceEnergyOutput(iHeatSource);
+                }
+
+                if (step.drawVolume_L > 0.)
+                {
+                    double outletT_C = hpwh.getOutletTemp();
+                    summary.drawVolume_L += step.drawVolume_L;
+                    summary.minOutletT_C = std::min(summary.minOutletT_C, outletT_C);
+                    if (outletT_C < minUsefulT_C)
+                    {
+                        summary.shortfallVolume_L += step.drawVolume_L;
+                        summary.shortfallEnergy_kWh +=
+                            KJ_TO_KWH(step.drawVolume_L * DENSITYWATER_kgperL * CPWATER_kJperkgC *
+                                      (minUsefulT_C - outletT_C));
+                    }
+                }
+            }
+            hpwh.getState(summary.finalState);
+        },
+        nThreads);
+
+    return summaries;
+}
@@ -38,6 +38,12 @@ HPWH::HeatSource::HeatSource(
 
 HPWH::HeatSource::HeatSource(const HeatSource& hSource) : Sender(hSource) { *this = hSource; }
 
+void HPWH::HeatSource::setCourier(const std::shared_ptr<Courier::Courier>& courier)
+{
+    Sender::operator=(Sender("HeatSource", name, courier));
+    parent_pointer = hpwh;
+}
+
 HPWH::HeatSource& HPWH::HeatSource::operator=(const HeatSource& hSource)
 {
     if (this == &hSource)
@@ -55,17 +61,13 @@ HPWH::HeatSource& HPWH::HeatSource::operator=(const HeatSource& hSource)
 
     isVIP = hSource.isVIP;
 
-    if (hSource.backupHeatSource != NULL || hSource.companionHeatSource != NULL ||
-        hSource.followedByHeatSource != NULL)
-    {
-        send_error("HeatSources cannot be copied if they contain pointers to other HeatSources.");
-    }
-    else
-    {
-        companionHeatSource = NULL;
-        backupHeatSource = NULL;
-        followedByHeatSource = NULL;
-    }
+    lockedOut = hSource.lockedOut;
+
+    // pointers to other heat sources are only meaningful within the owning HPWH,
+    // which rebinds them when it is copied
+    companionHeatSource = NULL;
+    backupHeatSource = NULL;
+    followedByHeatSource = NULL;
 
     heatDist = hSource.heatDist;
 
@@ -89,6 +91,19 @@ HPWH::HeatSource& HPWH::HeatSource::operator=(const HeatSource& hSource)
     return *this;
 }
 
+void HPWH::HeatSource::setOwner(HPWH* hpwh_in)
+{
+    hpwh = hpwh_in;
+    parent_pointer = hpwh;
+
+    for (auto& logic : turnOnLogicSet)
+        logic = logic->clone(hpwh);
+    for (auto& logic : shutOffLogicSet)
+        logic = logic->clone(hpwh);
+    if (standbyLogic != NULL)
+        standbyLogic = standbyLogic->clone(hpwh);
+}
+
 void HPWH::HeatSource::from(
     const hpwh_data_model::heat_source_configuration::HeatSourceConfiguration& hsc)
 {
@@ -345,13 +360,44 @@ double HPWH::HeatSource::fractToMeetComparisonExternal() const
     return frac;
 }
 
-double HPWH::HeatSource::heat(double cap_kJ, const double maxSetpointT_C)
+HPWH::Gradient HPWH::HeatSource::fractToMeetComparisonExternalGradient() const
+{
+    // follows the logic that sets the minimum
+    double frac = 1.;
+    Gradient fracGradient(hpwh->sensitivity->coefficients.size());
+    for (auto& logic : shutOffLogicSet)
+    {
+        double fracTemp = logic->getFractToMeetComparisonExternal();
+        if (fracTemp < frac)
+        {
+            frac = fracTemp;
+            fracGradient = logic->getFractToMeetComparisonExternalGradient();
+        }
+    }
+    return fracGradient;
+}
+
+double HPWH::HeatSource::heat(double cap_kJ,
+                              const double maxSetpointT_C,
+                              Gradient* capGradient_kJ /*=nullptr*/)
 {
     std::vector<double> heatDistribution;
 
     // calcHeatDist takes care of the swooping for wrapped configurations
     calcHeatDist(heatDistribution);
-    double maxWeight = *max_element(heatDistribution.begin(), heatDistribution.end());
+    auto maxElement = max_element(heatDistribution.begin(), heatDistribution.end());
+    double maxWeight = *maxElement;
+
+    // derivatives follow the same steps, with the leftover capacity taking those of the capacity
+    const bool hasGradients = (capGradient_kJ != nullptr) && hpwh->tank->tracksGradients();
+    std::vector<Gradient> heatDistributionGradient;
+    Gradient maxWeightGradient, leftoverCapGradient_kJ;
+    if (hasGradients)
+    {
+        calcHeatDistGradient(heatDistributionGradient);
+        maxWeightGradient = heatDistributionGradient[maxElement - heatDistribution.begin()];
+        leftoverCapGradient_kJ = Gradient(capGradient_kJ->size());
+    }
 
     int numNodes = hpwh->getNumNodes();
     double leftoverCap_kJ = 0.;
@@ -364,17 +410,52 @@ double HPWH::HeatSource::heat(double cap_kJ, const double maxSetpointT_C)
             std::pow(1. - frac, withhold_pow) * leftoverCap_kJ; // smooth step-function
         double carriedCap_kJ = leftoverCap_kJ - withheldCap_kJ;
         double availableCap_kJ = nodeCap_kJ + carriedCap_kJ;
+
+        Gradient withheldCapGradient_kJ, availableCapGradient_kJ;
+        if (hasGradients)
+        {
+            Gradient fracGradient =
+                (heatDistributionGradient[i] - frac * maxWeightGradient) / maxWeight;
+            withheldCapGradient_kJ =
+                (-withhold_pow * std::pow(1. - frac, withhold_pow - 1.) * leftoverCap_kJ) *
+                    fracGradient +
+                std::pow(1. - frac, withhold_pow) * leftoverCapGradient_kJ;
+            availableCapGradient_kJ = cap_kJ * heatDistributionGradient[i] +
+                                      heatDistribution[i] * *capGradient_kJ +
+                                      leftoverCapGradient_kJ - withheldCapGradient_kJ;
+        }
+
         if (availableCap_kJ > 0.)
         {
-            leftoverCap_kJ = hpwh->addHeatAboveNode(availableCap_kJ, i, maxSetpointT_C);
+            leftoverCap_kJ = hpwh->addHeatAboveNode(availableCap_kJ,
+                                                    i,
+                                                    maxSetpointT_C,
+                                                    hasGradients ? &availableCapGradient_kJ
+                                                                 : nullptr);
             leftoverCap_kJ += withheldCap_kJ;
+            if (hasGradients)
+                leftoverCapGradient_kJ = availableCapGradient_kJ + withheldCapGradient_kJ;
         }
     }
+    if (hasGradients)
+        *capGradient_kJ = leftoverCapGradient_kJ;
     return leftoverCap_kJ;
 }
 
 double HPWH::HeatSource::getTankTemp() const { return hpwh->getAverageTankTemp_C(heatDist); }
 
+HPWH::Gradient HPWH::HeatSource::getTankTempGradient() const
+{
+    return hpwh->tank->getAverageNodeTGradient_C(heatDist);
+}
+
+void HPWH::HeatSource::calcHeatDistGradient(std::vector<Gradient>& heatDistributionGradient)
+{
+    // fixed distribution
+    heatDistributionGradient.assign(hpwh->getNumNodes(),
+                                    Gradient(hpwh->sensitivity->coefficients.size()));
+}
+
 void HPWH::HeatSource::calcHeatDist(std::vector<double>& heatDistribution)
 {
     // Populate the vector of heat distribution
@@ -19,9 +19,16 @@ class HPWH::HeatSource : public Sender
     virtual ~HeatSource() = default;
     HeatSource& operator=(const HeatSource& hSource); /// assignment operator
 
+    /// report to courier, as if constructed with it
+    void setCourier(const std::shared_ptr<Courier::Courier>& courier);
+
     void to(hpwh_data_model::heat_source_configuration::HeatSourceConfiguration& hsc) const;
     void from(const hpwh_data_model::heat_source_configuration::HeatSourceConfiguration& hsc);
 
+    /// returns a copy owned by hpwh_in, with its own heating logics; references to other heat
+    /// sources are left for the owning HPWH to rebind
+    virtual std::shared_ptr<HeatSource> clone(HPWH* hpwh_in) const = 0;
+
     virtual HEATSOURCE_TYPE typeOfHeatSource() const = 0;
     virtual void
     to(std::unique_ptr<hpwh_data_model::ashrae205::HeatSourceTemplate>& p_hs) const = 0;
@@ -30,6 +37,9 @@ class HPWH::HeatSource : public Sender
 
     virtual void calcHeatDist(std::vector<double>& heatDistribution);
 
+    /// derivatives of calcHeatDist, if the tank tracks those of its temperatures
+    virtual void calcHeatDistGradient(std::vector<Gradient>& heatDistributionGradient);
+
     bool isACompressor() const { return typeOfHeatSource() == TYPE_compressor; }
     /**< returns if the heat source uses a compressor or not */
     bool isAResistance() const { return typeOfHeatSource() == TYPE_resistance; }
@@ -67,6 +77,9 @@ class HPWH::HeatSource : public Sender
     /**< calculates the distance the current state is from the shutOff logic for external
      * configurations*/
 
+    Gradient fractToMeetComparisonExternalGradient() const;
+    /**< derivatives of fractToMeetComparisonExternal */
+
     void addHeat(double externalT_C, double minutesToRun);
     /**< adds heat to the hpwh - this is the function that interprets the
         various configurations (internal/external, resistance/heat pump) to add heat */
@@ -86,6 +99,8 @@ class HPWH::HeatSource : public Sender
     // some outputs
     double runtime_min;
     /**< this is the percentage of the step that the heat source was running */
+    Gradient runtimeGradient_min;
+    /**< derivatives of runtime_min, if a test is finding them (not copied) */
     double energyInput_kWh;
     /**< the energy used by the heat source */
     double energyOutput_kWh;
@@ -165,8 +180,16 @@ class HPWH::HeatSource : public Sender
     double getTankTemp() const;
     /**< returns the tank temperature weighted by the condensity for this heat source */
 
+    Gradient getTankTempGradient() const;
+    /**< derivatives of getTankTemp */
+
   protected:
-    double heat(double cap_kJ, double maxSetpointT_C);
+    /// if capGradient_kJ is given, it holds the derivatives of cap_kJ on entry and those of the
+    /// returned leftover capacity on exit
+    double heat(double cap_kJ, double maxSetpointT_C, Gradient* capGradient_kJ = nullptr);
+
+    /// assign the owning HPWH and replace the heating logics with copies bound to it
+    void setOwner(HPWH* hpwh_in);
 
   public:
 }; // end of HeatSource class
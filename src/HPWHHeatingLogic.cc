@@ -119,6 +119,76 @@ double HPWH::SoCBasedHeatingLogic::getFractToMeetComparisonExternal()
     return std::min(fractCalcNode, fractNextNode);
 }
 
+HPWH::Gradient HPWH::SoCBasedHeatingLogic::getFractToMeetComparisonExternalGradient()
+{
+    // same steps as getFractToMeetComparisonExternal
+    auto& nodeTs_C = hpwh->tank->nodeTs_C;
+    auto& nodeTGradients_C = hpwh->tank->nodeTGradients_C;
+    Gradient zeroGradient(hpwh->tank->outletTGradient_C.size());
+
+    double deltaSoCFraction = (getComparisonValue() + HPWH::TOL_MINVALUE) - getTankValue();
+    double fullNodeSoC = 1. / hpwh->getNumNodes();
+    if (deltaSoCFraction >= fullNodeSoC)
+    {
+        return zeroGradient;
+    }
+    Gradient deltaSoCFractionGradient =
+        -1. * hpwh->tank->calcSoCFractionGradient(
+                  getMainsT_C(), tempMinUseful_C, hpwh->getSetpoint());
+
+    int calcNode = 0;
+    for (int i = hpwh->getNumNodes() - 1; i >= 0; i--)
+    {
+        if (nodeTs_C[i] < tempMinUseful_C)
+        {
+            calcNode = i + 1;
+            break;
+        }
+    }
+    if (calcNode == hpwh->getNumNodes())
+    {
+        return zeroGradient;
+    }
+
+    double maxSoC =
+        hpwh->getNumNodes() * getChargePerNode(getMainsT_C(), tempMinUseful_C, hpwh->setpoint_C);
+    double targetTemp =
+        deltaSoCFraction * maxSoC +
+        (nodeTs_C[calcNode] - getMainsT_C()) / (tempMinUseful_C - getMainsT_C());
+    targetTemp = targetTemp * (tempMinUseful_C - getMainsT_C()) + getMainsT_C();
+    Gradient targetTempGradient =
+        (maxSoC * (tempMinUseful_C - getMainsT_C())) * deltaSoCFractionGradient +
+        nodeTGradients_C[calcNode];
+
+    double fractCalcNode = 1.;
+    Gradient fractCalcNodeGradient = zeroGradient;
+    if (nodeTs_C[calcNode] < hpwh->setpoint_C)
+    {
+        double nodeDiffT_C = hpwh->setpoint_C - nodeTs_C[calcNode];
+        fractCalcNode = (targetTemp - nodeTs_C[calcNode]) / nodeDiffT_C;
+        fractCalcNodeGradient =
+            (targetTempGradient - (1. - fractCalcNode) * nodeTGradients_C[calcNode]) /
+            nodeDiffT_C;
+    }
+
+    if (calcNode == 0)
+    {
+        return fractCalcNodeGradient;
+    }
+
+    double nodeDiffT_C = nodeTs_C[calcNode] - nodeTs_C[calcNode - 1];
+    double fractNextNode = (tempMinUseful_C - nodeTs_C[calcNode - 1]) / nodeDiffT_C;
+    fractNextNode += HPWH::TOL_MINVALUE;
+    if (fractCalcNode <= fractNextNode)
+    {
+        return fractCalcNodeGradient;
+    }
+    return (-1. * nodeTGradients_C[calcNode - 1] -
+            (fractNextNode - HPWH::TOL_MINVALUE) *
+                (nodeTGradients_C[calcNode] - nodeTGradients_C[calcNode - 1])) /
+           nodeDiffT_C;
+}
+
 /* Temperature Based Heating Logic*/
 HPWH::TempBasedHeatingLogic::TempBasedHeatingLogic(std::string desc,
                                                    std::vector<NodeWeight> n,
@@ -223,30 +293,26 @@ double HPWH::TempBasedHeatingLogic::nodeWeightAvgFract()
     return 0.;
 }
 
-double HPWH::TempBasedHeatingLogic::getFractToMeetComparisonExternal()
+std::vector<double> HPWH::TempBasedHeatingLogic::getExternalNodeWeights(int& firstNode,
+                                                                        int& calcNode)
 {
-    int calcNode = 0;
-    int firstNode = -1;
-    double sum = 0;
-    double totWeight = 0;
-
-    double comparisonT_C = getComparisonValue() + HPWH::TOL_MINVALUE; // slightly over heat
+    std::vector<double> nodeWeights(hpwh->getNumNodes(), 0.);
+    calcNode = 0;
+    firstNode = -1;
 
     switch (dist.distributionType)
     {
     case DistributionType::BottomOfTank:
     {
         firstNode = calcNode = 0;
-        sum = hpwh->tank->nodeTs_C.front();
-        totWeight = 1.;
+        nodeWeights.front() = 1.;
         break;
     }
 
     case DistributionType::TopOfTank:
     {
         firstNode = calcNode = hpwh->getNumNodes() - 1;
-        sum = hpwh->tank->nodeTs_C.back();
-        totWeight = 1.;
+        nodeWeights.back() = 1.;
         break;
     }
     case DistributionType::Weighted:
@@ -261,12 +327,31 @@ double HPWH::TempBasedHeatingLogic::getFractToMeetComparisonExternal()
                 if (firstNode == -1)
                     firstNode = i;
                 calcNode = i;
-                sum += w * hpwh->tank->nodeTs_C[i];
-                totWeight += w;
+                nodeWeights[i] = w;
             }
         }
     }
     }
+    return nodeWeights;
+}
+
+double HPWH::TempBasedHeatingLogic::getFractToMeetComparisonExternal()
+{
+    int calcNode, firstNode;
+    auto nodeWeights = getExternalNodeWeights(firstNode, calcNode);
+
+    double sum = 0;
+    double totWeight = 0;
+    for (int i = 0; i < hpwh->getNumNodes(); ++i)
+    {
+        if (nodeWeights[i] > 0.)
+        {
+            sum += nodeWeights[i] * hpwh->tank->nodeTs_C[i];
+            totWeight += nodeWeights[i];
+        }
+    }
+
+    double comparisonT_C = getComparisonValue() + HPWH::TOL_MINVALUE; // slightly over heat
 
     double averageT_C = sum / totWeight;
     double targetT_C = (calcNode < hpwh->getNumNodes() - 1) ? hpwh->tank->nodeTs_C[calcNode + 1]
@@ -291,6 +376,50 @@ double HPWH::TempBasedHeatingLogic::getFractToMeetComparisonExternal()
     return nodeDensity * nodeFrac;
 }
 
+HPWH::Gradient HPWH::TempBasedHeatingLogic::getFractToMeetComparisonExternalGradient()
+{
+    auto& nodeTs_C = hpwh->tank->nodeTs_C;
+    auto& nodeTGradients_C = hpwh->tank->nodeTGradients_C;
+    Gradient nodeFracGradient(hpwh->tank->outletTGradient_C.size());
+
+    int calcNode, firstNode;
+    auto nodeWeights = getExternalNodeWeights(firstNode, calcNode);
+
+    double sum = 0;
+    double totWeight = 0;
+    Gradient sumGradient;
+    for (int i = 0; i < hpwh->getNumNodes(); ++i)
+    {
+        if (nodeWeights[i] > 0.)
+        {
+            sum += nodeWeights[i] * nodeTs_C[i];
+            sumGradient += nodeWeights[i] * nodeTGradients_C[i];
+            totWeight += nodeWeights[i];
+        }
+    }
+
+    double comparisonT_C = getComparisonValue() + HPWH::TOL_MINVALUE;
+    double averageT_C = sum / totWeight;
+    double targetT_C =
+        (calcNode < hpwh->getNumNodes() - 1) ? nodeTs_C[calcNode + 1] : hpwh->getSetpoint();
+    double nodeDiffT_C = targetT_C - nodeTs_C[firstNode];
+
+    // zero where the fraction is fixed
+    if (compare(averageT_C, comparisonT_C) || (nodeDiffT_C <= 0.))
+        return nodeFracGradient;
+
+    Gradient targetTGradient_C = (calcNode < hpwh->getNumNodes() - 1)
+                                     ? nodeTGradients_C[calcNode + 1]
+                                     : nodeFracGradient;
+    Gradient nodeDiffTGradient_C = targetTGradient_C - nodeTGradients_C[firstNode];
+    double nodeFrac = (comparisonT_C - averageT_C) / nodeDiffT_C;
+    nodeFracGradient =
+        (-1. / totWeight * sumGradient - nodeFrac * nodeDiffTGradient_C) / nodeDiffT_C;
+
+    double nodeDensity = static_cast<double>(hpwh->getNumNodes()) / LOGIC_SIZE;
+    return nodeDensity * nodeFracGradient;
+}
+
 /*static*/
 std::shared_ptr<HPWH::HeatingLogic>
 HPWH::HeatingLogic::make(const hpwh_data_model::heat_source_configuration::HeatingLogic& logic,
@@ -29,6 +29,9 @@ struct HPWH::HeatingLogic
 
     virtual ~HeatingLogic() = default;
 
+    /**< returns a copy that refers to hpwh_in */
+    virtual std::shared_ptr<HeatingLogic> clone(HPWH* hpwh_in) const = 0;
+
     /**< checks that the input is all valid. */
     virtual bool isValid() = 0;
     /**< gets the value for comparing the tank value to, i.e. the target SoC */
@@ -39,6 +42,9 @@ struct HPWH::HeatingLogic
     virtual double nodeWeightAvgFract() = 0;
     /**< gets the fraction of a node that has to be heated up to met the turnoff condition*/
     virtual double getFractToMeetComparisonExternal() = 0;
+    /**< derivatives of getFractToMeetComparisonExternal, if the tank tracks those of its
+     * temperatures */
+    virtual Gradient getFractToMeetComparisonExternalGradient() = 0;
 
     virtual void setDecisionPoint(double value) = 0;
     double getDecisionPoint() { return decisionPoint; }
@@ -76,12 +82,21 @@ struct HPWH::SoCBasedHeatingLogic : HPWH::HeatingLogic
         , hysteresisFraction(hF)
         , useCostantMains(constMains)
         , constantMains_C(mains_C) {};
+
+    std::shared_ptr<HeatingLogic> clone(HPWH* hpwh_in) const override
+    {
+        auto logic = std::make_shared<SoCBasedHeatingLogic>(*this);
+        logic->hpwh = hpwh_in;
+        return logic;
+    }
+
     bool isValid() override;
 
     double getComparisonValue() override;
     double getTankValue() override;
     double nodeWeightAvgFract() override;
     double getFractToMeetComparisonExternal() override;
+    Gradient getFractToMeetComparisonExternalGradient() override;
     double getMainsT_C();
     double getTempMinUseful_C();
     void setDecisionPoint(double value) override;
@@ -122,12 +137,20 @@ struct HPWH::TempBasedHeatingLogic : HPWH::HeatingLogic
     {
     }
 
+    std::shared_ptr<HeatingLogic> clone(HPWH* hpwh_in) const override
+    {
+        auto logic = std::make_shared<TempBasedHeatingLogic>(*this);
+        logic->hpwh = hpwh_in;
+        return logic;
+    }
+
     bool isValid() override;
 
     double getComparisonValue() override;
     double getTankValue() override;
     double nodeWeightAvgFract() override;
     double getFractToMeetComparisonExternal() override;
+    Gradient getFractToMeetComparisonExternalGradient() override;
 
     void setDecisionPoint(double value) override;
     void setDecisionPoint(double value, bool absolute);
@@ -139,6 +162,10 @@ struct HPWH::TempBasedHeatingLogic : HPWH::HeatingLogic
 
   private:
     bool isDistributionValid();
+
+    /// weights of the nodes averaged by getFractToMeetComparisonExternal, with the indices of
+    /// the first and last weighted nodes
+    std::vector<double> getExternalNodeWeights(int& firstNode, int& calcNode);
 };
 
 #endif
@@ -0,0 +1,399 @@
+/*
+ * Implementation of class HPWH::JSONLoader
+ */
+
+#include <mutex>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHJSONLoader.hh"
+
+namespace
+{
+/// values of one performance map, read outside the JSON tree
+struct PerformanceMapValues
+{
+    std::string system; /**< "integrated_system" or "central_system" */
+    std::size_t iConfiguration = 0;
+    std::unordered_map<std::string, std::vector<double>> gridVariables;
+    std::unordered_map<std::string, std::vector<double>> lookupVariables;
+};
+
+/// builds the JSON tree, except for the performance maps of heat-source configurations
+class InputSAX : public nlohmann::json_sax<nlohmann::json>
+{
+  public:
+    nlohmann::json root;
+    std::vector<PerformanceMapValues> maps;
+    std::string errorMessage;
+
+    bool null() override { return addValue(nullptr); }
+
+    bool boolean(bool val) override { return addValue(val); }
+
+    bool number_integer(number_integer_t val) override { return addNumber(val); }
+
+    bool number_unsigned(number_unsigned_t val) override { return addNumber(val); }
+
+    bool number_float(number_float_t val, const string_t& /*s*/) override
+    {
+        return addNumber(val);
+    }
+
+    bool string(string_t& val) override { return addValue(val); }
+
+    bool binary(binary_t& val) override { return addValue(nlohmann::json::binary(val)); }
+
+    bool start_object(std::size_t /*elements*/) override
+    {
+        if (mapDepth > 0)
+        {
+            if (mapDepth != 1)
+                return fail("Unexpected object in a performance map.");
+            mapDepth = 2;
+            group = (pendingKey == "grid_variables") ? &maps.back().gridVariables
+                    : (pendingKey == "lookup_variables")
+                        ? &maps.back().lookupVariables
+                        : nullptr;
+            if (group == nullptr)
+                return fail(fmt::format("Unexpected performance-map member {}.", pendingKey));
+            return true;
+        }
+
+        if (isPerformanceMap())
+        {
+            PerformanceMapValues map;
+            map.system = frames[1].key;
+            map.iConfiguration = frames[frames.size() - 3].index;
+            maps.push_back(map);
+            mapDepth = 1;
+            return true;
+        }
+        return open(nlohmann::json::object(), false);
+    }
+
+    bool key(string_t& val) override
+    {
+        pendingKey = val;
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if (mapDepth > 0)
+        {
+            --mapDepth;
+            return true;
+        }
+        return close();
+    }
+
+    bool start_array(std::size_t /*elements*/) override
+    {
+        if (mapDepth > 0)
+        {
+            if (mapDepth != 2)
+                return fail("Unexpected array in a performance map.");
+            mapDepth = 3;
+            values = &(*group)[pendingKey];
+            return true;
+        }
+        return open(nlohmann::json::array(), true);
+    }
+
+    bool end_array() override
+    {
+        if (mapDepth > 0)
+        {
+            mapDepth = 2;
+            return true;
+        }
+        return close();
+    }
+
+    bool parse_error(std::size_t position,
+                     const std::string& /*last_token*/,
+                     const nlohmann::json::exception& ex) override
+    {
+        return fail(fmt::format("JSON parse error at byte {}: {}", position, ex.what()));
+    }
+
+  private:
+    ///	@struct Frame
+    struct Frame
+    {
+        std::string key;       /**< of the container in its parent object */
+        std::size_t index = 0; /**< of the container in its parent array */
+        bool isArray = false;
+        std::size_t size = 0;
+    };
+
+    std::vector<nlohmann::json*> containers; /**< open in the tree, from the root */
+    std::vector<Frame> frames;               /**< as containers */
+    std::string pendingKey;
+
+    int mapDepth = 0; /**< 1: map, 2: variable group, 3: variable values */
+    std::unordered_map<std::string, std::vector<double>>* group = nullptr;
+    std::vector<double>* values = nullptr;
+
+    bool fail(const std::string& message)
+    {
+        if (errorMessage.empty())
+            errorMessage = message;
+        return false;
+    }
+
+    /// a new object is the performance map of a heat source in a heat-source configuration
+    bool isPerformanceMap() const
+    {
+        std::size_t n = frames.size();
+        return (pendingKey == "performance_map") && (n >= 5) && !frames[n - 1].isArray &&
+               (frames[n - 1].key == "performance") && (frames[n - 2].key == "heat_source") &&
+               frames[n - 4].isArray && (frames[n - 4].key == "heat_source_configurations");
+    }
+
+    template <typename T>
+    bool addNumber(T val)
+    {
+        if (mapDepth == 0)
+            return addValue(val);
+        if (mapDepth != 3)
+            return fail("Unexpected number in a performance map.");
+        values->push_back(static_cast<double>(val));
+        return true;
+    }
+
+    nlohmann::json* add(nlohmann::json&& value)
+    {
+        if (containers.empty())
+        {
+            root = std::move(value);
+            return &root;
+        }
+        auto& parent = *containers.back();
+        if (parent.is_array())
+        {
+            parent.push_back(std::move(value));
+            ++frames.back().size;
+            return &parent.back();
+        }
+        auto& member = parent[pendingKey];
+        member = std::move(value);
+        return &member;
+    }
+
+    bool addValue(nlohmann::json&& value)
+    {
+        if (mapDepth > 0)
+            return fail("Unexpected value in a performance map.");
+        add(std::move(value));
+        return true;
+    }
+
+    bool open(nlohmann::json&& container, bool isArray)
+    {
+        Frame frame;
+        frame.isArray = isArray;
+        if (!frames.empty() && frames.back().isArray)
+            frame.index = frames.back().size;
+        else
+            frame.key = pendingKey;
+        containers.push_back(add(std::move(container)));
+        frames.push_back(frame);
+        return true;
+    }
+
+    bool close()
+    {
+        containers.pop_back();
+        frames.pop_back();
+        return true;
+    }
+};
+
+/// forwards data-model messages, except warnings about the performance maps, which from_json
+/// does not see
+class MapFilterCourier : public Courier::DefaultCourier
+{
+  public:
+    explicit MapFilterCourier(std::shared_ptr<::Courier::Courier> target_in)
+        : target(std::move(target_in))
+    {
+    }
+
+  protected:
+    void write_message(const std::string& message_type, const std::string& message) override
+    {
+        if (message_type == "ERROR")
+            target->send_error(message);
+        else if (message.find("performance_map") != std::string::npos)
+            return;
+        else if (message_type == "WARNING")
+            target->send_warning(message);
+        else if (message_type == "INFO")
+            target->send_info(message);
+        else
+            target->send_debug(message);
+    }
+
+  private:
+    std::shared_ptr<::Courier::Courier> target;
+};
+
+/// sets the data-model loggers to courier when it goes out of scope
+struct RestoreLoggers
+{
+    std::shared_ptr<Courier::Courier> courier;
+    ~RestoreLoggers() { hpwh_data_model::init(courier); }
+};
+
+/// a grid or lookup variable: its values and their _is_set flag
+using Variable = std::pair<std::vector<double>*, bool*>;
+
+/// move the values read for a performance map into the data-model map; findGridVariable gives
+/// the member for a grid-variable name, as grid variables differ between heat-source types
+template <typename PerformanceMap, typename FindGridVariable>
+bool setPerformanceMap(PerformanceMap& perf_map,
+                       PerformanceMapValues& map,
+                       FindGridVariable findGridVariable,
+                       std::string& unknownName)
+{
+    auto setValues = [&unknownName](Variable variable,
+                                    const std::string& variableName,
+                                    std::vector<double>& values)
+    {
+        if (variable.first == nullptr)
+        {
+            unknownName = variableName;
+            return false;
+        }
+        *variable.first = std::move(values);
+        *variable.second = true;
+        return true;
+    };
+
+    auto& grid_variables = perf_map.grid_variables;
+    for (auto& [variableName, values] : map.gridVariables)
+        if (!setValues(findGridVariable(grid_variables, variableName), variableName, values))
+            return false;
+
+    auto& lookup_variables = perf_map.lookup_variables;
+    for (auto& [variableName, values] : map.lookupVariables)
+    {
+        Variable variable = {nullptr, nullptr};
+        if (variableName == "input_power")
+            variable = {&lookup_variables.input_power, &lookup_variables.input_power_is_set};
+        else if (variableName == "heating_capacity")
+            variable = {&lookup_variables.heating_capacity,
+                        &lookup_variables.heating_capacity_is_set};
+        if (!setValues(variable, variableName, values))
+            return false;
+    }
+
+    perf_map.grid_variables_is_set = !map.gridVariables.empty();
+    perf_map.lookup_variables_is_set = !map.lookupVariables.empty();
+    return true;
+}
+} // namespace
+
+void HPWH::JSONLoader::load(std::istream& is, hpwh_data_model::hpwh_sim_input::HPWHSimInput& hsi)
+{
+    InputSAX sax;
+    if (!nlohmann::json::sax_parse(is, &sax))
+    {
+        send_error(sax.errorMessage.empty() ? "Unable to read JSON input." : sax.errorMessage);
+        return;
+    }
+
+    {
+        // the loggers are global: set them under the lock preset decoding holds, and restore
+        // them even if from_json throws
+        std::lock_guard<std::mutex> lock(HPWH::getDataModelMutex());
+        RestoreLoggers restoreLoggers {get_courier()};
+        hpwh_data_model::init(std::make_shared<MapFilterCourier>(get_courier()));
+        hpwh_data_model::hpwh_sim_input::from_json(sax.root, hsi);
+    }
+
+    nMapValues = 0;
+    for (auto& map : sax.maps)
+    {
+        auto& configurations = (map.system == "central_system")
+                                   ? hsi.central_system.heat_source_configurations
+                                   : hsi.integrated_system.performance.heat_source_configurations;
+        if ((map.iConfiguration >= configurations.size()) ||
+            !configurations[map.iConfiguration].heat_source)
+        {
+            send_error("A performance map was found outside a heat source.");
+            return;
+        }
+        auto& config = configurations[map.iConfiguration];
+
+        for (auto& group : {&map.gridVariables, &map.lookupVariables})
+            for (auto& variable : *group)
+                nMapValues += variable.second.size();
+
+        bool isSet = false;
+        std::string unknownName;
+        switch (config.heat_source_type)
+        {
+        case hpwh_data_model::heat_source_configuration::HeatSourceType::CONDENSER:
+        {
+            auto& perf = reinterpret_cast<
+                hpwh_data_model::rscondenserwaterheatsource::RSCONDENSERWATERHEATSOURCE*>(
+                config.heat_source.get())->performance;
+            isSet = setPerformanceMap(
+                perf.performance_map,
+                map,
+                [](auto& grid, const std::string& variableName) -> Variable
+                {
+                    if (variableName == "evaporator_environment_dry_bulb_temperature")
+                        return {&grid.evaporator_environment_dry_bulb_temperature,
+                                &grid.evaporator_environment_dry_bulb_temperature_is_set};
+                    if (variableName == "heat_source_temperature")
+                        return {&grid.heat_source_temperature,
+                                &grid.heat_source_temperature_is_set};
+                    return {nullptr, nullptr};
+                },
+                unknownName);
+            perf.performance_map_is_set = true;
+            break;
+        }
+        case hpwh_data_model::heat_source_configuration::HeatSourceType::AIRTOWATERHEATPUMP:
+        {
+            auto& perf =
+                reinterpret_cast<hpwh_data_model::rsairtowaterheatpump::RSAIRTOWATERHEATPUMP*>(
+                    config.heat_source.get())->performance;
+            isSet = setPerformanceMap(
+                perf.performance_map,
+                map,
+                [](auto& grid, const std::string& variableName) -> Variable
+                {
+                    if (variableName == "evaporator_environment_dry_bulb_temperature")
+                        return {&grid.evaporator_environment_dry_bulb_temperature,
+                                &grid.evaporator_environment_dry_bulb_temperature_is_set};
+                    if (variableName == "condenser_entering_temperature")
+                        return {&grid.condenser_entering_temperature,
+                                &grid.condenser_entering_temperature_is_set};
+                    if (variableName == "condenser_leaving_temperature")
+                        return {&grid.condenser_leaving_temperature,
+                                &grid.condenser_leaving_temperature_is_set};
+                    return {nullptr, nullptr};
+                },
+                unknownName);
+            perf.performance_map_is_set = true;
+            break;
+        }
+        default:
+            send_error("Only condensers and air-to-water heat pumps have performance maps.");
+            return;
+        }
+
+        if (!isSet)
+        {
+            send_error(fmt::format("Unknown performance-map variable {}.", unknownName));
+            return;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef HPWHJSONLOADER_hh
+#define HPWHJSONLOADER_hh
+
+#include "HPWH.hh"
+#include <istream>
+
+///	@class HPWH::JSONLoader HPWHJSONLoader.hh
+/// Reads an HPWHSimInput from JSON text as a stream of SAX events, without holding the whole
+/// document as a JSON tree. The performance maps of condensers and air-to-water heat pumps,
+/// which hold nearly all the values of large models, are read directly into vectors; the rest
+/// of the document is read into a (small) tree and converted by from_json, after which the
+/// maps are moved into the data-model structures.
+class HPWH::JSONLoader : public Sender
+{
+  public:
+    JSONLoader(
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+        const std::string& name_in = "jsonLoader")
+        : Sender("JSONLoader", name_in, courier)
+    {
+    }
+
+    void load(std::istream& is, hpwh_data_model::hpwh_sim_input::HPWHSimInput& hsi);
+
+    /// performance-map values read outside the JSON tree by the last load
+    std::size_t getNumMapValues() const { return nMapValues; }
+
+  private:
+    std::size_t nMapValues = 0;
+};
+
+#endif
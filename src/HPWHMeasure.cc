@@ -0,0 +1,77 @@
+/*
+ * Implementation of HPWH::measureAll
+ */
+
+#include <chrono>
+
+#include "HPWH.hh"
+#include "HPWHParallel.hh"
+
+//-----------------------------------------------------------------------------
+///	@brief	Find the first-hour rating, then run the E50, UEF, and E95 24-hr tests.
+/// @note	The first-hour rating is found once; the tests run in parallel on
+///         private copies, so this instance is not modified.
+//-----------------------------------------------------------------------------
+HPWH::StandardTestResults HPWH::measureAll(unsigned nThreads /*=0*/) const
+{
+    auto startTime = std::chrono::steady_clock::now();
+    auto firstHourRating = getFirstHourRating();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    auto results = measureAll(firstHourRating.designation, nThreads);
+    results.firstHourRating = firstHourRating;
+    results.hasFirstHourRating = true;
+    results.firstHourRatingTime_s = elapsed.count();
+    return results;
+}
+
+HPWH::StandardTestResults HPWH::measureAll(FirstHourRating::Designation designation,
+                                           unsigned nThreads /*=0*/) const
+{
+    StandardTestResults results;
+    results.firstHourRating.designation = designation;
+    results.firstHourRating.drawVolume_L = 0.;
+    results.tests = {{"E50", testConfiguration_E50, {}},
+                     {"UEF", testConfiguration_UEF, {}},
+                     {"E95", testConfiguration_E95, {}}};
+
+    // copies are made here, so that this instance is only read from the calling thread
+    std::vector<std::unique_ptr<HPWH>> copies;
+    copies.reserve(results.tests.size());
+    for (std::size_t iTest = 0; iTest < results.tests.size(); ++iTest)
+        copies.push_back(clone());
+
+    hpwh_parallel::forEach(
+        results.tests.size(),
+        [&](std::size_t iTest)
+        {
+            auto& test = results.tests[iTest];
+            auto startTime = std::chrono::steady_clock::now();
+            test.testSummary = copies[iTest]->run24hrTest(test.testConfiguration, designation);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+            test.elapsedTime_s = elapsed.count();
+        },
+        nThreads);
+
+    return results;
+}
+
+//-----------------------------------------------------------------------------
+///	@brief	Standard test results, with the 24-hr test reports keyed by configuration
+//-----------------------------------------------------------------------------
+nlohmann::json HPWH::StandardTestResults::report()
+{
+    nlohmann::json j_results = {};
+    if (hasFirstHourRating)
+    {
+        j_results["first_hour_rating"] = firstHourRating.report();
+        j_results["first_hour_rating"]["elapsed_time_s"] = firstHourRatingTime_s;
+    }
+    for (auto& test : tests)
+    {
+        auto& j_test = j_results["24_hr_tests"][test.name];
+        j_test = test.testSummary.report();
+        j_test["elapsed_time_s"] = test.elapsedTime_s;
+    }
+    return j_results;
+}
@@ -0,0 +1,46 @@
+/*
+ * Implementation of class HPWH::ModelSpec
+ */
+
+#include "HPWH.hh"
+#include "HPWHModelSpec.hh"
+
+HPWH::ModelSpec::ModelSpec(const HPWH& hpwh)
+    : prototype(hpwh), initialState(hpwh.getState()), name(hpwh.name)
+{
+}
+
+std::shared_ptr<const HPWH::ModelSpec>
+HPWH::ModelSpec::fromPreset(const std::string& modelName,
+                            const std::shared_ptr<Courier::Courier>& courier)
+{
+    HPWH hpwh(courier);
+    hpwh.initPreset(modelName);
+    return std::make_shared<const ModelSpec>(hpwh);
+}
+
+std::shared_ptr<const HPWH::ModelSpec>
+HPWH::ModelSpec::fromPreset(hpwh_presets::MODELS presetNum,
+                            const std::shared_ptr<Courier::Courier>& courier)
+{
+    HPWH hpwh(courier);
+    hpwh.initPreset(presetNum);
+    return std::make_shared<const ModelSpec>(hpwh);
+}
+
+std::shared_ptr<const HPWH::ModelSpec>
+HPWH::ModelSpec::fromJSON(const nlohmann::json& j,
+                          const std::string& modelName,
+                          const std::shared_ptr<Courier::Courier>& courier)
+{
+    HPWH hpwh(courier);
+    hpwh.initFromJSON(j, modelName);
+    return std::make_shared<const ModelSpec>(hpwh);
+}
+
+std::unique_ptr<HPWH> HPWH::ModelSpec::instantiate(const State& state) const
+{
+    auto hpwh = prototype.clone();
+    hpwh->setState(state);
+    return hpwh;
+}
@@ -0,0 +1,52 @@
+#ifndef HPWHMODELSPEC_hh
+#define HPWHMODELSPEC_hh
+
+#include "HPWH.hh"
+
+///	@class HPWH::ModelSpec HPWHModelSpec.hh
+/// Immutable model configuration, constructed once per preset or JSON input and shared
+/// (reference-counted) between any number of simulated units. Each unit then needs only a
+/// HPWH::State; working HPWH instances are created from the spec without re-parsing input.
+/// A spec is never run, so it may be shared between threads.
+class HPWH::ModelSpec
+{
+  public:
+    /// capture the configuration and current state of hpwh
+    explicit ModelSpec(const HPWH& hpwh);
+
+    static std::shared_ptr<const ModelSpec>
+    fromPreset(const std::string& modelName,
+               const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    static std::shared_ptr<const ModelSpec>
+    fromPreset(hpwh_presets::MODELS presetNum,
+               const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    static std::shared_ptr<const ModelSpec>
+    fromJSON(const nlohmann::json& j,
+             const std::string& modelName = "custom",
+             const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    const std::string& getName() const { return name; }
+
+    hpwh_presets::MODELS getModel() const { return prototype.model; }
+
+    /// the state of a newly instantiated unit
+    const State& getInitialState() const { return initialState; }
+
+    /// create a working instance in the initial state
+    std::unique_ptr<HPWH> instantiate() const { return prototype.clone(); }
+
+    /// create a working instance in the given state
+    std::unique_ptr<HPWH> instantiate(const State& state) const;
+
+    /// the configured instance; read-only
+    const HPWH& getPrototype() const { return prototype; }
+
+  private:
+    const HPWH prototype;
+    const State initialState;
+    const std::string name;
+};
+
+#endif
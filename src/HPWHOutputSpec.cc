@@ -0,0 +1,340 @@
+/*
+ * Implementation of class HPWH::OutputSpec
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHOutputSpec.hh"
+#include "HPWHResults.hh"
+
+namespace
+{
+struct QuantityName
+{
+    const char* name;
+    HPWH::OutputSpec::Quantity quantity;
+};
+
+/// as in the per-minute CSV heading
+const QuantityName quantityNames[] = {
+    {"Ta", HPWH::OutputSpec::Quantity::ambientT},
+    {"Tsetpoint", HPWH::OutputSpec::Quantity::setpointT},
+    {"inletT", HPWH::OutputSpec::Quantity::inletT},
+    {"draw", HPWH::OutputSpec::Quantity::draw},
+    {"toutlet", HPWH::OutputSpec::Quantity::outletT},
+    {"soCFract", HPWH::OutputSpec::Quantity::soCFract},
+    {"targetSoCFract", HPWH::OutputSpec::Quantity::targetSoCFract},
+    {"unmetDraw", HPWH::OutputSpec::Quantity::unmetDraw}};
+
+/// parse an index from 1 between prefix and suffix, as in "h_src2Out" or "tcouple3"
+bool parseIndexed(const std::string& columnName,
+                  const std::string& prefix,
+                  const std::string& suffix,
+                  int& index)
+{
+    if ((columnName.size() <= prefix.size() + suffix.size()) ||
+        (columnName.compare(0, prefix.size(), prefix) != 0) ||
+        (columnName.compare(columnName.size() - suffix.size(), suffix.size(), suffix) != 0))
+        return false;
+
+    std::string digits =
+        columnName.substr(prefix.size(), columnName.size() - prefix.size() - suffix.size());
+    if ((digits.size() > 3) ||
+        !std::all_of(digits.begin(), digits.end(), [](char c) { return std::isdigit(c) != 0; }))
+        return false;
+    index = std::stoi(digits) - 1;
+    return (index >= 0);
+}
+} // namespace
+
+std::string HPWH::OutputSpec::getUnits(Quantity quantity)
+{
+    switch (quantity)
+    {
+    case Quantity::ambientT:
+    case Quantity::setpointT:
+    case Quantity::inletT:
+    case Quantity::outletT:
+    case Quantity::tcouple:
+        return "C";
+    case Quantity::draw:
+    case Quantity::unmetDraw:
+        return "gal";
+    case Quantity::heatSourceIn:
+    case Quantity::heatSourceOut:
+        return "Wh";
+    case Quantity::soCFract:
+    case Quantity::targetSoCFract:
+        return "";
+    }
+    return "";
+}
+
+bool HPWH::OutputSpec::isDrawDependent(Quantity quantity)
+{
+    return (quantity == Quantity::inletT) || (quantity == Quantity::outletT);
+}
+
+HPWH::OutputSpec::Aggregation
+HPWH::OutputSpec::getAggregation(const std::string& aggregationName) const
+{
+    for (auto aggregation : {Aggregation::sum,
+                             Aggregation::mean,
+                             Aggregation::volumeWeightedMean,
+                             Aggregation::min,
+                             Aggregation::max})
+        if (getAggregationName(aggregation) == aggregationName)
+            return aggregation;
+    send_error(fmt::format("Unknown aggregation {}.", aggregationName));
+    return Aggregation::sum;
+}
+
+std::string HPWH::OutputSpec::getAggregationName(Aggregation aggregation)
+{
+    switch (aggregation)
+    {
+    case Aggregation::sum:
+        return "sum";
+    case Aggregation::mean:
+        return "mean";
+    case Aggregation::volumeWeightedMean:
+        return "volume_weighted_mean";
+    case Aggregation::min:
+        return "min";
+    case Aggregation::max:
+        return "max";
+    }
+    return "";
+}
+
+void HPWH::OutputSpec::addColumn(const std::string& columnName,
+                                 Aggregation aggregation,
+                                 const std::string& label /*=""*/)
+{
+    Column column;
+    column.aggregation = aggregation;
+    column.label = label.empty()
+                       ? fmt::format("{} {}", columnName, getAggregationName(aggregation))
+                       : label;
+
+    auto found = std::find_if(std::begin(quantityNames),
+                              std::end(quantityNames),
+                              [&columnName](const QuantityName& quantityName)
+                              { return columnName == quantityName.name; });
+    if (found != std::end(quantityNames))
+        column.quantity = found->quantity;
+    else if (parseIndexed(columnName, "h_src", "In", column.index))
+        column.quantity = Quantity::heatSourceIn;
+    else if (parseIndexed(columnName, "h_src", "Out", column.index))
+        column.quantity = Quantity::heatSourceOut;
+    else if (parseIndexed(columnName, "tcouple", "", column.index) &&
+             (column.index < TestData::nTCouples))
+        column.quantity = Quantity::tcouple;
+    else
+    {
+        send_error(fmt::format("Unknown output column {}.", columnName));
+    }
+    columns.push_back(column);
+}
+
+void HPWH::OutputSpec::from(const nlohmann::json& j)
+{
+    if (j.contains("interval_min"))
+        interval_min = j["interval_min"].get<long>();
+    if (j.contains("minimum_use_T_C"))
+        minUseT_C = j["minimum_use_T_C"].get<double>();
+    if (interval_min < 1)
+    {
+        send_error("The output interval must be at least one minute.");
+    }
+
+    columns.clear();
+    if (!j.contains("columns") || !j["columns"].is_array() || j["columns"].empty())
+    {
+        send_error("An output specification needs at least one column.");
+    }
+    for (auto& j_column : j["columns"])
+    {
+        if (!j_column.contains("name") || !j_column.contains("aggregation"))
+        {
+            send_error("Each output column needs a name and an aggregation.");
+        }
+        addColumn(j_column["name"].get<std::string>(),
+                  getAggregation(j_column["aggregation"].get<std::string>()),
+                  j_column.contains("label") ? j_column["label"].get<std::string>() : "");
+    }
+}
+
+HPWH::OutputSpec::Recorder::Recorder(const OutputSpec& spec_in,
+                                     const HPWH& hpwh_in,
+                                     CSVSink& sink_in)
+    : Recorder(spec_in, hpwh_in)
+{
+    sink = &sink_in;
+}
+
+HPWH::OutputSpec::Recorder::Recorder(const OutputSpec& spec_in,
+                                     const HPWH& hpwh_in,
+                                     ResultsWriter& writer_in)
+    : Recorder(spec_in, hpwh_in)
+{
+    writer = &writer_in;
+}
+
+HPWH::OutputSpec::Recorder::Recorder(const OutputSpec& spec_in, const HPWH& hpwh_in)
+    : spec(spec_in), hpwh(hpwh_in), accumulators(spec.columns.size())
+{
+    for (auto& column : spec.columns)
+    {
+        if (((column.quantity == Quantity::heatSourceIn) ||
+             (column.quantity == Quantity::heatSourceOut)) &&
+            (column.index >= hpwh.getNumHeatSources()))
+        {
+            spec.send_error(fmt::format("There is no heat source {} for output column {}.",
+                                        column.index + 1,
+                                        column.label));
+        }
+    }
+}
+
+void HPWH::OutputSpec::Recorder::writeHeading()
+{
+    if (writer)
+    {
+        writer->addColumn("minutes", "min");
+        for (auto& column : spec.columns)
+            writer->addColumn(column.label, getUnits(column.quantity));
+        return;
+    }
+
+    sink->write("minutes");
+    for (auto& column : spec.columns)
+        sink->write(",{}", column.label);
+    sink->endRow();
+}
+
+double HPWH::OutputSpec::Recorder::getValue(const Column& column, const TestData& testData) const
+{
+    switch (column.quantity)
+    {
+    case Quantity::ambientT:
+        return testData.ambientT_C;
+    case Quantity::setpointT:
+        return testData.setpointT_C;
+    case Quantity::inletT:
+        return testData.inletT_C;
+    case Quantity::draw:
+        return L_TO_GAL(testData.drawVolume_L);
+    case Quantity::outletT:
+        return testData.outletT_C;
+    case Quantity::heatSourceIn:
+        return testData.h_srcIn_kWh[column.index] * 1000.;
+    case Quantity::heatSourceOut:
+        return testData.h_srcOut_kWh[column.index] * 1000.;
+    case Quantity::tcouple:
+        return testData.thermocoupleT_C[column.index];
+    case Quantity::soCFract:
+        return hpwh.getSoCFraction();
+    case Quantity::targetSoCFract:
+        return hpwh._targetSoC;
+    case Quantity::unmetDraw:
+        return (testData.outletT_C < spec.minUseT_C) ? L_TO_GAL(testData.drawVolume_L) : 0.;
+    }
+    return 0.;
+}
+
+void HPWH::OutputSpec::Recorder::add(const TestData& testData)
+{
+    if (nSteps == 0)
+        intervalBegin_min = testData.time_min;
+
+    for (std::size_t iCol = 0; iCol < spec.columns.size(); ++iCol)
+    {
+        auto& column = spec.columns[iCol];
+        auto& accumulator = accumulators[iCol];
+        if (isDrawDependent(column.quantity) && !(testData.drawVolume_L > 0.))
+            continue;
+
+        double value = getValue(column, testData);
+        switch (column.aggregation)
+        {
+        case Aggregation::sum:
+        case Aggregation::mean:
+            accumulator.sum += value;
+            break;
+        case Aggregation::volumeWeightedMean:
+            accumulator.sum += value * testData.drawVolume_L;
+            accumulator.weight += testData.drawVolume_L;
+            break;
+        case Aggregation::min:
+            accumulator.min = (accumulator.n == 0) ? value : std::min(accumulator.min, value);
+            break;
+        case Aggregation::max:
+            accumulator.max = (accumulator.n == 0) ? value : std::max(accumulator.max, value);
+            break;
+        }
+        ++accumulator.n;
+    }
+
+    if (++nSteps == spec.interval_min)
+        writeRow();
+}
+
+void HPWH::OutputSpec::Recorder::finish()
+{
+    if (nSteps > 0)
+        writeRow();
+}
+
+void HPWH::OutputSpec::Recorder::writeRow()
+{
+    if (writer)
+        writer->write(intervalBegin_min);
+    else
+        sink->write("{:g}", intervalBegin_min);
+    for (std::size_t iCol = 0; iCol < spec.columns.size(); ++iCol)
+    {
+        auto& accumulator = accumulators[iCol];
+        double value = 0.;
+        bool hasValue = (accumulator.n > 0);
+        switch (spec.columns[iCol].aggregation)
+        {
+        case Aggregation::sum:
+            value = accumulator.sum;
+            break;
+        case Aggregation::mean:
+            if (hasValue)
+                value = accumulator.sum / static_cast<double>(accumulator.n);
+            break;
+        case Aggregation::volumeWeightedMean:
+            hasValue = (accumulator.weight > 0.);
+            if (hasValue)
+                value = accumulator.sum / accumulator.weight;
+            break;
+        case Aggregation::min:
+            value = accumulator.min;
+            break;
+        case Aggregation::max:
+            value = accumulator.max;
+            break;
+        }
+        accumulator = Accumulator();
+
+        if (writer)
+            writer->write(hasValue ? value : std::numeric_limits<double>::quiet_NaN());
+        else if (hasValue)
+            sink->write(",{:0.6f}", value);
+        else
+            sink->write(",");
+    }
+    if (writer)
+        writer->endRow();
+    else
+        sink->endRow();
+    nSteps = 0;
+}
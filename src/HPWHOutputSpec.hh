@@ -0,0 +1,130 @@
+#ifndef HPWHOUTPUTSPEC_hh
+#define HPWHOUTPUTSPEC_hh
+
+#include "HPWH.hh"
+#include "HPWHCSVSink.hh"
+
+///	@class HPWH::OutputSpec HPWHOutputSpec.hh
+/// Which quantities are written during a run, and how each is aggregated over a fixed number
+/// of minutes. Columns are named as in the per-minute CSV output ("Ta", "toutlet", "h_src1In",
+/// ...), in the same units. A Recorder aggregates each step as it is taken, so a run writes
+/// one row per interval rather than one per minute.
+class HPWH::OutputSpec : public Sender
+{
+  public:
+    enum class Quantity
+    {
+        ambientT,
+        setpointT,
+        inletT,
+        draw,
+        outletT,
+        heatSourceIn,
+        heatSourceOut,
+        tcouple,
+        soCFract,
+        targetSoCFract,
+        unmetDraw /**< draw delivered below minUseT_C */
+    };
+
+    enum class Aggregation
+    {
+        sum,
+        mean,
+        volumeWeightedMean, /**< weighted by draw volume; empty if nothing is drawn */
+        min,
+        max
+    };
+
+    ///	@struct Column
+    struct Column
+    {
+        Quantity quantity = Quantity::draw;
+        int index = 0; /**< heat source or thermocouple, from 0 */
+        Aggregation aggregation = Aggregation::sum;
+        std::string label;
+    };
+
+    long interval_min = 60;
+    double minUseT_C = F_TO_C(110.);
+    std::vector<Column> columns;
+
+    OutputSpec(
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+        const std::string& name_in = "outputSpec")
+        : Sender("OutputSpec", name_in, courier)
+    {
+    }
+
+    /// add a column by its per-minute CSV name; the label defaults to "<name> <aggregation>"
+    void addColumn(const std::string& columnName,
+                   Aggregation aggregation,
+                   const std::string& label = "");
+
+    /// read a specification of the form
+    ///     {"interval_min": 15, "minimum_use_T_C": 43.3,
+    ///      "columns": [{"name": "h_src1In", "aggregation": "sum"},
+    ///                  {"name": "toutlet", "aggregation": "volume_weighted_mean",
+    ///                   "label": "outletT (C)"}]}
+    void from(const nlohmann::json& j);
+
+    Aggregation getAggregation(const std::string& aggregationName) const;
+
+    static std::string getAggregationName(Aggregation aggregation);
+
+    /// as written per minute
+    static std::string getUnits(Quantity quantity);
+
+    /// defined only in minutes with a draw, as in the per-minute output; other minutes are not
+    /// aggregated, and an interval without a draw has no value
+    static bool isDrawDependent(Quantity quantity);
+
+    class Recorder;
+};
+
+///	@class HPWH::OutputSpec::Recorder HPWHOutputSpec.hh
+/// Applies an OutputSpec to the steps of one run of hpwh, writing CSV to sink or the binary
+/// columnar format to writer.
+class HPWH::OutputSpec::Recorder
+{
+  public:
+    Recorder(const OutputSpec& spec_in, const HPWH& hpwh_in, CSVSink& sink_in);
+
+    Recorder(const OutputSpec& spec_in, const HPWH& hpwh_in, ResultsWriter& writer_in);
+
+    void writeHeading();
+
+    /// add the step just run, writing a row once the interval is complete
+    void add(const TestData& testData);
+
+    /// write the last interval, if incomplete
+    void finish();
+
+  private:
+    ///	@struct Accumulator
+    struct Accumulator
+    {
+        long n = 0; /**< minutes aggregated */
+        double sum = 0.;
+        double weight = 0.;
+        double min = 0.;
+        double max = 0.;
+    };
+
+    const OutputSpec& spec;
+    const HPWH& hpwh;
+    CSVSink* sink = nullptr;
+    ResultsWriter* writer = nullptr;
+
+    std::vector<Accumulator> accumulators; /**< one per column */
+    long nSteps = 0;                       /**< in the current interval */
+    double intervalBegin_min = 0.;
+
+    Recorder(const OutputSpec& spec_in, const HPWH& hpwh_in);
+
+    double getValue(const Column& column, const TestData& testData) const;
+
+    void writeRow();
+};
+
+#endif
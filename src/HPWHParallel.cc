@@ -0,0 +1,190 @@
+/*
+ * Implementation of parallel helpers
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HPWHParallel.hh"
+
+unsigned hpwh_parallel::getDefaultThreadCount()
+{
+    unsigned nThreads = std::thread::hardware_concurrency();
+    return (nThreads > 0) ? nThreads : 1;
+}
+
+void hpwh_parallel::forEach(std::size_t count,
+                            const std::function<void(std::size_t)>& task,
+                            unsigned nThreads /*=0*/)
+{
+    if (nThreads == 0)
+        nThreads = getDefaultThreadCount();
+    nThreads = static_cast<unsigned>(std::min<std::size_t>(nThreads, count));
+
+    if (nThreads <= 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr firstException = nullptr;
+    std::mutex exceptionMutex;
+
+    auto work = [&]()
+    {
+        for (std::size_t i = next++; (i < count) && !failed; i = next++)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+                if (!firstException)
+                    firstException = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    for (unsigned iThread = 1; iThread < nThreads; ++iThread)
+        threads.emplace_back(work);
+    work();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (firstException)
+        std::rethrow_exception(firstException);
+}
+
+namespace
+{
+thread_local int workerIndex = -1;
+}
+
+hpwh_parallel::ThreadPool::ThreadPool(unsigned nThreads /*=0*/)
+    : nQueued(0), nPending(0), stopping(false), firstException(nullptr), nextQueue(0)
+{
+    if (nThreads == 0)
+        nThreads = getDefaultThreadCount();
+
+    queues.reserve(nThreads);
+    for (unsigned iWorker = 0; iWorker < nThreads; ++iWorker)
+        queues.push_back(std::make_unique<Queue>());
+
+    threads.reserve(nThreads);
+    for (unsigned iWorker = 0; iWorker < nThreads; ++iWorker)
+        threads.emplace_back([this, iWorker]() { work(iWorker); });
+}
+
+hpwh_parallel::ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasksFinished.wait(lock, [this]() { return nPending == 0; });
+        stopping = true;
+    }
+    taskQueued.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void hpwh_parallel::ThreadPool::submit(std::function<void()> task)
+{
+    // tasks submitted by a worker stay with that worker unless stolen
+    unsigned iQueue = (workerIndex >= 0) && (static_cast<std::size_t>(workerIndex) < queues.size())
+                          ? static_cast<unsigned>(workerIndex)
+                          : nextQueue++ % static_cast<unsigned>(queues.size());
+    {
+        // counted before queuing, so that a task is never taken before it is counted
+        std::lock_guard<std::mutex> lock(mutex);
+        ++nPending;
+        ++nQueued;
+
+        std::lock_guard<std::mutex> queueLock(queues[iQueue]->mutex);
+        queues[iQueue]->tasks.push_back(std::move(task));
+    }
+    taskQueued.notify_one();
+}
+
+void hpwh_parallel::ThreadPool::wait()
+{
+    std::exception_ptr exception = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasksFinished.wait(lock, [this]() { return nPending == 0; });
+        std::swap(exception, firstException);
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+int hpwh_parallel::ThreadPool::getWorkerIndex() { return workerIndex; }
+
+bool hpwh_parallel::ThreadPool::takeTask(unsigned iWorker, std::function<void()>& task)
+{
+    auto nQueues = static_cast<unsigned>(queues.size());
+    for (unsigned offset = 0; offset < nQueues; ++offset)
+    {
+        auto& queue = *queues[(iWorker + offset) % nQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        if (offset == 0)
+        { // own queue: oldest first
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        else
+        { // steal the most recently queued
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        --nQueued;
+        return true;
+    }
+    return false;
+}
+
+void hpwh_parallel::ThreadPool::work(unsigned iWorker)
+{
+    workerIndex = static_cast<int>(iWorker);
+    while (true)
+    {
+        std::function<void()> task;
+        if (takeTask(iWorker, task))
+        {
+            std::exception_ptr exception = nullptr;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (exception && !firstException)
+                firstException = exception;
+            if (--nPending == 0)
+                tasksFinished.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        taskQueued.wait(lock, [this]() { return stopping || (nQueued > 0); });
+        if (stopping && (nQueued == 0))
+            return;
+    }
+}
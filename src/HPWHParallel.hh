@@ -0,0 +1,80 @@
+#ifndef HPWHPARALLEL_hh
+#define HPWHPARALLEL_hh
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// helpers for running independent simulations concurrently
+namespace hpwh_parallel
+{
+
+/// number of threads used when none is specified
+unsigned getDefaultThreadCount();
+
+/// Call task(i) for each i in [0, count) using up to nThreads threads (0: hardware concurrency).
+/// Tasks are handed out in order as threads become free. With a single thread, tasks run in
+/// order on the calling thread. The first exception thrown by a task is rethrown once all threads
+/// have finished; remaining tasks are skipped.
+void forEach(std::size_t count,
+             const std::function<void(std::size_t)>& task,
+             unsigned nThreads = 0);
+
+///	@class ThreadPool
+/// Fixed set of worker threads, each with its own task queue. Tasks are dealt to the queues in
+/// turn (or to the submitting worker's own queue); a worker whose queue is empty steals from the
+/// back of another's, so uneven task lengths do not leave threads idle.
+class ThreadPool
+{
+  public:
+    /// nThreads = 0: hardware concurrency
+    explicit ThreadPool(unsigned nThreads = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// waits for queued tasks, then joins the workers
+    ~ThreadPool();
+
+    unsigned getNumThreads() const { return static_cast<unsigned>(threads.size()); }
+
+    void submit(std::function<void()> task);
+
+    /// block until all submitted tasks have finished; rethrows the first task exception
+    void wait();
+
+    /// index of the calling worker in its pool, or -1 if not called from a worker
+    static int getWorkerIndex();
+
+  private:
+    struct Queue
+    {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable taskQueued;
+    std::condition_variable tasksFinished;
+    std::atomic<std::size_t> nQueued;
+    std::size_t nPending;
+    bool stopping;
+    std::exception_ptr firstException;
+    std::atomic<unsigned> nextQueue;
+
+    bool takeTask(unsigned iWorker, std::function<void()>& task);
+    void work(unsigned iWorker);
+};
+
+} // namespace hpwh_parallel
+
+#endif
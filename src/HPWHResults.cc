@@ -0,0 +1,358 @@
+/*
+ * Implementation of classes HPWH::ResultsWriter and HPWH::ResultsReader
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHResults.hh"
+
+namespace
+{
+const char resultsMagic[8] = {'H', 'P', 'W', 'H', 'R', 'E', 'S', '\0'};
+const char indexMagic[8] = {'H', 'P', 'W', 'H', 'I', 'D', 'X', '\0'};
+
+constexpr std::size_t headerSize = 32;
+constexpr std::size_t nameSize = 44;
+constexpr std::size_t unitsSize = 12;
+constexpr std::size_t typeSize = 4;
+constexpr std::size_t columnHeaderSize = 64;
+constexpr std::size_t trailerSize = 24;
+
+bool isLittleEndian()
+{
+    const std::uint16_t one = 1;
+    char first;
+    std::memcpy(&first, &one, 1);
+    return (first == 1);
+}
+
+template <typename T>
+void appendLittleEndian(std::vector<char>& bytes, T value)
+{
+    char raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    if (!isLittleEndian())
+        std::reverse(raw, raw + sizeof(T));
+    bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+template <typename T>
+T fromLittleEndian(const char* bytes)
+{
+    char raw[sizeof(T)];
+    std::memcpy(raw, bytes, sizeof(T));
+    if (!isLittleEndian())
+        std::reverse(raw, raw + sizeof(T));
+    T value;
+    std::memcpy(&value, raw, sizeof(T));
+    return value;
+}
+
+/// text padded with nulls to width
+void appendText(std::vector<char>& bytes, const std::string& text, std::size_t width)
+{
+    bytes.insert(bytes.end(), text.begin(), text.end());
+    bytes.insert(bytes.end(), width - text.size(), '\0');
+}
+
+/// text up to the first null
+std::string readText(const char* bytes, std::size_t width)
+{
+    return std::string(bytes, std::find(bytes, bytes + width, '\0'));
+}
+
+std::uint64_t alignTo8(std::uint64_t size) { return (size + 7) & ~std::uint64_t(7); }
+
+const char* getTypeName(HPWH::ResultsWriter::Type type)
+{
+    switch (type)
+    {
+    case HPWH::ResultsWriter::Type::int32:
+        return "<i4";
+    case HPWH::ResultsWriter::Type::float32:
+        return "<f4";
+    case HPWH::ResultsWriter::Type::float64:
+        return "<f8";
+    }
+    return "";
+}
+
+std::size_t getItemSize(HPWH::ResultsWriter::Type type)
+{
+    return (type == HPWH::ResultsWriter::Type::float64) ? 8 : 4;
+}
+} // namespace
+
+HPWH::ResultsWriter::ResultsWriter(const std::string& filepath,
+                                   std::size_t blockRows_in /*=defaultBlockRows*/,
+                                   const std::shared_ptr<Courier::Courier>& courier)
+    : Sender("ResultsWriter", filepath, courier)
+    , destination(filepath)
+    , file(filepath, std::ios::out | std::ios::binary | std::ios::trunc)
+    , blockRows(std::max(blockRows_in, std::size_t(1)))
+{
+    if (!file.is_open())
+    {
+        send_error(fmt::format("Could not open output file {}", filepath));
+    }
+}
+
+HPWH::ResultsWriter::~ResultsWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void HPWH::ResultsWriter::addColumn(const std::string& name,
+                                    const std::string& units,
+                                    Type type /*=Type::float64*/)
+{
+    if (hasHeader)
+    {
+        send_error(fmt::format("Column {} was added after the first row.", name));
+    }
+    if ((name.size() >= nameSize) || (units.size() >= unitsSize))
+    {
+        send_error(fmt::format("Column name {} or units {} is too long.", name, units));
+    }
+    appendText(columnHeaders, name, nameSize);
+    appendText(columnHeaders, units, unitsSize);
+    appendText(columnHeaders, getTypeName(type), typeSize);
+    appendLittleEndian(columnHeaders, static_cast<std::uint32_t>(getItemSize(type)));
+
+    columns.push_back({type, getItemSize(type), {}});
+    columns.back().values.reserve(blockRows * getItemSize(type));
+}
+
+void HPWH::ResultsWriter::write(double value)
+{
+    if (iColumn >= columns.size())
+    {
+        send_error(fmt::format("{}: a row has more than {} values.", destination, columns.size()));
+    }
+    auto& column = columns[iColumn++];
+    switch (column.type)
+    {
+    case Type::int32:
+        appendLittleEndian(column.values, static_cast<std::int32_t>(std::lround(value)));
+        break;
+    case Type::float32:
+        appendLittleEndian(column.values, static_cast<float>(value));
+        break;
+    case Type::float64:
+        appendLittleEndian(column.values, value);
+        break;
+    }
+}
+
+void HPWH::ResultsWriter::write(int value)
+{
+    if ((iColumn < columns.size()) && (columns[iColumn].type == Type::int32))
+        appendLittleEndian(columns[iColumn++].values, static_cast<std::int32_t>(value));
+    else
+        write(static_cast<double>(value));
+}
+
+void HPWH::ResultsWriter::endRow()
+{
+    if (iColumn != columns.size())
+    {
+        send_error(fmt::format(
+            "{}: a row has {} values for {} columns.", destination, iColumn, columns.size()));
+    }
+    if (!hasHeader)
+        writeHeader();
+    iColumn = 0;
+    if (++nBlockRows == blockRows)
+        writeBlock();
+}
+
+void HPWH::ResultsWriter::writeHeader()
+{
+    std::vector<char> header(resultsMagic, resultsMagic + sizeof(resultsMagic));
+    appendLittleEndian(header, version);
+    appendLittleEndian(header, static_cast<std::uint32_t>(columns.size()));
+    appendLittleEndian(header, std::uint64_t(0));
+    appendLittleEndian(header, std::uint64_t(0));
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(columnHeaders.data(), static_cast<std::streamsize>(columnHeaders.size()));
+    hasHeader = true;
+}
+
+void HPWH::ResultsWriter::writeBlock()
+{
+    if (nBlockRows == 0)
+        return;
+    index.push_back(static_cast<std::uint64_t>(file.tellp()));
+    index.push_back(nBlockRows);
+
+    const char padding[8] = {};
+    for (auto& column : columns)
+    {
+        file.write(column.values.data(), static_cast<std::streamsize>(column.values.size()));
+        file.write(padding,
+                   static_cast<std::streamsize>(alignTo8(column.values.size()) -
+                                                column.values.size()));
+        column.values.clear();
+    }
+    nBlockRows = 0;
+}
+
+void HPWH::ResultsWriter::close()
+{
+    if (isClosed)
+        return;
+    isClosed = true;
+    if (!hasHeader)
+        writeHeader();
+    writeBlock();
+
+    std::vector<char> footer;
+    for (auto entry : index)
+        appendLittleEndian(footer, entry);
+    appendLittleEndian(footer, static_cast<std::uint64_t>(file.tellp()));
+    appendLittleEndian(footer, static_cast<std::uint64_t>(index.size() / 2));
+    footer.insert(footer.end(), indexMagic, indexMagic + sizeof(indexMagic));
+    file.write(footer.data(), static_cast<std::streamsize>(footer.size()));
+
+    file.close();
+    if (file.fail())
+    {
+        send_error(fmt::format("Could not write {}", destination));
+    }
+    if (iColumn != 0)
+    {
+        send_error(fmt::format("{}: the last row is incomplete and was not written.",
+                               destination));
+    }
+}
+
+HPWH::ResultsReader::ResultsReader(const std::string& filepath,
+                                   const std::shared_ptr<Courier::Courier>& courier)
+    : Sender("ResultsReader", filepath, courier)
+    , source(filepath)
+    , file(filepath, std::ios::in | std::ios::binary)
+{
+    if (!file.is_open())
+    {
+        send_error(fmt::format("Could not open results file {}", filepath));
+    }
+
+    file.seekg(0, std::ios::end);
+    auto fileSize = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(0);
+
+    char header[headerSize];
+    if ((fileSize < headerSize + trailerSize) || !file.read(header, headerSize) ||
+        (std::memcmp(header, resultsMagic, sizeof(resultsMagic)) != 0))
+    {
+        send_error(fmt::format("{} is not a results file.", source));
+    }
+    if (fromLittleEndian<std::uint32_t>(header + 8) != ResultsWriter::version)
+    {
+        send_error(fmt::format("{} has an unsupported version.", source));
+    }
+
+    std::size_t nColumns = fromLittleEndian<std::uint32_t>(header + 12);
+    std::vector<char> columnHeaders(nColumns * columnHeaderSize);
+    if ((headerSize + columnHeaders.size() + trailerSize > fileSize) ||
+        !file.read(columnHeaders.data(), static_cast<std::streamsize>(columnHeaders.size())))
+    {
+        send_error(fmt::format("{} is truncated.", source));
+    }
+    for (std::size_t i = 0; i < nColumns; ++i)
+    {
+        const char* columnHeader = columnHeaders.data() + i * columnHeaderSize;
+        Column column;
+        column.name = readText(columnHeader, nameSize);
+        column.units = readText(columnHeader + nameSize, unitsSize);
+        column.type = readText(columnHeader + nameSize + unitsSize, typeSize);
+        column.itemSize =
+            fromLittleEndian<std::uint32_t>(columnHeader + nameSize + unitsSize + typeSize);
+        if (!(((column.type == "<f8") && (column.itemSize == 8)) ||
+              ((column.type == "<f4") && (column.itemSize == 4)) ||
+              ((column.type == "<i4") && (column.itemSize == 4))))
+        {
+            send_error(fmt::format("{}: column {} has an unsupported type.", source, column.name));
+        }
+        columns.push_back(column);
+    }
+
+    char trailer[trailerSize];
+    file.seekg(static_cast<std::streamoff>(fileSize - trailerSize));
+    if (!file.read(trailer, trailerSize) ||
+        (std::memcmp(trailer + 16, indexMagic, sizeof(indexMagic)) != 0))
+    {
+        send_error(fmt::format("{} has no index; it may not have been closed.", source));
+    }
+    auto indexOffset = fromLittleEndian<std::uint64_t>(trailer);
+    auto nBlocks = fromLittleEndian<std::uint64_t>(trailer + 8);
+    if ((indexOffset > fileSize) || (nBlocks > (fileSize - indexOffset) / 16))
+    {
+        send_error(fmt::format("{} has an invalid index.", source));
+    }
+
+    std::vector<char> indexBytes(static_cast<std::size_t>(nBlocks) * 16);
+    file.seekg(static_cast<std::streamoff>(indexOffset));
+    file.read(indexBytes.data(), static_cast<std::streamsize>(indexBytes.size()));
+    for (std::size_t i = 0; i < indexBytes.size(); i += 8)
+        index.push_back(fromLittleEndian<std::uint64_t>(indexBytes.data() + i));
+    for (std::size_t iBlock = 0; iBlock < index.size(); iBlock += 2)
+        nRows += static_cast<std::size_t>(index[iBlock + 1]);
+}
+
+std::size_t HPWH::ResultsReader::findColumn(const std::string& name) const
+{
+    for (std::size_t i = 0; i < columns.size(); ++i)
+        if (columns[i].name == name)
+            return i;
+    send_error(fmt::format("{} has no column {}.", source, name));
+    return 0;
+}
+
+std::vector<double> HPWH::ResultsReader::getColumn(std::size_t iColumn)
+{
+    if (iColumn >= columns.size())
+    {
+        send_error(fmt::format("{} has only {} columns.", source, columns.size()));
+    }
+    auto& column = columns[iColumn];
+
+    std::vector<double> values;
+    values.reserve(nRows);
+    std::vector<char> bytes;
+    for (std::size_t iBlock = 0; iBlock < index.size(); iBlock += 2)
+    {
+        auto nBlockRows = index[iBlock + 1];
+        auto offset = index[iBlock];
+        for (std::size_t i = 0; i < iColumn; ++i)
+            offset += alignTo8(nBlockRows * columns[i].itemSize);
+
+        bytes.resize(static_cast<std::size_t>(nBlockRows * column.itemSize));
+        file.seekg(static_cast<std::streamoff>(offset));
+        if (!file.read(bytes.data(), static_cast<std::streamsize>(bytes.size())))
+        {
+            send_error(fmt::format("{} is truncated.", source));
+        }
+        for (std::size_t i = 0; i < bytes.size(); i += column.itemSize)
+        {
+            if (column.type == "<f8")
+                values.push_back(fromLittleEndian<double>(bytes.data() + i));
+            else if (column.type == "<f4")
+                values.push_back(fromLittleEndian<float>(bytes.data() + i));
+            else
+                values.push_back(fromLittleEndian<std::int32_t>(bytes.data() + i));
+        }
+    }
+    return values;
+}
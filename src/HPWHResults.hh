@@ -0,0 +1,121 @@
+#ifndef HPWHRESULTS_hh
+#define HPWHRESULTS_hh
+
+#include "HPWH.hh"
+#include <cstdint>
+#include <fstream>
+
+///	@class HPWH::ResultsWriter HPWHResults.hh
+/// Writes results in a binary columnar format, as an alternative to CSV. Rows are gathered into
+/// blocks, and each block is written column by column, every column fixed-width and
+/// little-endian. A footer indexes the blocks, so columns can be mapped rather than parsed:
+///     header:  "HPWHRES\0", version (u32), number of columns (u32), reserved (u64, u64)
+///     columns: name (44 chars), units (12 chars), NumPy type ("<f8", "<f4", or "<i4"),
+///              item size (u32); 64 bytes each
+///     blocks:  for each column, the values of the block's rows, padded to 8 bytes
+///     index:   for each block, its offset and number of rows (u64, u64)
+///     trailer: offset of the index (u64), number of blocks (u64), "HPWHIDX\0"
+class HPWH::ResultsWriter : public Sender
+{
+  public:
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::size_t defaultBlockRows = 1 << 14;
+
+    enum class Type
+    {
+        int32,
+        float32,
+        float64
+    };
+
+    explicit ResultsWriter(
+        const std::string& filepath,
+        std::size_t blockRows_in = defaultBlockRows,
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    ResultsWriter(const ResultsWriter&) = delete;
+    ResultsWriter& operator=(const ResultsWriter&) = delete;
+
+    /// writes the index; errors are only reported by close
+    ~ResultsWriter();
+
+    /// add a column; all columns must be added before the first row
+    void addColumn(const std::string& name, const std::string& units, Type type = Type::float64);
+
+    /// the next value of the current row; missing values are written as NaN
+    void write(double value);
+
+    void write(int value);
+
+    /// end the current row, which must have a value for every column
+    void endRow();
+
+    /// write the last block and the index, and close the file
+    void close();
+
+  private:
+    ///	@struct Column
+    struct Column
+    {
+        Type type;
+        std::size_t itemSize;
+        std::vector<char> values; /**< of the current block, little-endian */
+    };
+
+    std::string destination; /**< for messages */
+    std::ofstream file;
+    std::size_t blockRows;
+    std::vector<Column> columns;
+    std::vector<char> columnHeaders;
+
+    std::size_t iColumn = 0; /**< of the next value in the current row */
+    std::size_t nBlockRows = 0;
+    std::vector<std::uint64_t> index; /**< offset and number of rows, per block */
+    bool hasHeader = false;
+    bool isClosed = false;
+
+    void writeHeader();
+
+    void writeBlock();
+};
+
+///	@class HPWH::ResultsReader HPWHResults.hh
+/// Reads files written by ResultsWriter. Only the header and index are read on opening; a
+/// column is read, block by block, when it is requested.
+class HPWH::ResultsReader : public Sender
+{
+  public:
+    ///	@struct Column
+    struct Column
+    {
+        std::string name;
+        std::string units;
+        std::string type; /**< as a NumPy type string */
+        std::size_t itemSize = 0;
+    };
+
+    explicit ResultsReader(
+        const std::string& filepath,
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>());
+
+    const std::vector<Column>& getColumns() const { return columns; }
+
+    std::size_t getNumRows() const { return nRows; }
+
+    /// index of the named column
+    std::size_t findColumn(const std::string& name) const;
+
+    /// all values of a column, as double
+    std::vector<double> getColumn(std::size_t iColumn);
+
+    std::vector<double> getColumn(const std::string& name) { return getColumn(findColumn(name)); }
+
+  private:
+    std::string source; /**< for messages */
+    std::ifstream file;
+    std::vector<Column> columns;
+    std::vector<std::uint64_t> index; /**< offset and number of rows, per block */
+    std::size_t nRows = 0;
+};
+
+#endif
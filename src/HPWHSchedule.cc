@@ -0,0 +1,791 @@
+/*
+ * Implementation of classes HPWH::SparseSchedule, HPWH::ScheduleStream, and HPWH::ScheduleSet
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHSchedule.hh"
+
+namespace
+{
+/// read-only view of a whole file; mapped where the platform allows, otherwise copied
+class MappedFile
+{
+  public:
+    explicit MappedFile(const std::string& filepath)
+    {
+#ifndef _WIN32
+        int fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        isOpen = true;
+        struct stat status;
+        if ((fstat(fd, &status) == 0) && (status.st_size > 0))
+        {
+            size = static_cast<std::size_t>(status.st_size);
+            void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED)
+            {
+                mapped = static_cast<const char*>(address);
+                madvise(address, size, MADV_SEQUENTIAL);
+            }
+            else
+                size = 0;
+        }
+        close(fd);
+#else
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open())
+            return;
+        isOpen = true;
+        copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (mapped)
+            munmap(const_cast<char*>(mapped), size);
+#endif
+    }
+
+    bool is_open() const { return isOpen; }
+
+    std::string_view getText() const
+    {
+#ifndef _WIN32
+        return std::string_view(mapped, size);
+#else
+        return copy;
+#endif
+    }
+
+  private:
+    bool isOpen = false;
+#ifndef _WIN32
+    const char* mapped = nullptr;
+    std::size_t size = 0;
+#else
+    std::string copy;
+#endif
+};
+
+bool isBlank(char c) { return (c == ' ') || (c == '\t') || (c == '\r'); }
+
+std::string_view trimFront(std::string_view s)
+{
+    std::size_t i = 0;
+    while ((i < s.size()) && isBlank(s[i]))
+        ++i;
+    return s.substr(i);
+}
+
+/// parse a number at the front of s, leaving s after it
+template <typename T>
+bool parseNumber(std::string_view& s, T& value)
+{
+    s = trimFront(s);
+    if (!s.empty() && (s.front() == '+'))
+        s.remove_prefix(1);
+    const char* end = s.data() + s.size();
+    const char* next = s.data();
+#if defined(__cpp_lib_to_chars)
+    auto result = std::from_chars(s.data(), end, value);
+    if (result.ec != std::errc())
+        return false;
+    next = result.ptr;
+#else
+    if constexpr (std::is_integral_v<T>)
+    {
+        auto result = std::from_chars(s.data(), end, value);
+        if (result.ec != std::errc())
+            return false;
+        next = result.ptr;
+    }
+    else
+    {
+        // no floating-point from_chars in this library; strtod needs a terminated copy
+        char buffer[64];
+        std::size_t n = std::min(s.size(), sizeof(buffer) - 1);
+        s.copy(buffer, n);
+        buffer[n] = '\0';
+        char* bufferEnd;
+        value = std::strtod(buffer, &bufferEnd);
+        if (bufferEnd == buffer)
+            return false;
+        next = s.data() + (bufferEnd - buffer);
+    }
+#endif
+    s.remove_prefix(static_cast<std::size_t>(next - s.data()));
+    return true;
+}
+
+/// parse "default <value>"
+bool parseDefault(std::string_view line, double& value)
+{
+    line = trimFront(line);
+    if (line.substr(0, 7) != "default")
+        return false;
+    line.remove_prefix(7);
+    return parseNumber(line, value);
+}
+
+/// spreadsheet exports may leave rows of empty cells
+bool isEmptyRow(std::string_view line)
+{
+    return (line.find_first_not_of(" \t\r,") == std::string_view::npos);
+}
+
+/// parse "<minute or hour>,<value>"; returns an error message, or nullptr
+const char* parseEntry(std::string_view line, long& index, double& value)
+{
+    if (!parseNumber(line, index))
+        return "expected a minute or hour";
+    line = trimFront(line);
+    if (line.empty() || (line.front() != ','))
+        return "expected a comma";
+    line.remove_prefix(1);
+    if (!parseNumber(line, value))
+        return "expected a value";
+    return nullptr;
+}
+
+const char* outOfRangeMessage = "the input file has more minutes than the test was defined with";
+
+/// runs owned by a schedule that was parsed rather than mapped
+struct OwnedRuns
+{
+    std::vector<std::uint32_t> begins_min;
+    std::vector<double> values;
+};
+
+const char packedMagic[8] = {'H', 'P', 'W', 'H', 'S', 'C', 'H', '\0'};
+const std::uint32_t byteOrderMark = 0x01020304;
+
+enum ValueType : std::uint32_t
+{
+    SINGLE = 1,
+    DOUBLE = 2
+};
+
+/// Packed file layout, in native byte order: header; column headers; then, for each column,
+/// run beginnings (uint32) and values (float or double), each section 8-byte aligned; then
+/// the test information text.
+struct PackedHeader
+{
+    char magic[8];
+    std::uint32_t byteOrder;
+    std::uint32_t version;
+    std::uint64_t length;
+    std::uint32_t step_s;
+    std::uint32_t nColumns;
+    std::uint64_t infoOffset;
+    std::uint64_t infoSize;
+};
+static_assert(sizeof(PackedHeader) == 48);
+
+struct PackedColumn
+{
+    char name[24];
+    std::uint32_t valueType;
+    std::uint32_t nRuns;
+    std::uint64_t beginsOffset;
+    std::uint64_t valuesOffset;
+};
+static_assert(sizeof(PackedColumn) == 48);
+
+std::uint64_t alignTo8(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+} // namespace
+
+void HPWH::SparseSchedule::read(const std::string& filepath, long minutesOfTest)
+{
+    MappedFile file(filepath);
+    if (!file.is_open())
+    {
+        send_error(fmt::format("Could not open schedule file {}", filepath));
+    }
+    parse(file.getText(), minutesOfTest, filepath);
+}
+
+void HPWH::SparseSchedule::parse(std::string_view text,
+                                 long minutesOfTest,
+                                 const std::string& source /*="schedule"*/)
+{
+    if ((minutesOfTest < 0) || (static_cast<std::uint64_t>(minutesOfTest) > UINT32_MAX))
+    {
+        send_error(fmt::format("{}: a test of {} minutes is out of range", source, minutesOfTest));
+    }
+
+    int lineNumber = 0;
+    auto nextLine = [&](std::string_view& line)
+    {
+        if (text.empty())
+            return false;
+        auto end = text.find('\n');
+        line = text.substr(0, end);
+        text.remove_prefix((end == std::string_view::npos) ? text.size() : end + 1);
+        ++lineNumber;
+        return true;
+    };
+
+    std::string_view line;
+    double defaultValue = 0.;
+    if (!nextLine(line) || !parseDefault(line, defaultValue))
+    {
+        send_error(fmt::format("{}:1: first line must specify default", source));
+    }
+
+    // entries as listed; a missing or blank header means there are none
+    struct Entry
+    {
+        long begin_min;
+        double value;
+    };
+    std::vector<Entry> entries;
+    long entryLength_min = 1;
+    bool isSorted = true;
+    if (nextLine(line) && !trimFront(line).empty())
+    {
+        if (std::tolower(static_cast<unsigned char>(trimFront(line).front())) == 'h')
+            entryLength_min = 60;
+
+        while (nextLine(line))
+        {
+            if (isEmptyRow(line))
+                continue;
+            long index;
+            double value;
+            if (auto error = parseEntry(line, index, value))
+            {
+                send_error(fmt::format("{}:{}: {}", source, lineNumber, error));
+            }
+
+            long begin_min = index * entryLength_min;
+            if ((index < 0) || (begin_min >= minutesOfTest))
+            {
+                send_error(fmt::format("{}:{}: {}", source, lineNumber, outOfRangeMessage));
+            }
+            if (!entries.empty() && (begin_min <= entries.back().begin_min))
+                isSorted = false;
+            entries.push_back({begin_min, value});
+        }
+    }
+
+    // as when entries were written in file order, a repeated minute takes its last value
+    if (!isSorted)
+    {
+        std::stable_sort(entries.begin(),
+                         entries.end(),
+                         [](const Entry& a, const Entry& b) { return a.begin_min < b.begin_min; });
+        std::vector<Entry> uniqueEntries;
+        uniqueEntries.reserve(entries.size());
+        for (auto& entry : entries)
+        {
+            if (!uniqueEntries.empty() && (uniqueEntries.back().begin_min == entry.begin_min))
+                uniqueEntries.back() = entry;
+            else
+                uniqueEntries.push_back(entry);
+        }
+        entries = std::move(uniqueEntries);
+    }
+
+    // runs cover every minute; equal neighbors are merged
+    auto runs = std::make_shared<OwnedRuns>();
+    auto addRun = [&runs](long begin_min, double value)
+    {
+        if (runs->values.empty() || (runs->values.back() != value))
+        {
+            runs->begins_min.push_back(static_cast<std::uint32_t>(begin_min));
+            runs->values.push_back(value);
+        }
+    };
+    long covered_min = 0;
+    for (auto& entry : entries)
+    {
+        if (entry.begin_min > covered_min)
+            addRun(covered_min, defaultValue);
+        addRun(entry.begin_min, entry.value);
+        covered_min = std::min(entry.begin_min + entryLength_min, minutesOfTest);
+    }
+    if ((covered_min < minutesOfTest) || runs->values.empty())
+        addRun(covered_min, defaultValue);
+
+    length_min = minutesOfTest;
+    nRuns = runs->values.size();
+    runBegins_min = runs->begins_min.data();
+    doubleValues = runs->values.data();
+    singleValues = nullptr;
+    storage = runs;
+}
+
+std::size_t HPWH::SparseSchedule::findRun(long minute) const
+{
+    auto after = std::upper_bound(runBegins_min, runBegins_min + nRuns, minute);
+    return (after == runBegins_min) ? 0 : static_cast<std::size_t>(after - runBegins_min - 1);
+}
+
+double HPWH::SparseSchedule::operator[](long minute) const { return getValue(findRun(minute)); }
+
+std::vector<double> HPWH::SparseSchedule::expand() const
+{
+    std::vector<double> values;
+    values.reserve(static_cast<std::size_t>(length_min));
+    for (std::size_t iRun = 0; iRun < nRuns; ++iRun)
+    {
+        long end_min = (iRun + 1 < nRuns) ? long(runBegins_min[iRun + 1]) : length_min;
+        values.resize(static_cast<std::size_t>(end_min), getValue(iRun));
+    }
+    return values;
+}
+
+double HPWH::SparseSchedule::Cursor::operator()(long minute)
+{
+    if (minute < lastMinute)
+        iRun = schedule->findRun(minute);
+    lastMinute = minute;
+
+    auto nRuns = schedule->nRuns;
+    while ((iRun + 1 < nRuns) && (long(schedule->runBegins_min[iRun + 1]) <= minute))
+        ++iRun;
+    return schedule->getValue(iRun);
+}
+
+HPWH::ScheduleStream::~ScheduleStream() { stop(); }
+
+void HPWH::ScheduleStream::stop()
+{
+    if (reader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        reader.join();
+    }
+}
+
+void HPWH::ScheduleStream::open(const std::string& filepath,
+                                long minutesOfTest,
+                                std::size_t chunkSize_in /*=defaultChunkSize*/)
+{
+    stop();
+    file.close();
+    source = filepath;
+    length_min = minutesOfTest;
+    chunkSize = std::max(chunkSize_in, std::size_t(1));
+    lineNumber = 0;
+    lastMinute = -1;
+    hasEntry = false;
+    window = decltype(window)();
+    nEntries = 0;
+    hasAllEntries = false;
+    chunk.clear();
+    remaining = std::string_view();
+    partialLine.clear();
+    isAtEnd = false;
+    hasReadChunk = readFailed = stopping = false;
+
+    file.open(filepath, std::ios::binary);
+    if (!file.is_open())
+    {
+        send_error(fmt::format("Could not open schedule file {}", filepath));
+    }
+    reader = std::thread(&ScheduleStream::readAhead, this);
+
+    std::string_view line;
+    if (!nextLine(line) || !parseDefault(line, defaultValue))
+    {
+        send_error(fmt::format("{}:1: first line must specify default", source));
+    }
+    entryLength_min = 1;
+    if (nextLine(line) && !trimFront(line).empty())
+    {
+        if (std::tolower(static_cast<unsigned char>(trimFront(line).front())) == 'h')
+            entryLength_min = 60;
+    }
+    else
+        hasAllEntries = true;
+}
+
+void HPWH::ScheduleStream::readAhead()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this]() { return !hasReadChunk || stopping; });
+        if (stopping)
+            return;
+
+        // only this thread touches readChunk while hasReadChunk is clear
+        lock.unlock();
+        readChunk.resize(chunkSize);
+        file.read(readChunk.data(), static_cast<std::streamsize>(chunkSize));
+        readChunk.resize(static_cast<std::size_t>(file.gcount()));
+        bool failed = file.bad();
+        lock.lock();
+
+        hasReadChunk = true;
+        readFailed = failed;
+        changed.notify_all();
+        if (readChunk.empty())
+            return;
+    }
+}
+
+bool HPWH::ScheduleStream::takeChunk()
+{
+    if (isAtEnd || !reader.joinable())
+        return false;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return hasReadChunk; });
+        if (readFailed)
+        {
+            send_error(fmt::format("Could not read schedule file {}", source));
+        }
+        std::swap(chunk, readChunk);
+        hasReadChunk = false;
+    }
+    changed.notify_all();
+    remaining = chunk;
+    isAtEnd = chunk.empty();
+    return !isAtEnd;
+}
+
+bool HPWH::ScheduleStream::nextLine(std::string_view& line)
+{
+    while (true)
+    {
+        auto end = remaining.find('\n');
+        if (end != std::string_view::npos)
+        {
+            ++lineNumber;
+            if (partialLine.empty())
+                line = remaining.substr(0, end);
+            else
+            {
+                splitLine = partialLine.append(remaining.substr(0, end));
+                partialLine.clear();
+                line = splitLine;
+            }
+            remaining.remove_prefix(end + 1);
+            return true;
+        }
+
+        // the rest of this chunk begins a line
+        partialLine.append(remaining);
+        remaining = std::string_view();
+        if (!takeChunk())
+        {
+            if (partialLine.empty())
+                return false;
+            ++lineNumber;
+            splitLine.swap(partialLine);
+            partialLine.clear();
+            line = splitLine;
+            return true;
+        }
+    }
+}
+
+bool HPWH::ScheduleStream::readEntry(Entry& entry_out)
+{
+    std::string_view line;
+    while (nextLine(line))
+    {
+        if (isEmptyRow(line))
+            continue;
+        long index;
+        if (auto error = parseEntry(line, index, entry_out.value))
+        {
+            send_error(fmt::format("{}:{}: {}", source, lineNumber, error));
+        }
+        entry_out.begin_min = index * entryLength_min;
+        if ((index < 0) || (entry_out.begin_min >= length_min))
+        {
+            send_error(fmt::format("{}:{}: {}", source, lineNumber, outOfRangeMessage));
+        }
+        entry_out.order = nEntries++;
+        return true;
+    }
+    return false;
+}
+
+void HPWH::ScheduleStream::fillWindow()
+{
+    Entry newEntry;
+    while (!hasAllEntries && (window.size() < reorderWindow))
+    {
+        if (!readEntry(newEntry))
+        {
+            hasAllEntries = true;
+            break;
+        }
+        if (newEntry.begin_min <= lastMinute)
+        {
+            send_error(fmt::format("{}:{}: this entry is more than {} entries out of order to "
+                                   "stream",
+                                   source,
+                                   lineNumber,
+                                   reorderWindow));
+        }
+        window.push(newEntry);
+    }
+}
+
+double HPWH::ScheduleStream::operator()(long minute)
+{
+    if (minute < lastMinute)
+    {
+        send_error(fmt::format("{}: minute {} requested after minute {}; a streamed schedule "
+                               "only moves forward",
+                               source,
+                               minute,
+                               lastMinute));
+    }
+
+    fillWindow();
+    while (!window.empty() && (window.top().begin_min <= minute))
+    {
+        entry = window.top();
+        hasEntry = true;
+        window.pop();
+    }
+    lastMinute = minute;
+
+    if (hasEntry && (minute < entry.begin_min + entryLength_min))
+        return entry.value;
+    return defaultValue;
+}
+
+void HPWH::ScheduleSet::add(const std::string& name, const SparseSchedule& schedule)
+{
+    if (name.size() >= sizeof(PackedColumn::name))
+    {
+        send_error(fmt::format("Schedule name {} is too long", name));
+    }
+    if (columns.empty())
+        length_min = schedule.getLength_min();
+    else if (schedule.getLength_min() != length_min)
+    {
+        send_error(fmt::format("Schedule {} has {} minutes; others have {}",
+                               name,
+                               schedule.getLength_min(),
+                               length_min));
+    }
+    for (auto& column : columns)
+    {
+        if (column.first == name)
+        {
+            column.second = schedule;
+            return;
+        }
+    }
+    columns.push_back({name, schedule});
+}
+
+bool HPWH::ScheduleSet::has(const std::string& name) const
+{
+    for (auto& column : columns)
+        if (column.first == name)
+            return true;
+    return false;
+}
+
+const HPWH::SparseSchedule& HPWH::ScheduleSet::get(const std::string& name) const
+{
+    for (auto& column : columns)
+        if (column.first == name)
+            return column.second;
+    send_error(fmt::format("No schedule named {}", name));
+    return columns.front().second;
+}
+
+void HPWH::ScheduleSet::write(const std::string& filepath, bool singlePrecision /*=false*/) const
+{
+    PackedHeader header = {};
+    std::copy(packedMagic, packedMagic + sizeof(packedMagic), header.magic);
+    header.byteOrder = byteOrderMark;
+    header.version = version;
+    header.length = static_cast<std::uint64_t>(length_min);
+    header.step_s = 60;
+    header.nColumns = static_cast<std::uint32_t>(columns.size());
+
+    std::uint64_t offset = sizeof(PackedHeader) + columns.size() * sizeof(PackedColumn);
+    std::vector<PackedColumn> packedColumns(columns.size());
+    for (std::size_t iColumn = 0; iColumn < columns.size(); ++iColumn)
+    {
+        auto& schedule = columns[iColumn].second;
+        bool isExactSingle = true;
+        for (std::size_t iRun = 0; isExactSingle && (iRun < schedule.nRuns); ++iRun)
+        {
+            double value = schedule.getValue(iRun);
+            isExactSingle = (double(float(value)) == value);
+        }
+
+        auto& packedColumn = packedColumns[iColumn];
+        columns[iColumn].first.copy(packedColumn.name, sizeof(packedColumn.name) - 1);
+        packedColumn.valueType = (singlePrecision || isExactSingle) ? SINGLE : DOUBLE;
+        packedColumn.nRuns = static_cast<std::uint32_t>(schedule.nRuns);
+        packedColumn.beginsOffset = offset;
+        offset = alignTo8(offset + schedule.nRuns * sizeof(std::uint32_t));
+        packedColumn.valuesOffset = offset;
+        std::size_t valueSize = (packedColumn.valueType == SINGLE) ? sizeof(float) : sizeof(double);
+        offset = alignTo8(offset + schedule.nRuns * valueSize);
+    }
+    header.infoOffset = offset;
+    header.infoSize = info.size();
+
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        send_error(fmt::format("Could not open output file {}", filepath));
+    }
+    auto pad = [&file]()
+    {
+        static const char zeros[8] = {};
+        auto position = static_cast<std::uint64_t>(file.tellp());
+        file.write(zeros, static_cast<std::streamsize>(alignTo8(position) - position));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(packedColumns.data()),
+               static_cast<std::streamsize>(packedColumns.size() * sizeof(PackedColumn)));
+    for (std::size_t iColumn = 0; iColumn < columns.size(); ++iColumn)
+    {
+        auto& schedule = columns[iColumn].second;
+        file.write(reinterpret_cast<const char*>(schedule.runBegins_min),
+                   static_cast<std::streamsize>(schedule.nRuns * sizeof(std::uint32_t)));
+        pad();
+        for (std::size_t iRun = 0; iRun < schedule.nRuns; ++iRun)
+        {
+            double value = schedule.getValue(iRun);
+            if (packedColumns[iColumn].valueType == SINGLE)
+            {
+                float singleValue = static_cast<float>(value);
+                file.write(reinterpret_cast<const char*>(&singleValue), sizeof(singleValue));
+            }
+            else
+                file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        pad();
+    }
+    file.write(info.data(), static_cast<std::streamsize>(info.size()));
+    if (!file)
+    {
+        send_error(fmt::format("Could not write {}", filepath));
+    }
+}
+
+void HPWH::ScheduleSet::read(const std::string& filepath)
+{
+    auto file = std::make_shared<MappedFile>(filepath);
+    if (!file->is_open())
+    {
+        send_error(fmt::format("Could not open schedule file {}", filepath));
+    }
+    auto text = file->getText();
+    auto base = text.data();
+    auto size = static_cast<std::uint64_t>(text.size());
+
+    PackedHeader header;
+    if ((size < sizeof(header)) || !std::equal(packedMagic, packedMagic + 8, base))
+    {
+        send_error(fmt::format("{} is not a packed schedule file", filepath));
+    }
+    std::copy(base, base + sizeof(header), reinterpret_cast<char*>(&header));
+    if (header.byteOrder != byteOrderMark)
+    {
+        send_error(fmt::format("{} was packed with another byte order", filepath));
+    }
+    if (header.version != version)
+    {
+        send_error(fmt::format("{} has version {}; version {} is supported",
+                               filepath,
+                               header.version,
+                               version));
+    }
+    if (header.step_s != 60)
+    {
+        send_error(fmt::format("{} has a time step of {} s; only 60 s is supported",
+                               filepath,
+                               header.step_s));
+    }
+    auto isInFile = [size](std::uint64_t offset, std::uint64_t length)
+    { return (offset <= size) && (length <= size - offset); };
+    if (!isInFile(sizeof(header), std::uint64_t(header.nColumns) * sizeof(PackedColumn)) ||
+        !isInFile(header.infoOffset, header.infoSize) || (header.length > UINT32_MAX))
+    {
+        send_error(fmt::format("{} is truncated or corrupt", filepath));
+    }
+
+    length_min = static_cast<long>(header.length);
+    info.assign(base + header.infoOffset, header.infoSize);
+    columns.clear();
+    for (std::uint32_t iColumn = 0; iColumn < header.nColumns; ++iColumn)
+    {
+        PackedColumn packedColumn;
+        auto columnStart = base + sizeof(header) + iColumn * sizeof(PackedColumn);
+        std::copy(columnStart, columnStart + sizeof(packedColumn),
+                  reinterpret_cast<char*>(&packedColumn));
+        packedColumn.name[sizeof(packedColumn.name) - 1] = '\0';
+
+        std::size_t valueSize = (packedColumn.valueType == SINGLE) ? sizeof(float) : sizeof(double);
+        bool isValid = ((packedColumn.valueType == SINGLE) || (packedColumn.valueType == DOUBLE)) &&
+                       (packedColumn.nRuns > 0) && (packedColumn.beginsOffset % 8 == 0) &&
+                       (packedColumn.valuesOffset % 8 == 0) &&
+                       isInFile(packedColumn.beginsOffset,
+                                std::uint64_t(packedColumn.nRuns) * sizeof(std::uint32_t)) &&
+                       isInFile(packedColumn.valuesOffset, packedColumn.nRuns * valueSize);
+        if (!isValid)
+        {
+            send_error(fmt::format("{}: column {} is corrupt", filepath, packedColumn.name));
+        }
+
+        SparseSchedule schedule(get_courier(), packedColumn.name);
+        schedule.length_min = length_min;
+        schedule.nRuns = packedColumn.nRuns;
+        schedule.runBegins_min =
+            reinterpret_cast<const std::uint32_t*>(base + packedColumn.beginsOffset);
+        auto values = base + packedColumn.valuesOffset;
+        if (packedColumn.valueType == SINGLE)
+            schedule.singleValues = reinterpret_cast<const float*>(values);
+        else
+            schedule.doubleValues = reinterpret_cast<const double*>(values);
+        schedule.storage = file;
+        if ((schedule.runBegins_min[0] != 0) ||
+            (long(schedule.runBegins_min[schedule.nRuns - 1]) >= std::max(length_min, 1L)))
+        {
+            send_error(fmt::format("{}: column {} is corrupt", filepath, packedColumn.name));
+        }
+        columns.push_back({packedColumn.name, schedule});
+    }
+}
+
+bool HPWH::ScheduleSet::isPacked(const std::string& filepath)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    char magic[sizeof(packedMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::equal(packedMagic, packedMagic + sizeof(packedMagic), magic);
+}
@@ -0,0 +1,227 @@
+#ifndef HPWHSCHEDULE_hh
+#define HPWHSCHEDULE_hh
+
+#include "HPWH.hh"
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string_view>
+#include <thread>
+
+///	@class HPWH::SparseSchedule HPWHSchedule.hh
+/// A per-minute schedule held as runs of constant value, as written in the schedule files of a
+/// test directory ("default" plus the minutes or hours that differ from it). Nothing is
+/// expanded, so memory use depends on the number of changes, not on the length of the test.
+/// Copies share their runs.
+class HPWH::SparseSchedule : public Sender
+{
+  public:
+    SparseSchedule(
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+        const std::string& name_in = "schedule")
+        : Sender("SparseSchedule", name_in, courier)
+    {
+    }
+
+    /// read a schedule file, which is mapped into memory rather than streamed:
+    ///     default <value>
+    ///     minutes,<label>       ("hours,<label>" for hourly entries)
+    ///     <minute>,<value>
+    ///     ...
+    void read(const std::string& filepath, long minutesOfTest);
+
+    /// parse schedule text in the file format; errors are reported as source:line
+    void parse(std::string_view text, long minutesOfTest, const std::string& source = "schedule");
+
+    long getLength_min() const { return length_min; }
+    std::size_t getNumRuns() const { return nRuns; }
+    bool isSinglePrecision() const { return singleValues != nullptr; }
+
+    /// value at any minute, by binary search
+    double operator[](long minute) const;
+
+    /// all minutes, as the former dense reader produced
+    std::vector<double> expand() const;
+
+    ///	@class Cursor
+    /// Steps through the schedule in O(1) per minute when minutes are visited in increasing
+    /// order; a step backward repositions by binary search.
+    class Cursor
+    {
+      public:
+        explicit Cursor(const SparseSchedule& schedule_in) : schedule(&schedule_in) {}
+
+        double operator()(long minute);
+
+      private:
+        const SparseSchedule* schedule;
+        std::size_t iRun = 0; /**< run covering the last minute visited */
+        long lastMinute = 0;
+    };
+
+    Cursor getCursor() const { return Cursor(*this); }
+
+  private:
+    friend class HPWH::ScheduleSet;
+
+    long length_min = 0;
+    std::size_t nRuns = 0;
+    const std::uint32_t* runBegins_min = nullptr; /**< ascending, from minute 0 */
+    const double* doubleValues = nullptr;         /**< set for double precision */
+    const float* singleValues = nullptr;          /**< set for single precision */
+    std::shared_ptr<const void> storage;          /**< owns, or maps, the runs */
+
+    double getValue(std::size_t iRun) const
+    {
+        return singleValues ? singleValues[iRun] : doubleValues[iRun];
+    }
+
+    /// index of the run covering minute
+    std::size_t findRun(long minute) const;
+};
+
+///	@class HPWH::ScheduleStream HPWHSchedule.hh
+/// Reads a schedule file front to back in fixed-size chunks, for runs too long to hold their
+/// schedules. While one chunk is parsed, the next is read on a background thread. Entries are
+/// sorted within a window of fixed size, so they may be out of order by up to that many entries.
+/// Memory use does not depend on the length of the file or of the test. Minutes must be
+/// requested in increasing order.
+class HPWH::ScheduleStream : public Sender
+{
+  public:
+    static constexpr std::size_t defaultChunkSize = 1 << 16;
+    static constexpr std::size_t reorderWindow = 4096; /**< entries */
+
+    ScheduleStream(
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+        const std::string& name_in = "scheduleStream")
+        : Sender("ScheduleStream", name_in, courier)
+    {
+    }
+
+    ScheduleStream(const ScheduleStream&) = delete;
+    ScheduleStream& operator=(const ScheduleStream&) = delete;
+
+    ~ScheduleStream();
+
+    /// open a schedule file, in the format read by SparseSchedule, and read its default
+    void open(const std::string& filepath,
+              long minutesOfTest,
+              std::size_t chunkSize_in = defaultChunkSize);
+
+    /// value at minute, which may repeat but not decrease
+    double operator()(long minute);
+
+  private:
+    ///	@struct Entry
+    struct Entry
+    {
+        long begin_min = 0;
+        double value = 0.;
+        long order = 0; /**< in the file; a repeated minute takes its last value */
+
+        bool operator>(const Entry& entry) const
+        {
+            return (begin_min > entry.begin_min) ||
+                   ((begin_min == entry.begin_min) && (order > entry.order));
+        }
+    };
+
+    std::string source; /**< for messages */
+    long length_min = 0;
+    long entryLength_min = 1;
+    double defaultValue = 0.;
+    int lineNumber = 0;
+    long lastMinute = -1; /**< last requested */
+
+    bool hasEntry = false; /**< the last entry at or before lastMinute */
+    Entry entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> window; /**< read ahead */
+    long nEntries = 0;
+    bool hasAllEntries = false;
+
+    // chunks
+    std::ifstream file;
+    std::size_t chunkSize = defaultChunkSize;
+    std::string chunk;          /**< being parsed */
+    std::string_view remaining; /**< unparsed part of chunk */
+    std::string partialLine;    /**< start of a line split between chunks */
+    std::string splitLine;      /**< the last line returned, if it was split */
+    bool isAtEnd = false;
+
+    // reader thread
+    std::thread reader;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::string readChunk; /**< read ahead by the reader thread */
+    bool hasReadChunk = false;
+    bool readFailed = false;
+    bool stopping = false;
+
+    /// next line, without its newline; false at the end of the file
+    bool nextLine(std::string_view& line);
+
+    /// swap in the chunk read ahead; false at the end of the file
+    bool takeChunk();
+
+    /// next entry from the file; false at the end of the file
+    bool readEntry(Entry& entry_out);
+
+    /// read entries until the window is full
+    void fillWindow();
+
+    void readAhead();
+
+    void stop();
+};
+
+///	@class HPWH::ScheduleSet HPWHSchedule.hh
+/// The schedules of one test, with its test information, packed in a single binary file.
+/// Each column is stored as runs of constant value, in single or double precision. Reading
+/// maps the file, and the schedules refer directly to the mapping; nothing is parsed or copied.
+class HPWH::ScheduleSet : public Sender
+{
+  public:
+    static constexpr std::uint32_t version = 1;
+
+    ScheduleSet(
+        const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+        const std::string& name_in = "scheduleSet")
+        : Sender("ScheduleSet", name_in, courier)
+    {
+    }
+
+    std::string info; /**< contents of testInfo.txt */
+
+    long getLength_min() const { return length_min; }
+
+    /// all columns must have the same length
+    void add(const std::string& name, const SparseSchedule& schedule);
+
+    bool has(const std::string& name) const;
+
+    const SparseSchedule& get(const std::string& name) const;
+
+    const std::vector<std::pair<std::string, SparseSchedule>>& getColumns() const
+    {
+        return columns;
+    }
+
+    /// Columns whose values are all exact in single precision are stored that way;
+    /// singlePrecision stores every column in single precision, rounding where needed.
+    void write(const std::string& filepath, bool singlePrecision = false) const;
+
+    void read(const std::string& filepath);
+
+    /// whether filepath starts as a packed schedule file
+    static bool isPacked(const std::string& filepath);
+
+  private:
+    long length_min = 0;
+    std::vector<std::pair<std::string, SparseSchedule>> columns; /**< in the order added */
+};
+
+#endif
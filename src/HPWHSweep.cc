@@ -0,0 +1,259 @@
+/*
+ * Implementation of class HPWH::Sweep
+ */
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <optional>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHSweep.hh"
+#include "HPWHParallel.hh"
+
+HPWH::Sweep::Sweep(const std::shared_ptr<const ModelSpec>& spec_in,
+                   const std::shared_ptr<const Fleet::Schedule>& schedule_in,
+                   const std::shared_ptr<Courier::Courier>& courier,
+                   const std::string& name_in /*="sweep"*/)
+    : Sender("Sweep", name_in, courier), spec(spec_in), schedule(schedule_in)
+{
+    if (!spec)
+    {
+        send_error("No model given.");
+    }
+    if (!schedule)
+    {
+        send_error("No schedule given.");
+    }
+}
+
+std::unique_ptr<HPWH> HPWH::Sweep::instantiate(const Design& design) const
+{
+    auto hpwh = spec->instantiate();
+    if (design.tankVolume_L > 0.)
+    {
+        hpwh->setTankSize(design.tankVolume_L, UNITS_L);
+    }
+    if (design.capacityScale != 1.)
+    {
+        hpwh->setScaleCapacityCOP(design.capacityScale, 1.);
+    }
+    if (design.inletHeightFraction >= 0.)
+    {
+        hpwh->setInletByFraction(design.inletHeightFraction);
+    }
+    if (design.setpoint_C > 0.)
+    {
+        double maxAllowedSetpointT_C;
+        std::string why;
+        if (!hpwh->isNewSetpointPossible(design.setpoint_C, maxAllowedSetpointT_C, why))
+        {
+            return nullptr;
+        }
+        hpwh->setSetpoint(design.setpoint_C);
+    }
+    hpwh->resetTankToSetpoint();
+    return hpwh;
+}
+
+HPWH::Sweep::Evaluation
+HPWH::Sweep::evaluate(const Design& design, long minutesToRun, double minOutletT_C) const
+{
+    if (minutesToRun <= 0)
+    {
+        send_error("Run length must be positive.");
+    }
+    if (schedule->size() < static_cast<std::size_t>(minutesToRun))
+    {
+        send_error(fmt::format("The schedule is shorter than {} minutes.", minutesToRun));
+    }
+
+    Evaluation evaluation;
+    evaluation.design = design;
+    auto hpwh = instantiate(design);
+    if (!hpwh)
+    {
+        evaluation.feasible = false;
+        return evaluation;
+    }
+    evaluation.minOutletT_C = hpwh->getTankNodeTemp(hpwh->getNumNodes() - 1);
+
+    evaluation.passes = true;
+    for (long i = 0; i < minutesToRun; ++i)
+    {
+        auto drStatus =
+            schedule->drStatus.empty() ? DR_ALLOW : static_cast<DRMODES>(schedule->drStatus[i]);
+        hpwh->runOneStep(schedule->inletT_C[i],
+                         schedule->drawVolume_L[i],
+                         schedule->ambientT_C[i],
+                         schedule->externalT_C[i],
+                         drStatus);
+        for (int iHeatSource = 0; iHeatSource < hpwh->getNumHeatSources(); ++iHeatSource)
+            evaluation.energyInput_kWh += hpwh->getNthHeatSourceEnergyInput(iHeatSource);
+        evaluation.minutesRun = i + 1;
+
+        if (schedule->drawVolume_L[i] > 0.)
+        {
+            evaluation.minOutletT_C = std::min(evaluation.minOutletT_C, hpwh->getOutletTemp());
+            if (evaluation.minOutletT_C < minOutletT_C)
+            {
+                evaluation.passes = false;
+                break;
+            }
+        }
+    }
+    return evaluation;
+}
+
+//-----------------------------------------------------------------------------
+///	@brief	Evaluate the sweep. A line is the set of volumes at one combination
+///         of capacity, setpoint, and inlet height. With bisection, each line
+///         is a task that searches for its smallest passing volume, reading
+///         the bounds set by finished lines of the same setpoint and inlet
+///         height before each step.
+//-----------------------------------------------------------------------------
+HPWH::Sweep::Results HPWH::Sweep::run(const Axes& axes,
+                                      long minutesToRun,
+                                      double minOutletT_C,
+                                      bool bisect /*=true*/,
+                                      unsigned nThreads /*=0*/) const
+{
+    Design unchanged;
+    auto getValues = [](const std::vector<double>& axis, double unchangedValue)
+    { return axis.empty() ? std::vector<double>({unchangedValue}) : axis; };
+    auto volumes_L = getValues(axes.tankVolumes_L, unchanged.tankVolume_L);
+    auto capacityScales = getValues(axes.capacityScales, unchanged.capacityScale);
+    auto setpoints_C = getValues(axes.setpoints_C, unchanged.setpoint_C);
+    auto inletHeightFractions = getValues(axes.inletHeightFractions, unchanged.inletHeightFraction);
+
+    if (!std::is_sorted(volumes_L.begin(), volumes_L.end()) ||
+        !std::is_sorted(capacityScales.begin(), capacityScales.end()))
+    {
+        send_error("Tank volumes and capacity scales must be in ascending order.");
+    }
+
+    const std::size_t nVolumes = volumes_L.size();
+    const std::size_t nCapacities = capacityScales.size();
+    const std::size_t nGroups = setpoints_C.size() * inletHeightFractions.size();
+    const std::size_t nLines = nGroups * nCapacities;
+
+    Results results;
+    results.gridSize = nLines * nVolumes;
+
+    // line iLine = iGroup * nCapacities + iCapacity
+    auto getDesign = [&](std::size_t iLine, std::size_t iVolume)
+    {
+        std::size_t iGroup = iLine / nCapacities;
+        Design design;
+        design.tankVolume_L = volumes_L[iVolume];
+        design.capacityScale = capacityScales[iLine % nCapacities];
+        design.setpoint_C = setpoints_C[iGroup / inletHeightFractions.size()];
+        design.inletHeightFraction = inletHeightFractions[iGroup % inletHeightFractions.size()];
+        return design;
+    };
+
+    // evaluations of each line, indexed by volume; empty if not run
+    std::vector<std::vector<std::optional<Evaluation>>> lineEvaluations(
+        nLines, std::vector<std::optional<Evaluation>>(nVolumes));
+    auto evaluateAt = [&](std::size_t iLine, std::size_t iVolume) -> const Evaluation&
+    {
+        auto& evaluation = lineEvaluations[iLine][iVolume];
+        if (!evaluation)
+            evaluation = evaluate(getDesign(iLine, iVolume), minutesToRun, minOutletT_C);
+        return *evaluation;
+    };
+
+    // smallest passing volume index of each line; nVolumes if none, unknown until found
+    constexpr std::size_t unknown = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> minPassingIndex(nLines, unknown);
+    std::mutex boundsMutex;
+
+    if (bisect)
+    {
+        hpwh_parallel::forEach(
+            nLines,
+            [&](std::size_t iLine)
+            {
+                std::size_t iGroupStart = iLine - iLine % nCapacities;
+                std::size_t lo = 0, hi = nVolumes;
+                while (lo < hi)
+                {
+                    {
+                        // smaller capacities need at least as large a volume
+                        std::lock_guard<std::mutex> lock(boundsMutex);
+                        for (std::size_t j = iGroupStart; j < iGroupStart + nCapacities; ++j)
+                        {
+                            if (minPassingIndex[j] == unknown)
+                                continue;
+                            if (j < iLine)
+                                hi = std::min(hi, minPassingIndex[j]);
+                            else if (j > iLine)
+                                lo = std::max(lo, minPassingIndex[j]);
+                        }
+                    }
+                    if (lo >= hi)
+                        break;
+                    std::size_t mid = lo + (hi - lo) / 2;
+                    if (evaluateAt(iLine, mid).passes)
+                        hi = mid;
+                    else
+                        lo = mid + 1;
+                }
+                // the result may be known only from a bound; confirm it
+                lo = std::min(lo, hi);
+                while ((lo < nVolumes) && !evaluateAt(iLine, lo).passes)
+                    ++lo;
+
+                std::lock_guard<std::mutex> lock(boundsMutex);
+                minPassingIndex[iLine] = lo;
+            },
+            nThreads);
+    }
+    else
+    {
+        hpwh_parallel::forEach(
+            nLines * nVolumes,
+            [&](std::size_t iDesign) { evaluateAt(iDesign / nVolumes, iDesign % nVolumes); },
+            nThreads);
+        for (std::size_t iLine = 0; iLine < nLines; ++iLine)
+        {
+            minPassingIndex[iLine] = nVolumes;
+            for (std::size_t iVolume = 0; iVolume < nVolumes; ++iVolume)
+                if (lineEvaluations[iLine][iVolume]->passes)
+                {
+                    minPassingIndex[iLine] = iVolume;
+                    break;
+                }
+        }
+    }
+
+    // collect in grid order
+    for (std::size_t iLine = 0; iLine < nLines; ++iLine)
+    {
+        for (auto& evaluation : lineEvaluations[iLine])
+            if (evaluation)
+                results.evaluations.push_back(*evaluation);
+
+        if (minPassingIndex[iLine] >= nVolumes)
+            continue;
+        auto& passing = *lineEvaluations[iLine][minPassingIndex[iLine]];
+        results.frontier.push_back(passing);
+
+        auto isSmaller = [](const Design& design0, const Design& design1)
+        {
+            if (design0.tankVolume_L != design1.tankVolume_L)
+                return design0.tankVolume_L < design1.tankVolume_L;
+            if (design0.capacityScale != design1.capacityScale)
+                return design0.capacityScale < design1.capacityScale;
+            return design0.setpoint_C < design1.setpoint_C;
+        };
+        if (!results.hasBest || isSmaller(passing.design, results.best.design))
+        {
+            results.best = passing;
+            results.hasBest = true;
+        }
+    }
+    return results;
+}
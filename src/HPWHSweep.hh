@@ -0,0 +1,83 @@
+#ifndef HPWHSWEEP_hh
+#define HPWHSWEEP_hh
+
+#include "HPWH.hh"
+#include "HPWHFleet.hh"
+#include "HPWHModelSpec.hh"
+
+///	@class HPWH::Sweep HPWHSweep.hh
+/// Sizes a model against a draw schedule by sweeping tank volume, compressor capacity, setpoint,
+/// and inlet height. A design passes if the outlet temperature never falls below a threshold
+/// during a draw; a run stops at its first violation. Passing is taken to be monotonic in volume
+/// and capacity, so the smallest passing volume is bisected for each combination of the other
+/// values. These searches run concurrently, and each is narrowed by the results found so far at
+/// smaller capacities (an upper bound) and larger capacities (a lower bound).
+class HPWH::Sweep : public Sender
+{
+  public:
+    ///	@struct Axes
+    /// values to sweep; an empty axis leaves the model unchanged
+    struct Axes
+    {
+        std::vector<double> tankVolumes_L;  /**< ascending */
+        std::vector<double> capacityScales; /**< ascending; scales compressor input power */
+        std::vector<double> setpoints_C;
+        std::vector<double> inletHeightFractions;
+    };
+
+    ///	@struct Design
+    struct Design
+    {
+        double tankVolume_L = 0.;         /**< used if positive */
+        double capacityScale = 1.;        /**< used if not 1 */
+        double setpoint_C = 0.;           /**< used if positive */
+        double inletHeightFraction = -1.; /**< used if not negative */
+    };
+
+    ///	@struct Evaluation
+    struct Evaluation
+    {
+        Design design;
+        bool feasible = true;     /**< false if the setpoint cannot be reached; not run */
+        bool passes = false;
+        long minutesRun = 0;      /**< up to and including the first violation */
+        double minOutletT_C = 0.; /**< lowest outlet temperature during draws */
+        double energyInput_kWh = 0.;
+    };
+
+    ///	@struct Results
+    struct Results
+    {
+        std::size_t gridSize = 0;
+        std::vector<Evaluation> evaluations; /**< every design run */
+        std::vector<Evaluation> frontier;    /**< smallest passing volume, per other values */
+        bool hasBest = false;
+        Evaluation best; /**< smallest volume, then capacity, then setpoint */
+    };
+
+    Sweep(const std::shared_ptr<const ModelSpec>& spec_in,
+          const std::shared_ptr<const Fleet::Schedule>& schedule_in,
+          const std::shared_ptr<Courier::Courier>& courier = std::make_shared<DefaultCourier>(),
+          const std::string& name_in = "sweep");
+
+    /// run one design, starting with the tank at setpoint, until it fails to deliver
+    /// minOutletT_C or minutesToRun has elapsed; a design that cannot be configured is
+    /// marked infeasible, and fails
+    Evaluation evaluate(const Design& design, long minutesToRun, double minOutletT_C) const;
+
+    /// find the passing frontier (bisect = true) or evaluate every design
+    Results run(const Axes& axes,
+                long minutesToRun,
+                double minOutletT_C,
+                bool bisect = true,
+                unsigned nThreads = 0) const;
+
+  private:
+    std::shared_ptr<const ModelSpec> spec;
+    std::shared_ptr<const Fleet::Schedule> schedule;
+
+    /// create a working instance for design; null if its setpoint cannot be reached
+    std::unique_ptr<HPWH> instantiate(const Design& design) const;
+};
+
+#endif
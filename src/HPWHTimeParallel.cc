@@ -0,0 +1,212 @@
+/*
+ * Implementation of class HPWH::TimeParallel
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include "HPWH.hh"
+#include "HPWHTimeParallel.hh"
+#include "HPWHParallel.hh"
+
+HPWH::TimeParallel::TimeParallel(const HPWH& hpwh,
+                                 const std::shared_ptr<const Fleet::Schedule>& schedule_in,
+                                 const std::shared_ptr<Courier::Courier>& courier,
+                                 const std::string& name_in /*="time-parallel"*/)
+    : Sender("TimeParallel", name_in, courier), prototype(hpwh.clone()), schedule(schedule_in)
+{
+    if (!schedule)
+    {
+        send_error("No schedule given.");
+    }
+}
+
+HPWH::TimeParallel::ChunkRun
+HPWH::TimeParallel::runFine(const State& startState, long begin_min, long end_min) const
+{
+    ChunkRun chunkRun;
+    auto hpwh = prototype->clone();
+    hpwh->setState(startState);
+    for (long i = begin_min; i < end_min; ++i)
+    {
+        auto drStatus =
+            schedule->drStatus.empty() ? DR_ALLOW : static_cast<DRMODES>(schedule->drStatus[i]);
+        hpwh->runOneStep(schedule->inletT_C[i],
+                         schedule->drawVolume_L[i],
+                         schedule->ambientT_C[i],
+                         schedule->externalT_C[i],
+                         drStatus);
+        for (int iHeatSource = 0; iHeatSource < hpwh->getNumHeatSources(); ++iHeatSource)
+        {
+            chunkRun.energyInput_kWh += hpwh->getNthHeatSourceEnergyInput(iHeatSource);
+            chunkRun.energyOutput_kWh += hpwh->getNthHeatSourceEnergyOutput(iHeatSource);
+        }
+    }
+    hpwh->getState(chunkRun.endState);
+    return chunkRun;
+}
+
+HPWH::State HPWH::TimeParallel::runCoarse(const State& startState,
+                                          long begin_min,
+                                          long end_min,
+                                          double coarseStep_min) const
+{
+    auto hpwh = prototype->clone();
+    hpwh->setState(startState);
+    for (long i = begin_min; i < end_min;)
+    {
+        // draws are summed and conditions averaged over the step
+        long iEnd = std::min(end_min, i + static_cast<long>(std::ceil(coarseStep_min)));
+        double stepDrawVolume_L = 0.;
+        double inletT_C = 0., ambientT_C = 0., externalT_C = 0.;
+        for (long j = i; j < iEnd; ++j)
+        {
+            stepDrawVolume_L += schedule->drawVolume_L[j];
+            inletT_C += schedule->inletT_C[j];
+            ambientT_C += schedule->ambientT_C[j];
+            externalT_C += schedule->externalT_C[j];
+        }
+        double nMinutes = static_cast<double>(iEnd - i);
+        auto drStatus =
+            schedule->drStatus.empty() ? DR_ALLOW : static_cast<DRMODES>(schedule->drStatus[i]);
+
+        hpwh->setMinutesPerStep(nMinutes);
+        hpwh->runOneStep(inletT_C / nMinutes,
+                         stepDrawVolume_L,
+                         ambientT_C / nMinutes,
+                         externalT_C / nMinutes,
+                         drStatus);
+        i = iEnd;
+    }
+    return hpwh->getState();
+}
+
+/// largest change in any node temperature, or infinity if a heat source changed its status
+static double getBoundaryChange_C(const HPWH::State& state0, const HPWH::State& state1)
+{
+    if (state0.heatSourceFlags != state1.heatSourceFlags)
+        return HUGE_VAL;
+    double change_C = 0.;
+    for (std::size_t i = 0; i < state0.tankTs_C.size(); ++i)
+        change_C = std::max(change_C, std::abs(state1.tankTs_C[i] - state0.tankTs_C[i]));
+    return change_C;
+}
+
+HPWH::TimeParallel::Results HPWH::TimeParallel::run(long minutesToRun) const
+{
+    return run(minutesToRun, Options());
+}
+
+//-----------------------------------------------------------------------------
+///	@brief	Parareal iteration: U(k+1) <- F(U(k)) + G(U'(k)) - G(U(k)), where F and
+///         G are the fine and coarse propagators over chunk k and U'(k) is the
+///         updated start of chunk k. The correction applies to node temperatures;
+///         the discrete status of the heat sources is taken from F.
+//-----------------------------------------------------------------------------
+HPWH::TimeParallel::Results HPWH::TimeParallel::run(long minutesToRun,
+                                                    const Options& options) const
+{
+    if (minutesToRun <= 0)
+    {
+        send_error("Run length must be positive.");
+    }
+    if (schedule->size() < static_cast<std::size_t>(minutesToRun))
+    {
+        send_error(fmt::format("The schedule is shorter than {} minutes.", minutesToRun));
+    }
+
+    Results results;
+    auto startTime = std::chrono::steady_clock::now();
+
+    unsigned nThreads =
+        (options.nThreads > 0) ? options.nThreads : hpwh_parallel::getDefaultThreadCount();
+    std::size_t nChunks = (options.nChunks > 0) ? options.nChunks : nThreads;
+    nChunks = std::min(nChunks, static_cast<std::size_t>(minutesToRun));
+    std::size_t maxIterations = (options.maxIterations > 0) ? options.maxIterations : nChunks;
+
+    // temperature depression requires a one-minute step
+    bool useCoarse = (options.coarseStep_min > 1.) && !prototype->doTempDepression;
+
+    std::vector<long> chunkBegin_min(nChunks + 1);
+    for (std::size_t k = 0; k <= nChunks; ++k)
+        chunkBegin_min[k] = static_cast<long>(k * minutesToRun / nChunks);
+
+    // initial estimate of the chunk starting states
+    std::vector<State> startStates(nChunks, prototype->getState());
+    std::vector<State> coarseEndStates(nChunks);
+    if (useCoarse)
+    {
+        for (std::size_t k = 0; k < nChunks; ++k)
+        {
+            coarseEndStates[k] = runCoarse(
+                startStates[k], chunkBegin_min[k], chunkBegin_min[k + 1], options.coarseStep_min);
+            if (k + 1 < nChunks)
+                startStates[k + 1] = coarseEndStates[k];
+        }
+    }
+
+    std::vector<ChunkRun> chunkRuns(nChunks);
+    while (results.nIterations < maxIterations)
+    {
+        ++results.nIterations;
+        hpwh_parallel::forEach(
+            nChunks,
+            [&](std::size_t k)
+            { chunkRuns[k] = runFine(startStates[k], chunkBegin_min[k], chunkBegin_min[k + 1]); },
+            nThreads);
+
+        // update the starting states serially; the first chunk's never changes
+        results.boundaryChange_C = 0.;
+        for (std::size_t k = 0; k + 1 < nChunks; ++k)
+        {
+            State newStartState = chunkRuns[k].endState;
+            if (useCoarse)
+            {
+                auto coarseEndState = runCoarse(startStates[k],
+                                                chunkBegin_min[k],
+                                                chunkBegin_min[k + 1],
+                                                options.coarseStep_min);
+                for (std::size_t i = 0; i < newStartState.tankTs_C.size(); ++i)
+                    newStartState.tankTs_C[i] +=
+                        coarseEndState.tankTs_C[i] - coarseEndStates[k].tankTs_C[i];
+                coarseEndStates[k] = coarseEndState;
+            }
+            results.boundaryChange_C =
+                std::max(results.boundaryChange_C,
+                         getBoundaryChange_C(startStates[k + 1], newStartState));
+            startStates[k + 1] = newStartState;
+        }
+        if (results.boundaryChange_C <= options.tolerance_C)
+        {
+            results.converged = true;
+            break;
+        }
+    }
+    if (results.nIterations >= nChunks)
+        results.converged = true; // every chunk has been refined from an exact start
+
+    results.nChunks = nChunks;
+    for (auto& chunkRun : chunkRuns)
+    {
+        results.energyInput_kWh += chunkRun.energyInput_kWh;
+        results.energyOutput_kWh += chunkRun.energyOutput_kWh;
+    }
+    results.finalState = chunkRuns.back().endState;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    results.elapsedTime_s = elapsed.count();
+
+    if (options.compareToSerial)
+    {
+        startTime = std::chrono::steady_clock::now();
+        auto serialRun = runFine(prototype->getState(), 0, minutesToRun);
+        elapsed = std::chrono::steady_clock::now() - startTime;
+        results.hasSerial = true;
+        results.serialEnergyInput_kWh = serialRun.energyInput_kWh;
+        results.serialEnergyOutput_kWh = serialRun.energyOutput_kWh;
+        results.serialElapsedTime_s = elapsed.count();
+    }
+    return results;
+}
@@ -0,0 +1,78 @@
+#ifndef HPWHTIMEPARALLEL_hh
+#define HPWHTIMEPARALLEL_hh
+
+#include "HPWH.hh"
+#include "HPWHFleet.hh"
+
+///	@class HPWH::TimeParallel HPWHTimeParallel.hh
+/// Experimental parareal-style driver for a single long simulation. The run is split into
+/// chunks; each iteration refines every chunk concurrently, at the full time step, from the
+/// current estimate of its starting state, then updates the estimates. A cheap coarse-step
+/// propagator predicts the starting states and corrects them between iterations; without one,
+/// each chunk simply starts from where its predecessor ended in the previous iteration.
+/// After n iterations the first n chunks match the serial run, so the result is exact once the
+/// iteration count reaches the number of chunks; usually the boundary states converge sooner.
+class HPWH::TimeParallel : public Sender
+{
+  public:
+    ///	@struct Options
+    struct Options
+    {
+        std::size_t nChunks = 0;       /**< 0: one per thread */
+        double coarseStep_min = 15.;   /**< 0: no coarse propagator */
+        double tolerance_C = 0.01;     /**< on the change of any boundary node temperature */
+        std::size_t maxIterations = 0; /**< 0: nChunks */
+        unsigned nThreads = 0;         /**< 0: hardware concurrency */
+        bool compareToSerial = false;  /**< also run serially, for the energy differences */
+    };
+
+    ///	@struct Results
+    struct Results
+    {
+        double energyInput_kWh = 0.;
+        double energyOutput_kWh = 0.;
+        std::size_t nChunks = 0;
+        std::size_t nIterations = 0;
+        bool converged = false;
+        double boundaryChange_C = 0.; /**< largest boundary change in the last iteration */
+        double elapsedTime_s = 0.;
+        State finalState;
+
+        bool hasSerial = false;
+        double serialEnergyInput_kWh = 0.;
+        double serialEnergyOutput_kWh = 0.;
+        double serialElapsedTime_s = 0.;
+    };
+
+    TimeParallel(const HPWH& hpwh,
+                 const std::shared_ptr<const Fleet::Schedule>& schedule_in,
+                 const std::shared_ptr<Courier::Courier>& courier =
+                     std::make_shared<DefaultCourier>(),
+                 const std::string& name_in = "time-parallel");
+
+    /// simulate from the current state of the model given at construction
+    Results run(long minutesToRun, const Options& options) const;
+
+    Results run(long minutesToRun) const;
+
+  private:
+    std::unique_ptr<HPWH> prototype;
+    std::shared_ptr<const Fleet::Schedule> schedule;
+
+    ///	@struct ChunkRun
+    struct ChunkRun
+    {
+        State endState;
+        double energyInput_kWh = 0.;
+        double energyOutput_kWh = 0.;
+    };
+
+    /// run minutes [begin_min, end_min) at the full step from startState
+    ChunkRun runFine(const State& startState, long begin_min, long end_min) const;
+
+    /// run minutes [begin_min, end_min) at the coarse step from startState
+    State
+    runCoarse(const State& startState, long begin_min, long end_min, double coarseStep_min) const;
+};
+
+#endif
@@ -219,6 +219,47 @@ void HPWH::calcThermalDist(std::vector<double>& thermalDist,
     }
 }
 
+/*static*/
+void HPWH::calcThermalDistGradient(std::vector<Gradient>& thermalDistGradient,
+                                   const double shrinkageT_C,
+                                   const int lowestNode,
+                                   const std::vector<double>& nodeT_C,
+                                   const std::vector<Gradient>& nodeTGradient_C,
+                                   const double setpointT_C)
+{
+    std::vector<double> thermalDist;
+    calcThermalDist(thermalDist, shrinkageT_C, lowestNode, nodeT_C, setpointT_C);
+
+    const std::size_t nParameters = nodeTGradient_C.front().size();
+    thermalDistGradient.assign(nodeT_C.size(), Gradient(nParameters));
+
+    // derivatives of the unnormalized weights retained by calcThermalDist
+    double totDist = 0.;
+    Gradient totDistGradient(nParameters);
+    for (int i = lowestNode; i < static_cast<int>(nodeT_C.size()); i++)
+    {
+        double Toffset_C = 5.0 / 1.8;
+        double expit = expitFunc((nodeT_C[i] - nodeT_C[lowestNode]) / shrinkageT_C, Toffset_C);
+        double dist = expit * (setpointT_C - nodeT_C[i]);
+        if ((dist <= 0.) || (thermalDist[i] <= 0.))
+            continue;
+        thermalDistGradient[i] = -expit * (1. - expit) * (setpointT_C - nodeT_C[i]) / shrinkageT_C *
+                                     (nodeTGradient_C[i] - nodeTGradient_C[lowestNode]) -
+                                 expit * nodeTGradient_C[i];
+        totDist += dist;
+        totDistGradient += thermalDistGradient[i];
+    }
+
+    if (totDist <= 0.)
+        return;
+    for (int i = lowestNode; i < static_cast<int>(nodeT_C.size()); i++)
+    {
+        if (thermalDist[i] > 0.)
+            thermalDistGradient[i] =
+                (thermalDistGradient[i] - thermalDist[i] * totDistGradient) / totDist;
+    }
+}
+
 /*static*/
 void HPWH::scaleVector(std::vector<double>& coeffs, const double scaleFactor)
 {
@@ -4,6 +4,7 @@
 
 #include "HPWH.hh"
 #include "Resistance.hh"
+#include "Tank.hh"
 
 HPWH::Resistance::Resistance(HPWH* hpwh_in,
                              std::shared_ptr<Courier::Courier> courier_in,
@@ -31,6 +32,13 @@ HPWH::Resistance& HPWH::Resistance::operator=(const HPWH::Resistance& r_in)
     return *this;
 }
 
+std::shared_ptr<HPWH::HeatSource> HPWH::Resistance::clone(HPWH* hpwh_in) const
+{
+    auto resistance = std::make_shared<Resistance>(*this);
+    resistance->setOwner(hpwh_in);
+    return resistance;
+}
+
 void HPWH::Resistance::from(
     const std::unique_ptr<hpwh_data_model::ashrae205::HeatSourceTemplate>& hs)
 {
@@ -87,7 +95,16 @@ void HPWH::Resistance::addHeat(double minutesToRun)
     calcHeatDist(heatDistribution);
 
     double cap_kJ = power_kW * (minutesToRun * sec_per_min);
-    auto leftoverCap_kJ = heat(cap_kJ, 100.);
+
+    // derivatives, if tracked, follow from those of the heating time
+    const bool hasGradients = hpwh->tank->tracksGradients();
+    Gradient capGradient_kJ, leftoverCapGradient_kJ;
+    if (hasGradients)
+        capGradient_kJ = (power_kW * sec_per_min) * hpwh->sensitivity->heatingTimeGradient_min;
+    leftoverCapGradient_kJ = capGradient_kJ;
+
+    auto leftoverCap_kJ =
+        heat(cap_kJ, 100., hasGradients ? &leftoverCapGradient_kJ : nullptr);
 
     runtime_min = (1. - (leftoverCap_kJ / cap_kJ)) * minutesToRun;
     if (runtime_min < -TOL_MINVALUE)
@@ -98,6 +115,15 @@ void HPWH::Resistance::addHeat(double minutesToRun)
     // update the input & output energy
     energyInput_kWh += power_kW * (runtime_min / min_per_hr);
     energyOutput_kWh += power_kW * (runtime_min / min_per_hr);
+
+    if (hasGradients)
+    {
+        runtimeGradient_min =
+            (1. - leftoverCap_kJ / cap_kJ) * hpwh->sensitivity->heatingTimeGradient_min -
+            (minutesToRun / cap_kJ) *
+                (leftoverCapGradient_kJ - (leftoverCap_kJ / cap_kJ) * capGradient_kJ);
+        hpwh->sensitivity->stepInputGradient_kJ += (power_kW * sec_per_min) * runtimeGradient_min;
+    }
 }
 
 bool HPWH::Resistance::toLockOrUnlock()
@@ -18,6 +18,8 @@ class HPWH::Resistance : public HPWH::HeatSource
 
     Resistance& operator=(const Resistance& r_in);
 
+    std::shared_ptr<HeatSource> clone(HPWH* hpwh_in) const override;
+
     HEATSOURCE_TYPE typeOfHeatSource() const override { return HPWH::TYPE_resistance; }
 
     Description description;
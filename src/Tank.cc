@@ -21,10 +21,22 @@ HPWH::Tank& HPWH::Tank::operator=(const HPWH::Tank& tank_in)
     fittingsUA_kJperHrC = tank_in.fittingsUA_kJperHrC;
     nodeTs_C = tank_in.nodeTs_C;
     nextNodeTs_C = tank_in.nextNodeTs_C;
+    standbyLosses_kJ = tank_in.standbyLosses_kJ;
     mixesOnDraw = tank_in.mixesOnDraw;
     mixBelowFractionOnDraw = tank_in.mixBelowFractionOnDraw;
     doInversionMixing = tank_in.doInversionMixing;
+    doConduction = tank_in.doConduction;
+    nodeVolume_L = tank_in.nodeVolume_L;
+    nodeCp_kJperC = tank_in.nodeCp_kJperC;
+    nodeHeight_m = tank_in.nodeHeight_m;
+    fracAreaTop = tank_in.fracAreaTop;
+    fracAreaSide = tank_in.fracAreaSide;
+    inletHeight = tank_in.inletHeight;
+    inlet2Height = tank_in.inlet2Height;
     hasHeatExchanger = tank_in.hasHeatExchanger;
+    heatExchangerEffectiveness = tank_in.heatExchangerEffectiveness;
+    nodeHeatExchangerEffectiveness = tank_in.nodeHeatExchangerEffectiveness;
+    outletT_C = tank_in.outletT_C;
     description = tank_in.description;
     productInformation = tank_in.productInformation;
     return *this;
@@ -193,6 +205,14 @@ void HPWH::Tank::setNodeTs_C(const std::vector<double>& nodeTs_C_in)
 
     // set node temps
     resampleIntensive(nodeTs_C, nodeTs_C_in);
+    if (tracksGradients())
+        trackGradients(outletTGradient_C.size());
+}
+
+void HPWH::Tank::trackGradients(std::size_t nParameters)
+{
+    nodeTGradients_C.assign(nParameters > 0 ? getNumNodes() : 0, Gradient(nParameters));
+    outletTGradient_C = Gradient(nParameters);
 }
 
 void HPWH::Tank::setProfileTs_C(const std::vector<double>& profileTs_C)
@@ -254,9 +274,11 @@ double HPWH::Tank::getAverageNodeT_C(const std::vector<double>& dist) const
     return tankT_C;
 }
 
-double HPWH::Tank::getAverageNodeT_C(const WeightedDistribution& wdist) const
+/// average of node values over a distribution
+static double getAverageNodeValue(const std::vector<double>& nodeValues,
+                                  const HPWH::WeightedDistribution& wdist)
 {
-    const int numNodes = hpwh->getNumNodes();
+    const int numNodes = static_cast<int>(nodeValues.size());
     double sum = 0;
     double totWeight = 0;
     auto distPoint = wdist.begin();
@@ -266,7 +288,7 @@ double HPWH::Tank::getAverageNodeT_C(const WeightedDistribution& wdist) const
         double norm_dist_height = distPoint->height / wdist.maximumHeight();
 
         double next_norm_node_height = static_cast<double>(i + 1) / numNodes;
-        double nodeT_C = hpwh->tank->nodeTs_C[i];
+        double nodeT_C = nodeValues[i];
         double norm_height = norm_node_height;
         while (norm_dist_height < next_norm_node_height)
         {
@@ -294,6 +316,11 @@ double HPWH::Tank::getAverageNodeT_C(const WeightedDistribution& wdist) const
     return sum / totWeight;
 }
 
+double HPWH::Tank::getAverageNodeT_C(const WeightedDistribution& wdist) const
+{
+    return getAverageNodeValue(hpwh->tank->nodeTs_C, wdist);
+}
+
 double HPWH::Tank::getAverageNodeT_C(const Distribution& dist) const
 {
     switch (dist.distributionType)
@@ -316,6 +343,50 @@ double HPWH::Tank::getAverageNodeT_C(const Distribution& dist) const
     return 0;
 }
 
+HPWH::Gradient HPWH::Tank::getAverageNodeTGradient_C() const
+{
+    Gradient gradient;
+    for (auto& nodeTGradient_C : nodeTGradients_C)
+        gradient += nodeTGradient_C;
+    return gradient / static_cast<double>(getNumNodes());
+}
+
+HPWH::Gradient HPWH::Tank::getAverageNodeTGradient_C(const WeightedDistribution& wdist) const
+{
+    // the average is linear in the node values, so apply it to each component
+    Gradient gradient(outletTGradient_C.size());
+    std::vector<double> nodeValues(getNumNodes());
+    for (std::size_t iParam = 0; iParam < gradient.size(); ++iParam)
+    {
+        for (int i = 0; i < getNumNodes(); ++i)
+            nodeValues[i] = nodeTGradients_C[i][iParam];
+        gradient[iParam] = getAverageNodeValue(nodeValues, wdist);
+    }
+    return gradient;
+}
+
+HPWH::Gradient HPWH::Tank::getAverageNodeTGradient_C(const Distribution& dist) const
+{
+    switch (dist.distributionType)
+    {
+    case DistributionType::BottomOfTank:
+    {
+        return nodeTGradients_C.front();
+    }
+
+    case DistributionType::TopOfTank:
+    {
+        return nodeTGradients_C.back();
+    }
+
+    case DistributionType::Weighted:
+    {
+        return getAverageNodeTGradient_C(dist.weightedDistribution);
+    }
+    }
+    return {};
+}
+
 // returns tank heat content relative to 0 C using kJ
 double HPWH::Tank::getHeatContent_kJ() const
 {
@@ -354,7 +425,10 @@ void HPWH::Tank::setDoInversionMixing(bool doInversionMixing_in)
 
 void HPWH::Tank::setDoConduction(bool doConduction_in) { doConduction = doConduction_in; }
 
-void HPWH::Tank::mixNodes(int mixBottomNode, int mixBelowNode, double mixFactor)
+void HPWH::Tank::mixNodes(int mixBottomNode,
+                          int mixBelowNode,
+                          double mixFactor,
+                          const Gradient& mixFactorGradient /*={}*/)
 {
     double avgT_C = 0.;
     double numAvgNodes = static_cast<double>(mixBelowNode - mixBottomNode);
@@ -364,8 +438,19 @@ void HPWH::Tank::mixNodes(int mixBottomNode, int mixBelowNode, double mixFactor)
     }
     avgT_C /= numAvgNodes;
 
+    Gradient avgTGradient_C;
+    if (tracksGradients())
+    {
+        for (int i = mixBottomNode; i < mixBelowNode; i++)
+            avgTGradient_C += nodeTGradients_C[i];
+        avgTGradient_C /= numAvgNodes;
+    }
+
     for (int i = mixBottomNode; i < mixBelowNode; i++)
     {
+        if (tracksGradients())
+            nodeTGradients_C[i] += mixFactorGradient * (avgT_C - nodeTs_C[i]) +
+                                   mixFactor * (avgTGradient_C - nodeTGradients_C[i]);
         nodeTs_C[i] += mixFactor * (avgT_C - nodeTs_C[i]);
     }
 }
@@ -408,6 +493,16 @@ void HPWH::Tank::mixInversions()
                     // Assign the tank temps from i to k
                     for (int k = i; k >= m; k--)
                         nodeTs_C[k] = Tmixed;
+
+                    if (tracksGradients())
+                    {
+                        Gradient mixedTGradient_C;
+                        for (int k = i; k >= m; k--)
+                            mixedTGradient_C += nodeTGradients_C[k];
+                        mixedTGradient_C /= static_cast<double>(i - m + 1);
+                        for (int k = i; k >= m; k--)
+                            nodeTGradients_C[k] = mixedTGradient_C;
+                    }
                 }
             }
 
@@ -421,6 +516,10 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
                              double inletVol2_L,
                              double inletT2_C)
 {
+    const bool hasGradients = tracksGradients();
+    if (hasGradients)
+        outletTGradient_C.assign(outletTGradient_C.size(), 0.);
+
     if (drawVolume_L > 0.)
     {
         if (inletVol2_L > drawVolume_L)
@@ -465,19 +564,30 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
         if (hasHeatExchanger)
         {
             outletT_C = inletT_C;
-            for (auto& nodeT_C : nodeTs_C)
+            for (int i = 0; i < getNumNodes(); ++i)
             {
+                double& nodeT_C = nodeTs_C[i];
                 double maxHeatExchange_kJ = drawCp_kJperC * (nodeT_C - outletT_C);
                 double heatExchange_kJ = nodeHeatExchangerEffectiveness * maxHeatExchange_kJ;
 
                 nodeT_C -= heatExchange_kJ / nodeCp_kJperC;
                 outletT_C += heatExchange_kJ / drawCp_kJperC;
+
+                if (hasGradients)
+                {
+                    Gradient heatExchangeGradient_kJ =
+                        nodeHeatExchangerEffectiveness * drawCp_kJperC *
+                        (nodeTGradients_C[i] - outletTGradient_C);
+                    nodeTGradients_C[i] -= heatExchangeGradient_kJ / nodeCp_kJperC;
+                    outletTGradient_C += heatExchangeGradient_kJ / drawCp_kJperC;
+                }
             }
         }
         else
         {
             double remainingDrawVolume_N = drawVolume_N;
             double totalExpelledHeat_kJ = 0.;
+            Gradient totalExpelledHeatGradient_kJ(outletTGradient_C.size());
             while (remainingDrawVolume_N > 0.)
             {
 
@@ -488,6 +598,13 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
                 double outputHeat_kJ = nodeCp_kJperC * incrementalDrawVolume_N * nodeTs_C.back();
                 totalExpelledHeat_kJ += outputHeat_kJ;
                 nodeTs_C.back() -= outputHeat_kJ / nodeCp_kJperC;
+                if (hasGradients)
+                {
+                    Gradient outputHeatGradient_kJ =
+                        nodeCp_kJperC * incrementalDrawVolume_N * nodeTGradients_C.back();
+                    totalExpelledHeatGradient_kJ += outputHeatGradient_kJ;
+                    nodeTGradients_C.back() -= outputHeatGradient_kJ / nodeCp_kJperC;
+                }
 
                 double inletFraction = 0.; // accumulate inlet contributions
                 for (int i = getNumNodes() - 1; i >= 0; --i)
@@ -510,6 +627,14 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
                             incrementalDrawVolume_N * (1. - inletFraction) * nodeTs_C[i - 1];
                         nodeTs_C[i] += transferT_C;
                         nodeTs_C[i - 1] -= transferT_C;
+                        if (hasGradients)
+                        {
+                            Gradient transferTGradient_C = incrementalDrawVolume_N *
+                                                           (1. - inletFraction) *
+                                                           nodeTGradients_C[i - 1];
+                            nodeTGradients_C[i] += transferTGradient_C;
+                            nodeTGradients_C[i - 1] -= transferTGradient_C;
+                        }
                     }
                 }
 
@@ -518,6 +643,7 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
             }
 
             outletT_C = totalExpelledHeat_kJ / drawCp_kJperC;
+            outletTGradient_C = totalExpelledHeatGradient_kJ / drawCp_kJperC;
         }
 
         // account for mixing at the bottom of the tank
@@ -531,6 +657,7 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
 
     // Initialize newnodeTs_C
     nextNodeTs_C = nodeTs_C;
+    std::vector<Gradient> nextNodeTGradients_C = nodeTGradients_C;
 
     double standbyLossesBottom_kJ = 0.;
     double standbyLossesTop_kJ = 0.;
@@ -547,6 +674,13 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
 
         nextNodeTs_C.front() -= standbyLossesBottom_kJ / nodeCp_kJperC;
         nextNodeTs_C.back() -= standbyLossesTop_kJ / nodeCp_kJperC;
+
+        if (hasGradients)
+        {
+            double lossFactor = standbyLossRate_kJperHrC * hpwh->hoursPerStep / nodeCp_kJperC;
+            nextNodeTGradients_C.front() -= lossFactor * nodeTGradients_C.front();
+            nextNodeTGradients_C.back() -= lossFactor * nodeTGradients_C.back();
+        }
     }
 
     // Standby losses from the sides of the tank
@@ -560,6 +694,9 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
             standbyLossesSides_kJ += losses_kJ;
 
             nextNodeTs_C[i] -= losses_kJ / nodeCp_kJperC;
+            if (hasGradients)
+                nextNodeTGradients_C[i] -= standbyLossRate_kJperHrC * hpwh->hoursPerStep /
+                                           nodeCp_kJperC * nodeTGradients_C[i];
         }
     }
 
@@ -582,17 +719,29 @@ void HPWH::Tank::updateNodes(double drawVolume_L,
         { // inner edges of top and bottom nodes
             nextNodeTs_C.front() += tau * (nodeTs_C[1] - nodeTs_C.front());
             nextNodeTs_C.back() += tau * (nodeTs_C[getNumNodes() - 2] - nodeTs_C.back());
+            if (hasGradients)
+            {
+                nextNodeTGradients_C.front() +=
+                    tau * (nodeTGradients_C[1] - nodeTGradients_C.front());
+                nextNodeTGradients_C.back() +=
+                    tau * (nodeTGradients_C[getNumNodes() - 2] - nodeTGradients_C.back());
+            }
         }
 
         // Internal nodes
         for (int i = 1; i < getNumNodes() - 1; i++)
         {
             nextNodeTs_C[i] += tau * (nodeTs_C[i + 1] - 2. * nodeTs_C[i] + nodeTs_C[i - 1]);
+            if (hasGradients)
+                nextNodeTGradients_C[i] +=
+                    tau * (nodeTGradients_C[i + 1] - 2. * nodeTGradients_C[i] +
+                           nodeTGradients_C[i - 1]);
         }
     }
 
     // Update nodeTs_C
     nodeTs_C = nextNodeTs_C;
+    nodeTGradients_C = nextNodeTGradients_C;
 
     standbyLosses_kJ += standbyLossesBottom_kJ + standbyLossesTop_kJ + standbyLossesSides_kJ;
 
@@ -652,8 +801,13 @@ double HPWH::Tank::calcSoCFraction(double tMains_C, double tMinUseful_C, double
     return chargeEquivalent / maxSoC;
 }
 
-double HPWH::Tank::addHeatAboveNode(double qAdd_kJ, int nodeNum, const double maxHeatToT_C)
+double HPWH::Tank::addHeatAboveNode(double qAdd_kJ,
+                                    int nodeNum,
+                                    const double maxHeatToT_C,
+                                    Gradient* qAddGradient_kJ /*=nullptr*/)
 {
+    const bool hasGradients = tracksGradients() && (qAddGradient_kJ != nullptr);
+
     // find number of nodes at or above nodeNum with the same temperature
     int numNodesToHeat = 1;
     for (int i = nodeNum; i < getNumNodes() - 1; i++)
@@ -674,6 +828,7 @@ double HPWH::Tank::addHeatAboveNode(double qAdd_kJ, int nodeNum, const double ma
         int targetTempNodeNum = nodeNum + numNodesToHeat;
 
         double heatToT_C;
+        Gradient heatToTGradient_C;
         if (targetTempNodeNum > (getNumNodes() - 1))
         {
             // no nodes above the equal-temp nodes; target temperature is the maximum
@@ -682,10 +837,13 @@ double HPWH::Tank::addHeatAboveNode(double qAdd_kJ, int nodeNum, const double ma
         else
         {
             heatToT_C = nodeTs_C[targetTempNodeNum];
+            if (hasGradients)
+                heatToTGradient_C = nodeTGradients_C[targetTempNodeNum];
             if (heatToT_C > maxHeatToT_C)
             {
                 // Ensure temperature does not exceed maximum
                 heatToT_C = maxHeatToT_C;
+                heatToTGradient_C.clear();
             }
         }
 
@@ -700,12 +858,30 @@ double HPWH::Tank::addHeatAboveNode(double qAdd_kJ, int nodeNum, const double ma
                 nodeTs_C[nodeNum + j] = heatToT_C;
             }
             qAdd_kJ = 0.;
+
+            if (hasGradients)
+            {
+                heatToTGradient_C =
+                    nodeTGradients_C[nodeNum] + *qAddGradient_kJ / nodeCp_kJperC / numNodesToHeat;
+                for (int j = 0; j < numNodesToHeat; ++j)
+                    nodeTGradients_C[nodeNum + j] = heatToTGradient_C;
+                qAddGradient_kJ->assign(qAddGradient_kJ->size(), 0.);
+            }
         }
         else if (qIncrement_kJ > 0.)
         { // add qIncrement_kJ to raise all equal-temp-nodes to heatToT_C
             for (int j = 0; j < numNodesToHeat; ++j)
                 nodeTs_C[nodeNum + j] = heatToT_C;
             qAdd_kJ -= qIncrement_kJ;
+
+            if (hasGradients)
+            {
+                heatToTGradient_C.resize(qAddGradient_kJ->size());
+                *qAddGradient_kJ -= numNodesToHeat * nodeCp_kJperC *
+                                    (heatToTGradient_C - nodeTGradients_C[nodeNum]);
+                for (int j = 0; j < numNodesToHeat; ++j)
+                    nodeTGradients_C[nodeNum + j] = heatToTGradient_C;
+            }
         }
         numNodesToHeat++;
     }
@@ -714,6 +890,20 @@ double HPWH::Tank::addHeatAboveNode(double qAdd_kJ, int nodeNum, const double ma
     return qAdd_kJ;
 }
 
+HPWH::Gradient
+HPWH::Tank::calcSoCFractionGradient(double tMains_C, double tMinUseful_C, double tMax_C) const
+{
+    // nodes below the minimum useful temperature hold no charge
+    Gradient chargeGradient(outletTGradient_C.size());
+    for (int i = 0; i < getNumNodes(); ++i)
+    {
+        if (nodeTs_C[i] >= tMinUseful_C)
+            chargeGradient += nodeTGradients_C[i] / (tMinUseful_C - tMains_C);
+    }
+    double maxSoC = getNumNodes() * getChargePerNode(tMains_C, tMinUseful_C, tMax_C);
+    return chargeGradient / maxSoC;
+}
+
 void HPWH::Tank::addExtraHeatAboveNode(double qAdd_kJ, const int nodeNum)
 {
     // find number of nodes at or above nodeNum with the same temperature
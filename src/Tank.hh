@@ -24,8 +24,14 @@ class HPWH::Tank : public Sender
     /**< constructor assigns a pointer to the hpwh that owns this heat source  */
     Tank(const Tank& tank);            /// copy constructor
     Tank& operator=(const Tank& tank); /// assignment operator
-    /**< the copy constructor and assignment operator basically just checks if there
-        are backup/companion pointers - these can't be copied */
+
+    /// report to courier, as if constructed with it
+    void setCourier(const std::shared_ptr<Courier::Courier>& courier)
+    {
+        Sender::operator=(Sender("HeatSource", name, courier));
+    }
+    /**< the copy constructor and assignment operator copy the configuration and the node state;
+        the owning HPWH must rebind hpwh */
 
     Description description;
     ProductInformation productInformation;
@@ -65,7 +71,12 @@ class HPWH::Tank : public Sender
     /// get the UA
     double getUA_kJperHrC() const;
 
-    double addHeatAboveNode(double qAdd_kJ, int nodeNum, const double maxHeatToT_C);
+    /// if qAddGradient_kJ is given, it holds the derivatives of qAdd_kJ on entry and those of
+    /// the returned heat on exit
+    double addHeatAboveNode(double qAdd_kJ,
+                            int nodeNum,
+                            const double maxHeatToT_C,
+                            Gradient* qAddGradient_kJ = nullptr);
 
     void addExtraHeatAboveNode(double qAdd_kJ, const int nodeNum);
 
@@ -80,6 +91,17 @@ class HPWH::Tank : public Sender
     /// future node temperature of each node - 0 is the bottom
     std::vector<double> nextNodeTs_C;
 
+    /// derivatives of the node temperatures, empty unless tracked (not copied)
+    std::vector<Gradient> nodeTGradients_C;
+
+    /// derivatives of the outlet temperature, if node derivatives are tracked
+    Gradient outletTGradient_C;
+
+    /// track derivatives with respect to nParameters, from zero, or stop if nParameters is zero
+    void trackGradients(std::size_t nParameters);
+
+    bool tracksGradients() const { return !nodeTGradients_C.empty(); }
+
     /// heat lost to standby
     double standbyLosses_kJ;
 
@@ -154,6 +176,12 @@ class HPWH::Tank : public Sender
 
     double getAverageNodeT_C(const Distribution& dist) const;
 
+    Gradient getAverageNodeTGradient_C() const;
+
+    Gradient getAverageNodeTGradient_C(const WeightedDistribution& wdist) const;
+
+    Gradient getAverageNodeTGradient_C(const Distribution& dist) const;
+
     double getHeatContent_kJ() const;
 
     double getNthSimTcouple(int iTCouple, int nTCouple) const;
@@ -180,7 +208,10 @@ class HPWH::Tank : public Sender
 
     void setOutletT_C(double outletT_C_in) { outletT_C = outletT_C_in; }
 
-    void mixNodes(int mixBottomNode, int mixBelowNode, double mixFactor);
+    void mixNodes(int mixBottomNode,
+                  int mixBelowNode,
+                  double mixFactor,
+                  const Gradient& mixFactorGradient = {});
 
     void mixInversions();
 
@@ -202,6 +233,8 @@ class HPWH::Tank : public Sender
 
     double calcSoCFraction(double tMains_C, double tMinUseful_C, double tMax_C) const;
 
+    Gradient calcSoCFractionGradient(double tMains_C, double tMinUseful_C, double tMax_C) const;
+
     /// UA of the fittings
     double fittingsUA_kJperHrC;
 
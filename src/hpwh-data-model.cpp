@@ -15,6 +15,7 @@ void init(std::shared_ptr<Courier::Courier> logger_in /*= std::make_shared<Couri
     hpwh_data_model::rsintegratedwaterheater::logger = logger_in;
     hpwh_data_model::rstank::logger = logger_in;
     hpwh_data_model::rscondenserwaterheatsource::logger = logger_in;
+    hpwh_data_model::rsairtowaterheatpump::logger = logger_in;
     hpwh_data_model::rsresistancewaterheatsource::logger = logger_in;
     hpwh_data_model::heat_source_configuration::logger = logger_in;
     hpwh_data_model::central_water_heating_system::logger = logger_in;
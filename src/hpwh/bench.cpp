@@ -0,0 +1,91 @@
+/*
+ * Time the initialization of preset models
+ */
+#include "HPWH.hh"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <fmt/format.h>
+
+#include <CLI/CLI.hpp>
+
+namespace hpwh_cli
+{
+
+/// presets
+static void benchPresets(int nRepeats, const std::string& outputFilepath);
+
+CLI::App* add_bench(CLI::App& app)
+{
+    const auto subcommand = app.add_subcommand("bench", "Time model initialization");
+    subcommand->require_subcommand(1);
+
+    const auto presets_subcommand = subcommand->add_subcommand(
+        "presets", "Compare cold and warm initPreset latency for every preset");
+
+    static int nRepeats = 100;
+    presets_subcommand->add_option("-r,--repeats", nRepeats, "Warm initializations per preset");
+
+    static std::string outputFilepath = "";
+    presets_subcommand->add_option("-o,--output", outputFilepath, "CSV filepath");
+
+    presets_subcommand->callback([&]() { benchPresets(nRepeats, outputFilepath); });
+
+    return subcommand;
+}
+
+void benchPresets(int nRepeats, const std::string& outputFilepath)
+{
+    using clock = std::chrono::steady_clock;
+    if (nRepeats < 1)
+        nRepeats = 1;
+
+    std::ofstream outputFile;
+    if (!outputFilepath.empty())
+    {
+        outputFile.open(outputFilepath, std::ofstream::out);
+        if (!outputFile.is_open())
+        {
+            std::cout << "Could not open output file " << outputFilepath << "\n";
+            exit(1);
+        }
+        outputFile << "model,cold_us,warm_us\n";
+    }
+
+    // cold: decoded and configured; warm: copied from the cached prototype
+    HPWH::clearPresetCache();
+    double coldTotal_us = 0., warmTotal_us = 0.;
+    std::cout << fmt::format(
+        "{:<32}{:>12}{:>12}{:>10}\n", "model", "cold (us)", "warm (us)", "ratio");
+    for (auto& model : hpwh_presets::models)
+    {
+        HPWH hpwh;
+        auto startTime = clock::now();
+        hpwh.initPreset(model.model());
+        std::chrono::duration<double, std::micro> cold_us = clock::now() - startTime;
+
+        startTime = clock::now();
+        for (int i = 0; i < nRepeats; ++i)
+            hpwh.initPreset(model.model());
+        std::chrono::duration<double, std::micro> warm_us = (clock::now() - startTime) / nRepeats;
+
+        coldTotal_us += cold_us.count();
+        warmTotal_us += warm_us.count();
+        std::cout << fmt::format("{:<32}{:>12.1f}{:>12.2f}{:>10.1f}\n",
+                                 hpwh.name,
+                                 cold_us.count(),
+                                 warm_us.count(),
+                                 cold_us.count() / warm_us.count());
+        if (outputFile.is_open())
+            outputFile << fmt::format(
+                "{},{:0.3f},{:0.3f}\n", hpwh.name, cold_us.count(), warm_us.count());
+    }
+    std::cout << fmt::format("{:<32}{:>12.1f}{:>12.2f}{:>10.1f}\n",
+                             "total",
+                             coldTotal_us,
+                             warmTotal_us,
+                             coldTotal_us / warmTotal_us);
+}
+
+} // namespace hpwh_cli
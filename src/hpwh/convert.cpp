@@ -2,8 +2,10 @@
  * Measure the performance metrics of a HPWH model
  */
 
+#include <chrono>
 #include <CLI/CLI.hpp>
 #include "HPWH.hh"
+#include "HPWHParallel.hh"
 #include "hpwh-data-model.hh"
 
 namespace hpwh_cli
@@ -15,6 +17,10 @@ void convert(const std::string& specType,
              std::string sOutputDir,
              std::string sOutputFilename);
 
+/// convert every preset
+static void
+convertAllPresets(std::string sOutputDir, std::string sOutputFilename, unsigned nThreads);
+
 CLI::App* add_convert(CLI::App& app)
 {
     const auto subcommand = app.add_subcommand("convert", "Convert to JSON");
@@ -34,6 +40,9 @@ CLI::App* add_convert(CLI::App& app)
     static std::string modelFilepath = "";
     model_group->add_option("-f,--filepath", modelFilepath, "Model filepath");
 
+    static bool allPresets = false;
+    model_group->add_flag("--all-presets", allPresets, "Convert every preset");
+
     model_group->required(1);
 
     //
@@ -43,9 +52,18 @@ CLI::App* add_convert(CLI::App& app)
     static std::string sOutputFilename = "";
     subcommand->add_option("-f,--filename", sOutputFilename, "Output filename");
 
+    static unsigned nThreads = 0;
+    subcommand->add_option("-j,--threads", nThreads, "Number of threads (0: all cores)");
+
     subcommand->callback(
         [&]()
         {
+            if (allPresets)
+            {
+                convertAllPresets(sOutputDir, sOutputFilename, nThreads);
+                return;
+            }
+
             HPWH hpwh;
             modelName = std::filesystem::path(modelName).stem().string();
             if (specType == "Preset")
@@ -69,8 +87,7 @@ CLI::App* add_convert(CLI::App& app)
                     hpwh.get_courier()->send_error(
                         fmt::format("Could not open input file {}\n", modelFilepath));
                 }
-                nlohmann::json j = nlohmann::json::parse(inputFile);
-                hpwh.initFromJSON(j, modelName);
+                hpwh.initFromJSON(inputFile, modelName);
             }
             else if (specType == "Legacy")
             {
@@ -116,4 +133,53 @@ void convert(const std::string& specType,
     outputFile.close();
 }
 
+void convertAllPresets(std::string sOutputDir, std::string sOutputFilename, unsigned nThreads)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    auto hpwhs = HPWH::initAllPresets();
+
+    std::vector<nlohmann::json> j_models(hpwhs.size());
+    hpwh_parallel::forEach(
+        hpwhs.size(),
+        [&](std::size_t iModel)
+        {
+            hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+            hpwhs[iModel]->to(hsi);
+            hpwh_data_model::hpwh_sim_input::to_json(j_models[iModel], hsi);
+        },
+        nThreads);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::cout << fmt::format("Converted {} presets in {:0.2f} s\n", hpwhs.size(), elapsed.count());
+
+    // written in catalog order
+    if (sOutputFilename == "")
+        sOutputFilename = "presets";
+    sOutputFilename = std::filesystem::path(sOutputFilename).stem().string();
+    nlohmann::json j_all = nlohmann::json::array();
+    for (std::size_t iModel = 0; iModel < hpwhs.size(); ++iModel)
+    {
+        auto& hpwh = *hpwhs[iModel];
+        j_all.push_back({{"model", hpwh.name}, {"hpwh_sim_input", j_models[iModel]}});
+
+        std::string modelFilename = sOutputDir + "/" + hpwh.name + "_Preset.json";
+        std::ofstream modelFile(modelFilename, std::ofstream::out);
+        if (!modelFile.is_open())
+        {
+            hpwh.get_courier()->send_error(
+                fmt::format("Could not open output file {}\n", modelFilename));
+        }
+        modelFile << j_models[iModel].dump(2) << "\n";
+    }
+
+    std::string allFilename = sOutputDir + "/" + sOutputFilename + ".json";
+    std::ofstream allFile(allFilename, std::ofstream::out);
+    if (!allFile.is_open())
+    {
+        std::make_shared<HPWH::DefaultCourier>()->send_error(
+            fmt::format("Could not open output file {}\n", allFilename));
+    }
+    allFile << j_all.dump(2) << "\n";
+}
+
 } // namespace hpwh_cli
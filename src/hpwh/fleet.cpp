@@ -0,0 +1,255 @@
+/*
+ * Simulate a fleet of HPWH units described by a manifest.
+ */
+#include "HPWH.hh"
+#include "HPWHFleet.hh"
+#include "HPWHModelSpec.hh"
+#include "HPWHSchedule.hh"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <fmt/format.h>
+
+#include <CLI/CLI.hpp>
+
+namespace hpwh_cli
+{
+
+int readSchedule(HPWH::SparseSchedule& schedule, std::string scheduleFileName, long minutesOfTest);
+
+/// fleet
+static void fleet(const std::string& manifestFilepath,
+                  const std::string& outputDir,
+                  const std::string& resultsName,
+                  unsigned nThreads,
+                  bool loadShapeOnly);
+
+CLI::App* add_fleet(CLI::App& app)
+{
+    const auto subcommand = app.add_subcommand("fleet", "Simulate a fleet of units");
+
+    static std::string manifestFilepath = "";
+    subcommand->add_option("-f,--manifest", manifestFilepath, "Manifest filepath (JSON)")
+        ->required();
+
+    static std::string outputDir = ".";
+    subcommand->add_option("-d,--dir", outputDir, "Output directory");
+
+    static std::string resultsName = "fleet";
+    subcommand->add_option("-r,--results", resultsName, "Results filename prefix");
+
+    static unsigned nThreads = 0;
+    subcommand->add_option("-j,--threads", nThreads, "Number of threads (0: all cores)");
+
+    static bool loadShapeOnly = false;
+    subcommand->add_flag("-s,--load-shape",
+                         loadShapeOnly,
+                         "Write only the aggregate load and its quantiles per interval");
+
+    subcommand->callback(
+        [&]() { fleet(manifestFilepath, outputDir, resultsName, nThreads, loadShapeOnly); });
+
+    return subcommand;
+}
+
+/// read the schedules of a test directory, as used by `hpwh run`; null on failure
+std::shared_ptr<const HPWH::Fleet::Schedule>
+readFleetSchedule(const std::string& testDir, long minutesToRun, std::string& errorMessage)
+{
+    std::vector<std::string> scheduleNames = {"inletT", "draw", "ambientT", "evaporatorT", "DR"};
+    std::vector<std::vector<double>> allSchedules(scheduleNames.size());
+    for (std::size_t i = 0; i < scheduleNames.size(); ++i)
+    {
+        std::string fileToOpen = testDir + "/" + scheduleNames[i] + "schedule.csv";
+        HPWH::SparseSchedule sparseSchedule;
+        if (readSchedule(sparseSchedule, fileToOpen, minutesToRun) != 0)
+        {
+            errorMessage = "readSchedule returns an error on " + scheduleNames[i] + " schedule!";
+            return nullptr;
+        }
+        allSchedules[i] = sparseSchedule.expand();
+    }
+
+    auto fleetSchedule = std::make_shared<HPWH::Fleet::Schedule>();
+    fleetSchedule->inletT_C = allSchedules[0];
+    fleetSchedule->drawVolume_L.reserve(allSchedules[1].size());
+    for (auto& draw_gal : allSchedules[1])
+        fleetSchedule->drawVolume_L.push_back(GAL_TO_L(draw_gal));
+    fleetSchedule->ambientT_C = allSchedules[2];
+    fleetSchedule->externalT_C = allSchedules[3];
+    fleetSchedule->drStatus.reserve(allSchedules[4].size());
+    for (auto& drStatus : allSchedules[4])
+        fleetSchedule->drStatus.push_back(static_cast<int>(drStatus));
+    return fleetSchedule;
+}
+
+std::shared_ptr<const HPWH::Fleet::Schedule> readFleetSchedule(const std::string& testDir,
+                                                               long minutesToRun)
+{
+    std::string errorMessage;
+    auto fleetSchedule = readFleetSchedule(testDir, minutesToRun, errorMessage);
+    if (!fleetSchedule)
+        std::make_shared<HPWH::DefaultCourier>()->send_error(errorMessage);
+    return fleetSchedule;
+}
+
+/// build a model spec from a manifest entry
+std::shared_ptr<const HPWH::ModelSpec> makeModelSpec(const nlohmann::json& j_unit)
+{
+    std::string specType = j_unit.value("spec", "Preset");
+    std::string modelName = j_unit.value("model", "");
+    std::string modelFilepath = j_unit.value("filepath", "");
+
+    HPWH hpwh;
+    if (specType == "Preset")
+    {
+        hpwh.initPreset(modelName);
+    }
+    else if (specType == "JSON")
+    {
+        if (!modelName.empty())
+            modelFilepath = "./models_json/" + modelName + ".json";
+        else if (!modelFilepath.empty())
+            modelName = getModelNameFromFilepath(modelFilepath);
+
+        std::ifstream inputFile;
+        inputFile.open(modelFilepath.c_str(), std::ifstream::in);
+        if (!inputFile.is_open())
+        {
+            hpwh.get_courier()->send_error(
+                fmt::format("Could not open input file {}\n", modelFilepath));
+        }
+        hpwh.initFromJSON(inputFile, modelName);
+    }
+    else if (specType == "Legacy")
+    {
+        hpwh.initLegacy(modelName);
+    }
+    else
+    {
+        hpwh.get_courier()->send_error(fmt::format("Invalid specification type {}", specType));
+    }
+    return std::make_shared<const HPWH::ModelSpec>(hpwh);
+}
+
+void fleet(const std::string& manifestFilepath,
+           const std::string& outputDir,
+           const std::string& resultsName,
+           unsigned nThreads,
+           bool loadShapeOnly)
+{
+    auto courier = std::make_shared<HPWH::DefaultCourier>();
+
+    std::ifstream manifestFile(manifestFilepath);
+    if (!manifestFile.is_open())
+        courier->send_error(fmt::format("Could not open manifest file {}", manifestFilepath));
+    nlohmann::json j_manifest = nlohmann::json::parse(manifestFile);
+
+    if (!j_manifest.contains("length_of_test"))
+        courier->send_error("Must record length_of_test in the manifest");
+    long minutesToRun = j_manifest["length_of_test"];
+    double interval_min = j_manifest.value("interval_min", 60.);
+    std::string sharedScheduleDir = j_manifest.value("schedule", "");
+
+    // models and schedules are read once, however many units use them
+    std::map<std::string, std::shared_ptr<const HPWH::ModelSpec>> specs;
+    std::map<std::string, std::shared_ptr<const HPWH::Fleet::Schedule>> schedules;
+
+    HPWH::Fleet hpwhFleet;
+    for (auto& j_unit : j_manifest["units"])
+    {
+        std::string specKey = fmt::format("{}:{}:{}",
+                                          j_unit.value("spec", "Preset"),
+                                          j_unit.value("model", ""),
+                                          j_unit.value("filepath", ""));
+        auto& spec = specs[specKey];
+        if (!spec)
+            spec = makeModelSpec(j_unit);
+
+        std::string scheduleDir = j_unit.value("schedule", sharedScheduleDir);
+        if (scheduleDir.empty())
+            courier->send_error(
+                fmt::format("No schedule given for a unit of {}", spec->getName()));
+        auto& unitSchedule = schedules[scheduleDir];
+        if (!unitSchedule)
+            unitSchedule = readFleetSchedule(scheduleDir, minutesToRun);
+
+        HPWH::Fleet::Unit unit;
+        unit.spec = spec;
+        unit.schedule = unitSchedule;
+        unit.drawScale = j_unit.value("draw_scale", 1.);
+        unit.setpoint_C = j_unit.value("setpoint_C", 0.);
+        if (j_unit.contains("tank_size_gal"))
+            unit.tankVolume_L = GAL_TO_L(j_unit["tank_size_gal"].get<double>());
+
+        std::string unitName = j_unit.value("name", spec->getName());
+        int count = j_unit.value("count", 1);
+        for (int iCopy = 0; iCopy < count; ++iCopy)
+        {
+            unit.name = (count > 1) ? fmt::format("{}_{}", unitName, iCopy + 1) : unitName;
+            hpwhFleet.addUnit(unit);
+        }
+    }
+
+    std::cout << "Now Simulating " << hpwhFleet.getNumUnits() << " units for " << minutesToRun
+              << " Minutes\n";
+    auto startTime = std::chrono::steady_clock::now();
+    if (loadShapeOnly)
+    {
+        auto loadShape = hpwhFleet.runLoadShape(minutesToRun, interval_min, nThreads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        std::cout << fmt::format("Simulated in {:0.2f} s\n", elapsed.count());
+
+        std::string fileToOpen = outputDir + "/" + resultsName + "_load_shape.csv";
+        std::ofstream loadShapeFile(fileToOpen);
+        if (!loadShapeFile.is_open())
+            courier->send_error(fmt::format("Could not open output file {}", fileToOpen));
+        loadShapeFile << "interval,start (min),energy input (kWh),unit min (kWh),unit p10 (kWh),"
+                         "unit p50 (kWh),unit p90 (kWh),unit p99 (kWh),unit max (kWh)\n";
+        for (std::size_t iInterval = 0; iInterval < loadShape.intervals.size(); ++iInterval)
+        {
+            auto& intervalLoad = loadShape.intervals[iInterval];
+            auto& sketch = intervalLoad.unitInput_kWh;
+            loadShapeFile << fmt::format("{},{:g},{:0.4f}",
+                                         iInterval,
+                                         iInterval * loadShape.interval_min,
+                                         intervalLoad.energyInput_kWh);
+            for (double q : {0., 0.1, 0.5, 0.9, 0.99, 1.})
+                loadShapeFile << fmt::format(",{:0.4f}", sketch.getQuantile(q));
+            loadShapeFile << "\n";
+        }
+        return;
+    }
+
+    auto results = hpwhFleet.run(minutesToRun, interval_min, nThreads);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::cout << fmt::format("Simulated in {:0.2f} s\n", elapsed.count());
+
+    std::string fileToOpen = outputDir + "/" + resultsName + "_units.csv";
+    std::ofstream unitsFile(fileToOpen);
+    if (!unitsFile.is_open())
+        courier->send_error(fmt::format("Could not open output file {}", fileToOpen));
+    unitsFile << "unit,energy input (kWh),energy output (kWh),draw volume (L),min outlet T (C)\n";
+    for (auto& unitSummary : results.units)
+        unitsFile << fmt::format("{},{:0.4f},{:0.4f},{:0.2f},{:0.2f}\n",
+                                 unitSummary.name,
+                                 unitSummary.energyInput_kWh,
+                                 unitSummary.energyOutput_kWh,
+                                 unitSummary.drawVolume_L,
+                                 unitSummary.minOutletT_C);
+
+    fileToOpen = outputDir + "/" + resultsName + "_load.csv";
+    std::ofstream loadFile(fileToOpen);
+    if (!loadFile.is_open())
+        courier->send_error(fmt::format("Could not open output file {}", fileToOpen));
+    loadFile << "interval,start (min),energy input (kWh)\n";
+    for (std::size_t iInterval = 0; iInterval < results.load_kWh.size(); ++iInterval)
+        loadFile << fmt::format("{},{:g},{:0.4f}\n",
+                                iInterval,
+                                iInterval * results.interval_min,
+                                results.load_kWh[iInterval]);
+}
+
+} // namespace hpwh_cli
@@ -0,0 +1,192 @@
+/*
+ * Compare peak heap and load time of initFromJSON, through a JSON tree and streamed.
+ *
+ * A separate executable, as counting the heap replaces the global operator new.
+ */
+#include "HPWH.hh"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+#include <CLI/CLI.hpp>
+
+/// heap use by operator new, counted only while tracking
+namespace
+{
+std::atomic<bool> trackHeap(false);
+std::atomic<std::size_t> heapInUse(0);
+std::atomic<std::size_t> heapPeak(0);
+
+/// each allocation is preceded by its size, in a header that keeps the default alignment
+constexpr std::size_t heapHeaderSize = alignof(std::max_align_t);
+
+void* allocate(std::size_t size)
+{
+    void* block = std::malloc(size + heapHeaderSize);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    *static_cast<std::size_t*>(block) = size;
+    if (trackHeap)
+    {
+        std::size_t inUse = heapInUse += size;
+        std::size_t peak = heapPeak;
+        while ((inUse > peak) && !heapPeak.compare_exchange_weak(peak, inUse))
+        {
+        }
+    }
+    return static_cast<char*>(block) + heapHeaderSize;
+}
+
+void deallocate(void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+    void* block = static_cast<char*>(ptr) - heapHeaderSize;
+    std::size_t size = *static_cast<std::size_t*>(block);
+    if (trackHeap)
+        heapInUse -= std::min(size, heapInUse.load());
+    std::free(block);
+}
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { deallocate(ptr); }
+
+/// peak heap above that in use at the start, and time, of one load
+struct LoadCost
+{
+    double peak_kB = 0.;
+    double time_ms = 0.;
+};
+
+template <typename Load>
+static LoadCost measureLoad(Load load)
+{
+    using clock = std::chrono::steady_clock;
+    heapInUse = 0;
+    heapPeak = 0;
+    trackHeap = true;
+    auto startTime = clock::now();
+    load();
+    std::chrono::duration<double, std::milli> time_ms = clock::now() - startTime;
+    trackHeap = false;
+    return {static_cast<double>(heapPeak) / 1024., time_ms.count()};
+}
+
+static void benchJSON(const std::string& modelsDir, const std::string& outputFilepath)
+{
+    std::vector<std::filesystem::path> modelFilepaths;
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator(modelsDir, ec))
+        if (entry.path().extension() == ".json")
+            modelFilepaths.push_back(entry.path());
+    if (ec || modelFilepaths.empty())
+    {
+        std::cout << "No JSON models found in " << modelsDir << "\n";
+        exit(1);
+    }
+    std::sort(modelFilepaths.begin(), modelFilepaths.end());
+
+    std::ofstream outputFile;
+    if (!outputFilepath.empty())
+    {
+        outputFile.open(outputFilepath, std::ofstream::out);
+        if (!outputFile.is_open())
+        {
+            std::cout << "Could not open output file " << outputFilepath << "\n";
+            exit(1);
+        }
+        outputFile << "model,size_kB,tree_peak_kB,tree_ms,stream_peak_kB,stream_ms\n";
+    }
+
+    LoadCost treeTotal, streamTotal;
+    std::cout << fmt::format("{:<36}{:>10}{:>14}{:>10}{:>14}{:>10}\n",
+                             "model",
+                             "size (kB)",
+                             "tree (kB)",
+                             "(ms)",
+                             "stream (kB)",
+                             "(ms)");
+    for (auto& modelFilepath : modelFilepaths)
+    {
+        // read the file first, so that neither load includes the disk
+        std::ifstream inputFile(modelFilepath);
+        std::stringstream buffer;
+        buffer << inputFile.rdbuf();
+        const std::string text = buffer.str();
+        const std::string modelName = modelFilepath.stem().string();
+
+        LoadCost tree = measureLoad(
+            [&]()
+            {
+                HPWH hpwh;
+                nlohmann::json j = nlohmann::json::parse(text);
+                hpwh.initFromJSON(j, modelName);
+            });
+        LoadCost stream = measureLoad(
+            [&]()
+            {
+                HPWH hpwh;
+                std::istringstream is(text);
+                hpwh.initFromJSON(is, modelName);
+            });
+
+        treeTotal.peak_kB = std::max(treeTotal.peak_kB, tree.peak_kB);
+        treeTotal.time_ms += tree.time_ms;
+        streamTotal.peak_kB = std::max(streamTotal.peak_kB, stream.peak_kB);
+        streamTotal.time_ms += stream.time_ms;
+
+        double size_kB = static_cast<double>(text.size()) / 1024.;
+        std::cout << fmt::format("{:<36}{:>10.1f}{:>14.1f}{:>10.2f}{:>14.1f}{:>10.2f}\n",
+                                 modelName,
+                                 size_kB,
+                                 tree.peak_kB,
+                                 tree.time_ms,
+                                 stream.peak_kB,
+                                 stream.time_ms);
+        if (outputFile.is_open())
+            outputFile << fmt::format("{},{:0.1f},{:0.1f},{:0.3f},{:0.1f},{:0.3f}\n",
+                                      modelName,
+                                      size_kB,
+                                      tree.peak_kB,
+                                      tree.time_ms,
+                                      stream.peak_kB,
+                                      stream.time_ms);
+    }
+    std::cout << fmt::format("{:<36}{:>10}{:>14.1f}{:>10.2f}{:>14.1f}{:>10.2f}\n",
+                             "max peak / total time",
+                             "",
+                             treeTotal.peak_kB,
+                             treeTotal.time_ms,
+                             streamTotal.peak_kB,
+                             streamTotal.time_ms);
+}
+
+int main(int argc, char** argv)
+{
+    CLI::App app {"hpwh_json_bench"};
+
+    std::string modelsDir = "./models_json";
+    app.add_option("-d,--dir", modelsDir, "Directory of JSON models");
+
+    std::string outputFilepath = "";
+    app.add_option("-o,--output", outputFilepath, "CSV filepath");
+
+    CLI11_PARSE(app, argc, argv);
+
+    benchJSON(modelsDir, outputFilepath);
+    return EXIT_SUCCESS;
+}
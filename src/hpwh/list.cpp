@@ -0,0 +1,47 @@
+/*
+ * List the preset models
+ */
+#include "HPWH.hh"
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+
+#include <CLI/CLI.hpp>
+
+namespace hpwh_cli
+{
+
+/// list
+static void list(const std::string& filter);
+
+CLI::App* add_list(CLI::App& app)
+{
+    const auto subcommand = app.add_subcommand("list", "List the preset models");
+
+    static std::string filter = "";
+    subcommand->add_option("-f,--filter", filter, "Only models whose names contain this text");
+
+    subcommand->callback([&]() { list(filter); });
+
+    return subcommand;
+}
+
+/// reads only the constant preset table; no model is initialized
+void list(const std::string& filter)
+{
+    std::cout << fmt::format("{:>6}  {:<32}{}\n", "number", "name", "form");
+    for (auto& model : hpwh_presets::models)
+    {
+        std::string_view name = model.name;
+        if (!filter.empty() && (name.find(filter) == std::string_view::npos))
+            continue;
+        std::cout << fmt::format("{:>6}  {:<32}{}\n",
+                                 model.id,
+                                 name,
+                                 model.build ? "compiled"
+                                             : fmt::format("CBOR, {} bytes", model.size));
+    }
+}
+
+} // namespace hpwh_cli
@@ -13,6 +13,12 @@ CLI::App* add_run(CLI::App& app);
 CLI::App* add_measure(CLI::App& app);
 CLI::App* add_make(CLI::App& app);
 CLI::App* add_convert(CLI::App& app);
+CLI::App* add_fleet(CLI::App& app);
+CLI::App* add_sweep(CLI::App& app);
+CLI::App* add_serve(CLI::App& app);
+CLI::App* add_schedules(CLI::App& app);
+CLI::App* add_bench(CLI::App& app);
+CLI::App* add_list(CLI::App& app);
 } // namespace hpwh_cli
 
 using namespace hpwh_cli;
@@ -26,6 +32,12 @@ int main(int argc, char** argv)
     add_measure(app);
     add_make(app);
     add_convert(app);
+    add_fleet(app);
+    add_sweep(app);
+    add_serve(app);
+    add_schedules(app);
+    add_bench(app);
+    add_list(app);
 
     CLI11_PARSE(app, argc, argv);
 
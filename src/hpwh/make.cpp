@@ -88,8 +88,7 @@ CLI::App* add_make(CLI::App& app)
                     hpwh.get_courier()->send_error(
                         fmt::format("Could not open input file {}\n", modelFilepath));
                 }
-                nlohmann::json j = nlohmann::json::parse(inputFile);
-                hpwh.initFromJSON(j, modelName);
+                hpwh.initFromJSON(inputFile, modelName);
             }
             else if (specType == "Legacy")
             {
@@ -2,8 +2,11 @@
  * Measure the performance metrics of a HPWH model
  */
 
+#include <chrono>
 #include <CLI/CLI.hpp>
 #include "HPWH.hh"
+#include "HPWHCSVSink.hh"
+#include "HPWHParallel.hh"
 
 namespace hpwh_cli
 {
@@ -14,7 +17,16 @@ static void measure(HPWH& hpwh,
                     bool sSupressOutput,
                     std::string sResultsFilename,
                     std::string customDrawProfile,
-                    std::string sTestConfig);
+                    std::string sTestConfig,
+                    bool allConfigs,
+                    unsigned nThreads);
+
+/// measure every preset
+static void measureAllPresets(std::string outputDir,
+                              std::string resultsFilename,
+                              std::string testConfig,
+                              bool allConfigs,
+                              unsigned nThreads);
 
 CLI::App* add_measure(CLI::App& app)
 {
@@ -35,6 +47,9 @@ CLI::App* add_measure(CLI::App& app)
     static std::string modelFilepath = "";
     model_group->add_option("-f,--filepath", modelFilepath, "Model filepath");
 
+    static bool allPresets = false;
+    model_group->add_flag("--all-presets", allPresets, "Measure every preset");
+
     model_group->required(1);
 
     //
@@ -53,9 +68,22 @@ CLI::App* add_measure(CLI::App& app)
     static std::string testConfig = "UEF";
     subcommand->add_option("-c,--config", testConfig, "test configuration");
 
+    static bool allConfigs = false;
+    subcommand->add_flag(
+        "-a,--all-configs", allConfigs, "Run the E50, UEF, and E95 tests concurrently");
+
+    static unsigned nThreads = 0;
+    subcommand->add_option("-j,--threads", nThreads, "Number of threads (0: all cores)");
+
     subcommand->callback(
         [&]()
         {
+            if (allPresets)
+            {
+                measureAllPresets(outputDir, resultsFilename, testConfig, allConfigs, nThreads);
+                return;
+            }
+
             HPWH hpwh;
             if (specType == "Preset")
             {
@@ -78,8 +106,7 @@ CLI::App* add_measure(CLI::App& app)
                     hpwh.get_courier()->send_error(
                         fmt::format("Could not open input file {}\n", modelFilepath));
                 }
-                nlohmann::json j = nlohmann::json::parse(inputFile);
-                hpwh.initFromJSON(j, modelName);
+                hpwh.initFromJSON(inputFile, modelName);
             }
             else if (specType == "Legacy")
             {
@@ -88,7 +115,14 @@ CLI::App* add_measure(CLI::App& app)
                 else if (modelNumber != -1)
                     hpwh.initLegacy(static_cast<hpwh_presets::MODELS>(modelNumber));
             }
-            measure(hpwh, outputDir, saveTestData, resultsFilename, drawProfileName, testConfig);
+            measure(hpwh,
+                    outputDir,
+                    saveTestData,
+                    resultsFilename,
+                    drawProfileName,
+                    testConfig,
+                    allConfigs,
+                    nThreads);
         });
 
     return subcommand;
@@ -99,7 +133,9 @@ void measure(HPWH& hpwh,
              bool saveTestData,
              std::string resultsFilename,
              std::string drawProfileName,
-             std::string testConfig)
+             std::string testConfig,
+             bool allConfigs,
+             unsigned nThreads)
 {
     auto designation = HPWH::FirstHourRating::Designation::Medium;
 
@@ -140,27 +176,43 @@ void measure(HPWH& hpwh,
             hpwh.get_courier()->send_error("Invalid input: Draw profile name not found.");
         }
     }
-    else
+    else if (!allConfigs)
     {
-        auto firstHourRating = hpwh.findFirstHourRating();
+        // as in measureAll, the rating is found on a copy, so the test starts from this state
+        auto firstHourRating = hpwh.getFirstHourRating();
         designation = firstHourRating.designation;
         j_results["first_hour_rating"] = firstHourRating.report();
     }
 
-    // select test configuration
-    transform(testConfig.begin(),
-              testConfig.end(),
-              testConfig.begin(),
-              ::toupper); // make uppercase
-    HPWH::TestConfiguration testConfiguration = HPWH::testConfiguration_UEF;
-    if (testConfig == "E50")
-        testConfiguration = HPWH::testConfiguration_E50;
-    else if (testConfig == "E95")
-        testConfiguration = HPWH::testConfiguration_E95;
+    // test data are labeled by configuration when all are run
+    std::vector<std::pair<std::string, HPWH::TestSummary>> testSummaries;
+    if (allConfigs)
+    {
+        auto results = (drawProfileName != "") ? hpwh.measureAll(designation, nThreads)
+                                               : hpwh.measureAll(nThreads);
+        j_results = results.report();
+        for (auto& test : results.tests)
+            testSummaries.push_back({"_" + test.name, std::move(test.testSummary)});
+    }
+    else
+    {
+        // select test configuration
+        transform(testConfig.begin(),
+                  testConfig.end(),
+                  testConfig.begin(),
+                  ::toupper); // make uppercase
+        HPWH::TestConfiguration testConfiguration = HPWH::testConfiguration_UEF;
+        if (testConfig == "E50")
+            testConfiguration = HPWH::testConfiguration_E50;
+        else if (testConfig == "E95")
+            testConfiguration = HPWH::testConfiguration_E95;
 
-    auto testSummary = hpwh.run24hrTest(testConfiguration, designation);
+        auto testSummary = hpwh.run24hrTest(testConfiguration, designation);
+
+        j_results["24_hr_test"] = testSummary.report();
+        testSummaries.push_back({"", std::move(testSummary)});
+    }
 
-    j_results["24_hr_test"] = testSummary.report();
     if ((outputDir != "") && (resultsFilename != ""))
     {
         resultsFilename = std::filesystem::path(resultsFilename).stem().string();
@@ -178,19 +230,103 @@ void measure(HPWH& hpwh,
 
     if (saveTestData)
     {
-        std::ofstream outputFile;
-        std::string filepath = "test24hrEF_" + hpwh.name + ".csv";
-        if (outputDir != "")
-            filepath = outputDir + "/" + filepath;
-        outputFile.open(filepath.c_str(), std::ifstream::out);
-        if (!outputFile.is_open())
+        for (auto& [suffix, testSummary] : testSummaries)
         {
-            std::cout << "Could not open output file " << filepath << "\n";
+            std::ofstream outputFile;
+            std::string filepath = "test24hrEF_" + hpwh.name + suffix + ".csv";
+            if (outputDir != "")
+                filepath = outputDir + "/" + filepath;
+            outputFile.open(filepath.c_str(), std::ifstream::out);
+            if (!outputFile.is_open())
+            {
+                std::cout << "Could not open output file " << filepath << "\n";
+                exit(1);
+            }
+            HPWH::CSVSink outputSink(outputFile);
+            hpwh.writeCSVHeading(outputSink);
+            for (auto& testData : testSummary.testDataSet)
+                hpwh.writeCSVRow(outputSink, testData);
+            outputSink.close();
+        }
+    }
+}
+
+void measureAllPresets(std::string outputDir,
+                       std::string resultsFilename,
+                       std::string testConfig,
+                       bool allConfigs,
+                       unsigned nThreads)
+{
+    transform(testConfig.begin(), testConfig.end(), testConfig.begin(), ::toupper);
+    HPWH::TestConfiguration testConfiguration = HPWH::testConfiguration_UEF;
+    if (testConfig == "E50")
+        testConfiguration = HPWH::testConfiguration_E50;
+    else if (testConfig == "E95")
+        testConfiguration = HPWH::testConfiguration_E95;
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto hpwhs = HPWH::initAllPresets();
+
+    // each model is measured serially; models are spread over the threads
+    std::vector<nlohmann::json> j_modelResults(hpwhs.size());
+    hpwh_parallel::forEach(
+        hpwhs.size(),
+        [&](std::size_t iModel)
+        {
+            auto& hpwh = *hpwhs[iModel];
+            auto& j_results = j_modelResults[iModel];
+            try
+            {
+                if (allConfigs)
+                {
+                    j_results = hpwh.measureAll(1).report();
+                }
+                else
+                {
+                    auto firstHourRating = hpwh.getFirstHourRating();
+                    j_results["first_hour_rating"] = firstHourRating.report();
+                    j_results["24_hr_test"] =
+                        hpwh.run24hrTest(testConfiguration, firstHourRating.designation).report();
+                }
+            }
+            catch (std::exception& e)
+            {
+                j_results = {{"error", e.what()}};
+            }
+        },
+        nThreads);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::cout << fmt::format("Measured {} presets in {:0.2f} s\n", hpwhs.size(), elapsed.count());
+
+    // written in catalog order
+    if (resultsFilename == "")
+        resultsFilename = "presets_measured";
+    resultsFilename = std::filesystem::path(resultsFilename).stem().string();
+    nlohmann::json j_allResults = nlohmann::json::array();
+    for (std::size_t iModel = 0; iModel < hpwhs.size(); ++iModel)
+    {
+        auto& name = hpwhs[iModel]->name;
+        j_allResults.push_back({{"model", name}, {"results", j_modelResults[iModel]}});
+
+        std::string modelFilepath = outputDir + "/" + name + "_" + resultsFilename + ".json";
+        std::ofstream modelFile(modelFilepath, std::ofstream::out | std::ofstream::trunc);
+        if (!modelFile.is_open())
+        {
+            std::cout << "Could not open output file " << modelFilepath << "\n";
             exit(1);
         }
-        hpwh.writeCSVHeading(&outputFile);
-        for (auto& testData : testSummary.testDataSet)
-            hpwh.writeCSVRow(&outputFile, testData);
+        modelFile << j_modelResults[iModel].dump(2);
+    }
+
+    std::string resultsFilepath = outputDir + "/" + resultsFilename + ".json";
+    std::ofstream resultsFile(resultsFilepath, std::ofstream::out | std::ofstream::trunc);
+    if (!resultsFile.is_open())
+    {
+        std::cout << "Could not open output file " << resultsFilepath << "\n";
+        exit(1);
     }
+    resultsFile << j_allResults.dump(2);
 }
+
 } // namespace hpwh_cli
@@ -3,12 +3,17 @@
  */
 #include "HPWH.hh"
 #include "Condenser.hh"
+#include "HPWHSchedule.hh"
+#include "HPWHCSVSink.hh"
+#include "HPWHOutputSpec.hh"
+#include "HPWHResults.hh"
 #include "hpwh-data-model.hh"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include <functional>
 #include <fmt/format.h>
 
 using std::endl;
@@ -16,8 +21,6 @@ using std::ifstream;
 using std::string;
 #include <CLI/CLI.hpp>
 
-typedef std::vector<double> schedule;
-
 namespace hpwh_cli
 {
 
@@ -27,7 +30,10 @@ static void run(const std::string specType,
                 std::string sTestName,
                 std::string sOutputDir,
                 double airTemp,
-                std::string measuredFilepath);
+                std::string measuredFilepath,
+                std::string outputSpecFilepath,
+                bool streamSchedules,
+                bool binaryResults);
 
 CLI::App* add_run(CLI::App& app)
 {
@@ -52,7 +58,9 @@ CLI::App* add_run(CLI::App& app)
 
     //
     static std::string fullTestName = "";
-    subcommand->add_option("-t,--test", fullTestName, "Test name")->required();
+    subcommand
+        ->add_option("-t,--test", fullTestName, "Test directory, or packed schedule file")
+        ->required();
 
     static std::string outputDir = ".";
     subcommand->add_option("-d,--dir", outputDir, "Output directory");
@@ -63,6 +71,21 @@ CLI::App* add_run(CLI::App& app)
     static std::string measuredFilepath = "";
     subcommand->add_option("-i,--init_tank_temps", measuredFilepath, "Measured filepath");
 
+    static std::string outputSpecFilepath = "";
+    subcommand->add_option("-o,--output_spec",
+                           outputSpecFilepath,
+                           "Output specification filepath (aggregated columns, in JSON)");
+
+    static bool streamSchedules = false;
+    subcommand->add_flag("--stream",
+                         streamSchedules,
+                         "Read schedule files in chunks as the run proceeds, in constant memory");
+
+    static bool binaryResults = false;
+    subcommand->add_flag("--binary",
+                         binaryResults,
+                         "Write results in the binary columnar format (.hpwhr) instead of CSV");
+
     subcommand->callback(
         [&]()
         {
@@ -89,8 +112,7 @@ CLI::App* add_run(CLI::App& app)
                     hpwh.get_courier()->send_error(
                         fmt::format("Could not open input file {}\n", modelFilepath));
                 }
-                nlohmann::json j = nlohmann::json::parse(inputFile);
-                hpwh.initFromJSON(j, modelName);
+                hpwh.initFromJSON(inputFile, modelName);
             }
             else if (specType == "Legacy")
             {
@@ -99,20 +121,33 @@ CLI::App* add_run(CLI::App& app)
                 else if (modelNumber != -1)
                     hpwh.initLegacy(static_cast<hpwh_presets::MODELS>(modelNumber));
             }
-            run(specType, hpwh, fullTestName, outputDir, airTemp, measuredFilepath);
+            run(specType,
+                hpwh,
+                fullTestName,
+                outputDir,
+                airTemp,
+                measuredFilepath,
+                outputSpecFilepath,
+                streamSchedules,
+                binaryResults);
         });
 
     return subcommand;
 }
 
-int readSchedule(schedule& scheduleArray, string scheduleFileName, long minutesOfTest);
+int readSchedule(HPWH::SparseSchedule& schedule, string scheduleFileName, long minutesOfTest);
+
+int openSchedule(HPWH::ScheduleStream& schedule, string scheduleFileName, long minutesOfTest);
 
 void run(const std::string specType,
          HPWH& hpwh,
          std::string fullTestName,
          std::string outputDir,
          double airTemp,
-         std::string measuredFilepath)
+         std::string measuredFilepath,
+         std::string outputSpecFilepath,
+         bool streamSchedules,
+         bool binaryResults)
 {
     HPWH::DRMODES drStatus = HPWH::DR_ALLOW;
     hpwh_presets::MODELS model;
@@ -124,7 +159,9 @@ void run(const std::string specType,
 
     // Schedule stuff
     std::vector<string> scheduleNames;
-    std::vector<schedule> allSchedules(7);
+    std::vector<HPWH::SparseSchedule> allSchedules(7);
+    std::vector<HPWH::ScheduleStream> scheduleStreams(7);
+    std::vector<bool> hasSchedule(7, false);
 
     string fileToOpen, fileToOpen2, scheduleName, var1;
     string inputVariableName, firstCol;
@@ -164,12 +201,18 @@ void run(const std::string specType,
         newSetpoint = (149 - 32) / 1.8;
     }
 
+    // a test is a directory of schedules, or the same packed into one file
+    HPWH::ScheduleSet packedSchedules;
+    bool isPacked = HPWH::ScheduleSet::isPacked(fullTestName);
+
     std::string sTestName = fullTestName; // remove path prefixes
     if (fullTestName.find("/") != std::string::npos)
     {
         std::size_t iLast = fullTestName.find_last_of("/");
         sTestName = fullTestName.substr(iLast + 1);
     }
+    if (isPacked)
+        sTestName = std::filesystem::path(sTestName).stem().string();
 
     // Use the built-in temperature depression for the lockout test. Set the temp depression of 4C
     // to better try and trigger the lockout and hysteresis conditions
@@ -178,12 +221,22 @@ void run(const std::string specType,
     hpwh.setDoTempDepression(HPWH_doTempDepress);
 
     // Read the test control file
-    fileToOpen = fullTestName + "/" + "testInfo.txt";
-    controlFile.open(fileToOpen.c_str());
-    if (!controlFile.is_open())
+    std::stringstream controlText;
+    if (isPacked)
     {
-        std::cout << "Could not open control file " << fileToOpen << "\n";
-        exit(1);
+        packedSchedules.read(fullTestName);
+        controlText << packedSchedules.info;
+    }
+    else
+    {
+        fileToOpen = fullTestName + "/" + "testInfo.txt";
+        controlFile.open(fileToOpen.c_str());
+        if (!controlFile.is_open())
+        {
+            std::cout << "Could not open control file " << fileToOpen << "\n";
+            exit(1);
+        }
+        controlText << controlFile.rdbuf();
     }
     outputCode = 0;
     minutesToRun = 0;
@@ -200,7 +253,7 @@ void run(const std::string specType,
     std::cout << "Running: " << hpwh.name << ", " << specType << ", " << fullTestName << endl;
 
     std::string line;
-    while (std::getline(controlFile, line))
+    while (std::getline(controlText, line))
     {
         std::vector<std::string> entries = {};
         std::string entry;
@@ -274,11 +327,27 @@ void run(const std::string specType,
 
     for (i = 0; (unsigned)i < scheduleNames.size(); i++)
     {
-        fileToOpen = fullTestName + "/" + scheduleNames[i] + "schedule.csv";
-        outputCode = readSchedule(allSchedules[i], fileToOpen, minutesToRun);
+        if (isPacked)
+        {
+            outputCode = 1;
+            if (packedSchedules.has(scheduleNames[i]))
+            {
+                allSchedules[i] = packedSchedules.get(scheduleNames[i]);
+                outputCode = (allSchedules[i].getLength_min() >= minutesToRun) ? 0 : 2;
+            }
+        }
+        else
+        {
+            fileToOpen = fullTestName + "/" + scheduleNames[i] + "schedule.csv";
+            outputCode = streamSchedules
+                             ? openSchedule(scheduleStreams[i], fileToOpen, minutesToRun)
+                             : readSchedule(allSchedules[i], fileToOpen, minutesToRun);
+        }
+        hasSchedule[i] = (outputCode == 0);
         if (outputCode != 0)
         {
-            if (scheduleNames[i] != "setpoint" && scheduleNames[i] != "SoC")
+            // optional schedules may be absent, but not unreadable
+            if ((outputCode == 2) || (scheduleNames[i] != "setpoint" && scheduleNames[i] != "SoC"))
             {
                 std::cout << "readSchedule returns an error on " << scheduleNames[i]
                           << " schedule!\n";
@@ -291,6 +360,17 @@ void run(const std::string specType,
         }
     }
 
+    // minutes are visited in order, so each cursor or stream advances in constant time
+    std::vector<std::function<double(long)>> cursors;
+    for (i = 0; (unsigned)i < scheduleNames.size(); i++)
+    {
+        if (streamSchedules && !isPacked)
+            cursors.push_back([&scheduleStream = scheduleStreams[i]](long minute)
+                              { return scheduleStream(minute); });
+        else
+            cursors.push_back(allSchedules[i].getCursor());
+    }
+
     if (doInvMix == 0)
     {
         hpwh.setDoInversionMixing(false);
@@ -304,11 +384,11 @@ void run(const std::string specType,
     {
         double maxAllowedSetpointT_C;
         string why;
-        if (!allSchedules[5].empty())
+        if (hasSchedule[5])
         {
-            if (hpwh.isNewSetpointPossible(allSchedules[5][0], maxAllowedSetpointT_C, why))
+            if (hpwh.isNewSetpointPossible(cursors[5](0), maxAllowedSetpointT_C, why))
             {
-                hpwh.setSetpoint(allSchedules[5][0]);
+                hpwh.setSetpoint(cursors[5](0));
             }
         }
         else if (newSetpoint > 0)
@@ -339,7 +419,7 @@ void run(const std::string specType,
     }
     if (useSoC)
     {
-        if (allSchedules[6].empty())
+        if (!hasSchedule[6])
         {
             std::cout << "If useSoC is true need an SoCschedule.csv file \n";
         }
@@ -349,25 +429,84 @@ void run(const std::string specType,
     // ----------------------Open the Output Files and Print the Header----------------------------
     // //
 
-    fileToOpen = outputDir + "/" + sTestName + "_" + specType + "_" + hpwh.name + ".csv";
-    outputFile.open(fileToOpen.c_str(), std::ifstream::out);
-    if (!outputFile.is_open())
+    fileToOpen = outputDir + "/" + sTestName + "_" + specType + "_" + hpwh.name +
+                 (binaryResults ? ".hpwhr" : ".csv");
+
+    // CSV rows are formatted into a buffer and written on another thread
+    std::unique_ptr<HPWH::CSVSink> outputSink;
+    std::unique_ptr<HPWH::ResultsWriter> resultsWriter;
+    if (binaryResults)
     {
-        std::cout << "Could not open output file " << fileToOpen << "\n";
-        exit(1);
+        resultsWriter = std::make_unique<HPWH::ResultsWriter>(
+            fileToOpen, HPWH::ResultsWriter::defaultBlockRows, hpwh.get_courier());
     }
-    if (minutesToRun > 500000.)
+    else
     {
-        outputFile << "time (day)";
-        for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+        outputFile.open(fileToOpen.c_str(), std::ifstream::out);
+        if (!outputFile.is_open())
         {
-            outputFile << fmt::format(",h_src{}In (Wh),h_src{}Out (Wh)", iHS + 1, iHS + 1);
+            std::cout << "Could not open output file " << fileToOpen << "\n";
+            exit(1);
         }
-        outputFile << std::endl;
+        outputSink = std::make_unique<HPWH::CSVSink>(
+            outputFile, true, HPWH::CSVSink::defaultFlushSize, hpwh.get_courier());
+    }
+
+    // keep the results so far readable if the run stops early
+    auto flushOutput = [&]()
+    {
+        if (resultsWriter)
+            resultsWriter->close();
+        else
+            outputSink->flush();
+    };
+
+    // an output specification replaces the per-minute and daily rows
+    HPWH::OutputSpec outputSpec(hpwh.get_courier());
+    std::unique_ptr<HPWH::OutputSpec::Recorder> recorder;
+    if (!outputSpecFilepath.empty())
+    {
+        std::ifstream outputSpecFile(outputSpecFilepath);
+        if (!outputSpecFile.is_open())
+        {
+            std::cout << "Could not open output specification " << outputSpecFilepath << "\n";
+            exit(1);
+        }
+        outputSpec.from(nlohmann::json::parse(outputSpecFile));
+        recorder = resultsWriter ? std::make_unique<HPWH::OutputSpec::Recorder>(
+                                       outputSpec, hpwh, *resultsWriter)
+                                 : std::make_unique<HPWH::OutputSpec::Recorder>(
+                                       outputSpec, hpwh, *outputSink);
+        recorder->writeHeading();
+    }
+    else if (minutesToRun > 500000.)
+    {
+        if (resultsWriter)
+        {
+            resultsWriter->addColumn("time (day)", "day", HPWH::ResultsWriter::Type::int32);
+            for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+            {
+                resultsWriter->addColumn(fmt::format("h_src{}In (Wh)", iHS + 1), "Wh");
+                resultsWriter->addColumn(fmt::format("h_src{}Out (Wh)", iHS + 1), "Wh");
+            }
+        }
+        else
+        {
+            outputSink->write("time (day)");
+            for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+            {
+                outputSink->write(",h_src{}In (Wh),h_src{}Out (Wh)", iHS + 1, iHS + 1);
+            }
+            outputSink->endRow();
+        }
+    }
+    else if (resultsWriter)
+    {
+        hpwh.writeResultsHeading(*resultsWriter, HPWH::CSVOPT_NONE);
     }
     else
     {
-        hpwh.writeCSVHeading(&outputFile, HPWH::CSVOPT_NONE);
+        hpwh.writeCSVHeading(*outputSink, HPWH::CSVOPT_NONE);
     }
 
     // ------------------------------------- Simulate --------------------------------------- //
@@ -375,6 +514,7 @@ void run(const std::string specType,
 
     std::vector<double> nodeExtraHeat_W;
     std::vector<double>* vectptr = NULL;
+
     // Loop over the minutes in the test
     for (i = 0; i < minutesToRun; i++)
     {
@@ -384,24 +524,27 @@ void run(const std::string specType,
         }
         else
         {
-            airTemp2 = allSchedules[2][i];
+            airTemp2 = cursors[2](i);
         }
 
         double tankHCStart = hpwh.getTankHeatContent_kJ();
 
+        double inletT_C = cursors[0](i);
+        double draw_gal = cursors[1](i);
+
         // Process the dr status
-        drStatus = static_cast<HPWH::DRMODES>(int(allSchedules[4][i]));
+        drStatus = static_cast<HPWH::DRMODES>(int(cursors[4](i)));
 
         // Change setpoint if there is a setpoint schedule.
-        if (!allSchedules[5].empty() && !hpwh.isSetpointFixed())
+        if (hasSchedule[5] && !hpwh.isSetpointFixed())
         {
-            hpwh.setSetpoint(allSchedules[5][i]); // expect this to fail sometimes
+            hpwh.setSetpoint(cursors[5](i)); // expect this to fail sometimes
         }
 
         // Change SoC schedule
         if (useSoC)
         {
-            hpwh.setTargetSoCFraction(allSchedules[6][i]);
+            hpwh.setTargetSoCFraction(cursors[6](i));
         }
 
         // Mix down for yearly tests with large compressors
@@ -410,26 +553,26 @@ void run(const std::string specType,
             // Do a simple mix down of the draw for the cold water temperature
             if (hpwh.getSetpoint() <= 125.)
             {
-                allSchedules[1][i] *= (125. - allSchedules[0][i]) /
-                                      (hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1, HPWH::UNITS_F) -
-                                       allSchedules[0][i]);
+                draw_gal *=
+                    (125. - inletT_C) /
+                    (hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1, HPWH::UNITS_F) - inletT_C);
             }
         }
 
         // Run the step
-        hpwh.runOneStep(allSchedules[0][i],           // Inlet water temperature (C)
-                        GAL_TO_L(allSchedules[1][i]), // Flow in gallons
-                        airTemp2,                     // Ambient Temp (C)
-                        allSchedules[3][i],           // External Temp (C)
-                        drStatus, // DDR Status (now an enum. Fixed for now as allow)
-                        1. * GAL_TO_L(allSchedules[1][i]),
-                        allSchedules[0][i],
+        hpwh.runOneStep(inletT_C,           // Inlet water temperature (C)
+                        GAL_TO_L(draw_gal), // Flow in gallons
+                        airTemp2,           // Ambient Temp (C)
+                        cursors[3](i),      // External Temp (C)
+                        drStatus,           // DDR Status (now an enum. Fixed for now as allow)
+                        1. * GAL_TO_L(draw_gal),
+                        inletT_C,
                         vectptr);
 
-        if (!hpwh.isEnergyBalanced(
-                GAL_TO_L(allSchedules[1][i]), allSchedules[0][i], tankHCStart, EBALTHRESHOLD))
+        if (!hpwh.isEnergyBalanced(GAL_TO_L(draw_gal), inletT_C, tankHCStart, EBALTHRESHOLD))
         {
             std::cout << "WARNING: On minute " << i << " HPWH has an energy balance error.\n";
+            flushOutput();
             exit(1);
         }
 
@@ -441,6 +584,7 @@ void run(const std::string specType,
                 std::cout << "ERROR: On minute " << i << " heat source " << iHS << " ran for "
                           << hpwh.getNthHeatSourceRunTime(iHS) << "minutes"
                           << "\n";
+                flushOutput();
                 exit(1);
             }
         }
@@ -460,7 +604,7 @@ void run(const std::string specType,
             }
         }
         // Recording
-        if (minutesToRun < 500000.)
+        if (recorder || (minutesToRun < 500000.))
         {
             if (HPWH_doTempDepress)
             {
@@ -471,8 +615,8 @@ void run(const std::string specType,
             testData.time_min = i;
             testData.ambientT_C = airTemp2;
             testData.setpointT_C = hpwh.getSetpoint();
-            testData.inletT_C = allSchedules[0][i];
-            testData.drawVolume_L = GAL_TO_L(allSchedules[1][i]);
+            testData.inletT_C = inletT_C;
+            testData.drawVolume_L = GAL_TO_L(draw_gal);
             testData.outletT_C = hpwh.getOutletTemp();
 
             testData.h_srcIn_kWh = {};
@@ -490,7 +634,12 @@ void run(const std::string specType,
                 testData.thermocoupleT_C.push_back(
                     hpwh.getNthSimTcouple(iTC + 1, HPWH::TestData::nTCouples, HPWH::UNITS_C));
 
-            hpwh.writeCSVRow(&outputFile, testData);
+            if (recorder)
+                recorder->add(testData);
+            else if (resultsWriter)
+                hpwh.writeResultsRow(*resultsWriter, testData);
+            else
+                hpwh.writeCSVRow(*outputSink, testData);
         }
         else
         {
@@ -502,12 +651,26 @@ void run(const std::string specType,
 
             if (subhourTime_min >= 1439.)
             {
-                outputFile << fmt::format("{:d}", static_cast<int>(trunc((i + 1) / 1440.) - 1));
-                for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+                int day = static_cast<int>(trunc((i + 1) / 1440.) - 1);
+                if (resultsWriter)
+                {
+                    resultsWriter->write(day);
+                    for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+                    {
+                        resultsWriter->write(cumHeatIn[iHS]);
+                        resultsWriter->write(cumHeatOut[iHS]);
+                    }
+                    resultsWriter->endRow();
+                }
+                else
                 {
-                    outputFile << fmt::format(",{:0.0f},{:0.0f}", cumHeatIn[iHS], cumHeatOut[iHS]);
+                    outputSink->write("{:d}", day);
+                    for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+                    {
+                        outputSink->write(",{:0.0f},{:0.0f}", cumHeatIn[iHS], cumHeatOut[iHS]);
+                    }
+                    outputSink->endRow();
                 }
-                outputFile << std::endl;
 
                 subhourTime_min = 0;
                 for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
@@ -521,81 +684,61 @@ void run(const std::string specType,
         }
     }
 
-    outputFile.close();
+    if (recorder)
+        recorder->finish();
+    if (resultsWriter)
+        resultsWriter->close();
+    else
+    {
+        outputSink->close();
+        outputFile.close();
+    }
 
     controlFile.close();
 }
 
-// this function reads the named schedule into the provided array
-int readSchedule(schedule& scheduleArray, string scheduleFileName, long minutesOfTest)
+// this function reads the named schedule, without expanding it to every minute;
+// returns 0 if read, 1 if absent, 2 if present but unreadable
+int readSchedule(HPWH::SparseSchedule& schedule, string scheduleFileName, long minutesOfTest)
 {
-    int minuteHrTmp;
-    bool hourInput;
-    string line, snippet, s, minORhr;
-    double valTmp;
-    ifstream inputFile(scheduleFileName.c_str());
-    // open the schedule file provided
     std::cout << "Opening " << scheduleFileName << '\n';
 
-    if (!inputFile.is_open())
+    // optional schedules are often absent; that is not worth an error message
+    if (!std::filesystem::exists(scheduleFileName))
     {
         return 1;
     }
+    try
+    {
+        schedule.read(scheduleFileName, minutesOfTest);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << e.what() << '\n';
+        return 2;
+    }
+    return 0;
+}
 
-    inputFile >> snippet >> valTmp;
-    // std::cout << "snippet " << snippet << " valTmp"<< valTmp<<'\n';
+// this function opens the named schedule to be read as the run proceeds;
+// returns as readSchedule
+int openSchedule(HPWH::ScheduleStream& schedule, string scheduleFileName, long minutesOfTest)
+{
+    std::cout << "Streaming " << scheduleFileName << '\n';
 
-    if (snippet != "default")
+    if (!std::filesystem::exists(scheduleFileName))
     {
-        std::cout << "First line of " << scheduleFileName << " must specify default\n";
         return 1;
     }
-    // std::cout << valTmp << " minutes = " << minutesOfTest << "\n";
-
-    // Fill with the default value
-    scheduleArray.assign(minutesOfTest, valTmp);
-
-    // Burn the first two lines
-    std::getline(inputFile, line);
-    std::getline(inputFile, line);
-
-    std::stringstream ss(line); // Will parse with a stringstream
-    // Grab the first token, which is the minute or hour marker
-    ss >> minORhr;
-    if (minORhr.empty())
-    { // If nothing left in the file
-        return 0;
+    try
+    {
+        schedule.open(scheduleFileName, minutesOfTest);
     }
-    hourInput = tolower(minORhr.at(0)) == 'h';
-    char c; // to eat the commas nom nom
-    // Read all the exceptions to the default value
-    while (inputFile >> minuteHrTmp >> c >> valTmp)
+    catch (const std::exception& e)
     {
-
-        if (minuteHrTmp >= (int)scheduleArray.size())
-        {
-            std::cout << "In " << scheduleFileName
-                      << " the input file has more minutes than the test was defined with\n";
-            return 1;
-        }
-        // Update the value
-        if (!hourInput)
-        {
-            scheduleArray[minuteHrTmp] = valTmp;
-        }
-        else if (hourInput)
-        {
-            for (int j = minuteHrTmp * 60; j < (minuteHrTmp + 1) * 60; j++)
-            {
-                scheduleArray[j] = valTmp;
-                // std::cout << "minute " << j-(minuteHrTmp) * 60 << " of hour" <<
-                // (minuteHrTmp)<<"\n";
-            }
-        }
+        std::cout << e.what() << '\n';
+        return 2;
     }
-
-    inputFile.close();
-
     return 0;
 }
 
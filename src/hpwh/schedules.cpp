@@ -0,0 +1,113 @@
+/*
+ * Convert the schedules of a test directory to a packed schedule file.
+ */
+#include "HPWH.hh"
+#include "HPWHSchedule.hh"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <fmt/format.h>
+
+#include <CLI/CLI.hpp>
+
+namespace hpwh_cli
+{
+
+int readSchedule(HPWH::SparseSchedule& schedule, std::string scheduleFileName, long minutesOfTest);
+
+/// pack
+static void pack(const std::string& testDir, std::string outputFilepath, bool singlePrecision);
+
+CLI::App* add_schedules(CLI::App& app)
+{
+    const auto subcommand = app.add_subcommand("schedules", "Manage test schedules");
+    subcommand->require_subcommand(1);
+
+    const auto pack_subcommand = subcommand->add_subcommand(
+        "pack", "Pack testInfo.txt and the schedules of a test into one binary file");
+
+    static std::string testDir = "";
+    pack_subcommand->add_option("-t,--test", testDir, "Test directory")->required();
+
+    static std::string outputFilepath = "";
+    pack_subcommand->add_option(
+        "-o,--output", outputFilepath, "Packed filepath (default: <test directory>.hpwhs)");
+
+    static bool singlePrecision = false;
+    pack_subcommand->add_flag("--single",
+                              singlePrecision,
+                              "Store every schedule in single precision, rounding where needed");
+
+    pack_subcommand->callback([&]() { pack(testDir, outputFilepath, singlePrecision); });
+
+    return subcommand;
+}
+
+void pack(const std::string& testDir, std::string outputFilepath, bool singlePrecision)
+{
+    std::string fileToOpen = testDir + "/testInfo.txt";
+    std::ifstream controlFile(fileToOpen);
+    if (!controlFile.is_open())
+    {
+        std::cout << "Could not open control file " << fileToOpen << "\n";
+        exit(1);
+    }
+    std::stringstream controlText;
+    controlText << controlFile.rdbuf();
+
+    HPWH::ScheduleSet scheduleSet;
+    scheduleSet.info = controlText.str();
+
+    long minutesToRun = 0;
+    std::string line;
+    while (std::getline(controlText, line))
+    {
+        std::stringstream ss(line);
+        std::string key;
+        if ((ss >> key) && (key == "length_of_test"))
+            ss >> minutesToRun;
+    }
+    if (minutesToRun == 0)
+    {
+        std::cout << "Error, must record length_of_test in testInfo.txt file\n";
+        exit(1);
+    }
+
+    // as read by `hpwh run`; setpoint and SoC schedules are optional
+    for (std::string scheduleName :
+         {"inletT", "draw", "ambientT", "evaporatorT", "DR", "setpoint", "SoC"})
+    {
+        HPWH::SparseSchedule schedule;
+        fileToOpen = testDir + "/" + scheduleName + "schedule.csv";
+        int outputCode = readSchedule(schedule, fileToOpen, minutesToRun);
+        if (outputCode == 0)
+            scheduleSet.add(scheduleName, schedule);
+        else if ((outputCode == 2) || ((scheduleName != "setpoint") && (scheduleName != "SoC")))
+        {
+            std::cout << "readSchedule returns an error on " << scheduleName << " schedule!\n";
+            exit(1);
+        }
+    }
+
+    if (outputFilepath.empty())
+    {
+        std::string testName = std::filesystem::path(testDir).lexically_normal().string();
+        while (!testName.empty() && ((testName.back() == '/') || (testName.back() == '\\')))
+            testName.pop_back();
+        outputFilepath = testName + ".hpwhs";
+    }
+    scheduleSet.write(outputFilepath, singlePrecision);
+
+    std::size_t nRuns = 0;
+    for (auto& column : scheduleSet.getColumns())
+        nRuns += column.second.getNumRuns();
+    std::cout << fmt::format("Packed {} schedules ({} runs over {} minutes) to {}\n",
+                             scheduleSet.getColumns().size(),
+                             nRuns,
+                             minutesToRun,
+                             outputFilepath);
+}
+
+} // namespace hpwh_cli
@@ -0,0 +1,413 @@
+/*
+ * Serve simulation requests, one JSON object per line, from a long-lived process.
+ */
+#include "serve.hh"
+#include "Condenser.hh"
+#include "hpwh-data-model.hh"
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <CLI/CLI.hpp>
+
+namespace hpwh_cli
+{
+
+std::shared_ptr<const HPWH::Fleet::Schedule>
+readFleetSchedule(const std::string& testDir, long minutesToRun, std::string& errorMessage);
+std::shared_ptr<const HPWH::ModelSpec> makeModelSpec(const nlohmann::json& j_unit);
+
+/// serve
+static void serve(const std::string& socketPath, std::size_t cacheSize, unsigned nThreads);
+
+CLI::App* add_serve(CLI::App& app)
+{
+    const auto subcommand =
+        app.add_subcommand("serve", "Answer run, measure, make, and perfmap requests (NDJSON)");
+
+    static std::string socketPath = "";
+    subcommand->add_option(
+        "-u,--socket", socketPath, "Listen on this UNIX socket instead of stdin/stdout");
+
+    static std::size_t cacheSize = 32;
+    subcommand->add_option("-c,--cache", cacheSize, "Number of models and schedules to keep");
+
+    static unsigned nThreads = 0;
+    subcommand->add_option("-j,--threads", nThreads, "Number of threads (0: all cores)");
+
+    subcommand->callback([&]() { serve(socketPath, cacheSize, nThreads); });
+
+    return subcommand;
+}
+
+#ifndef _WIN32
+/// owns a connected socket, which is closed once the last pending reply is sent
+class SocketSink : public ReplySink
+{
+  public:
+    explicit SocketSink(int fd_in) : fd(fd_in) {}
+    ~SocketSink() override { close(fd); }
+
+    int getFD() const { return fd; }
+
+  protected:
+    void write(const std::string& line) override
+    {
+        std::size_t nSent = 0;
+        while (nSent < line.size())
+        {
+            auto n = ::send(fd, line.data() + nSent, line.size() - nSent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return; // client has gone; drop the reply
+            nSent += static_cast<std::size_t>(n);
+        }
+    }
+
+  private:
+    int fd;
+};
+#endif
+
+void Server::submit(const std::string& line, const std::shared_ptr<ReplySink>& sink)
+{
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+        return;
+    pool.submit(
+        [this, line, sink]()
+        {
+            nlohmann::json j_request, j_reply;
+            try
+            {
+                j_request = nlohmann::json::parse(line);
+                j_reply = handle(j_request);
+            }
+            catch (const std::exception& e)
+            {
+                j_reply = {{"error", e.what()}};
+            }
+            if (j_request.is_object() && j_request.contains("id"))
+                j_reply["id"] = j_request["id"];
+            sink->send(j_reply);
+        });
+}
+
+nlohmann::json Server::handle(const nlohmann::json& j_request)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    std::string cmd = j_request.value("cmd", "");
+    nlohmann::json j_reply;
+    if (cmd == "run")
+        j_reply = run(j_request);
+    else if (cmd == "measure")
+        j_reply = measure(j_request);
+    else if (cmd == "make")
+        j_reply = make(j_request);
+    else if (cmd == "perfmap")
+        j_reply = perfmap(j_request);
+    else if (cmd == "status")
+        j_reply = {{"models", specs.report()},
+                   {"schedules", schedules.report()},
+                   {"threads", pool.getNumThreads()}};
+    else
+        throw std::runtime_error(fmt::format("Unknown command \"{}\"", cmd));
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    j_reply["cmd"] = cmd;
+    j_reply["elapsed_time_s"] = elapsed.count();
+    return j_reply;
+}
+
+std::shared_ptr<const HPWH::ModelSpec> Server::getSpec(const nlohmann::json& j_request)
+{
+    std::string key = fmt::format("{}:{}:{}",
+                                  j_request.value("spec", "Preset"),
+                                  j_request.value("model", ""),
+                                  j_request.value("filepath", ""));
+    return specs.get(key, [&]() { return makeModelSpec(j_request); });
+}
+
+HPWH::TestConfiguration Server::getTestConfiguration(std::string sTestConfig)
+{
+    std::transform(sTestConfig.begin(), sTestConfig.end(), sTestConfig.begin(), ::toupper);
+    if (sTestConfig == "E50")
+        return HPWH::testConfiguration_E50;
+    if (sTestConfig == "E95")
+        return HPWH::testConfiguration_E95;
+    return HPWH::testConfiguration_UEF;
+}
+
+bool Server::findDesignation(const nlohmann::json& j_request,
+                             HPWH::FirstHourRating::Designation& designation)
+{
+    if (!j_request.contains("draw_profile"))
+        return false;
+    auto normalize = [](std::string name)
+    {
+        for (auto& c : name)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+        return name;
+    };
+    std::string drawProfileName = normalize(j_request["draw_profile"].get<std::string>());
+    for (auto& [key, value] : HPWH::FirstHourRating::DesignationMap)
+    {
+        if (normalize(value) == drawProfileName)
+        {
+            designation = key;
+            return true;
+        }
+    }
+    throw std::runtime_error("Invalid input: Draw profile name not found.");
+}
+
+nlohmann::json Server::run(const nlohmann::json& j_request)
+{
+    auto spec = getSpec(j_request);
+
+    std::shared_ptr<const HPWH::Fleet::Schedule> schedule;
+    long minutesToRun = j_request.value("length_of_test", 0L);
+    if (j_request.contains("schedule"))
+    {
+        auto& j_schedule = j_request["schedule"];
+        auto inlineSchedule = std::make_shared<HPWH::Fleet::Schedule>();
+        inlineSchedule->inletT_C = j_schedule.at("inletT_C").get<std::vector<double>>();
+        inlineSchedule->drawVolume_L = j_schedule.at("drawVolume_L").get<std::vector<double>>();
+        inlineSchedule->ambientT_C = j_schedule.at("ambientT_C").get<std::vector<double>>();
+        inlineSchedule->externalT_C = j_schedule.at("externalT_C").get<std::vector<double>>();
+        if (j_schedule.contains("drStatus"))
+            inlineSchedule->drStatus = j_schedule["drStatus"].get<std::vector<int>>();
+        if (minutesToRun == 0)
+            minutesToRun = static_cast<long>(inlineSchedule->size());
+        schedule = inlineSchedule;
+    }
+    else
+    {
+        std::string testDir = j_request.at("test_dir").get<std::string>();
+        if (minutesToRun == 0)
+            throw std::runtime_error("A run from test_dir needs length_of_test");
+        schedule = schedules.get(fmt::format("{}:{}", testDir, minutesToRun),
+                                 [&]()
+                                 {
+                                     std::string errorMessage;
+                                     auto fleetSchedule = readFleetSchedule(
+                                         testDir, minutesToRun, errorMessage);
+                                     if (!fleetSchedule)
+                                         throw std::runtime_error(errorMessage);
+                                     return fleetSchedule;
+                                 });
+    }
+
+    HPWH::Fleet::Unit unit;
+    unit.name = spec->getName();
+    unit.spec = spec;
+    unit.schedule = schedule;
+    unit.drawScale = j_request.value("draw_scale", 1.);
+    unit.setpoint_C = j_request.value("setpoint_C", 0.);
+    if (j_request.contains("tank_size_gal"))
+        unit.tankVolume_L = GAL_TO_L(j_request["tank_size_gal"].get<double>());
+
+    HPWH::Fleet fleet;
+    fleet.addUnit(unit);
+    auto results = fleet.run(minutesToRun, j_request.value("interval_min", 60.), 1);
+
+    auto& summary = results.units.front();
+    return {{"model", summary.name},
+            {"energy_input_kWh", summary.energyInput_kWh},
+            {"energy_output_kWh", summary.energyOutput_kWh},
+            {"draw_volume_L", summary.drawVolume_L},
+            {"min_outlet_T_C", summary.minOutletT_C},
+            {"interval_min", results.interval_min},
+            {"load_kWh", results.load_kWh}};
+}
+
+nlohmann::json Server::measure(const nlohmann::json& j_request)
+{
+    auto hpwh = getSpec(j_request)->instantiate();
+
+    auto designation = HPWH::FirstHourRating::Designation::Medium;
+    bool hasDesignation = findDesignation(j_request, designation);
+
+    nlohmann::json j_results;
+    if (!j_request.contains("config"))
+    {
+        auto results =
+            hasDesignation ? hpwh->measureAll(designation, 1) : hpwh->measureAll(1);
+        j_results = results.report();
+    }
+    else
+    {
+        if (!hasDesignation)
+        {
+            auto firstHourRating = hpwh->findFirstHourRating();
+            designation = firstHourRating.designation;
+            j_results["first_hour_rating"] = firstHourRating.report();
+        }
+        auto testConfiguration = getTestConfiguration(j_request["config"].get<std::string>());
+        j_results["24_hr_test"] = hpwh->run24hrTest(testConfiguration, designation).report();
+    }
+    j_results["model"] = hpwh->name;
+    return j_results;
+}
+
+nlohmann::json Server::make(const nlohmann::json& j_request)
+{
+    auto hpwh = getSpec(j_request)->instantiate();
+    double targetEF = j_request.at("target_EF").get<double>();
+    auto testConfiguration = getTestConfiguration(j_request.value("config", "UEF"));
+    auto perfPolySet = (j_request.value("tier", 4) == 3) ? HPWH::tier3 : HPWH::tier4;
+
+    nlohmann::json j_results;
+    auto designation = HPWH::FirstHourRating::Designation::Medium;
+    if (!findDesignation(j_request, designation))
+    {
+        auto firstHourRating = hpwh->findFirstHourRating();
+        designation = firstHourRating.designation;
+        j_results["first_hour_rating"] = firstHourRating.report();
+    }
+
+    hpwh->makeGenericEF(targetEF, testConfiguration, designation, perfPolySet);
+    j_results["24_hr_test"] = hpwh->run24hrTest(testConfiguration, designation).report();
+    j_results["model"] = hpwh->name;
+
+    if (j_request.value("return_model", false))
+    {
+        hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+        hpwh->to(hsi);
+        hpwh_data_model::hpwh_sim_input::to_json(j_results["hpwh_sim_input"], hsi);
+    }
+    return j_results;
+}
+
+nlohmann::json Server::perfmap(const nlohmann::json& j_request)
+{
+    auto hpwh = getSpec(j_request)->instantiate();
+    if (!hpwh->hasACompressor())
+        throw std::runtime_error(fmt::format("Model {} has no compressor", hpwh->name));
+    auto compressor = hpwh->getCompressor();
+
+    auto makeRange = [](double min, double max, double step)
+    {
+        std::vector<double> values;
+        for (double value = min; value <= max + 1.e-9; value += step)
+            values.push_back(value);
+        return values;
+    };
+    auto externalTs_C = j_request.contains("externalT_C")
+                            ? j_request["externalT_C"].get<std::vector<double>>()
+                            : makeRange(-10., 40., 5.);
+    auto condenserTs_C = j_request.contains("condenserT_C")
+                             ? j_request["condenserT_C"].get<std::vector<double>>()
+                             : makeRange(10., 60., 5.);
+
+    // rows by external temperature
+    nlohmann::json j_inputPower_W = nlohmann::json::array();
+    nlohmann::json j_outputPower_W = nlohmann::json::array();
+    nlohmann::json j_cop = nlohmann::json::array();
+    for (auto externalT_C : externalTs_C)
+    {
+        std::vector<double> inputPower_W, outputPower_W, cop;
+        for (auto condenserT_C : condenserTs_C)
+        {
+            auto performance = compressor->getPerformance(externalT_C, condenserT_C);
+            inputPower_W.push_back(performance.inputPower_W);
+            outputPower_W.push_back(performance.outputPower_W);
+            cop.push_back(performance.cop);
+        }
+        j_inputPower_W.push_back(inputPower_W);
+        j_outputPower_W.push_back(outputPower_W);
+        j_cop.push_back(cop);
+    }
+    return {{"model", hpwh->name},
+            {"externalT_C", externalTs_C},
+            {"condenserT_C", condenserTs_C},
+            {"input_power_W", j_inputPower_W},
+            {"output_power_W", j_outputPower_W},
+            {"cop", j_cop}};
+}
+
+#ifndef _WIN32
+static void serveSocket(Server& server, const std::string& socketPath)
+{
+    int listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if ((listenFD < 0) || (socketPath.size() >= sizeof(address.sun_path)))
+    {
+        std::cerr << "Could not create socket " << socketPath << "\n";
+        exit(1);
+    }
+    socketPath.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if ((bind(listenFD, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) ||
+        (listen(listenFD, 16) != 0))
+    {
+        std::cerr << "Could not listen on socket " << socketPath << "\n";
+        exit(1);
+    }
+    std::cerr << "Listening on " << socketPath << "\n";
+
+    // one reader thread per connection; requests from all connections share the pool
+    while (true)
+    {
+        int fd = accept(listenFD, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        auto sink = std::make_shared<SocketSink>(fd);
+        std::thread(
+            [&server, sink]()
+            {
+                std::string buffer;
+                char chunk[4096];
+                ssize_t n;
+                while ((n = recv(sink->getFD(), chunk, sizeof(chunk), 0)) > 0)
+                {
+                    buffer.append(chunk, static_cast<std::size_t>(n));
+                    std::size_t start = 0, end;
+                    while ((end = buffer.find('\n', start)) != std::string::npos)
+                    {
+                        server.submit(buffer.substr(start, end - start), sink);
+                        start = end + 1;
+                    }
+                    buffer.erase(0, start);
+                }
+                server.submit(buffer, sink);
+            })
+            .detach();
+    }
+}
+#endif
+
+void serve(const std::string& socketPath, std::size_t cacheSize, unsigned nThreads)
+{
+    // replies own stdout; anything the library or schedule reader prints goes to stderr
+    std::ostream replyStream(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    Server server(cacheSize, nThreads);
+    if (!socketPath.empty())
+    {
+#ifndef _WIN32
+        serveSocket(server, socketPath);
+#else
+        std::cerr << "UNIX sockets are not available on this platform\n";
+        exit(1);
+#endif
+    }
+
+    auto sink = std::make_shared<StreamSink>(replyStream);
+    std::string line;
+    while (std::getline(std::cin, line))
+        server.submit(line, sink);
+    server.wait();
+    std::cout.rdbuf(replyStream.rdbuf());
+}
+
+} // namespace hpwh_cli
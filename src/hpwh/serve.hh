@@ -0,0 +1,198 @@
+/*
+ * Server for hpwh serve: requests, one JSON object per line, answered from cached models
+ */
+#ifndef HPWH_SERVE_hh
+#define HPWH_SERVE_hh
+
+#include "HPWH.hh"
+#include "HPWHFleet.hh"
+#include "HPWHModelSpec.hh"
+#include "HPWHParallel.hh"
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace hpwh_cli
+{
+
+///	@class LRUCache
+/// Thread-safe map of the most recently used values. A missing value is made outside the lock,
+/// so a slow make does not hold up requests for other keys; concurrent requests for the same
+/// key wait for the one value being made. A value whose make throws is not kept.
+template <typename Value>
+class LRUCache
+{
+  public:
+    explicit LRUCache(std::size_t capacity_in) : capacity(std::max<std::size_t>(capacity_in, 1))
+    {
+    }
+
+    template <typename Make>
+    Value get(const std::string& key, Make make)
+    {
+        std::promise<Value> promise;
+        std::shared_future<Value> value;
+        std::size_t serial = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = index.find(key);
+            if (found != index.end())
+            {
+                ++nHits;
+                entries.splice(entries.begin(), entries, found->second);
+                value = found->second->value;
+            }
+            else
+            {
+                serial = ++nMisses;
+                value = promise.get_future().share();
+                entries.push_front({key, value, serial});
+                index[key] = entries.begin();
+                if (entries.size() > capacity)
+                {
+                    index.erase(entries.back().key);
+                    entries.pop_back();
+                }
+            }
+        }
+
+        if (serial > 0)
+        {
+            try
+            {
+                promise.set_value(make());
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+                erase(key, serial);
+            }
+        }
+        return value.get();
+    }
+
+    nlohmann::json report()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nlohmann::json j = {{"capacity", capacity}, {"hits", nHits}, {"misses", nMisses}};
+        j["keys"] = nlohmann::json::array();
+        for (auto& entry : entries)
+            j["keys"].push_back(entry.key);
+        return j;
+    }
+
+  private:
+    ///	@struct Entry
+    struct Entry
+    {
+        std::string key;
+        std::shared_future<Value> value;
+        std::size_t serial; /**< distinguishes a remade value from an earlier one */
+    };
+
+    std::size_t capacity;
+    std::list<Entry> entries; /**< most recently used first */
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index;
+    std::size_t nHits = 0;
+    std::size_t nMisses = 0;
+    std::mutex mutex;
+
+    /// drop a failed value, unless it has since been evicted and remade
+    void erase(const std::string& key, std::size_t serial)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = index.find(key);
+        if ((found != index.end()) && (found->second->serial == serial))
+        {
+            entries.erase(found->second);
+            index.erase(found);
+        }
+    }
+};
+
+///	@class ReplySink
+/// destination of the replies to one client; each reply is written whole, as one line
+class ReplySink
+{
+  public:
+    virtual ~ReplySink() = default;
+
+    void send(const nlohmann::json& j_reply)
+    {
+        std::string line = j_reply.dump() + "\n";
+        std::lock_guard<std::mutex> lock(mutex);
+        write(line);
+    }
+
+  protected:
+    virtual void write(const std::string& line) = 0;
+
+  private:
+    std::mutex mutex;
+};
+
+class StreamSink : public ReplySink
+{
+  public:
+    explicit StreamSink(std::ostream& stream_in) : stream(stream_in) {}
+
+  protected:
+    void write(const std::string& line) override { stream << line << std::flush; }
+
+  private:
+    std::ostream& stream;
+};
+
+///	@class Server
+/// Decoded models and read schedules are cached between requests. Each request is a task on
+/// a shared pool; its reply is sent as soon as it finishes, tagged with the request "id", so
+/// replies may arrive out of order.
+class Server
+{
+  public:
+    Server(std::size_t cacheSize, unsigned nThreads)
+        : specs(cacheSize), schedules(cacheSize), pool(nThreads)
+    {
+    }
+
+    /// queue one request line; its reply goes to sink
+    void submit(const std::string& line, const std::shared_ptr<ReplySink>& sink);
+
+    void wait() { pool.wait(); }
+
+  private:
+    LRUCache<std::shared_ptr<const HPWH::ModelSpec>> specs;
+    LRUCache<std::shared_ptr<const HPWH::Fleet::Schedule>> schedules;
+    hpwh_parallel::ThreadPool pool;
+
+    nlohmann::json handle(const nlohmann::json& j_request);
+
+    /// the model of a request, as for a fleet manifest entry
+    std::shared_ptr<const HPWH::ModelSpec> getSpec(const nlohmann::json& j_request);
+
+    static HPWH::TestConfiguration getTestConfiguration(std::string sTestConfig);
+
+    /// compare draw-profile names in lowercase, without spaces
+    static bool findDesignation(const nlohmann::json& j_request,
+                                HPWH::FirstHourRating::Designation& designation);
+
+    /// simulate one unit, from a test directory or inline schedules
+    nlohmann::json run(const nlohmann::json& j_request);
+
+    /// 24-hr test in one configuration, or all three
+    nlohmann::json measure(const nlohmann::json& j_request);
+
+    /// fit a generic model to a target EF; the fitted model is not cached
+    nlohmann::json make(const nlohmann::json& j_request);
+
+    /// compressor performance over a grid of external and condenser temperatures
+    nlohmann::json perfmap(const nlohmann::json& j_request);
+};
+
+} // namespace hpwh_cli
+
+#endif
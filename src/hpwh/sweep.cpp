@@ -0,0 +1,168 @@
+/*
+ * Size a model by sweeping its tank volume, capacity, setpoint, and inlet height.
+ */
+#include "HPWH.hh"
+#include "HPWHSweep.hh"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <fmt/format.h>
+
+#include <CLI/CLI.hpp>
+
+namespace hpwh_cli
+{
+
+std::shared_ptr<const HPWH::Fleet::Schedule> readFleetSchedule(const std::string& testDir,
+                                                               long minutesToRun);
+std::shared_ptr<const HPWH::ModelSpec> makeModelSpec(const nlohmann::json& j_unit);
+
+/// sweep
+static void sweep(const nlohmann::json& j_model,
+                  const std::string& scheduleDir,
+                  long minutesToRun,
+                  const HPWH::Sweep::Axes& axes,
+                  double minOutletT_C,
+                  bool fullGrid,
+                  unsigned nThreads,
+                  const std::string& outputDir,
+                  const std::string& resultsName);
+
+CLI::App* add_sweep(CLI::App& app)
+{
+    const auto subcommand =
+        app.add_subcommand("sweep", "Find the smallest design that meets a delivery temperature");
+
+    //
+    static std::string specType = "Preset";
+    subcommand->add_option("-s,--spec", specType, "Specification type (Preset, JSON, Legacy)");
+
+    auto model_group = subcommand->add_option_group("Model options");
+
+    static std::string modelName = "";
+    model_group->add_option("-m,--model", modelName, "Model name");
+
+    static std::string modelFilepath = "";
+    model_group->add_option("-f,--filepath", modelFilepath, "Model filepath");
+
+    model_group->required(1);
+
+    //
+    static std::string scheduleDir = "";
+    subcommand->add_option("-t,--test", scheduleDir, "Directory of schedules")->required();
+
+    static long minutesToRun = 365 * 24 * 60;
+    subcommand->add_option("-l,--length", minutesToRun, "Minutes to run");
+
+    static double minOutletT_C = 0.;
+    subcommand->add_option("-o,--min-outlet", minOutletT_C, "Minimum outlet temperature (C)")
+        ->required();
+
+    static HPWH::Sweep::Axes axes;
+    subcommand->add_option("--volumes", axes.tankVolumes_L, "Tank volumes (L), ascending")
+        ->delimiter(',');
+    subcommand
+        ->add_option(
+            "--capacities", axes.capacityScales, "Compressor capacity scales, ascending")
+        ->delimiter(',');
+    subcommand->add_option("--setpoints", axes.setpoints_C, "Setpoints (C)")->delimiter(',');
+    subcommand
+        ->add_option("--inlets", axes.inletHeightFractions, "Inlet heights (fraction of tank)")
+        ->delimiter(',');
+
+    static bool fullGrid = false;
+    subcommand->add_flag("-g,--full-grid", fullGrid, "Evaluate every design, without bisection");
+
+    static unsigned nThreads = 0;
+    subcommand->add_option("-j,--threads", nThreads, "Number of threads (0: all cores)");
+
+    static std::string outputDir = ".";
+    subcommand->add_option("-d,--dir", outputDir, "Output directory");
+
+    static std::string resultsName = "sweep";
+    subcommand->add_option("-r,--results", resultsName, "Results filename");
+
+    subcommand->callback(
+        [&]()
+        {
+            nlohmann::json j_model = {
+                {"spec", specType}, {"model", modelName}, {"filepath", modelFilepath}};
+            sweep(j_model,
+                  scheduleDir,
+                  minutesToRun,
+                  axes,
+                  minOutletT_C,
+                  fullGrid,
+                  nThreads,
+                  outputDir,
+                  resultsName);
+        });
+
+    return subcommand;
+}
+
+static nlohmann::json report(const HPWH::Sweep::Evaluation& evaluation)
+{
+    nlohmann::json j_evaluation = {};
+    auto& design = evaluation.design;
+    j_evaluation["tank_volume_L"] = design.tankVolume_L;
+    j_evaluation["capacity_scale"] = design.capacityScale;
+    j_evaluation["setpoint_C"] = design.setpoint_C;
+    j_evaluation["inlet_height_fraction"] = design.inletHeightFraction;
+    j_evaluation["feasible"] = evaluation.feasible;
+    j_evaluation["passes"] = evaluation.passes;
+    j_evaluation["minutes_run"] = evaluation.minutesRun;
+    j_evaluation["min_outlet_T_C"] = evaluation.minOutletT_C;
+    j_evaluation["energy_input_kWh"] = evaluation.energyInput_kWh;
+    return j_evaluation;
+}
+
+void sweep(const nlohmann::json& j_model,
+           const std::string& scheduleDir,
+           long minutesToRun,
+           const HPWH::Sweep::Axes& axes,
+           double minOutletT_C,
+           bool fullGrid,
+           unsigned nThreads,
+           const std::string& outputDir,
+           const std::string& resultsName)
+{
+    auto spec = makeModelSpec(j_model);
+    auto schedule = readFleetSchedule(scheduleDir, minutesToRun);
+    HPWH::Sweep hpwhSweep(spec, schedule);
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto results = hpwhSweep.run(axes, minutesToRun, minOutletT_C, !fullGrid, nThreads);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::cout << fmt::format("Evaluated {} of {} designs in {:0.2f} s\n",
+                             results.evaluations.size(),
+                             results.gridSize,
+                             elapsed.count());
+
+    nlohmann::json j_results = {};
+    j_results["model"] = spec->getName();
+    j_results["min_outlet_T_C"] = minOutletT_C;
+    j_results["grid_size"] = results.gridSize;
+    if (results.hasBest)
+        j_results["best"] = report(results.best);
+    else
+        std::cout << "No design meets the minimum outlet temperature.\n";
+    j_results["frontier"] = nlohmann::json::array();
+    for (auto& evaluation : results.frontier)
+        j_results["frontier"].push_back(report(evaluation));
+    j_results["evaluations"] = nlohmann::json::array();
+    for (auto& evaluation : results.evaluations)
+        j_results["evaluations"].push_back(report(evaluation));
+
+    std::string fileToOpen = outputDir + "/" + resultsName + ".json";
+    std::ofstream resultsFile(fileToOpen);
+    if (!resultsFile.is_open())
+    {
+        std::cout << "Could not open output file " << fileToOpen << "\n";
+        exit(1);
+    }
+    resultsFile << j_results.dump(2);
+}
+
+} // namespace hpwh_cli
@@ -0,0 +1,261 @@
+/*
+ * Implementation of the C interface
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include "HPWH.hh"
+#include "hpwh_c.h"
+
+/// records messages instead of writing them; errors are still thrown. Copies of a model made
+/// while measuring share its courier, so messages are recorded under a lock.
+class RecordingCourier : public Courier::DefaultCourier
+{
+  public:
+    void setLastMessage(const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lastMessage = message;
+    }
+
+    std::string getLastMessage() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lastMessage;
+    }
+
+  protected:
+    void write_message(const std::string& message_type, const std::string& message) override
+    {
+        setLastMessage(fmt::format("[{}] {}", message_type, message));
+    }
+
+  private:
+    std::string lastMessage;
+    mutable std::mutex mutex;
+};
+
+struct hpwh_model
+{
+    std::shared_ptr<RecordingCourier> courier;
+    std::unique_ptr<HPWH> hpwh;
+    std::string lastReport; /**< of the most recent hpwh_measure */
+
+    /// copy returned by hpwh_last_message, which alone writes it
+    mutable std::string lastMessage;
+
+    hpwh_model()
+        : courier(std::make_shared<RecordingCourier>()), hpwh(std::make_unique<HPWH>(courier))
+    {
+    }
+};
+
+struct hpwh_state
+{
+    HPWH::State state;
+};
+
+/// run f, returning 0, or -1 if it throws or there is no model
+template <typename F>
+static int tryCall(const hpwh_model* model, F&& f)
+{
+    if (!model)
+        return -1;
+    try
+    {
+        f();
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        model->courier->setLastMessage(e.what());
+    }
+    catch (...)
+    {
+        // nothing may cross the C interface
+        model->courier->setLastMessage("Unknown error.");
+    }
+    return -1;
+}
+
+hpwh_model* hpwh_create(void)
+{
+    try
+    {
+        return new hpwh_model();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void hpwh_destroy(hpwh_model* model) { delete model; }
+
+const char* hpwh_last_message(const hpwh_model* model)
+{
+    if (!model)
+        return "No model.";
+    model->lastMessage = model->courier->getLastMessage();
+    return model->lastMessage.c_str();
+}
+
+int hpwh_init_preset(hpwh_model* model, const char* preset_name)
+{
+    return tryCall(model,
+                   [&]()
+                   {
+                       if (!preset_name)
+                           throw std::invalid_argument("No preset name.");
+                       model->hpwh->initPreset(preset_name);
+                   });
+}
+
+int hpwh_init_json(hpwh_model* model, const char* json, const char* model_name)
+{
+    return tryCall(model,
+                   [&]()
+                   {
+                       if (!json)
+                           throw std::invalid_argument("No JSON input.");
+                       model->hpwh->initFromJSON(nlohmann::json::parse(json),
+                                                 model_name ? model_name : "custom");
+                   });
+}
+
+int hpwh_get_num_nodes(const hpwh_model* model)
+{
+    return model ? model->hpwh->getNumNodes() : -1;
+}
+
+int hpwh_get_num_heat_sources(const hpwh_model* model)
+{
+    return model ? model->hpwh->getNumHeatSources() : -1;
+}
+
+/// run the steps of hpwh_run
+static void runSteps(HPWH& hpwh,
+                     size_t n_steps,
+                     const double* inlet_T_C,
+                     const double* draw_volume_L,
+                     const double* ambient_T_C,
+                     const double* external_T_C,
+                     const int* dr_status,
+                     double* energy_input_kWh,
+                     double* energy_output_kWh,
+                     double* outlet_T_C,
+                     double* tank_T_C)
+{
+    auto nHeatSources = static_cast<std::size_t>(hpwh.getNumHeatSources());
+    auto nNodes = static_cast<std::size_t>(hpwh.getNumNodes());
+    for (std::size_t i = 0; i < n_steps; ++i)
+    {
+        auto drStatus = dr_status ? static_cast<HPWH::DRMODES>(dr_status[i]) : HPWH::DR_ALLOW;
+        hpwh.runOneStep(inlet_T_C[i], draw_volume_L[i], ambient_T_C[i], external_T_C[i], drStatus);
+
+        for (std::size_t j = 0; j < nHeatSources; ++j)
+        {
+            if (energy_input_kWh)
+                energy_input_kWh[i * nHeatSources + j] =
+                    hpwh.getNthHeatSourceEnergyInput(static_cast<int>(j));
+            if (energy_output_kWh)
+                energy_output_kWh[i * nHeatSources + j] =
+                    hpwh.getNthHeatSourceEnergyOutput(static_cast<int>(j));
+        }
+        if (outlet_T_C)
+            outlet_T_C[i] = hpwh.getOutletTemp();
+        if (tank_T_C)
+            for (std::size_t j = 0; j < nNodes; ++j)
+                tank_T_C[i * nNodes + j] = hpwh.getTankNodeTemp(static_cast<int>(j));
+    }
+}
+
+int hpwh_run(hpwh_model* model,
+             size_t n_steps,
+             const double* inlet_T_C,
+             const double* draw_volume_L,
+             const double* ambient_T_C,
+             const double* external_T_C,
+             const int* dr_status,
+             double* energy_input_kWh,
+             double* energy_output_kWh,
+             double* outlet_T_C,
+             double* tank_T_C)
+{
+    return tryCall(model,
+                   [&]()
+                   {
+                       if (!inlet_T_C || !draw_volume_L || !ambient_T_C || !external_T_C)
+                           throw std::invalid_argument("Missing input schedule.");
+                       runSteps(*model->hpwh,
+                                n_steps,
+                                inlet_T_C,
+                                draw_volume_L,
+                                ambient_T_C,
+                                external_T_C,
+                                dr_status,
+                                energy_input_kWh,
+                                energy_output_kWh,
+                                outlet_T_C,
+                                tank_T_C);
+                   });
+}
+
+int hpwh_measure(hpwh_model* model,
+                 unsigned n_threads,
+                 char* buffer,
+                 size_t buffer_size,
+                 size_t* report_length)
+{
+    return tryCall(model,
+                   [&]()
+                   {
+                       model->lastReport.clear();
+                       model->lastReport = model->hpwh->measureAll(n_threads).report().dump();
+                       auto& report = model->lastReport;
+                       if (report_length)
+                           *report_length = report.size();
+                       if (buffer && (buffer_size > 0))
+                       {
+                           auto nCopied = std::min(report.size(), buffer_size - 1);
+                           std::memcpy(buffer, report.data(), nCopied);
+                           buffer[nCopied] = '\0';
+                       }
+                   });
+}
+
+const char* hpwh_last_report(const hpwh_model* model)
+{
+    return model ? model->lastReport.c_str() : "";
+}
+
+hpwh_state* hpwh_get_state(const hpwh_model* model)
+{
+    std::unique_ptr<hpwh_state> state;
+    if (tryCall(model,
+                [&]()
+                {
+                    state = std::make_unique<hpwh_state>();
+                    model->hpwh->getState(state->state);
+                }) != 0)
+        return nullptr;
+    return state.release();
+}
+
+int hpwh_set_state(hpwh_model* model, const hpwh_state* state)
+{
+    return tryCall(model,
+                   [&]()
+                   {
+                       if (!state)
+                           throw std::invalid_argument("No state.");
+                       model->hpwh->setState(state->state);
+                   });
+}
+
+void hpwh_destroy_state(hpwh_state* state) { delete state; }
@@ -0,0 +1,92 @@
+/*
+ * C interface to HPWHsim, for embedding (e.g., through Python ctypes)
+ */
+
+#ifndef HPWH_C_h
+#define HPWH_C_h
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define HPWH_C_API __declspec(dllexport)
+#else
+#define HPWH_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// opaque model instance
+    typedef struct hpwh_model hpwh_model;
+
+    /// opaque snapshot of the dynamic state of a model
+    typedef struct hpwh_state hpwh_state;
+
+    /// Functions returning int give 0 on success and -1 on error, including a NULL model; the
+    /// message of the most recent error or warning is then available from hpwh_last_message. A
+    /// model must not be used from more than one thread at a time; distinct models may run
+    /// concurrently.
+
+    /// NULL if the model cannot be created
+    HPWH_C_API hpwh_model* hpwh_create(void);
+
+    HPWH_C_API void hpwh_destroy(hpwh_model* model);
+
+    /// valid until the next call of hpwh_last_message or hpwh_destroy on the same model
+    HPWH_C_API const char* hpwh_last_message(const hpwh_model* model);
+
+    HPWH_C_API int hpwh_init_preset(hpwh_model* model, const char* preset_name);
+
+    /// json: HPWHSimInput document
+    HPWH_C_API int hpwh_init_json(hpwh_model* model, const char* json, const char* model_name);
+
+    /// -1 for a NULL model
+    HPWH_C_API int hpwh_get_num_nodes(const hpwh_model* model);
+
+    /// -1 for a NULL model
+    HPWH_C_API int hpwh_get_num_heat_sources(const hpwh_model* model);
+
+    /// Run n_steps one-minute steps. Inputs are arrays of length n_steps; dr_status may be NULL
+    /// (DR_ALLOW). Any output array may be NULL: energy_input_kWh and energy_output_kWh have
+    /// n_steps * (number of heat sources) values, row-major by step; outlet_T_C has n_steps;
+    /// tank_T_C has n_steps * (number of nodes), row-major by step, bottom node first.
+    HPWH_C_API int hpwh_run(hpwh_model* model,
+                            size_t n_steps,
+                            const double* inlet_T_C,
+                            const double* draw_volume_L,
+                            const double* ambient_T_C,
+                            const double* external_T_C,
+                            const int* dr_status,
+                            double* energy_input_kWh,
+                            double* energy_output_kWh,
+                            double* outlet_T_C,
+                            double* tank_T_C);
+
+    /// Measure the first-hour rating and the E50, UEF, and E95 24-hr tests, as JSON. Up to
+    /// buffer_size - 1 characters and a terminating null are written to buffer (which may be
+    /// NULL if buffer_size is 0); report_length receives the full length of the report.
+    HPWH_C_API int hpwh_measure(hpwh_model* model,
+                                unsigned n_threads,
+                                char* buffer,
+                                size_t buffer_size,
+                                size_t* report_length);
+
+    /// the whole report of the most recent hpwh_measure, valid until the next call of
+    /// hpwh_measure or hpwh_destroy; empty if there is none
+    HPWH_C_API const char* hpwh_last_report(const hpwh_model* model);
+
+    /// snapshot the dynamic state; NULL on error
+    HPWH_C_API hpwh_state* hpwh_get_state(const hpwh_model* model);
+
+    /// restore a snapshot taken from this or an identically configured model
+    HPWH_C_API int hpwh_set_state(hpwh_model* model, const hpwh_state* state);
+
+    HPWH_C_API void hpwh_destroy_state(hpwh_state* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
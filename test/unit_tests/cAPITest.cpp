@@ -0,0 +1,132 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "hpwh_c.h"
+#include "unit-test.hh"
+
+#include <cstring>
+
+/*
+ * create, run, measure, and destroy a model through the C interface
+ */
+TEST(CAPITest, lifecycle)
+{
+    hpwh_model* model = hpwh_create();
+    ASSERT_NE(model, nullptr);
+    ASSERT_EQ(hpwh_init_preset(model, "AOSmithHPTS50"), 0) << hpwh_last_message(model);
+
+    const int nHeatSources = hpwh_get_num_heat_sources(model);
+    const int nNodes = hpwh_get_num_nodes(model);
+    ASSERT_GT(nHeatSources, 0);
+    ASSERT_GT(nNodes, 0);
+
+    const std::size_t nSteps = 60;
+    std::vector<double> inletT_C(nSteps, F_TO_C(50.)), ambientT_C(nSteps, F_TO_C(67.5));
+    std::vector<double> drawVolume_L(nSteps, 0.);
+    for (std::size_t i = 0; i < 10; ++i)
+        drawVolume_L[i] = GAL_TO_L(2.);
+    std::vector<double> energyInput_kWh(nSteps * nHeatSources);
+    std::vector<double> outletT_C(nSteps), tankT_C(nSteps * nNodes);
+
+    auto state = hpwh_get_state(model);
+    ASSERT_NE(state, nullptr);
+    ASSERT_EQ(hpwh_run(model,
+                       nSteps,
+                       inletT_C.data(),
+                       drawVolume_L.data(),
+                       ambientT_C.data(),
+                       ambientT_C.data(),
+                       nullptr,
+                       energyInput_kWh.data(),
+                       nullptr,
+                       outletT_C.data(),
+                       tankT_C.data()),
+              0)
+        << hpwh_last_message(model);
+
+    double totalInput_kWh = 0.;
+    for (auto input_kWh : energyInput_kWh)
+        totalInput_kWh += input_kWh;
+    EXPECT_GT(totalInput_kWh, 0.);
+    EXPECT_GT(outletT_C.front(), inletT_C.front());
+
+    // rerun from the snapshot
+    std::vector<double> rerunTankT_C(nSteps * nNodes);
+    ASSERT_EQ(hpwh_set_state(model, state), 0);
+    ASSERT_EQ(hpwh_run(model,
+                       nSteps,
+                       inletT_C.data(),
+                       drawVolume_L.data(),
+                       ambientT_C.data(),
+                       ambientT_C.data(),
+                       nullptr,
+                       nullptr,
+                       nullptr,
+                       nullptr,
+                       rerunTankT_C.data()),
+              0);
+    EXPECT_EQ(rerunTankT_C, tankT_C);
+    hpwh_destroy_state(state);
+
+    // a short buffer gets the start of the report; the whole report is kept
+    char buffer[8];
+    std::size_t reportLength = 0;
+    ASSERT_EQ(hpwh_measure(model, 2, buffer, sizeof(buffer), &reportLength), 0)
+        << hpwh_last_message(model);
+    const std::string report = hpwh_last_report(model);
+    EXPECT_EQ(report.size(), reportLength);
+    EXPECT_EQ(std::strlen(buffer), sizeof(buffer) - 1);
+    EXPECT_EQ(report.compare(0, sizeof(buffer) - 1, buffer), 0);
+    auto j_report = nlohmann::json::parse(report);
+    EXPECT_TRUE(j_report.contains("first_hour_rating"));
+    EXPECT_TRUE(j_report["24_hr_tests"].contains("UEF"));
+
+    hpwh_destroy(model);
+}
+
+TEST(CAPITest, errors)
+{
+    hpwh_model* model = hpwh_create();
+    EXPECT_EQ(hpwh_init_preset(model, "NotAModel"), -1);
+    EXPECT_STRNE(hpwh_last_message(model), "");
+    EXPECT_EQ(hpwh_init_preset(model, nullptr), -1);
+    EXPECT_EQ(hpwh_init_json(model, "{\"integrated_system\": ", "broken"), -1);
+    EXPECT_STRNE(hpwh_last_message(model), "");
+
+    ASSERT_EQ(hpwh_init_preset(model, "restankRealistic"), 0);
+    double value = 0.;
+    auto runOneStep = [&value](hpwh_model* runModel, const double* inletT_C)
+    {
+        return hpwh_run(runModel,
+                        1,
+                        inletT_C,
+                        &value,
+                        &value,
+                        &value,
+                        nullptr,
+                        nullptr,
+                        nullptr,
+                        nullptr,
+                        nullptr);
+    };
+    EXPECT_EQ(runOneStep(model, nullptr), -1);
+    EXPECT_EQ(hpwh_set_state(model, nullptr), -1);
+    EXPECT_STREQ(hpwh_last_report(model), "");
+    hpwh_destroy(model);
+
+    // a NULL model is an error, not a crash
+    EXPECT_EQ(hpwh_init_preset(nullptr, "AOSmithHPTS50"), -1);
+    EXPECT_EQ(hpwh_init_json(nullptr, "{}", "custom"), -1);
+    EXPECT_EQ(hpwh_get_num_nodes(nullptr), -1);
+    EXPECT_EQ(hpwh_get_num_heat_sources(nullptr), -1);
+    EXPECT_EQ(runOneStep(nullptr, &value), -1);
+    EXPECT_EQ(hpwh_measure(nullptr, 1, nullptr, 0, nullptr), -1);
+    EXPECT_EQ(hpwh_get_state(nullptr), nullptr);
+    EXPECT_EQ(hpwh_set_state(nullptr, nullptr), -1);
+    EXPECT_STRNE(hpwh_last_message(nullptr), "");
+    EXPECT_STREQ(hpwh_last_report(nullptr), "");
+    hpwh_destroy(nullptr);
+    hpwh_destroy_state(nullptr);
+}
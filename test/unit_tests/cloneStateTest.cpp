@@ -0,0 +1,207 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHHeatSource.hh"
+#include "HPWHModelSpec.hh"
+#include "Tank.hh"
+#include "unit-test.hh"
+
+#include <fstream>
+
+namespace
+{
+/// run a short, repeatable draw sequence
+void runSequence(HPWH& hpwh, int nSteps)
+{
+    const double inletT_C = F_TO_C(50.);
+    const double ambientT_C = F_TO_C(67.5);
+    for (int i = 0; i < nSteps; ++i)
+    {
+        double drawVolume_L = (i % 30 < 5) ? GAL_TO_L(1.5) : 0.;
+        hpwh.runOneStep(inletT_C, drawVolume_L, ambientT_C, ambientT_C, HPWH::DR_ALLOW);
+    }
+}
+
+void expectSameTank(HPWH& hpwh1, HPWH& hpwh2)
+{
+    std::vector<double> tankTs1_C, tankTs2_C;
+    hpwh1.getTankTemps(tankTs1_C);
+    hpwh2.getTankTemps(tankTs2_C);
+    ASSERT_EQ(tankTs1_C.size(), tankTs2_C.size());
+    for (std::size_t i = 0; i < tankTs1_C.size(); ++i)
+        EXPECT_EQ(tankTs1_C[i], tankTs2_C[i]);
+}
+} // namespace
+
+/*
+ * clone tests
+ */
+TEST(CloneStateTest, cloneIsIndependent)
+{
+    for (const std::string modelName :
+         {"AOSmithHPTS50", "Sanco83", "ColmacCxV_5_SP", "restankRealistic"})
+    {
+        HPWH hpwh;
+        hpwh.initPreset(modelName);
+        runSequence(hpwh, 60);
+
+        auto copy = hpwh.clone();
+        expectSameTank(hpwh, *copy);
+
+        runSequence(hpwh, 120);
+        runSequence(*copy, 120);
+        expectSameTank(hpwh, *copy);
+        for (int iHeatSource = 0; iHeatSource < hpwh.getNumHeatSources(); ++iHeatSource)
+            EXPECT_EQ(hpwh.getNthHeatSourceEnergyInput(iHeatSource),
+                      copy->getNthHeatSourceEnergyInput(iHeatSource))
+                << modelName;
+
+        // changes to the copy must not reach the original
+        const double setpointT_C = hpwh.getSetpoint();
+        double maxAllowedSetpointT_C;
+        std::string why;
+        if (copy->isNewSetpointPossible(setpointT_C - 5., maxAllowedSetpointT_C, why))
+        {
+            copy->setSetpoint(setpointT_C - 5.);
+            EXPECT_EQ(hpwh.getSetpoint(), setpointT_C) << modelName;
+        }
+    }
+}
+
+TEST(CloneStateTest, cloneOutlivesOriginal)
+{
+    std::unique_ptr<HPWH> copy;
+    HPWH reference;
+    {
+        HPWH hpwh;
+        hpwh.initPreset("AOSmithHPTS50");
+        reference.initPreset("AOSmithHPTS50");
+        copy = hpwh.clone();
+    }
+    runSequence(reference, 240);
+    runSequence(*copy, 240);
+    expectSameTank(reference, *copy);
+}
+
+/*
+ * state snapshot tests
+ */
+TEST(CloneStateTest, restoreState)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTU80_DR");
+    runSequence(hpwh, 90);
+
+    HPWH::State state = hpwh.getState();
+    runSequence(hpwh, 180);
+    std::vector<double> tankTs_C;
+    hpwh.getTankTemps(tankTs_C);
+
+    hpwh.setState(state);
+    runSequence(hpwh, 180);
+    std::vector<double> rerunTankTs_C;
+    hpwh.getTankTemps(rerunTankTs_C);
+    ASSERT_EQ(tankTs_C.size(), rerunTankTs_C.size());
+    for (std::size_t i = 0; i < tankTs_C.size(); ++i)
+        EXPECT_EQ(tankTs_C[i], rerunTankTs_C[i]);
+}
+
+TEST(CloneStateTest, stateTransfersBetweenInstances)
+{
+    HPWH hpwh1, hpwh2;
+    hpwh1.initPreset("AOSmithHPTS50");
+    hpwh2.initPreset("AOSmithHPTS50");
+    runSequence(hpwh1, 90);
+
+    hpwh2.setState(hpwh1.getState());
+    expectSameTank(hpwh1, hpwh2);
+
+    HPWH other;
+    other.initPreset("restankRealistic");
+    EXPECT_ANY_THROW(other.setState(hpwh1.getState()));
+}
+
+/*
+ * shared model-specification tests
+ */
+TEST(CloneStateTest, instantiateFromModelSpec)
+{
+    auto spec = HPWH::ModelSpec::fromPreset("AOSmithHPTS50");
+    EXPECT_EQ(spec->getName(), "AOSmithHPTS50");
+
+    HPWH reference;
+    reference.initPreset("AOSmithHPTS50");
+    runSequence(reference, 90);
+
+    // units are held as states and run on a single working instance
+    std::vector<HPWH::State> units(4, spec->getInitialState());
+    auto hpwh = spec->instantiate();
+    for (auto& state : units)
+    {
+        hpwh->setState(state);
+        runSequence(*hpwh, 90);
+        hpwh->getState(state);
+    }
+    for (auto& state : units)
+    {
+        auto unit = spec->instantiate(state);
+        expectSameTank(reference, *unit);
+
+        std::size_t stateSize = sizeof(HPWH::State) + sizeof(double) * state.tankTs_C.size() +
+                                state.heatSourceFlags.size();
+        EXPECT_LT(stateSize, 2048);
+    }
+}
+
+/*
+ * preset cache tests
+ */
+namespace
+{
+/// any courier other than the default is configured from the cached input, not the prototype
+class TestCourier : public HPWH::DefaultCourier
+{
+};
+} // namespace
+
+TEST(CloneStateTest, cachedPresetsMatch)
+{
+    for (const std::string modelName : {"AOSmithHPTS50", "Sanco83", "ColmacCxV_5_SP"})
+    {
+        // configured from the model file, bypassing the preset cache
+        HPWH reference;
+        std::ifstream inputFile(fmt::format("{}/{}.json", HPWH_MODELS_JSON_DIR, modelName));
+        ASSERT_TRUE(inputFile.is_open()) << modelName;
+        reference.initFromJSON(nlohmann::json::parse(inputFile), modelName);
+
+        // the first copies the prototype as it is configured; the next from the cache
+        HPWH::clearPresetCache();
+        auto courier = std::make_shared<HPWH::DefaultCourier>();
+        HPWH cold, warm(courier, "warm"), configured(std::make_shared<TestCourier>());
+        cold.initPreset(modelName);
+        warm.initPreset(modelName);
+        configured.initPreset(modelName);
+        EXPECT_EQ(warm.name, modelName);
+        EXPECT_EQ(configured.name, modelName);
+
+        // the copy keeps this instance's courier, for the tank and heat sources too
+        EXPECT_EQ(warm.get_courier(), courier);
+        EXPECT_EQ(warm.tank->get_courier(), courier);
+        for (auto& heatSource : warm.heatSources)
+            EXPECT_EQ(heatSource->get_courier(), courier) << modelName;
+
+        runSequence(reference, 240);
+        for (HPWH* hpwh : {&cold, &warm, &configured})
+        {
+            runSequence(*hpwh, 240);
+            expectSameTank(reference, *hpwh);
+            ASSERT_EQ(hpwh->getNumHeatSources(), reference.getNumHeatSources()) << modelName;
+            for (int iHeatSource = 0; iHeatSource < reference.getNumHeatSources(); ++iHeatSource)
+                EXPECT_EQ(hpwh->getNthHeatSourceEnergyInput(iHeatSource),
+                          reference.getNthHeatSourceEnergyInput(iHeatSource))
+                    << modelName;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHCSVSink.hh"
+#include "unit-test.hh"
+
+#include <sstream>
+
+namespace
+{
+/// a step of restankRealistic with known values
+HPWH::TestData makeTestData(double time_min, double drawVolume_L)
+{
+    HPWH::TestData testData;
+    testData.time_min = time_min;
+    testData.ambientT_C = 19.5;
+    testData.setpointT_C = 51.7;
+    testData.inletT_C = 10.25;
+    testData.drawVolume_L = drawVolume_L;
+    testData.h_srcIn_kWh = {0.0015, 0.};
+    testData.h_srcOut_kWh = {0.0014, 0.};
+    testData.thermocoupleT_C = {50., 49.5, 48.3, 45., 30., 20.04};
+    testData.outletT_C = 50.5;
+    return testData;
+}
+
+// the layout written by the stream overloads before the sink was added
+const std::string heading = "minutes,Ta,Tsetpoint,inletT,draw,DRstatus,"
+                            "h_src1In (Wh),h_src1Out (Wh),h_src2In (Wh),h_src2Out (Wh),"
+                            "tcouple1 (C),tcouple2 (C),tcouple3 (C),tcouple4 (C),tcouple5 (C),"
+                            "tcouple6 (C),toutlet (C)\n";
+const std::string drawRow = "7, 19.500000, 51.700000, 10.250000, 1.500000, 0,1.50,1.40,0.00,0.00,"
+                            "50.00,49.50,48.30,45.00,30.00,20.04,50.50\n";
+const std::string noDrawRow = "8, 19.500000, 51.700000,,, 0,1.50,1.40,0.00,0.00,"
+                              "50.00,49.50,48.30,45.00,30.00,20.04,\n";
+} // namespace
+
+/*
+ * rows match the baseline layout byte for byte
+ */
+TEST(CSVSinkTest, rowLayout)
+{
+    HPWH hpwh;
+    hpwh.initPreset("restankRealistic");
+
+    std::ostringstream out;
+    auto testData = makeTestData(7., GAL_TO_L(1.5));
+    hpwh.writeCSVHeading(&out);
+    hpwh.writeCSVRow(&out, testData);
+    testData = makeTestData(8., 0.);
+    hpwh.writeCSVRow(&out, testData);
+    EXPECT_EQ(out.str(), heading + drawRow + noDrawRow);
+
+    // thermocouple and outlet temperatures in IP units
+    std::ostringstream ip;
+    testData = makeTestData(7., GAL_TO_L(1.5));
+    hpwh.writeCSVRow(&ip, testData, HPWH::CSVOPT_IPUNITS);
+    EXPECT_EQ(ip.str(),
+              "7, 19.500000, 51.700000, 10.250000, 1.500000, 0,1.50,1.40,0.00,0.00,"
+              "122.00,121.10,118.94,113.00,86.00,68.07,122.90\n");
+}
+
+/*
+ * a threaded sink with many small buffers keeps the rows whole and in order
+ */
+TEST(CSVSinkTest, threadedLayout)
+{
+    HPWH hpwh;
+    hpwh.initPreset("restankRealistic");
+
+    const int nPairs = 200;
+    std::ostringstream out;
+    {
+        HPWH::CSVSink sink(out, true, 256);
+        hpwh.writeCSVHeading(sink);
+        for (int i = 0; i < nPairs; ++i)
+        {
+            hpwh.writeCSVRow(sink, makeTestData(7., GAL_TO_L(1.5)));
+            hpwh.writeCSVRow(sink, makeTestData(8., 0.));
+        }
+        sink.close();
+    }
+
+    std::string expected = heading;
+    for (int i = 0; i < nPairs; ++i)
+        expected += drawRow + noDrawRow;
+    EXPECT_EQ(out.str(), expected);
+}
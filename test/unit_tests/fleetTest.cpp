@@ -0,0 +1,133 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHFleet.hh"
+#include "unit-test.hh"
+
+struct FleetTest : public testing::Test
+{
+    std::shared_ptr<HPWH::Fleet::Schedule> schedule;
+    const long minutesToRun = 6 * 60;
+
+    void SetUp() override
+    {
+        schedule = std::make_shared<HPWH::Fleet::Schedule>();
+        for (long i = 0; i < minutesToRun; ++i)
+        {
+            schedule->inletT_C.push_back(F_TO_C(50.));
+            schedule->drawVolume_L.push_back((i % 60 < 8) ? GAL_TO_L(1.5) : 0.);
+            schedule->ambientT_C.push_back(F_TO_C(67.5));
+            schedule->externalT_C.push_back(F_TO_C(67.5));
+        }
+    }
+
+    HPWH::Fleet makeFleet()
+    {
+        auto spec1 = HPWH::ModelSpec::fromPreset("AOSmithHPTS50");
+        auto spec2 = HPWH::ModelSpec::fromPreset("restankRealistic");
+
+        HPWH::Fleet fleet;
+        for (int i = 0; i < 6; ++i)
+        {
+            HPWH::Fleet::Unit unit;
+            unit.name = fmt::format("unit{}", i);
+            unit.spec = (i % 2 == 0) ? spec1 : spec2;
+            unit.schedule = schedule;
+            unit.drawScale = 0.5 + 0.25 * i;
+            fleet.addUnit(unit);
+        }
+        return fleet;
+    }
+};
+
+TEST_F(FleetTest, matchesIndividualRuns)
+{
+    auto fleet = makeFleet();
+    auto results = fleet.run(minutesToRun, 60., 3);
+    ASSERT_EQ(results.units.size(), fleet.getNumUnits());
+    ASSERT_EQ(results.load_kWh.size(), 6u);
+
+    double totalInput_kWh = 0.;
+    for (std::size_t iUnit = 0; iUnit < fleet.getNumUnits(); ++iUnit)
+    {
+        auto& unit = fleet.getUnits()[iUnit];
+        auto hpwh = unit.spec->instantiate();
+        double energyInput_kWh = 0.;
+        for (long i = 0; i < minutesToRun; ++i)
+        {
+            hpwh->runOneStep(schedule->inletT_C[i],
+                             unit.drawScale * schedule->drawVolume_L[i],
+                             schedule->ambientT_C[i],
+                             schedule->externalT_C[i],
+                             HPWH::DR_ALLOW);
+            // summed per step, as the fleet does, so the totals match exactly
+            double stepInput_kWh = 0.;
+            for (int iHeatSource = 0; iHeatSource < hpwh->getNumHeatSources(); ++iHeatSource)
+                stepInput_kWh += hpwh->getNthHeatSourceEnergyInput(iHeatSource);
+            energyInput_kWh += stepInput_kWh;
+        }
+        EXPECT_EQ(results.units[iUnit].name, unit.name);
+        EXPECT_EQ(results.units[iUnit].energyInput_kWh, energyInput_kWh);
+        totalInput_kWh += energyInput_kWh;
+    }
+
+    double totalLoad_kWh = 0.;
+    for (auto& load_kWh : results.load_kWh)
+        totalLoad_kWh += load_kWh;
+    EXPECT_NEAR_REL(totalLoad_kWh, totalInput_kWh);
+}
+
+TEST_F(FleetTest, threadCountDoesNotChangeUnits)
+{
+    auto fleet = makeFleet();
+    auto serialResults = fleet.run(minutesToRun, 30., 1);
+    auto parallelResults = fleet.run(minutesToRun, 30., 4);
+    for (std::size_t iUnit = 0; iUnit < fleet.getNumUnits(); ++iUnit)
+    {
+        EXPECT_EQ(serialResults.units[iUnit].energyInput_kWh,
+                  parallelResults.units[iUnit].energyInput_kWh);
+        EXPECT_EQ(serialResults.units[iUnit].minOutletT_C,
+                  parallelResults.units[iUnit].minOutletT_C);
+    }
+    for (std::size_t iInterval = 0; iInterval < serialResults.load_kWh.size(); ++iInterval)
+        EXPECT_NEAR_REL(serialResults.load_kWh[iInterval], parallelResults.load_kWh[iInterval]);
+}
+
+TEST_F(FleetTest, scheduleTooShort)
+{
+    auto fleet = makeFleet();
+    EXPECT_ANY_THROW(fleet.run(minutesToRun + 1));
+}
+
+TEST_F(FleetTest, loadShapeMatchesRun)
+{
+    auto fleet = makeFleet();
+    auto results = fleet.run(minutesToRun, 60., 2);
+    auto loadShape = fleet.runLoadShape(minutesToRun, 60., 3, 0.01, 4);
+    EXPECT_EQ(loadShape.nUnits, fleet.getNumUnits());
+    ASSERT_EQ(loadShape.intervals.size(), results.load_kWh.size());
+    for (std::size_t iInterval = 0; iInterval < loadShape.intervals.size(); ++iInterval)
+    {
+        auto& intervalLoad = loadShape.intervals[iInterval];
+        EXPECT_NEAR_REL(intervalLoad.energyInput_kWh, results.load_kWh[iInterval]);
+        auto& sketch = intervalLoad.unitInput_kWh;
+        EXPECT_EQ(sketch.getCount(), fleet.getNumUnits());
+        EXPECT_LE(sketch.getQuantile(0.5), sketch.getMax());
+        EXPECT_GE(sketch.getQuantile(0.5), sketch.getMin());
+    }
+}
+
+TEST(QuantileSketchTest, relativeAccuracy)
+{
+    HPWH::Fleet::QuantileSketch sketch1(0.01), sketch2(0.01);
+    for (int i = 1; i <= 1000; ++i)
+        ((i % 2 == 0) ? sketch1 : sketch2).add(0.001 * i);
+    sketch1.merge(sketch2);
+    EXPECT_EQ(sketch1.getCount(), 1000u);
+    EXPECT_EQ(sketch1.getMin(), 0.001);
+    EXPECT_EQ(sketch1.getMax(), 1.);
+    EXPECT_NEAR(sketch1.getQuantile(0.5), 0.5, 0.01 * 0.5);
+    EXPECT_NEAR(sketch1.getQuantile(0.9), 0.9, 0.01 * 0.9);
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "unit-test.hh"
+
+struct ForecastTest : public testing::Test
+{
+    HPWH::ForecastSchedule schedule;
+
+    void SetUp() override
+    {
+        // three hours, with a large draw at the start of each hour
+        for (int i = 0; i < 180; ++i)
+        {
+            double drawVolume_L = (i % 60 < 10) ? GAL_TO_L(2.) : 0.;
+            schedule.push_back({F_TO_C(50.), drawVolume_L, F_TO_C(67.5), F_TO_C(67.5)});
+        }
+    }
+};
+
+TEST_F(ForecastTest, liveInstanceUnchanged)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+    for (int i = 0; i < 30; ++i)
+        hpwh.runOneStep(F_TO_C(50.), GAL_TO_L(1.), F_TO_C(67.5), F_TO_C(67.5), HPWH::DR_ALLOW);
+
+    auto before = hpwh.getState();
+    hpwh.forecast(180., schedule, {{HPWH::DR_ALLOW}, {HPWH::DR_LOC | HPWH::DR_LOR}});
+    auto after = hpwh.getState();
+
+    EXPECT_EQ(before.tankTs_C, after.tankTs_C);
+    EXPECT_EQ(before.heatSourceFlags, after.heatSourceFlags);
+    EXPECT_EQ(before.timerTOT, after.timerTOT);
+}
+
+TEST_F(ForecastTest, matchesSerialRun)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+
+    std::vector<HPWH::DRCandidate> candidates = {{HPWH::DR_ALLOW},
+                                                 {HPWH::DR_LOC},
+                                                 {HPWH::DR_LOR},
+                                                 {HPWH::DR_LOC | HPWH::DR_LOR},
+                                                 {HPWH::DR_TOT, 30.}};
+    auto summaries = hpwh.forecast(180., schedule, candidates);
+    auto serialSummaries = hpwh.forecast(180., schedule, candidates, 43.333, 1);
+    ASSERT_EQ(summaries.size(), candidates.size());
+    for (std::size_t i = 0; i < summaries.size(); ++i)
+    {
+        EXPECT_EQ(summaries[i].energyInput_kWh, serialSummaries[i].energyInput_kWh);
+        EXPECT_EQ(summaries[i].shortfallEnergy_kWh, serialSummaries[i].shortfallEnergy_kWh);
+        EXPECT_EQ(summaries[i].finalState.tankTs_C, serialSummaries[i].finalState.tankTs_C);
+    }
+
+    // replay the unrestricted candidate directly
+    auto copy = hpwh.clone();
+    double energyInput_kWh = 0.;
+    for (auto& step : schedule)
+    {
+        copy->runOneStep(
+            step.inletT_C, step.drawVolume_L, step.ambientT_C, step.externalT_C, HPWH::DR_ALLOW);
+        for (int iHeatSource = 0; iHeatSource < copy->getNumHeatSources(); ++iHeatSource)
+            energyInput_kWh += copy->getNthHeatSourceEnergyInput(iHeatSource);
+    }
+    EXPECT_NEAR_REL(summaries[0].energyInput_kWh, energyInput_kWh);
+
+    // locking out all heat sources uses less energy and delivers colder water
+    EXPECT_LT(summaries[3].energyInput_kWh, summaries[0].energyInput_kWh);
+    EXPECT_GE(summaries[3].shortfallEnergy_kWh, summaries[0].shortfallEnergy_kWh);
+    EXPECT_LE(summaries[3].minOutletT_C, summaries[0].minOutletT_C);
+}
+
+TEST_F(ForecastTest, shortSchedule)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+    EXPECT_ANY_THROW(hpwh.forecast(240., schedule, {{HPWH::DR_ALLOW}}));
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+#include <sstream>
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHJSONLoader.hh"
+#include "unit-test.hh"
+
+namespace
+{
+/// a preset, written as hpwh-data-model JSON
+std::string getModelJSON(const std::string& modelName)
+{
+    HPWH hpwh;
+    hpwh.initPreset(modelName);
+    hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+    hpwh.to(hsi);
+
+    nlohmann::json j;
+    hpwh_data_model::hpwh_sim_input::to_json(j, hsi);
+    return j.dump();
+}
+
+void runSequence(HPWH& hpwh, int nSteps)
+{
+    const double inletT_C = F_TO_C(50.);
+    const double ambientT_C = F_TO_C(67.5);
+    for (int i = 0; i < nSteps; ++i)
+    {
+        double drawVolume_L = (i % 30 < 5) ? GAL_TO_L(1.5) : 0.;
+        hpwh.runOneStep(inletT_C, drawVolume_L, ambientT_C, ambientT_C, HPWH::DR_ALLOW);
+    }
+}
+} // namespace
+
+/*
+ * streamed and tree JSON input give the same model
+ */
+TEST(JSONLoaderTest, streamMatchesTree)
+{
+    for (const std::string modelName : {"AOSmithHPTS50", "ColmacCxV_5_SP", "restankRealistic"})
+    {
+        const std::string text = getModelJSON(modelName);
+
+        HPWH tree;
+        tree.initFromJSON(nlohmann::json::parse(text), modelName);
+
+        HPWH streamed;
+        std::istringstream is(text);
+        streamed.initFromJSON(is, modelName);
+
+        EXPECT_EQ(streamed.getNumHeatSources(), tree.getNumHeatSources()) << modelName;
+        EXPECT_EQ(streamed.getTankSize(), tree.getTankSize()) << modelName;
+
+        runSequence(tree, 240);
+        runSequence(streamed, 240);
+        std::vector<double> treeTs_C, streamedTs_C;
+        tree.getTankTemps(treeTs_C);
+        streamed.getTankTemps(streamedTs_C);
+        EXPECT_EQ(streamedTs_C, treeTs_C) << modelName;
+        for (int iHeatSource = 0; iHeatSource < tree.getNumHeatSources(); ++iHeatSource)
+            EXPECT_EQ(streamed.getNthHeatSourceEnergyInput(iHeatSource),
+                      tree.getNthHeatSourceEnergyInput(iHeatSource))
+                << modelName;
+    }
+}
+
+/*
+ * performance maps are read outside the JSON tree
+ */
+TEST(JSONLoaderTest, mapsBypassTree)
+{
+    HPWH::JSONLoader loader;
+    hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+
+    std::istringstream is(getModelJSON("ColmacCxV_5_SP"));
+    loader.load(is, hsi);
+    EXPECT_GT(loader.getNumMapValues(), 0u);
+
+    std::istringstream noMaps(getModelJSON("restankRealistic"));
+    loader.load(noMaps, hsi);
+    EXPECT_EQ(loader.getNumMapValues(), 0u);
+
+    std::istringstream truncated(getModelJSON("AOSmithHPTS50").substr(0, 100));
+    EXPECT_ANY_THROW(loader.load(truncated, hsi));
+}
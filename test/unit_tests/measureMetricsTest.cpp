@@ -101,7 +101,9 @@ TEST_F(MeasureMetricsTest, MakeGenericTier4_UEF)
         << "Could not complete first-hour rating sequence.";
 
     constexpr double UEF = 4.3;
-    EXPECT_NO_THROW(hpwh.makeGenericUEF(UEF, firstHourRating.designation, HPWH::tier4))
+    HPWH::TestSummary fitSummary;
+    EXPECT_NO_THROW(fitSummary =
+                        hpwh.makeGenericUEF(UEF, firstHourRating.designation, HPWH::tier4))
         << "Could not make generic model.";
 
     { // verify UEF
@@ -109,6 +111,7 @@ TEST_F(MeasureMetricsTest, MakeGenericTier4_UEF)
                                                        firstHourRating.designation))
             << "Could not complete complete 24-hr test.";
         EXPECT_NEAR(testSummary.EF, UEF, 1.e-12) << "Did not measure expected UEF";
+        EXPECT_EQ(fitSummary.EF, testSummary.EF) << "Reported UEF is not that of the model";
     }
 }
 
@@ -153,3 +156,243 @@ TEST_F(MeasureMetricsTest, MakeGenericTier4_E50_UEF_E95)
         EXPECT_NEAR(testSummary.EF, E95, 1.e-12) << "Did not measure expected E95";
     }
 }
+
+/*
+ * make E50, UEF, and E95 jointly where each configuration lies between performance temperatures,
+ * so that each varied coefficient affects two metrics
+ */
+TEST_F(MeasureMetricsTest, MakeGenericCoupled_E50_UEF_E95)
+{
+    HPWH hpwh;
+    hpwh.initPreset("Rheem2020Prem50");
+    const HPWH::PerformancePolySet perfPolySet({{45., {129.9, 2.14, 0.0}, {6.39, -0.0310, 0.0}},
+                                                {65., {118.1, 2.43, 0.0}, {8.56, -0.0428, 0.0}},
+                                                {90., {103.3, 2.79, 0.0}, {11.28, -0.0576, 0.0}},
+                                                {105., {94.5, 3.01, 0.0}, {12.91, -0.0665, 0.0}}});
+    hpwh.makeCondenserPerformance(perfPolySet);
+    firstHourRating = hpwh.getFirstHourRating();
+
+    constexpr double E50 = 3.5;
+    constexpr double UEF = 4.1;
+    constexpr double E95 = 4.8;
+    EXPECT_NO_THROW(
+        hpwh.makeGenericE50_UEF_E95(E50, UEF, E95, firstHourRating.designation, perfPolySet))
+        << "Could not make generic model.";
+
+    auto results = hpwh.measureAll(firstHourRating.designation);
+    ASSERT_EQ(results.tests.size(), 3u);
+    EXPECT_NEAR(results.tests[0].testSummary.EF, E50, 1.e-10) << "Did not measure expected E50";
+    EXPECT_NEAR(results.tests[1].testSummary.EF, UEF, 1.e-10) << "Did not measure expected UEF";
+    EXPECT_NEAR(results.tests[2].testSummary.EF, E95, 1.e-10) << "Did not measure expected E95";
+}
+
+/*
+ * two-parameter fit is independent of thread count
+ */
+TEST_F(MeasureMetricsTest, FitThreadCountIndependent)
+{
+    HPWH hpwh;
+    hpwh.initPreset("Rheem2020Prem50");
+    hpwh.makeCondenserPerformance(HPWH::tier4);
+    firstHourRating = hpwh.findFirstHourRating();
+
+    constexpr double UEF = 4.3;
+    std::vector<std::vector<double>> fittedCoeffs;
+    for (unsigned nThreads : {1u, 0u})
+    {
+        HPWH::PerformancePolySet perfPolySet = HPWH::tier4;
+        hpwh.getCompressor()->evaluatePerformance = perfPolySet.use();
+        int i_ambientT = perfPolySet.getAmbientT_index(HPWH::testConfiguration_UEF.ambientT_C);
+
+        auto metric = std::make_shared<HPWH::Fitter::EF_Metric>(UEF,
+                                                                HPWH::testConfiguration_UEF,
+                                                                firstHourRating.designation,
+                                                                hpwh.get_courier(),
+                                                                &hpwh);
+        std::vector<std::shared_ptr<HPWH::Fitter::Parameter>> parameters = {
+            std::make_shared<HPWH::Fitter::COP_Coefficient>(
+                i_ambientT, 0, hpwh.get_courier(), &perfPolySet),
+            std::make_shared<HPWH::Fitter::COP_Coefficient>(
+                i_ambientT, 1, hpwh.get_courier(), &perfPolySet)};
+
+        HPWH::Fitter fitter({metric}, parameters, hpwh.get_courier(), nThreads);
+        EXPECT_NO_THROW(fitter.fit()) << "Could not fit.";
+        EXPECT_NEAR(metric->getTestSummary().EF, UEF, 1.e-6);
+        fittedCoeffs.push_back(perfPolySet[i_ambientT].COP_coeffs);
+
+        hpwh.getCompressor()->evaluatePerformance = perfPolySet.make();
+    }
+    EXPECT_EQ(fittedCoeffs[0], fittedCoeffs[1]);
+}
+
+/*
+ * cached first-hour rating and prepared state
+ */
+TEST_F(MeasureMetricsTest, CachedFirstHourRating)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+    auto key = hpwh.getTestParameterKey();
+
+    HPWH::clearFirstHourRatingCache();
+    auto cachedRating = hpwh.getFirstHourRating();
+    EXPECT_EQ(hpwh.getTestParameterKey(), key) << "Model changed by getFirstHourRating.";
+    EXPECT_EQ(cachedRating.designation, HPWH::FirstHourRating::Designation::Low);
+    EXPECT_NEAR(cachedRating.drawVolume_L, 188.0302, 1.e-4);
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nMisses, 1u);
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nHits, 0u);
+
+    // the same model, or a copy, is found in the cache
+    EXPECT_EQ(hpwh.getFirstHourRating().drawVolume_L, cachedRating.drawVolume_L);
+    EXPECT_EQ(hpwh.clone()->getFirstHourRating().drawVolume_L, cachedRating.drawVolume_L);
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nMisses, 1u);
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nHits, 2u);
+
+    // a changed setpoint is not
+    auto changed = hpwh.clone();
+    changed->setSetpoint(F_TO_C(135.));
+    EXPECT_NE(changed->getTestParameterKey(), key);
+    changed->getFirstHourRating();
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nMisses, 2u);
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nHits, 2u);
+
+    // nor is a changed tank state
+    auto drawn = hpwh.clone();
+    drawn->runOneStep(F_TO_C(58.), GAL_TO_L(10.), F_TO_C(67.5), F_TO_C(67.5), HPWH::DR_ALLOW);
+    EXPECT_NE(drawn->getTestParameterKey(), key);
+    drawn->getFirstHourRating();
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nMisses, 3u);
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nHits, 2u);
+
+    HPWH::clearFirstHourRatingCache();
+    EXPECT_EQ(HPWH::getFirstHourRatingCacheCounts().nMisses, 0u);
+
+    // a change in performance changes the key
+    HPWH::PerformancePolySet perfPolySet = HPWH::tier4;
+    hpwh.getCompressor()->evaluatePerformance = perfPolySet.use();
+    auto tier4Key = hpwh.getTestParameterKey();
+    EXPECT_NE(tier4Key, key);
+    perfPolySet[1].COP_coeffs[0] += 0.01;
+    EXPECT_NE(hpwh.getTestParameterKey(), tier4Key);
+}
+
+TEST_F(MeasureMetricsTest, PreparedState)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+    firstHourRating = hpwh.getFirstHourRating();
+
+    auto preparedState = hpwh.getPreparedState(HPWH::testConfiguration_UEF);
+    auto fromPrepared = hpwh.clone()->run24hrTest(
+        HPWH::testConfiguration_UEF, firstHourRating.designation, preparedState);
+    auto fromStart =
+        hpwh.clone()->run24hrTest(HPWH::testConfiguration_UEF, firstHourRating.designation);
+    EXPECT_NEAR_REL_TOL(fromPrepared.EF, fromStart.EF, 1.e-9);
+}
+
+/*
+ * compare the EF gradient with respect to COP and input-power coefficients to central differences
+ */
+static void checkEF_Gradient(const std::string& modelName)
+{
+    HPWH hpwh;
+    hpwh.initPreset(modelName);
+    hpwh.makeCondenserPerformance(HPWH::tier4);
+    auto designation = hpwh.getFirstHourRating().designation;
+
+    HPWH::PerformancePolySet perfPolySet = HPWH::tier4;
+    hpwh.getCompressor()->evaluatePerformance = perfPolySet.use();
+    unsigned i_ambientT = perfPolySet.getAmbientT_index(HPWH::testConfiguration_UEF.ambientT_C);
+    std::vector<HPWH::PerformancePolySet::CoefficientIndex> coefficients = {
+        {i_ambientT, 0}, {i_ambientT, 1}, {i_ambientT, 0, true}, {i_ambientT, 1, true}};
+
+    auto testSummary = hpwh.clone()->run24hrTest(
+        HPWH::testConfiguration_UEF, designation, perfPolySet, coefficients);
+    ASSERT_EQ(testSummary.EF_gradient.size(), coefficients.size()) << modelName;
+    EXPECT_GT(testSummary.EF_gradient[0], 0.) << modelName;
+
+    for (std::size_t i = 0; i < coefficients.size(); ++i)
+    {
+        auto& coefficient = coefficients[i];
+        auto& perfPoly = perfPolySet[i_ambientT];
+        auto& coeff = coefficient.ofInputPower ? perfPoly.inputPower_coeffs[coefficient.exponent]
+                                               : perfPoly.COP_coeffs[coefficient.exponent];
+
+        // small enough that no control decision changes
+        const double dCoeff = (coefficient.ofInputPower ? 1.e-3 : 1.e-5) *
+                              std::pow(100., -static_cast<double>(coefficient.exponent));
+        coeff += dCoeff;
+        double EF_plus = hpwh.clone()->run24hrTest(HPWH::testConfiguration_UEF, designation).EF;
+        coeff -= 2. * dCoeff;
+        double EF_minus = hpwh.clone()->run24hrTest(HPWH::testConfiguration_UEF, designation).EF;
+        coeff += dCoeff;
+        EXPECT_NEAR_REL_TOL(testSummary.EF_gradient[i], (EF_plus - EF_minus) / (2. * dCoeff), 1.e-3)
+            << modelName << ", coefficient " << i;
+    }
+}
+
+/*
+ * EF gradient with respect to performance coefficients
+ */
+TEST_F(MeasureMetricsTest, EF_Gradient) { checkEF_Gradient("Rheem2020Prem50"); }
+
+/*
+ * EF gradient of external single-pass and multipass models
+ */
+TEST_F(MeasureMetricsTest, EF_GradientExternal)
+{
+    for (const std::string modelName : {"Sanco83", "NyleC60A_MP"})
+    {
+        checkEF_Gradient(modelName);
+    }
+}
+
+/*
+ * all standard configurations at once
+ */
+TEST_F(MeasureMetricsTest, MeasureAll)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+
+    auto results = hpwh.measureAll();
+    EXPECT_TRUE(results.hasFirstHourRating);
+    EXPECT_EQ(results.firstHourRating.designation, HPWH::FirstHourRating::Designation::Low);
+    ASSERT_EQ(results.tests.size(), 3u);
+    for (auto& test : results.tests)
+    {
+        auto testSummary =
+            hpwh.clone()->run24hrTest(test.testConfiguration, results.firstHourRating.designation);
+        EXPECT_EQ(test.testSummary.EF, testSummary.EF) << test.name;
+    }
+    EXPECT_NEAR(results.tests[1].testSummary.EF, 4.0834, 1.e-4);
+
+    auto j_results = results.report();
+    EXPECT_TRUE(j_results.contains("first_hour_rating"));
+    EXPECT_EQ(j_results["24_hr_tests"].size(), 3u);
+}
+
+/*
+ * all configurations at once give the results of separate measurements, as by `hpwh measure`
+ */
+TEST_F(MeasureMetricsTest, MeasureAllMatchesSeparate)
+{
+    HPWH hpwh;
+    hpwh.initPreset("Rheem2020Prem50");
+    auto results = hpwh.measureAll();
+    ASSERT_EQ(results.tests.size(), 3u);
+
+    for (auto& test : results.tests)
+    {
+        HPWH separate;
+        separate.initPreset("Rheem2020Prem50");
+        auto separateRating = separate.getFirstHourRating();
+        EXPECT_EQ(separateRating.designation, results.firstHourRating.designation) << test.name;
+        EXPECT_EQ(separateRating.drawVolume_L, results.firstHourRating.drawVolume_L) << test.name;
+
+        auto testSummary = separate.run24hrTest(test.testConfiguration, separateRating.designation);
+        EXPECT_EQ(testSummary.EF, test.testSummary.EF) << test.name;
+        EXPECT_EQ(testSummary.consumedHeatingEnergy_kJ, test.testSummary.consumedHeatingEnergy_kJ)
+            << test.name;
+    }
+}
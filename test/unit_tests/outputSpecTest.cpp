@@ -0,0 +1,159 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHCSVSink.hh"
+#include "HPWHOutputSpec.hh"
+#include "unit-test.hh"
+
+#include <sstream>
+
+namespace
+{
+std::vector<std::string> split(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ','))
+        fields.push_back(field);
+    return fields;
+}
+} // namespace
+
+TEST(OutputSpecTest, fromJSON)
+{
+    HPWH::OutputSpec spec;
+    spec.from({{"interval_min", 15},
+               {"columns",
+                {{{"name", "h_src2Out"}, {"aggregation", "sum"}},
+                 {{"name", "toutlet"}, {"aggregation", "volume_weighted_mean"}, {"label", "T"}},
+                 {{"name", "tcouple6"}, {"aggregation", "min"}}}}});
+    EXPECT_EQ(spec.interval_min, 15);
+    ASSERT_EQ(spec.columns.size(), 3u);
+    EXPECT_EQ(spec.columns[0].quantity, HPWH::OutputSpec::Quantity::heatSourceOut);
+    EXPECT_EQ(spec.columns[0].index, 1);
+    EXPECT_EQ(spec.columns[0].label, "h_src2Out sum");
+    EXPECT_EQ(spec.columns[1].aggregation, HPWH::OutputSpec::Aggregation::volumeWeightedMean);
+    EXPECT_EQ(spec.columns[1].label, "T");
+    EXPECT_EQ(spec.columns[2].quantity, HPWH::OutputSpec::Quantity::tcouple);
+    EXPECT_EQ(spec.columns[2].index, 5);
+
+    EXPECT_ANY_THROW(spec.addColumn("tcouple7", HPWH::OutputSpec::Aggregation::min));
+    EXPECT_ANY_THROW(spec.addColumn("h_src0In", HPWH::OutputSpec::Aggregation::sum));
+    EXPECT_ANY_THROW(spec.getAggregation("median"));
+    EXPECT_ANY_THROW(spec.from({{"interval_min", 0}, {"columns", {}}}));
+}
+
+/*
+ * hourly sums match the per-minute values, accumulated after the run
+ */
+TEST(OutputSpecTest, hourlySums)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+
+    HPWH::OutputSpec spec;
+    spec.interval_min = 60;
+    spec.addColumn("h_src1In", HPWH::OutputSpec::Aggregation::sum);
+    spec.addColumn("draw", HPWH::OutputSpec::Aggregation::sum);
+    spec.addColumn("toutlet", HPWH::OutputSpec::Aggregation::volumeWeightedMean);
+
+    std::ostringstream out;
+    HPWH::CSVSink sink(out);
+    HPWH::OutputSpec::Recorder recorder(spec, hpwh, sink);
+    recorder.writeHeading();
+
+    const double inletT_C = F_TO_C(50.);
+    const double ambientT_C = F_TO_C(67.5);
+    std::vector<double> energyInput_Wh(3, 0.), drawVolume_gal(3, 0.);
+    for (int i = 0; i < 150; ++i)
+    {
+        double drawVolume_L = (i % 30 < 5) ? GAL_TO_L(1.5) : 0.;
+        hpwh.runOneStep(inletT_C, drawVolume_L, ambientT_C, ambientT_C, HPWH::DR_ALLOW);
+
+        HPWH::TestData testData;
+        testData.time_min = i;
+        testData.drawVolume_L = drawVolume_L;
+        testData.outletT_C = hpwh.getOutletTemp();
+        for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+        {
+            testData.h_srcIn_kWh.push_back(hpwh.getNthHeatSourceEnergyInput(iHS));
+            testData.h_srcOut_kWh.push_back(hpwh.getNthHeatSourceEnergyOutput(iHS));
+        }
+        recorder.add(testData);
+
+        energyInput_Wh[i / 60] += testData.h_srcIn_kWh[0] * 1000.;
+        drawVolume_gal[i / 60] += L_TO_GAL(drawVolume_L);
+    }
+    recorder.finish();
+    sink.close();
+
+    std::istringstream lines(out.str());
+    std::string line;
+    std::getline(lines, line);
+    EXPECT_EQ(line, "minutes,h_src1In sum,draw sum,toutlet volume_weighted_mean");
+
+    // two full hours, and the last half hour
+    for (int iRow = 0; iRow < 3; ++iRow)
+    {
+        ASSERT_TRUE(std::getline(lines, line));
+        auto fields = split(line);
+        ASSERT_EQ(fields.size(), 4u);
+        EXPECT_EQ(std::stod(fields[0]), 60. * iRow);
+        EXPECT_NEAR(std::stod(fields[1]), energyInput_Wh[iRow], 1.e-5);
+        EXPECT_NEAR(std::stod(fields[2]), drawVolume_gal[iRow], 1.e-5);
+        EXPECT_GT(std::stod(fields[3]), inletT_C);
+    }
+    EXPECT_FALSE(std::getline(lines, line));
+}
+
+/*
+ * outlet and inlet temperatures are aggregated only over minutes with a draw
+ */
+TEST(OutputSpecTest, drawMinutesOnly)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+
+    HPWH::OutputSpec spec;
+    spec.interval_min = 10;
+    spec.addColumn("toutlet", HPWH::OutputSpec::Aggregation::mean);
+    spec.addColumn("toutlet", HPWH::OutputSpec::Aggregation::min);
+    spec.addColumn("toutlet", HPWH::OutputSpec::Aggregation::max);
+    spec.addColumn("inletT", HPWH::OutputSpec::Aggregation::mean);
+
+    std::ostringstream out;
+    HPWH::CSVSink sink(out);
+    HPWH::OutputSpec::Recorder recorder(spec, hpwh, sink);
+
+    // draws at minutes 2 to 4 only; idle minutes hold a stale outlet temperature
+    for (int i = 0; i < 20; ++i)
+    {
+        HPWH::TestData testData;
+        testData.time_min = i;
+        bool hasDraw = (i >= 2) && (i < 5);
+        testData.drawVolume_L = hasDraw ? 1. : 0.;
+        testData.outletT_C = hasDraw ? 40. + i : 10.;
+        testData.inletT_C = hasDraw ? 15. : 0.;
+        recorder.add(testData);
+    }
+    recorder.finish();
+    sink.close();
+
+    std::istringstream lines(out.str());
+    std::string line;
+    ASSERT_TRUE(std::getline(lines, line));
+    auto fields = split(line);
+    ASSERT_EQ(fields.size(), 5u);
+    EXPECT_NEAR(std::stod(fields[1]), 43., 1.e-6);
+    EXPECT_NEAR(std::stod(fields[2]), 42., 1.e-6);
+    EXPECT_NEAR(std::stod(fields[3]), 44., 1.e-6);
+    EXPECT_NEAR(std::stod(fields[4]), 15., 1.e-6);
+
+    // no draw in the second interval
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_EQ(line, "10,,,,");
+    EXPECT_FALSE(std::getline(lines, line));
+}
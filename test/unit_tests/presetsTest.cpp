@@ -0,0 +1,77 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "unit-test.hh"
+
+#include <fstream>
+
+/*
+ * preset lookup tests
+ */
+TEST(PresetsTest, lookupByNameAndNumber)
+{
+    for (auto& model : hpwh_presets::models)
+    {
+        hpwh_presets::MODELS number;
+        EXPECT_TRUE(HPWH::getPresetNumberFromName(model.name, number)) << model.name;
+        EXPECT_EQ(number, model.model());
+
+        std::string name;
+        EXPECT_TRUE(HPWH::getPresetNameFromNumber(name, model.model())) << model.id;
+        EXPECT_EQ(name, model.name);
+    }
+
+    hpwh_presets::MODELS number;
+    EXPECT_FALSE(HPWH::getPresetNumberFromName("", number));
+    EXPECT_FALSE(HPWH::getPresetNumberFromName("Sanco", number));
+    EXPECT_FALSE(HPWH::getPresetNumberFromName("zzz", number));
+
+    std::string name;
+    EXPECT_FALSE(HPWH::getPresetNameFromNumber(name, hpwh_presets::MODELS::unknown));
+    EXPECT_FALSE(HPWH::getPresetNameFromNumber(name, static_cast<hpwh_presets::MODELS>(100000)));
+}
+
+/*
+ * every preset, in catalog order, as used by `hpwh convert` and `hpwh measure --all-presets`
+ */
+TEST(PresetsTest, initAllPresets)
+{
+    auto hpwhs = HPWH::initAllPresets();
+    ASSERT_EQ(hpwhs.size(), hpwh_presets::models.size());
+    std::size_t iModel = 0;
+    for (auto& model : hpwh_presets::models)
+    {
+        EXPECT_EQ(hpwhs[iModel]->name, model.name);
+        EXPECT_EQ(hpwhs[iModel]->model, model.model());
+        ++iModel;
+    }
+}
+
+/*
+ * each preset's input, compiled or decoded from CBOR, is that read from its JSON model
+ */
+TEST(PresetsTest, inputMatchesModelJSON)
+{
+    hpwh_data_model::init(std::make_shared<HPWH::DefaultCourier>());
+    for (auto& model : hpwh_presets::models)
+    {
+        hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi;
+        if (model.build)
+            model.build(hsi);
+        else
+            hpwh_data_model::hpwh_sim_input::from_json(
+                nlohmann::json::from_cbor(model.cbor_data, model.cbor_data + model.size), hsi);
+
+        std::ifstream inputFile(fmt::format("{}/{}.json", HPWH_MODELS_JSON_DIR, model.name));
+        ASSERT_TRUE(inputFile.is_open()) << model.name;
+        hpwh_data_model::hpwh_sim_input::HPWHSimInput hsi_json;
+        hpwh_data_model::hpwh_sim_input::from_json(nlohmann::json::parse(inputFile), hsi_json);
+
+        nlohmann::json j, j_json;
+        hpwh_data_model::hpwh_sim_input::to_json(j, hsi);
+        hpwh_data_model::hpwh_sim_input::to_json(j_json, hsi_json);
+        EXPECT_EQ(j, j_json) << model.name;
+    }
+}
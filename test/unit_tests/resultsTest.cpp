@@ -0,0 +1,81 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHResults.hh"
+#include "unit-test.hh"
+
+#include <cmath>
+#include <filesystem>
+
+/*
+ * per-minute results read back from the binary columnar format match those written
+ */
+TEST(ResultsTest, roundTrip)
+{
+    HPWH hpwh;
+    hpwh.initPreset("AOSmithHPTS50");
+
+    auto filepath = (std::filesystem::temp_directory_path() / "resultsTest.hpwhr").string();
+    std::vector<HPWH::TestData> testDataSet;
+    {
+        // several blocks, the last one partial
+        HPWH::ResultsWriter writer(filepath, 50);
+        hpwh.writeResultsHeading(writer);
+
+        const double inletT_C = F_TO_C(50.);
+        const double ambientT_C = F_TO_C(67.5);
+        for (int i = 0; i < 120; ++i)
+        {
+            double drawVolume_L = (i % 30 < 5) ? GAL_TO_L(1.5) : 0.;
+            hpwh.runOneStep(inletT_C, drawVolume_L, ambientT_C, ambientT_C, HPWH::DR_ALLOW);
+
+            HPWH::TestData testData;
+            testData.time_min = i;
+            testData.ambientT_C = ambientT_C;
+            testData.setpointT_C = hpwh.getSetpoint();
+            testData.inletT_C = inletT_C;
+            testData.drawVolume_L = drawVolume_L;
+            testData.outletT_C = hpwh.getOutletTemp();
+            for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++)
+            {
+                testData.h_srcIn_kWh.push_back(hpwh.getNthHeatSourceEnergyInput(iHS));
+                testData.h_srcOut_kWh.push_back(hpwh.getNthHeatSourceEnergyOutput(iHS));
+            }
+            for (int iTC = 0; iTC < HPWH::TestData::nTCouples; iTC++)
+                testData.thermocoupleT_C.push_back(
+                    hpwh.getNthSimTcouple(iTC + 1, HPWH::TestData::nTCouples, HPWH::UNITS_C));
+            hpwh.writeResultsRow(writer, testData);
+            testDataSet.push_back(testData);
+        }
+        writer.close();
+    }
+
+    HPWH::ResultsReader reader(filepath);
+    EXPECT_EQ(reader.getNumRows(), 120u);
+    EXPECT_EQ(reader.getColumns().front().name, "minutes");
+    EXPECT_EQ(reader.getColumns().back().name, "toutlet (C)");
+
+    auto minutes = reader.getColumn("minutes");
+    auto energyInput_Wh = reader.getColumn("h_src1In (Wh)");
+    auto drStatus = reader.getColumn("DRstatus");
+    auto outletTs_C = reader.getColumn("toutlet (C)");
+    ASSERT_EQ(outletTs_C.size(), 120u);
+    for (std::size_t i = 0; i < testDataSet.size(); ++i)
+    {
+        auto& testData = testDataSet[i];
+        EXPECT_EQ(minutes[i], testData.time_min);
+        EXPECT_EQ(energyInput_Wh[i], testData.h_srcIn_kWh[0] * 1000.);
+        EXPECT_EQ(drStatus[i], HPWH::DR_ALLOW);
+
+        // as in the CSV output, the outlet temperature is missing without a draw
+        if (testData.drawVolume_L > 0.)
+            EXPECT_EQ(outletTs_C[i], testData.outletT_C);
+        else
+            EXPECT_TRUE(std::isnan(outletTs_C[i]));
+    }
+
+    EXPECT_ANY_THROW(reader.getColumn("no such column"));
+    std::filesystem::remove(filepath);
+}
@@ -0,0 +1,132 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHSchedule.hh"
+#include "unit-test.hh"
+
+#include <filesystem>
+#include <fstream>
+
+TEST(SparseScheduleTest, minuteEntries)
+{
+    HPWH::SparseSchedule schedule;
+    schedule.parse("default 0,\nminutes,flow_out_gal\n1,2\n2,2.5\n\n10,+1e-1\n,\n,\n", 20);
+    EXPECT_EQ(schedule.getNumRuns(), 6u);
+
+    auto values = schedule.expand();
+    ASSERT_EQ(values.size(), 20u);
+    auto cursor = schedule.getCursor();
+    for (long i = 0; i < 20; ++i)
+    {
+        double expected = (i == 1) ? 2. : (i == 2) ? 2.5 : (i == 10) ? 0.1 : 0.;
+        EXPECT_EQ(values[i], expected);
+        EXPECT_EQ(schedule[i], expected);
+        EXPECT_EQ(cursor(i), expected);
+    }
+
+    // stepping back repositions the cursor
+    EXPECT_EQ(cursor(2), 2.5);
+    EXPECT_EQ(cursor(10), 0.1);
+}
+
+TEST(SparseScheduleTest, hourEntriesOutOfOrder)
+{
+    HPWH::SparseSchedule schedule;
+    schedule.parse("default 20\r\nhours,T\r\n2,25\r\n0,15\r\n2,30\r\n", 4 * 60);
+    EXPECT_EQ(schedule.getNumRuns(), 4u);
+
+    auto cursor = schedule.getCursor();
+    for (long i = 0; i < 4 * 60; ++i)
+    {
+        double expected = (i < 60) ? 15. : (i < 120) ? 20. : (i < 180) ? 30. : 20.;
+        EXPECT_EQ(schedule[i], expected);
+        EXPECT_EQ(cursor(i), expected);
+    }
+}
+
+TEST(SparseScheduleTest, noEntries)
+{
+    HPWH::SparseSchedule schedule;
+    schedule.parse("default 51.7\n", 1440);
+    EXPECT_EQ(schedule.getNumRuns(), 1u);
+    EXPECT_EQ(schedule[1439], 51.7);
+}
+
+TEST(SparseScheduleTest, errors)
+{
+    HPWH::SparseSchedule schedule;
+    EXPECT_ANY_THROW(schedule.parse("", 10));
+    EXPECT_ANY_THROW(schedule.parse("minutes,flow\n1,2\n", 10));
+    EXPECT_ANY_THROW(schedule.parse("default 0\nminutes,flow\n1 2\n", 10));
+    EXPECT_ANY_THROW(schedule.parse("default 0\nminutes,flow\n1,x\n", 10));
+    EXPECT_ANY_THROW(schedule.parse("default 0\nminutes,flow\n10,1\n", 10));
+    EXPECT_ANY_THROW(schedule.parse("default 0\nhours,flow\n1,1\n", 60));
+    EXPECT_ANY_THROW(schedule.read("no_such_directory/drawschedule.csv", 10));
+}
+
+TEST(ScheduleStreamTest, matchesSparse)
+{
+    const std::string text = "default 1.5\nminutes,flow\n3,2\n3,2.5\n1,4\n\n,\n8,+1e-1\n12,7";
+    auto filepath = (std::filesystem::temp_directory_path() / "scheduleStreamTest.csv").string();
+    {
+        std::ofstream file(filepath, std::ios::binary);
+        file << text;
+    }
+
+    HPWH::SparseSchedule schedule;
+    schedule.parse(text, 20);
+    for (std::size_t chunkSize : {std::size_t(1), std::size_t(5), std::size_t(1024)})
+    {
+        // chunks smaller than a line split every entry
+        HPWH::ScheduleStream scheduleStream;
+        scheduleStream.open(filepath, 20, chunkSize);
+        for (long i = 0; i < 20; ++i)
+        {
+            EXPECT_EQ(scheduleStream(i), schedule[i]);
+            EXPECT_EQ(scheduleStream(i), schedule[i]);
+        }
+        EXPECT_ANY_THROW(scheduleStream(3));
+    }
+
+    // entries are checked as they are read ahead
+    HPWH::ScheduleStream scheduleStream;
+    scheduleStream.open(filepath, 10);
+    EXPECT_ANY_THROW(scheduleStream(0));
+    std::filesystem::remove(filepath);
+    EXPECT_ANY_THROW(scheduleStream.open(filepath, 20));
+}
+
+TEST(ScheduleSetTest, packedRoundTrip)
+{
+    HPWH::SparseSchedule draw, inletT;
+    draw.parse("default 0\nminutes,flow\n1,2\n2,2\n3,2\n5,1.573593645\n", 1440);
+    inletT.parse("default 10.5\nhours,T\n3,12.25\n", 1440);
+    EXPECT_EQ(draw.getNumRuns(), 5u);
+
+    HPWH::ScheduleSet scheduleSet;
+    scheduleSet.info = "length_of_test 1440\nsetpoint 52\n";
+    scheduleSet.add("draw", draw);
+    scheduleSet.add("inletT", inletT);
+
+    auto filepath = (std::filesystem::temp_directory_path() / "scheduleSetTest.hpwhs").string();
+    scheduleSet.write(filepath);
+    EXPECT_TRUE(HPWH::ScheduleSet::isPacked(filepath));
+
+    HPWH::ScheduleSet packed;
+    packed.read(filepath);
+    EXPECT_EQ(packed.getLength_min(), 1440);
+    EXPECT_EQ(packed.info, scheduleSet.info);
+    ASSERT_TRUE(packed.has("draw") && packed.has("inletT"));
+    EXPECT_FALSE(packed.has("DR"));
+
+    // values exact in single precision are stored that way
+    EXPECT_FALSE(packed.get("draw").isSinglePrecision());
+    EXPECT_TRUE(packed.get("inletT").isSinglePrecision());
+    EXPECT_EQ(packed.get("draw").expand(), draw.expand());
+    EXPECT_EQ(packed.get("inletT").expand(), inletT.expand());
+
+    std::filesystem::remove(filepath);
+    EXPECT_FALSE(HPWH::ScheduleSet::isPacked(filepath));
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "serve.hh"
+#include "unit-test.hh"
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace hpwh_cli;
+
+/*
+ * a slow make does not block other keys; a failed make is not kept
+ */
+TEST(ServeTest, cacheMakesOutsideLock)
+{
+    LRUCache<int> cache(4);
+    std::promise<void> started, released;
+    bool wasReleased = false;
+    std::thread slow(
+        [&]()
+        {
+            cache.get("slow",
+                      [&]()
+                      {
+                          started.set_value();
+                          auto status = released.get_future().wait_for(std::chrono::seconds(5));
+                          wasReleased = (status == std::future_status::ready);
+                          return 1;
+                      });
+        });
+    started.get_future().wait();
+    EXPECT_EQ(cache.get("fast", []() { return 2; }), 2);
+    released.set_value();
+    slow.join();
+    EXPECT_TRUE(wasReleased);
+    EXPECT_EQ(cache.get("slow", []() { return 0; }), 1);
+
+    EXPECT_ANY_THROW(cache.get("bad", []() -> int { throw std::runtime_error("bad"); }));
+    EXPECT_EQ(cache.get("bad", []() { return 3; }), 3);
+
+    auto j_report = cache.report();
+    EXPECT_EQ(j_report["hits"], 1);
+    EXPECT_EQ(j_report["misses"], 4);
+}
+
+/*
+ * replies to NDJSON requests, by id
+ */
+TEST(ServeTest, requests)
+{
+    std::ostringstream out;
+    {
+        Server server(4, 2);
+        auto sink = std::make_shared<StreamSink>(out);
+
+        nlohmann::json j_schedule = {{"inletT_C", std::vector<double>(120, F_TO_C(50.))},
+                                     {"drawVolume_L", std::vector<double>(120, 0.5)},
+                                     {"ambientT_C", std::vector<double>(120, F_TO_C(67.5))},
+                                     {"externalT_C", std::vector<double>(120, F_TO_C(67.5))}};
+        nlohmann::json j_run = {
+            {"id", 1}, {"cmd", "run"}, {"model", "AOSmithHPTS50"}, {"schedule", j_schedule}};
+        server.submit(j_run.dump(), sink);
+        server.submit(R"({"id": 2, "cmd": "perfmap", "model": "restankRealistic"})", sink);
+        server.submit(R"({"id": 3, "cmd": "fly"})", sink);
+        server.submit(R"({"id": 4, "cmd": )", sink);
+        server.submit("  ", sink);
+        server.wait();
+        server.submit(R"({"id": 5, "cmd": "status"})", sink);
+        server.wait();
+    }
+
+    std::map<int, nlohmann::json> replies;
+    std::vector<nlohmann::json> unnumbered;
+    std::istringstream lines(out.str());
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        auto j_reply = nlohmann::json::parse(line);
+        if (j_reply.contains("id"))
+            replies[j_reply["id"].get<int>()] = j_reply;
+        else
+            unnumbered.push_back(j_reply);
+    }
+    ASSERT_EQ(replies.size(), 4u);
+
+    EXPECT_EQ(replies[1]["cmd"], "run");
+    EXPECT_EQ(replies[1]["model"], "AOSmithHPTS50");
+    EXPECT_GT(replies[1]["energy_input_kWh"].get<double>(), 0.);
+    EXPECT_NEAR(replies[1]["draw_volume_L"].get<double>(), 60., 1.e-6);
+
+    EXPECT_TRUE(replies[2].contains("error")); // no compressor
+    EXPECT_TRUE(replies[3].contains("error")); // unknown command
+
+    // the malformed request cannot be tagged; the blank line has no reply
+    ASSERT_EQ(unnumbered.size(), 1u);
+    EXPECT_TRUE(unnumbered[0].contains("error"));
+
+    EXPECT_EQ(replies[5]["models"]["misses"], 2);
+    EXPECT_EQ(replies[5]["threads"], 2);
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHSweep.hh"
+#include "unit-test.hh"
+
+struct SweepTest : public testing::Test
+{
+    std::shared_ptr<const HPWH::ModelSpec> spec;
+    std::shared_ptr<HPWH::Fleet::Schedule> schedule;
+    const long minutesToRun = 24 * 60;
+    const double minOutletT_C = F_TO_C(110.);
+    HPWH::Sweep::Axes axes;
+
+    void SetUp() override
+    {
+        spec = HPWH::ModelSpec::fromPreset("TamScalable_SP");
+        double tankVolume_L = spec->getPrototype().getTankSize(HPWH::UNITS_L);
+
+        // a morning peak that draws the nominal tank volume over two hours
+        schedule = std::make_shared<HPWH::Fleet::Schedule>();
+        for (long i = 0; i < minutesToRun; ++i)
+        {
+            bool isPeak = (i >= 7 * 60) && (i < 9 * 60);
+            schedule->inletT_C.push_back(F_TO_C(50.));
+            schedule->drawVolume_L.push_back(isPeak ? tankVolume_L / 120. : 0.);
+            schedule->ambientT_C.push_back(F_TO_C(67.5));
+            schedule->externalT_C.push_back(F_TO_C(67.5));
+        }
+
+        for (double volumeFactor : {0.25, 0.5, 0.75, 1., 1.5, 2., 3.})
+            axes.tankVolumes_L.push_back(volumeFactor * tankVolume_L);
+        axes.capacityScales = {0.5, 1., 2.};
+    }
+};
+
+TEST_F(SweepTest, bisectionMatchesFullGrid)
+{
+    HPWH::Sweep sweep(spec, schedule);
+    auto fullResults = sweep.run(axes, minutesToRun, minOutletT_C, false, 4);
+    auto bisectResults = sweep.run(axes, minutesToRun, minOutletT_C, true, 4);
+
+    EXPECT_EQ(fullResults.gridSize, 21u);
+    EXPECT_EQ(fullResults.evaluations.size(), fullResults.gridSize);
+    EXPECT_LT(bisectResults.evaluations.size(), fullResults.evaluations.size());
+
+    ASSERT_EQ(bisectResults.frontier.size(), fullResults.frontier.size());
+    for (std::size_t i = 0; i < fullResults.frontier.size(); ++i)
+    {
+        EXPECT_EQ(bisectResults.frontier[i].design.tankVolume_L,
+                  fullResults.frontier[i].design.tankVolume_L);
+        EXPECT_EQ(bisectResults.frontier[i].design.capacityScale,
+                  fullResults.frontier[i].design.capacityScale);
+        EXPECT_TRUE(bisectResults.frontier[i].passes);
+    }
+    ASSERT_EQ(bisectResults.hasBest, fullResults.hasBest);
+    if (fullResults.hasBest)
+    {
+        EXPECT_EQ(bisectResults.best.design.tankVolume_L, fullResults.best.design.tankVolume_L);
+        EXPECT_EQ(bisectResults.best.minutesRun, minutesToRun);
+    }
+}
+
+TEST_F(SweepTest, failingDesignStopsEarly)
+{
+    // four times the peak draw, which the smallest tank at half capacity cannot meet
+    auto heavySchedule = std::make_shared<HPWH::Fleet::Schedule>(*schedule);
+    for (auto& drawVolume_L : heavySchedule->drawVolume_L)
+        drawVolume_L *= 4.;
+
+    HPWH::Sweep sweep(spec, heavySchedule);
+    HPWH::Sweep::Design design;
+    design.tankVolume_L = axes.tankVolumes_L.front();
+    design.capacityScale = 0.5;
+
+    auto evaluation = sweep.evaluate(design, minutesToRun, minOutletT_C);
+    EXPECT_FALSE(evaluation.passes);
+    EXPECT_LT(evaluation.minutesRun, minutesToRun);
+    EXPECT_LT(evaluation.minOutletT_C, minOutletT_C);
+}
+
+TEST_F(SweepTest, infeasibleSetpointIsMarked)
+{
+    HPWH::Sweep sweep(spec, schedule);
+    axes.setpoints_C = {F_TO_C(125.), F_TO_C(250.)};
+
+    HPWH::Sweep::Results results;
+    EXPECT_NO_THROW(results = sweep.run(axes, minutesToRun, minOutletT_C));
+    std::size_t nInfeasible = 0;
+    for (auto& evaluation : results.evaluations)
+    {
+        bool isReachable = evaluation.design.setpoint_C < F_TO_C(200.);
+        EXPECT_EQ(evaluation.feasible, isReachable);
+        if (!evaluation.feasible)
+        {
+            EXPECT_FALSE(evaluation.passes);
+            EXPECT_EQ(evaluation.minutesRun, 0);
+            ++nInfeasible;
+        }
+    }
+    EXPECT_GT(nInfeasible, 0u);
+    for (auto& evaluation : results.frontier)
+        EXPECT_EQ(evaluation.design.setpoint_C, F_TO_C(125.));
+    EXPECT_TRUE(results.hasBest);
+}
@@ -0,0 +1,71 @@
+/* Copyright (c) 2023 Big Ladder Software LLC. All rights reserved.
+ * See the LICENSE file for additional terms and conditions. */
+
+// HPWHsim
+#include "HPWH.hh"
+#include "HPWHTimeParallel.hh"
+#include "unit-test.hh"
+
+struct TimeParallelTest : public testing::Test
+{
+    std::shared_ptr<HPWH::Fleet::Schedule> schedule;
+    const long minutesToRun = 3 * 24 * 60;
+    HPWH hpwh;
+
+    void SetUp() override
+    {
+        // morning and evening draws
+        schedule = std::make_shared<HPWH::Fleet::Schedule>();
+        for (long i = 0; i < minutesToRun; ++i)
+        {
+            long minuteOfDay = i % (24 * 60);
+            bool isDrawing = ((minuteOfDay >= 7 * 60) && (minuteOfDay < 7 * 60 + 15)) ||
+                             ((minuteOfDay >= 19 * 60) && (minuteOfDay < 19 * 60 + 10));
+            schedule->inletT_C.push_back(F_TO_C(50.));
+            schedule->drawVolume_L.push_back(isDrawing ? GAL_TO_L(1.5) : 0.);
+            schedule->ambientT_C.push_back(F_TO_C(67.5));
+            schedule->externalT_C.push_back(F_TO_C(67.5));
+        }
+        hpwh.initPreset("AOSmithHPTS50");
+    }
+};
+
+TEST_F(TimeParallelTest, exactWithAllIterations)
+{
+    HPWH::TimeParallel timeParallel(hpwh, schedule);
+    HPWH::TimeParallel::Options options;
+    options.nChunks = 6;
+    options.tolerance_C = 0.;
+    options.nThreads = 3;
+    options.compareToSerial = true;
+
+    auto results = timeParallel.run(minutesToRun, options);
+    EXPECT_TRUE(results.converged);
+    EXPECT_LE(results.nIterations, options.nChunks);
+    ASSERT_TRUE(results.hasSerial);
+    EXPECT_NEAR_REL(results.energyInput_kWh, results.serialEnergyInput_kWh);
+    EXPECT_NEAR_REL(results.energyOutput_kWh, results.serialEnergyOutput_kWh);
+}
+
+TEST_F(TimeParallelTest, convergesWithinTolerance)
+{
+    HPWH::TimeParallel timeParallel(hpwh, schedule);
+    for (double coarseStep_min : {0., 15.})
+    {
+        HPWH::TimeParallel::Options options;
+        options.nChunks = 12;
+        options.coarseStep_min = coarseStep_min;
+        options.tolerance_C = 0.01;
+        options.compareToSerial = true;
+
+        auto results = timeParallel.run(minutesToRun, options);
+        EXPECT_TRUE(results.converged);
+        EXPECT_NEAR_REL_TOL(results.energyInput_kWh, results.serialEnergyInput_kWh, 5.e-3);
+    }
+}
+
+TEST_F(TimeParallelTest, scheduleTooShort)
+{
+    HPWH::TimeParallel timeParallel(hpwh, schedule);
+    EXPECT_ANY_THROW(timeParallel.run(minutesToRun + 1));
+}